@@ -49,7 +49,7 @@ using ::android::hardware::gnss::V1_0::IGnssCallback;
 using ::android::hardware::gnss::V1_0::IGnssNiCallback;
 using ::android::hardware::gnss::V1_0::GnssLocation;
 
-static void convertGnssSvStatus(GnssSvNotification& in, IGnssCallback::GnssSvStatus& out);
+static void convertGnssSvStatus(const GnssSvNotification& in, IGnssCallback::GnssSvStatus& out);
 
 GnssAPIClient::GnssAPIClient(const sp<IGnssCallback>& gpsCb,
     const sp<IGnssNiCallback>& niCb) :
@@ -122,7 +122,7 @@ void GnssAPIClient::gnssUpdateCallbacks(const sp<IGnssCallback>& gpsCb,
 
     locationCallbacks.gnssSvCb = nullptr;
     if (mGnssCbIface != nullptr) {
-        locationCallbacks.gnssSvCb = [this](GnssSvNotification gnssSvNotification) {
+        locationCallbacks.gnssSvCb = [this](const GnssSvNotification& gnssSvNotification) {
             onGnssSvCb(gnssSvNotification);
         };
     }
@@ -530,7 +530,7 @@ void GnssAPIClient::onStopTrackingCb(LocationError error)
     }
 }
 
-static void convertGnssSvStatus(GnssSvNotification& in, IGnssCallback::GnssSvStatus& out)
+static void convertGnssSvStatus(const GnssSvNotification& in, IGnssCallback::GnssSvStatus& out)
 {
     memset(&out, 0, sizeof(IGnssCallback::GnssSvStatus));
     out.numSvs = in.count;
@@ -49,8 +49,8 @@ using ::android::hardware::gnss::V2_0::IGnssCallback;
 using ::android::hardware::gnss::V1_0::IGnssNiCallback;
 using ::android::hardware::gnss::V2_0::GnssLocation;
 
-static void convertGnssSvStatus(GnssSvNotification& in, V1_0::IGnssCallback::GnssSvStatus& out);
-static void convertGnssSvStatus(GnssSvNotification& in,
+static void convertGnssSvStatus(const GnssSvNotification& in, V1_0::IGnssCallback::GnssSvStatus& out);
+static void convertGnssSvStatus(const GnssSvNotification& in,
         hidl_vec<V2_0::IGnssCallback::GnssSvInfo>& out);
 
 GnssAPIClient::GnssAPIClient(const sp<V1_0::IGnssCallback>& gpsCb,
@@ -135,7 +135,7 @@ void GnssAPIClient::setCallbacks()
     }
 
     locationCallbacks.gnssSvCb = nullptr;
-    locationCallbacks.gnssSvCb = [this](GnssSvNotification gnssSvNotification) {
+    locationCallbacks.gnssSvCb = [this](const GnssSvNotification& gnssSvNotification) {
         onGnssSvCb(gnssSvNotification);
     };
 
@@ -669,7 +669,7 @@ void GnssAPIClient::onStopTrackingCb(LocationError error)
     }
 }
 
-static void convertGnssSvStatus(GnssSvNotification& in, V1_0::IGnssCallback::GnssSvStatus& out)
+static void convertGnssSvStatus(const GnssSvNotification& in, V1_0::IGnssCallback::GnssSvStatus& out)
 {
     memset(&out, 0, sizeof(IGnssCallback::GnssSvStatus));
     out.numSvs = in.count;
@@ -697,7 +697,7 @@ static void convertGnssSvStatus(GnssSvNotification& in, V1_0::IGnssCallback::Gns
     }
 }
 
-static void convertGnssSvStatus(GnssSvNotification& in,
+static void convertGnssSvStatus(const GnssSvNotification& in,
         hidl_vec<V2_0::IGnssCallback::GnssSvInfo>& out)
 {
     out.resize(in.count);
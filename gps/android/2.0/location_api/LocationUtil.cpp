@@ -193,7 +193,7 @@ void convertGnssLocation(const V2_0::GnssLocation& in, Location& out)
     convertGnssLocation(in.v1_0, out);
 }
 
-void convertGnssConstellationType(GnssSvType& in, V1_0::GnssConstellationType& out)
+void convertGnssConstellationType(const GnssSvType& in, V1_0::GnssConstellationType& out)
 {
     switch(in) {
         case GNSS_SV_TYPE_GPS:
@@ -221,7 +221,7 @@ void convertGnssConstellationType(GnssSvType& in, V1_0::GnssConstellationType& o
     }
 }
 
-void convertGnssConstellationType(GnssSvType& in, V2_0::GnssConstellationType& out)
+void convertGnssConstellationType(const GnssSvType& in, V2_0::GnssConstellationType& out)
 {
     switch(in) {
         case GNSS_SV_TYPE_GPS:
@@ -29,12 +29,16 @@
 #define LOG_NDEBUG 0
 #define LOG_TAG "LocSvc_BatchingAdapter"
 
+#include <inttypes.h>
 #include <loc_pla.h>
 #include <log_util.h>
 #include <LocContext.h>
 #include <BatchingAdapter.h>
+#include <LocMsgPool.h>
+#include <LocStartupTrace.h>
 
 using namespace loc_core;
+using namespace loc_util;
 
 BatchingAdapter::BatchingAdapter() :
     LocAdapterBase(0,
@@ -50,11 +54,14 @@ BatchingAdapter::BatchingAdapter() :
     mBatchingTimeout(0),
     mBatchingAccuracy(1),
     mBatchSize(0),
-    mTripBatchSize(0)
+    mTripBatchSize(0),
+    mBatchLog(NULL),
+    mBatchLogTask(NULL)
 {
     LOC_LOGD("%s]: Constructor", __func__);
     readConfigCommand();
     setConfigCommand();
+    loc_util::LocStartupTrace::mark("BatchingAdapter constructed");
 }
 
 void
@@ -68,16 +75,19 @@ BatchingAdapter::readConfigCommand()
             LocMsg(),
             mAdapter(adapter) {}
         inline virtual void proc() const {
+            loc_util::LocStartupPhase phase("BatchingAdapter::readConfig");
             uint32_t batchingTimeout = 0;
             uint32_t batchingAccuracy = 0;
             uint32_t batchSize = 0;
             uint32_t tripBatchSize = 0;
+            uint32_t batchLogSize = 0;
             static const loc_param_s_type flp_conf_param_table[] =
             {
                 {"BATCH_SIZE", &batchSize, NULL, 'n'},
                 {"OUTDOOR_TRIP_BATCH_SIZE", &tripBatchSize, NULL, 'n'},
                 {"BATCH_SESSION_TIMEOUT", &batchingTimeout, NULL, 'n'},
                 {"ACCURACY", &batchingAccuracy, NULL, 'n'},
+                {"BATCH_LOG_SIZE", &batchLogSize, NULL, 'n'},
             };
             UTIL_READ_CONF(LOC_PATH_FLP_CONF, flp_conf_param_table);
 
@@ -88,6 +98,7 @@ BatchingAdapter::readConfigCommand()
              mAdapter.setTripBatchSize(tripBatchSize);
              mAdapter.setBatchingTimeout(batchingTimeout);
              mAdapter.setBatchingAccuracy(batchingAccuracy);
+             mAdapter.setBatchLogSize((size_t)batchLogSize * 1024);
         }
     };
 
@@ -95,6 +106,50 @@ BatchingAdapter::readConfigCommand()
 
 }
 
+BatchingAdapter::~BatchingAdapter()
+{
+    // the log task is joined before the log it writes goes away
+    if (NULL != mBatchLogTask) {
+        mBatchLogTask->destroy();
+    }
+    delete mBatchLog;
+}
+
+void
+BatchingAdapter::setBatchLogSize(size_t bytes)
+{
+    struct MsgOpenBatchLog : public LocMsg {
+        BatchingAdapter& mAdapter;
+        size_t mBytes;
+        inline MsgOpenBatchLog(BatchingAdapter& adapter, size_t bytes) :
+            LocMsg(),
+            mAdapter(adapter),
+            mBytes(bytes) {}
+        inline virtual void proc() const {
+            delete mAdapter.mBatchLog;
+            mAdapter.mBatchLog = NULL;
+            if (mBytes > 0) {
+                mAdapter.mBatchLog = new LocBatchLog(LOC_PATH_BATCH_LOG_STR, mBytes);
+                if (!mAdapter.mBatchLog->isOpen()) {
+                    delete mAdapter.mBatchLog;
+                    mAdapter.mBatchLog = NULL;
+                } else {
+                    LOC_LOGD("%s]: %zu locations logged in %zu bytes", __func__,
+                             mAdapter.mBatchLog->count(), mAdapter.mBatchLog->bytes());
+                }
+            }
+        }
+    };
+
+    if (NULL == mBatchLogTask) {
+        if (0 == bytes) {
+            return;
+        }
+        mBatchLogTask = new MsgTask("BatchLogMsgTask");
+    }
+    mBatchLogTask->sendMsg(new MsgOpenBatchLog(*this, bytes));
+}
+
 void
 BatchingAdapter::setConfigCommand()
 {
@@ -575,10 +630,16 @@ BatchingAdapter::getBatchedLocationsCommand(LocationAPI* client, uint32_t id, si
                         mAdapter.reportResponse(mClient, err, mSessionId);
                     }));
                 } else {
+                    // should the modem fail to serve them, e.g. as it restarted
+                    // and lost its buffer, the last locations come from the log
                     mApi.getBatchedLocations(mCount, new LocApiResponse(*mAdapter.getContext(),
                             [&mAdapter = mAdapter, mSessionId = mSessionId,
-                            mClient = mClient] (LocationError err) {
-                        mAdapter.reportResponse(mClient, err, mSessionId);
+                            mClient = mClient, mCount = mCount] (LocationError err) {
+                        if (LOCATION_ERROR_SUCCESS != err && NULL != mAdapter.mBatchLogTask) {
+                            mAdapter.getLoggedLocations(mClient, mSessionId, mCount, err);
+                        } else {
+                            mAdapter.reportResponse(mClient, err, mSessionId);
+                        }
                     }));
                 }
             } else {
@@ -591,44 +652,135 @@ BatchingAdapter::getBatchedLocationsCommand(LocationAPI* client, uint32_t id, si
 }
 
 void
-BatchingAdapter::reportLocationsEvent(const Location* locations, size_t count,
-        BatchingMode batchingMode)
+BatchingAdapter::getLoggedLocations(LocationAPI* client, uint32_t sessionId, size_t count,
+        LocationError err)
 {
-    LOC_LOGD("%s]: count %zu batchMode %d", __func__, count, batchingMode);
+    LOC_LOGD("%s]: client %p id %u count %zu", __func__, client, sessionId, count);
 
-    struct MsgReportLocations : public LocMsg {
+    // back on the adapter's MsgTask, where the client might be gone by now
+    struct MsgReportLoggedLocations : public LocMsg {
         BatchingAdapter& mAdapter;
-        Location* mLocations;
+        LocationAPI* mClient;
+        uint32_t mSessionId;
+        LocationError mErr;
+        std::vector<Location> mLocations;
+        inline MsgReportLoggedLocations(BatchingAdapter& adapter,
+                                        LocationAPI* client,
+                                        uint32_t sessionId,
+                                        LocationError err) :
+            LocMsg(),
+            mAdapter(adapter),
+            mClient(client),
+            mSessionId(sessionId),
+            mErr(err) {}
+        inline virtual void proc() const {
+            LocationError err = mErr;
+            auto it = mAdapter.mClientData.find(mClient);
+            if (!mLocations.empty() && it != mAdapter.mClientData.end() &&
+                    nullptr != it->second.batchingCb) {
+                BatchingOptions batchOptions = {sizeof(BatchingOptions),
+                                                BATCHING_MODE_NO_AUTO_REPORT};
+                it->second.batchingCb(mLocations.size(),
+                                      const_cast<Location*>(mLocations.data()), batchOptions);
+                err = LOCATION_ERROR_SUCCESS;
+            }
+            mAdapter.reportResponse(mClient, err, mSessionId);
+        }
+    };
+
+    struct MsgReadBatchLog : public LocMsg {
+        BatchingAdapter& mAdapter;
+        mutable MsgReportLoggedLocations* mReport;
         size_t mCount;
-        BatchingMode mBatchingMode;
-        inline MsgReportLocations(BatchingAdapter& adapter,
-                                  const Location* locations,
-                                  size_t count,
-                                  BatchingMode batchingMode) :
+        inline MsgReadBatchLog(BatchingAdapter& adapter,
+                               MsgReportLoggedLocations* report,
+                               size_t count) :
             LocMsg(),
             mAdapter(adapter),
-            mLocations(new Location[count]),
-            mCount(count),
-            mBatchingMode(batchingMode)
-        {
-            if (nullptr == mLocations) {
-                LOC_LOGE("%s]: new failed to allocate mLocations", __func__);
-                return;
+            mReport(report),
+            mCount(count) {}
+        inline virtual ~MsgReadBatchLog() {
+            delete mReport;
+        }
+        inline virtual void proc() const {
+            if (NULL != mAdapter.mBatchLog) {
+                mAdapter.mBatchLog->readLast(mCount, mReport->mLocations);
             }
-            for (size_t i=0; i < mCount; ++i) {
-                mLocations[i] = locations[i];
+            mAdapter.sendMsg(mReport);
+            mReport = NULL;
+        }
+    };
+
+    mBatchLogTask->sendMsg(new MsgReadBatchLog(*this,
+            new MsgReportLoggedLocations(*this, client, sessionId, err), count));
+}
+
+void
+BatchingAdapter::logLocations(LocBatch* batch)
+{
+    struct MsgLogLocations : public LocPooledMsg<MsgLogLocations> {
+        BatchingAdapter& mAdapter;
+        LocBatch* mBatch;
+        inline MsgLogLocations(BatchingAdapter& adapter, LocBatch* batch) :
+            LocPooledMsg(),
+            mAdapter(adapter),
+            mBatch(batch->share()) {}
+        inline virtual ~MsgLogLocations() {
+            mBatch->drop();
+        }
+        inline virtual void proc() const {
+            if (NULL != mAdapter.mBatchLog) {
+                mAdapter.mBatchLog->append(mBatch->locations(), mBatch->count());
             }
         }
+    };
+
+    mBatchLogTask->sendMsg(new MsgLogLocations(*this, batch));
+}
+
+void
+BatchingAdapter::reportLocationsEvent(const Location* locations, size_t count,
+        BatchingMode batchingMode)
+{
+    LocBatch* batch = LocBatch::create(locations, count);
+    if (nullptr == batch) {
+        LOC_LOGE("%s]: failed to allocate batch of %zu", __func__, count);
+        return;
+    }
+    reportLocationBatchEvent(batch, batchingMode);
+    batch->drop();
+}
+
+void
+BatchingAdapter::reportLocationBatchEvent(LocBatch* batch, BatchingMode batchingMode)
+{
+    LOC_LOGD("%s]: count %zu batchMode %d", __func__, batch->count(), batchingMode);
+
+    struct MsgReportLocations : public LocPooledMsg<MsgReportLocations> {
+        BatchingAdapter& mAdapter;
+        LocBatch* mBatch;
+        BatchingMode mBatchingMode;
+        inline MsgReportLocations(BatchingAdapter& adapter,
+                                  LocBatch* batch,
+                                  BatchingMode batchingMode) :
+            LocPooledMsg(),
+            mAdapter(adapter),
+            mBatch(batch->share()),
+            mBatchingMode(batchingMode) {}
         inline virtual ~MsgReportLocations() {
-            if (nullptr != mLocations)
-                delete[] mLocations;
+            mBatch->drop();
         }
         inline virtual void proc() const {
-            mAdapter.reportLocations(mLocations, mCount, mBatchingMode);
+            if (NULL != mAdapter.mBatchLogTask) {
+                mAdapter.logLocations(mBatch);
+            }
+            // every client gets the same locations, read only
+            mAdapter.reportLocations(const_cast<Location*>(mBatch->locations()),
+                                     mBatch->count(), mBatchingMode);
         }
     };
 
-    sendMsg(new MsgReportLocations(*this, locations, count, batchingMode));
+    sendMsg(new MsgReportLocations(*this, batch, batchingMode));
 }
 
 void
@@ -646,12 +798,12 @@ BatchingAdapter::reportLocations(Location* locations, size_t count, BatchingMode
 void
 BatchingAdapter::reportCompletedTripsEvent(uint32_t accumulated_distance)
 {
-    struct MsgReportCompletedTrips : public LocMsg {
+    struct MsgReportCompletedTrips : public LocPooledMsg<MsgReportCompletedTrips> {
         BatchingAdapter& mAdapter;
         uint32_t mAccumulatedDistance;
         inline MsgReportCompletedTrips(BatchingAdapter& adapter,
                                   uint32_t accumulated_distance) :
-            LocMsg(),
+            LocPooledMsg(),
             mAdapter(adapter),
             mAccumulatedDistance(accumulated_distance)
         {
@@ -32,6 +32,7 @@
 #include <LocAdapterBase.h>
 #include <LocContext.h>
 #include <LocationAPI.h>
+#include <LocBatchLog.h>
 #include <map>
 
 using namespace loc_core;
@@ -80,6 +81,15 @@ class BatchingAdapter : public LocAdapterBase {
     size_t mBatchSize;
     size_t mTripBatchSize;
 
+    /* ==== HISTORY ======================================================================== */
+    // every location reported, if BATCH_LOG_SIZE is set; only used on
+    // mBatchLogTask, so the file I/O stays off the adapter's MsgTask
+    loc_util::LocBatchLog* mBatchLog;
+    MsgTask* mBatchLogTask;
+    void logLocations(loc_util::LocBatch* batch);
+    void getLoggedLocations(LocationAPI* client, uint32_t sessionId, size_t count,
+                            LocationError err);
+
 protected:
 
     /* ==== CLIENT ========================================================================= */
@@ -88,7 +98,7 @@ protected:
 
 public:
     BatchingAdapter();
-    virtual ~BatchingAdapter() {}
+    virtual ~BatchingAdapter();
 
     /* ==== SSR ============================================================================ */
     /* ======== EVENTS ====(Called from QMI Thread)========================================= */
@@ -126,6 +136,7 @@ public:
     /* ======== EVENTS ====(Called from QMI Thread)========================================= */
     void reportLocationsEvent(const Location* locations, size_t count,
             BatchingMode batchingMode);
+    void reportLocationBatchEvent(loc_util::LocBatch* batch, BatchingMode batchingMode);
     void reportCompletedTripsEvent(uint32_t accumulatedDistance);
     void reportBatchStatusChangeEvent(BatchingStatus batchStatus);
     /* ======== UTILITIES ================================================================== */
@@ -146,6 +157,7 @@ public:
     uint32_t getBatchingTimeout() { return mBatchingTimeout; }
     void setBatchingAccuracy(uint32_t accuracy) { mBatchingAccuracy = accuracy; }
     uint32_t getBatchingAccuracy() { return mBatchingAccuracy; }
+    void setBatchLogSize(size_t bytes);
 
 };
 
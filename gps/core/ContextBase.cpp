@@ -37,6 +37,9 @@
 #include <loc_target.h>
 #include <loc_pla.h>
 #include <loc_log.h>
+#include <LocTimer.h>
+#include <LocInitTask.h>
+#include <LocStartupTrace.h>
 
 namespace loc_core {
 
@@ -51,6 +54,15 @@ uint64_t ContextBase::sSupportedMsgMask = 0;
 bool ContextBase::sGnssMeasurementSupported = false;
 uint8_t ContextBase::sFeaturesSupported[MAX_FEATURE_LENGTH];
 
+// parses the conf files into the loc_cfg cache, on a thread of its own from
+// prefetchConfig() while the libraries load, or else from readConfig()
+static loc_util::LocInitTask sConfFiles("parse conf files", []() -> void* {
+    UTIL_READ_CONF_DEFAULT(LOC_PATH_GPS_CONF);
+    UTIL_READ_CONF_DEFAULT(LOC_PATH_SAP_CONF);
+    UTIL_READ_CONF_DEFAULT(LOC_PATH_FLP_CONF);
+    return NULL;
+});
+
 const loc_param_s_type ContextBase::mGps_conf_table[] =
 {
   {"GPS_LOCK",                       &mGps_conf.GPS_LOCK,                       NULL, 'n'},
@@ -92,6 +104,7 @@ const loc_param_s_type ContextBase::mGps_conf_table[] =
   {"GNSS_DEPLOYMENT",  &mGps_conf.GNSS_DEPLOYMENT, NULL, 'n'},
   {"CUSTOM_NMEA_GGA_FIX_QUALITY_ENABLED",
            &mGps_conf.CUSTOM_NMEA_GGA_FIX_QUALITY_ENABLED, NULL, 'n'},
+  {"TIMER_WHEEL_SLACK_MS",           &mGps_conf.TIMER_WHEEL_SLACK_MS,           NULL, 'n' },
 };
 
 const loc_param_s_type ContextBase::mSap_conf_table[] =
@@ -113,11 +126,18 @@ const loc_param_s_type ContextBase::mSap_conf_table[] =
   {"SENSOR_ALGORITHM_CONFIG_MASK",   &mSap_conf.SENSOR_ALGORITHM_CONFIG_MASK,   NULL, 'n'}
 };
 
+void ContextBase::prefetchConfig()
+{
+    sConfFiles.start();
+}
+
 void ContextBase::readConfig()
 {
     static bool confReadDone = false;
     if (!confReadDone) {
         confReadDone = true;
+        loc_util::LocStartupPhase phase("ContextBase::readConfig");
+        sConfFiles.get();
         /*Defaults for gps.conf*/
         mGps_conf.INTERMEDIATE_POS = 0;
         mGps_conf.ACCURACY_THRES = 0;
@@ -191,10 +211,16 @@ void ContextBase::readConfig()
         /* default configuration QTI GNSS H/W */
         mGps_conf.GNSS_DEPLOYMENT = 0;
         mGps_conf.CUSTOM_NMEA_GGA_FIX_QUALITY_ENABLED = 0;
+        /* timers are kept in a heap by default */
+        mGps_conf.TIMER_WHEEL_SLACK_MS = 0;
 
         UTIL_READ_CONF(LOC_PATH_GPS_CONF, mGps_conf_table);
         UTIL_READ_CONF(LOC_PATH_SAP_CONF, mSap_conf_table);
 
+        if (mGps_conf.TIMER_WHEEL_SLACK_MS > 0) {
+            LocTimer::useTimerWheel(mGps_conf.TIMER_WHEEL_SLACK_MS);
+        }
+
         LOC_LOGI("%s] GNSS Deployment: %s", __FUNCTION__,
                 ((mGps_conf.GNSS_DEPLOYMENT == 1) ? "SS5" :
                 ((mGps_conf.GNSS_DEPLOYMENT == 2) ? "QFUSION" : "QGNSS")));
@@ -231,6 +257,7 @@ uint32_t ContextBase::getCarrierCapabilities() {
 
 LBSProxyBase* ContextBase::getLBSProxy(const char* libName)
 {
+    loc_util::LocStartupPhase phase("ContextBase::getLBSProxy");
     LBSProxyBase* proxy = NULL;
     LOC_LOGD("%s:%d]: getLBSProxy libname: %s\n", __func__, __LINE__, libName);
     void* lib = dlopen(libName, RTLD_NOW);
@@ -254,6 +281,7 @@ LBSProxyBase* ContextBase::getLBSProxy(const char* libName)
 
 LocApiBase* ContextBase::createLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask)
 {
+    loc_util::LocStartupPhase phase("ContextBase::createLocApi");
     LocApiBase* locApi = NULL;
     const char* libname = LOC_APIV2_0_LIB_NAME;
 
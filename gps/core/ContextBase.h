@@ -75,6 +75,7 @@ typedef struct loc_gps_cfg_s
     uint32_t       CP_MTLR_ES;
     uint32_t       GNSS_DEPLOYMENT;
     uint32_t       CUSTOM_NMEA_GGA_FIX_QUALITY_ENABLED;
+    uint32_t       TIMER_WHEEL_SLACK_MS;
 } loc_gps_cfg_s_type;
 
 /* NOTE: the implementaiton of the parser casts number
@@ -156,6 +157,9 @@ public:
     static uint8_t sFeaturesSupported[MAX_FEATURE_LENGTH];
     static bool sGnssMeasurementSupported;
 
+    // starts parsing the conf files ahead of readConfig(), which is
+    // then left with filling in the tables
+    static void prefetchConfig();
     void readConfig();
     static uint32_t getCarrierCapabilities();
     void setEngineCapabilities(uint64_t supportedMsgMask,
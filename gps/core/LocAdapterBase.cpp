@@ -224,6 +224,12 @@ void
 LocAdapterBase::reportBatchStatusChangeEvent(BatchingStatus /*batchStatus*/)
 DEFAULT_IMPL()
 
+void
+LocAdapterBase::reportLocationBatchEvent(loc_util::LocBatch* batch, BatchingMode batchingMode)
+{
+    reportLocationsEvent(batch->locations(), batch->count(), batchingMode);
+}
+
 void
 LocAdapterBase::reportPositionEvent(UlpLocation& /*location*/,
                                     GpsLocationExtended& /*locationExtended*/,
@@ -110,6 +110,14 @@ public:
         mMsgTask->sendMsg(msg);
     }
 
+    inline void sendMsg(const LocCoalescableMsg* msg) const {
+        mMsgTask->sendMsg(msg);
+    }
+
+    inline void sendMsg(const LocCoalescableMsg* msg) {
+        mMsgTask->sendMsg(msg);
+    }
+
     inline void updateEvtMask(LOC_API_ADAPTER_EVENT_MASK_T event,
                               loc_registration_mask_status status)
     {
@@ -207,6 +215,11 @@ public:
             BatchingMode batchingMode);
     virtual void reportCompletedTripsEvent(uint32_t accumulated_distance);
     virtual void reportBatchStatusChangeEvent(BatchingStatus batchStatus);
+    // adapters that keep the locations past this call share() batch instead
+    // of copying them; by default this goes to reportLocationsEvent().
+    // Comes after every older virtual, so prebuilt adapters keep their vtable.
+    virtual void reportLocationBatchEvent(loc_util::LocBatch* batch,
+            BatchingMode batchingMode);
 
     /* ==== CLIENT ========================================================================= */
     /* ======== COMMANDS ====(Called from Client Thread)==================================== */
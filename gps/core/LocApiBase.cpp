@@ -31,6 +31,7 @@
 
 #include <dlfcn.h>
 #include <inttypes.h>
+#include <memory>
 #include <gps_extended_c.h>
 #include <LocApiBase.h>
 #include <LocAdapterBase.h>
@@ -580,7 +581,16 @@ void LocApiBase::reportDBTPosition(UlpLocation &location, GpsLocationExtended &l
 
 void LocApiBase::reportLocations(Location* locations, size_t count, BatchingMode batchingMode)
 {
-    TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportLocationsEvent(locations, count, batchingMode));
+    loc_util::LocBatch* batch = loc_util::LocBatch::create(locations, count);
+    if (NULL != batch) {
+        reportLocationBatch(batch, batchingMode);
+        batch->drop();
+    }
+}
+
+void LocApiBase::reportLocationBatch(loc_util::LocBatch* batch, BatchingMode batchingMode)
+{
+    TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportLocationBatchEvent(batch, batchingMode));
 }
 
 void LocApiBase::reportCompletedTrips(uint32_t accumulated_distance)
@@ -800,6 +810,100 @@ void LocApiBase::modifyGeofence(uint32_t /*hwId*/, uint32_t /*clientId*/,
          const GeofenceOption& /*options*/, LocApiResponse* /*adapterResponse*/)
 DEFAULT_IMPL()
 
+// The single requests answer in any order, each on the context msg thread,
+// and the last one to come back answers for all of them.
+static void collectGeofenceResponses(ContextBase* context, size_t count,
+        LocApiCollectiveResponse* adapterResponse,
+        const std::function<void (size_t i, LocApiResponse* response)>& request)
+{
+    auto errs = std::make_shared<std::vector<LocationError>>(count,
+            LOCATION_ERROR_GENERAL_FAILURE);
+    if (0 == count || NULL == context) {
+        adapterResponse->returnToSender(*errs);
+        return;
+    }
+    auto pending = std::make_shared<size_t>(count);
+    for (size_t i = 0; i < count; i++) {
+        request(i, new LocApiResponse(*context,
+                [errs, pending, adapterResponse, i] (LocationError err) {
+            (*errs)[i] = err;
+            if (0 == --(*pending)) {
+                adapterResponse->returnToSender(*errs);
+            }
+        }));
+    }
+}
+
+void LocApiBase::addGeofences(size_t count, const uint32_t* clientIds,
+        const GeofenceOption* options, const GeofenceInfo* infos,
+        LocApiResponseData<LocApiGeofencesData>* adapterResponseData)
+{
+    auto data = std::make_shared<LocApiGeofencesData>();
+    data->errs.assign(count, LOCATION_ERROR_GENERAL_FAILURE);
+    data->hwIds.assign(count, 0);
+    if (0 == count || NULL == mContext) {
+        adapterResponseData->returnToSender(
+                (0 == count) ? LOCATION_ERROR_SUCCESS : LOCATION_ERROR_GENERAL_FAILURE, *data);
+        return;
+    }
+    auto pending = std::make_shared<size_t>(count);
+    for (size_t i = 0; i < count; i++) {
+        addGeofence(clientIds[i], options[i], infos[i],
+                new LocApiResponseData<LocApiGeofenceData>(*mContext,
+                [data, pending, adapterResponseData, i]
+                (LocationError err, LocApiGeofenceData geofenceData) {
+            data->errs[i] = err;
+            data->hwIds[i] = geofenceData.hwId;
+            if (0 == --(*pending)) {
+                LocationError allErr = LOCATION_ERROR_SUCCESS;
+                for (LocationError oneErr : data->errs) {
+                    if (LOCATION_ERROR_SUCCESS != oneErr) {
+                        allErr = oneErr;
+                        break;
+                    }
+                }
+                adapterResponseData->returnToSender(allErr, *data);
+            }
+        }));
+    }
+}
+
+void LocApiBase::removeGeofences(size_t count, const uint32_t* hwIds, const uint32_t* clientIds,
+        LocApiCollectiveResponse* adapterResponse)
+{
+    collectGeofenceResponses(mContext, count, adapterResponse,
+            [this, hwIds, clientIds] (size_t i, LocApiResponse* response) {
+        removeGeofence(hwIds[i], clientIds[i], response);
+    });
+}
+
+void LocApiBase::pauseGeofences(size_t count, const uint32_t* hwIds, const uint32_t* clientIds,
+        LocApiCollectiveResponse* adapterResponse)
+{
+    collectGeofenceResponses(mContext, count, adapterResponse,
+            [this, hwIds, clientIds] (size_t i, LocApiResponse* response) {
+        pauseGeofence(hwIds[i], clientIds[i], response);
+    });
+}
+
+void LocApiBase::resumeGeofences(size_t count, const uint32_t* hwIds, const uint32_t* clientIds,
+        LocApiCollectiveResponse* adapterResponse)
+{
+    collectGeofenceResponses(mContext, count, adapterResponse,
+            [this, hwIds, clientIds] (size_t i, LocApiResponse* response) {
+        resumeGeofence(hwIds[i], clientIds[i], response);
+    });
+}
+
+void LocApiBase::modifyGeofences(size_t count, const uint32_t* hwIds, const uint32_t* clientIds,
+        const GeofenceOption* options, LocApiCollectiveResponse* adapterResponse)
+{
+    collectGeofenceResponses(mContext, count, adapterResponse,
+            [this, hwIds, clientIds, options] (size_t i, LocApiResponse* response) {
+        modifyGeofence(hwIds[i], clientIds[i], options[i], response);
+    });
+}
+
 void LocApiBase::startTimeBasedTracking(const TrackingOptions& /*options*/,
         LocApiResponse* /*adapterResponse*/)
 DEFAULT_IMPL()
@@ -35,12 +35,14 @@
 #include <LocationAPI.h>
 #include <MsgTask.h>
 #include <LocSharedLock.h>
+#include <LocBatch.h>
 #include <log_util.h>
 
 namespace loc_core {
 
 class ContextBase;
 struct LocApiResponse;
+struct LocApiCollectiveResponse;
 template <typename> struct LocApiResponseData;
 
 int hexcode(char *hexstring, int string_size,
@@ -81,6 +83,12 @@ typedef struct
     uint32_t hwId;
 } LocApiGeofenceData;
 
+typedef struct
+{
+    std::vector<LocationError> errs;
+    std::vector<uint32_t> hwIds;
+} LocApiGeofencesData;
+
 struct LocApiMsg: LocMsg {
     private:
         std::function<void ()> mProcImpl;
@@ -205,6 +213,8 @@ public:
                            enum loc_sess_status status,
                            LocPosTechMask loc_technology_mask);
     void reportLocations(Location* locations, size_t count, BatchingMode batchingMode);
+    // shares batch with the adapters, rather than copying locations for each
+    void reportLocationBatch(loc_util::LocBatch* batch, BatchingMode batchingMode);
     void reportCompletedTrips(uint32_t accumulated_distance);
     void handleBatchStatusEvent(BatchingStatus batchStatus);
 
@@ -275,7 +285,6 @@ public:
     virtual void resumeGeofence(uint32_t hwId, uint32_t clientId, LocApiResponse* adapterResponse);
     virtual void modifyGeofence(uint32_t hwId, uint32_t clientId, const GeofenceOption& options,
              LocApiResponse* adapterResponse);
-
     virtual void startTimeBasedTracking(const TrackingOptions& options,
              LocApiResponse* adapterResponse);
     virtual void stopTimeBasedTracking(LocApiResponse* adapterResponse);
@@ -309,6 +318,23 @@ public:
     virtual void setTripBatchSize(size_t size);
     virtual void addToCallQueue(LocApiResponse* adapterResponse);
 
+    /* Bulk geofence requests, answered with one response carrying an error per
+       geofence. The defaults make the single requests above and answer once
+       all of theirs are back, for a LocApi with no bulk requests of its own.
+       They come after every older virtual, so that the vtable of a prebuilt
+       LocApi keeps its layout */
+    virtual void addGeofences(size_t count, const uint32_t* clientIds,
+            const GeofenceOption* options, const GeofenceInfo* infos,
+            LocApiResponseData<LocApiGeofencesData>* adapterResponseData);
+    virtual void removeGeofences(size_t count, const uint32_t* hwIds, const uint32_t* clientIds,
+            LocApiCollectiveResponse* adapterResponse);
+    virtual void pauseGeofences(size_t count, const uint32_t* hwIds, const uint32_t* clientIds,
+            LocApiCollectiveResponse* adapterResponse);
+    virtual void resumeGeofences(size_t count, const uint32_t* hwIds, const uint32_t* clientIds,
+            LocApiCollectiveResponse* adapterResponse);
+    virtual void modifyGeofences(size_t count, const uint32_t* hwIds, const uint32_t* clientIds,
+            const GeofenceOption* options, LocApiCollectiveResponse* adapterResponse);
+
     void updateEvtMask();
     void updateNmeaMask(uint32_t mask);
 
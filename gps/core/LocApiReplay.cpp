@@ -0,0 +1,782 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDEBUG 0
+#define LOG_TAG "LocSvc_LocApiReplay"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <algorithm>
+#include <LocApiReplay.h>
+#include <ContextBase.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+// positions are stamped from here on, so that they look like fixes of today
+#define LOC_REPLAY_EPOCH_MS 1600000000000ULL
+#define LOC_REPLAY_MAX_LINE 4096
+
+static inline uint64_t nowNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// FNV-1a
+static inline uint64_t hashOf(uint64_t hash, const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+LocApiReplay::LocApiReplay(LOC_API_ADAPTER_EVENT_MASK_T exMask, ContextBase* context,
+                           const std::vector<LocReplayEvent>& events,
+                           float speed, uint32_t rounds) :
+    LocApiBase(exMask, context),
+    mEvents(events), mSpeed(speed), mRounds(rounds),
+    mThreadStarted(false), mPlayRequested(false), mTracking(false),
+    mStopRequested(false), mDone(false), mReplayCpuNs(0), mNmeaSequence(0),
+    mMeasurements(new GnssMeasurements())
+{
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+    memset(&mSvNotify, 0, sizeof(mSvNotify));
+    for (int type = 0; type < LOC_REPLAY_EVENT_TYPE_COUNT; type++) {
+        mListeners[type] = 1;
+    }
+    LOC_LOGd("%zu events, speed %f, %u rounds", mEvents.size(), mSpeed, mRounds);
+}
+
+LocApiReplay::~LocApiReplay()
+{
+    pthread_mutex_lock(&mMutex);
+    mStopRequested = true;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+    if (mThreadStarted) {
+        pthread_join(mThread, NULL);
+    }
+    delete mMeasurements;
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+bool LocApiReplay::load(const char* path, std::vector<LocReplayEvent>& events)
+{
+    FILE* file = fopen(path, "r");
+    if (NULL == file) {
+        LOC_LOGe("can not open %s", path);
+        return false;
+    }
+
+    char* line = new char[LOC_REPLAY_MAX_LINE];
+    uint32_t lineNumber = 0;
+    while (NULL != fgets(line, LOC_REPLAY_MAX_LINE, file)) {
+        lineNumber++;
+        size_t length = strlen(line);
+        while (length > 0 && ('\n' == line[length - 1] || '\r' == line[length - 1])) {
+            line[--length] = '\0';
+        }
+        if (0 == length || '#' == line[0]) {
+            continue;
+        }
+
+        LocReplayEvent event = {};
+        char tag[8] = {};
+        int offset = 0;
+        if (2 != sscanf(line, "%u %7s %n", &event.mTimeMs, tag, &offset)) {
+            LOC_LOGw("%s:%u not an event", path, lineNumber);
+            continue;
+        }
+        const char* fields = line + offset;
+
+        if (0 == strcmp(tag, "POS")) {
+            char status = 0;
+            event.mType = LOC_REPLAY_POSITION;
+            if (7 > sscanf(fields, "%c %lf %lf %lf %f %f %f %" SCNx64, &status,
+                           &event.mLatitude, &event.mLongitude, &event.mAltitude,
+                           &event.mAccuracy, &event.mSpeed, &event.mBearing,
+                           &event.mGpsSvUsedMask)) {
+                LOC_LOGw("%s:%u bad position", path, lineNumber);
+                continue;
+            }
+            event.mStatus = ('i' == status) ? LOC_SESS_INTERMEDIATE :
+                            (('f' == status) ? LOC_SESS_FAILURE : LOC_SESS_SUCCESS);
+        } else if (0 == strcmp(tag, "SV") || 0 == strcmp(tag, "MEAS")) {
+            event.mType = ('S' == tag[0]) ? LOC_REPLAY_SV : LOC_REPLAY_MEASUREMENTS;
+            while ('\0' != *fields) {
+                LocReplaySv sv = {};
+                int type = 0;
+                int consumed = 0;
+                if (3 > sscanf(fields, "%d,%hu,%f%n,%f,%f%n", &type, &sv.mSvId,
+                               &sv.mCn0Dbhz, &consumed, &sv.mElevation, &sv.mAzimuth,
+                               &consumed) || 0 == consumed) {
+                    break;
+                }
+                sv.mType = (GnssSvType)type;
+                event.mSvs.push_back(sv);
+                fields += consumed;
+                while (' ' == *fields) {
+                    fields++;
+                }
+            }
+        } else if (0 == strcmp(tag, "NMEA")) {
+            event.mType = LOC_REPLAY_NMEA;
+            event.mNmea = fields;
+        } else {
+            LOC_LOGw("%s:%u unknown event %s", path, lineNumber, tag);
+            continue;
+        }
+        events.push_back(event);
+    }
+
+    delete[] line;
+    fclose(file);
+    LOC_LOGd("%zu events from %s", events.size(), path);
+    return true;
+}
+
+uint64_t LocApiReplay::keyOf(const Location& location)
+{
+    return location.timestamp;
+}
+
+uint64_t LocApiReplay::keyOf(const GnssSvNotification& svNotify)
+{
+    // only what the adapters leave as is; svId is changed for QZSS and the
+    // options for the SVs used in the fix; the carrier frequency is the time
+    uint64_t hash = hashOf(14695981039346656037ULL, &svNotify.count, sizeof(svNotify.count));
+    for (uint32_t i = 0; i < svNotify.count && i < GNSS_SV_MAX; i++) {
+        const GnssSv& sv = svNotify.gnssSvs[i];
+        hash = hashOf(hash, &sv.type, sizeof(sv.type));
+        hash = hashOf(hash, &sv.cN0Dbhz, sizeof(sv.cN0Dbhz));
+        hash = hashOf(hash, &sv.elevation, sizeof(sv.elevation));
+        hash = hashOf(hash, &sv.azimuth, sizeof(sv.azimuth));
+        hash = hashOf(hash, &sv.carrierFrequencyHz, sizeof(sv.carrierFrequencyHz));
+    }
+    return hash;
+}
+
+uint64_t LocApiReplay::keyOf(const GnssMeasurementsNotification& measurements)
+{
+    return (uint64_t)measurements.clock.timeNs;
+}
+
+void LocApiReplay::play()
+{
+    pthread_mutex_lock(&mMutex);
+    mPlayRequested = true;
+    startThreadLocked();
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool LocApiReplay::waitDone(uint32_t timeoutMs)
+{
+    uint64_t deadlineNs = nowNs() + (uint64_t)timeoutMs * 1000000;
+    struct timespec deadline = { (time_t)(deadlineNs / 1000000000),
+                                 (long)(deadlineNs % 1000000000) };
+    pthread_mutex_lock(&mMutex);
+    while (!mDone) {
+        if (0 == timeoutMs) {
+            pthread_cond_wait(&mCond, &mMutex);
+        } else if (ETIMEDOUT == pthread_cond_timedwait(&mCond, &mMutex, &deadline)) {
+            break;
+        }
+    }
+    bool done = mDone;
+    pthread_mutex_unlock(&mMutex);
+    return done;
+}
+
+void LocApiReplay::setListeners(LocReplayEventType type, uint32_t listeners)
+{
+    pthread_mutex_lock(&mMutex);
+    mListeners[type] = listeners;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocApiReplay::dispatched(LocReplayEventType type, uint64_t key)
+{
+    uint64_t now = nowNs();
+    pthread_mutex_lock(&mMutex);
+    if (mListeners[type] > 0) {
+        mPending[type].push_back({key, now, mListeners[type]});
+    }
+    mStats[type].mDispatched++;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocApiReplay::delivered(LocReplayEventType type, uint64_t key)
+{
+    uint64_t now = nowNs();
+    pthread_mutex_lock(&mMutex);
+    std::deque<Pending>& pending = mPending[type];
+    auto it = std::find_if(pending.begin(), pending.end(),
+                           [key] (const Pending& report) { return report.mKey == key; });
+    if (pending.end() != it) {
+        mStats[type].mDelivered++;
+        mStats[type].mLatencyNs.push_back(now - it->mDispatchNs);
+        // the reports before this one will not be delivered any more
+        mStats[type].mSkipped += it - pending.begin();
+        pending.erase(pending.begin(), it);
+        if (0 == --pending.front().mRemaining) {
+            pending.pop_front();
+        }
+    } else {
+        mStats[type].mUnmatched++;
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LocApiReplay::getStats(LocReplayEventType type, LocReplayStats& stats)
+{
+    pthread_mutex_lock(&mMutex);
+    stats = mStats[type];
+    pthread_mutex_unlock(&mMutex);
+}
+
+enum loc_api_adapter_err LocApiReplay::open(LOC_API_ADAPTER_EVENT_MASK_T mask)
+{
+    LOC_LOGd("mask: %" PRIx64, mask);
+    // the trace has debug NMEA and measurements, as a modem that supports them
+    uint8_t features[MAX_FEATURE_LENGTH] = {};
+    features[LOC_SUPPORTED_FEATURE_DEBUG_NMEA_V02 >> 3] |=
+            (1 << (LOC_SUPPORTED_FEATURE_DEBUG_NMEA_V02 & 7));
+    mContext->setEngineCapabilities(0, features, true);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err LocApiReplay::close()
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+void LocApiReplay::startFix(const LocPosMode& /*fixCriteria*/, LocApiResponse* adapterResponse)
+{
+    setTracking(true, adapterResponse);
+}
+
+void LocApiReplay::stopFix(LocApiResponse* adapterResponse)
+{
+    setTracking(false, adapterResponse);
+}
+
+void LocApiReplay::startTimeBasedTracking(const TrackingOptions& /*options*/,
+                                          LocApiResponse* adapterResponse)
+{
+    setTracking(true, adapterResponse);
+}
+
+void LocApiReplay::stopTimeBasedTracking(LocApiResponse* adapterResponse)
+{
+    setTracking(false, adapterResponse);
+}
+
+void LocApiReplay::setTracking(bool tracking, LocApiResponse* adapterResponse)
+{
+    sendMsg(new LocApiMsg([this, tracking, adapterResponse] () {
+        // the replay pauses while there is no session
+        pthread_mutex_lock(&mMutex);
+        mTracking = tracking;
+        startThreadLocked();
+        pthread_cond_broadcast(&mCond);
+        pthread_mutex_unlock(&mMutex);
+        if (NULL != adapterResponse) {
+            adapterResponse->returnToSender(LOCATION_ERROR_SUCCESS);
+        }
+    }));
+}
+
+void LocApiReplay::startThreadLocked()
+{
+    if (!mThreadStarted && mPlayRequested && mTracking) {
+        if (0 == pthread_create(&mThread, NULL, threadMain, this)) {
+            mThreadStarted = true;
+        } else {
+            LOC_LOGe("failed to create the replay thread");
+        }
+    }
+}
+
+void* LocApiReplay::threadMain(void* arg)
+{
+    ((LocApiReplay*)arg)->replay();
+    return NULL;
+}
+
+bool LocApiReplay::waitUntil(uint64_t timeNs)
+{
+    struct timespec until = { (time_t)(timeNs / 1000000000), (long)(timeNs % 1000000000) };
+    pthread_mutex_lock(&mMutex);
+    while (!mStopRequested) {
+        if (!mTracking) {
+            pthread_cond_wait(&mCond, &mMutex);
+        } else if (nowNs() < timeNs) {
+            pthread_cond_timedwait(&mCond, &mMutex, &until);
+        } else {
+            break;
+        }
+    }
+    bool play = !mStopRequested;
+    pthread_mutex_unlock(&mMutex);
+    return play;
+}
+
+void LocApiReplay::replay()
+{
+    struct timespec cpuStart, cpuEnd;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
+    // a round starts a second after the last event of the one before
+    uint64_t roundMs = (mEvents.empty() ? 0 : mEvents.back().mTimeMs) + 1000;
+    uint64_t startNs = nowNs();
+    bool play = true;
+    for (uint32_t round = 0; play && round < mRounds; round++) {
+        for (size_t i = 0; play && i < mEvents.size(); i++) {
+            uint64_t offsetMs = round * roundMs;
+            uint64_t dueNs = (mSpeed > 0) ?
+                    startNs + (uint64_t)((offsetMs + mEvents[i].mTimeMs) * 1e6 / mSpeed) : 0;
+            play = waitUntil(dueNs);
+            if (play) {
+                dispatch(mEvents[i], offsetMs);
+            }
+        }
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+    mReplayCpuNs = (cpuEnd.tv_sec - cpuStart.tv_sec) * 1000000000ULL +
+            cpuEnd.tv_nsec - cpuStart.tv_nsec;
+
+    if (play) {
+        // done once the adapters processed a message sent after the last report
+        mContext->sendMsg(new LocApiMsg([this] () {
+            pthread_mutex_lock(&mMutex);
+            mDone = true;
+            pthread_cond_broadcast(&mCond);
+            pthread_mutex_unlock(&mMutex);
+        }));
+    }
+    LOC_LOGd("replayed %u rounds in %" PRIu64 " ms", mRounds, (nowNs() - startNs) / 1000000);
+}
+
+void LocApiReplay::dispatch(const LocReplayEvent& event, uint64_t offsetMs)
+{
+    switch (event.mType) {
+    case LOC_REPLAY_POSITION: {
+        UlpLocation location = {};
+        GpsLocationExtended locationExtended = {};
+        location.size = sizeof(UlpLocation);
+        location.position_source = ULP_LOCATION_IS_FROM_GNSS;
+        location.tech_mask = LOC_POS_TECH_MASK_SATELLITE;
+        location.gpsLocation.size = sizeof(LocGpsLocation);
+        location.gpsLocation.flags = LOC_GPS_LOCATION_HAS_LAT_LONG |
+                LOC_GPS_LOCATION_HAS_ALTITUDE | LOC_GPS_LOCATION_HAS_SPEED |
+                LOC_GPS_LOCATION_HAS_BEARING | LOC_GPS_LOCATION_HAS_ACCURACY;
+        location.gpsLocation.latitude = event.mLatitude;
+        location.gpsLocation.longitude = event.mLongitude;
+        location.gpsLocation.altitude = event.mAltitude;
+        location.gpsLocation.speed = event.mSpeed;
+        location.gpsLocation.bearing = event.mBearing;
+        location.gpsLocation.accuracy = event.mAccuracy;
+        location.gpsLocation.timestamp = LOC_REPLAY_EPOCH_MS + offsetMs + event.mTimeMs;
+        locationExtended.size = sizeof(GpsLocationExtended);
+        if (0 != event.mGpsSvUsedMask) {
+            locationExtended.flags |= GPS_LOCATION_EXTENDED_HAS_GNSS_SV_USED_DATA;
+            locationExtended.gnss_sv_used_ids.gps_sv_used_ids_mask = event.mGpsSvUsedMask;
+        }
+        dispatched(LOC_REPLAY_POSITION, location.gpsLocation.timestamp);
+        reportPosition(location, locationExtended, event.mStatus, LOC_POS_TECH_MASK_SATELLITE);
+        break;
+    }
+    case LOC_REPLAY_SV: {
+        mSvNotify.size = sizeof(GnssSvNotification);
+        mSvNotify.count = 0;
+        for (size_t i = 0; i < event.mSvs.size() && mSvNotify.count < GNSS_SV_MAX; i++) {
+            GnssSv& sv = mSvNotify.gnssSvs[mSvNotify.count++];
+            memset(&sv, 0, sizeof(sv));
+            sv.size = sizeof(GnssSv);
+            sv.type = event.mSvs[i].mType;
+            sv.svId = event.mSvs[i].mSvId;
+            sv.cN0Dbhz = event.mSvs[i].mCn0Dbhz;
+            sv.elevation = event.mSvs[i].mElevation;
+            sv.azimuth = event.mSvs[i].mAzimuth;
+            sv.carrierFrequencyHz = (float)(offsetMs + event.mTimeMs);
+        }
+        dispatched(LOC_REPLAY_SV, keyOf(mSvNotify));
+        reportSv(mSvNotify);
+        break;
+    }
+    case LOC_REPLAY_MEASUREMENTS: {
+        GnssMeasurementsNotification& notify = mMeasurements->gnssMeasNotification;
+        mMeasurements->size = sizeof(GnssMeasurements);
+        mMeasurements->gnssSvMeasurementSet.svMeasCount = 0;
+        notify.size = sizeof(GnssMeasurementsNotification);
+        notify.count = 0;
+        for (size_t i = 0; i < event.mSvs.size() && notify.count < GNSS_MEASUREMENTS_MAX; i++) {
+            GnssMeasurementsData& data = notify.measurements[notify.count++];
+            memset(&data, 0, sizeof(data));
+            data.size = sizeof(GnssMeasurementsData);
+            data.flags = GNSS_MEASUREMENTS_DATA_SV_ID_BIT | GNSS_MEASUREMENTS_DATA_SV_TYPE_BIT |
+                    GNSS_MEASUREMENTS_DATA_CARRIER_TO_NOISE_BIT;
+            data.svId = event.mSvs[i].mSvId;
+            data.svType = event.mSvs[i].mType;
+            data.carrierToNoiseDbHz = event.mSvs[i].mCn0Dbhz;
+        }
+        memset(&notify.clock, 0, sizeof(notify.clock));
+        notify.clock.size = sizeof(GnssMeasurementsClock);
+        notify.clock.timeNs = (int64_t)(offsetMs + event.mTimeMs) * 1000000;
+        dispatched(LOC_REPLAY_MEASUREMENTS, keyOf(notify));
+        reportGnssMeasurements(*mMeasurements, -1);
+        break;
+    }
+    case LOC_REPLAY_NMEA: {
+        uint64_t key = ++mNmeaSequence;
+        dispatched(LOC_REPLAY_NMEA, key);
+        reportNmea(event.mNmea.c_str(), (int)event.mNmea.length());
+        // queued behind the NMEA report of every adapter
+        mContext->sendMsg(new LocApiMsg([this, key] () {
+            delivered(LOC_REPLAY_NMEA, key);
+        }));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+LocApiBase* LocApiReplayProxy::getLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                                         ContextBase* context) const
+{
+    mLocApi = new LocApiReplay(exMask, context, mEvents, mSpeed, mRounds);
+    if (mAutoPlay) {
+        mLocApi->play();
+    }
+    return mLocApi;
+}
+
+} // namespace loc_core
+
+#ifdef __LOC_DEBUG__
+
+#include <math.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <LocContext.h>
+
+using namespace loc_core;
+
+static LocApiReplayProxy* sProxy = nullptr;
+
+// the LocContext takes the program itself for its LBS library
+extern "C" LBSProxyBase* getLBSProxy() {
+    return sProxy;
+}
+
+enum {
+    REPLAY_CB_TRACKING = 0,
+    REPLAY_CB_SV,
+    REPLAY_CB_NMEA,
+    REPLAY_CB_MEASUREMENTS,
+    REPLAY_CB_RESPONSE,
+    REPLAY_CB_COUNT
+};
+static std::atomic<uint64_t> sCallbacks[REPLAY_CB_COUNT];
+
+// debug NMEA of an epoch, with as many fields as the modem sends
+static const struct {
+    const char* mTag;
+    int mFields;
+} sDebugNmea[] = {
+    { "PQWM1", 34 }, { "PQWP1", 10 }, { "PQWP2", 10 }, { "PQWP3", 15 }, { "PQWP4", 10 },
+    { "PQWP5", 30 }, { "PQWP6", 10 }, { "PQWP7", 450 }, { "PQWS1", 5 }
+};
+
+// xorshift, so that a trace is the same on any host
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static bool generateTrace(const char* path, uint32_t seconds, uint32_t hz) {
+    FILE* file = fopen(path, "w");
+    if (NULL == file) {
+        printf("can not create %s\n", path);
+        return false;
+    }
+    static const struct {
+        int mType;
+        int mCount;
+    } sConstellations[] = { { 1, 12 }, { 3, 6 }, { 6, 6 } };
+    uint32_t state = 2463534242;
+
+    fprintf(file, "# %u s at %u Hz\n", seconds, hz);
+    for (uint32_t epoch = 0; epoch < seconds * hz; epoch++) {
+        uint32_t ms = epoch * 1000 / hz;
+        // measurements, SV status, then the fix, as the engine reports an epoch
+        fprintf(file, "%u MEAS", ms);
+        for (auto& c : sConstellations) {
+            for (int sv = 1; sv <= c.mCount; sv++) {
+                fprintf(file, " %d,%d,%.2f", c.mType, sv, 20 + (nextRandom(state) % 2500) / 100.0);
+            }
+        }
+        fprintf(file, "\n%u SV", ms);
+        for (auto& c : sConstellations) {
+            for (int sv = 1; sv <= c.mCount; sv++) {
+                fprintf(file, " %d,%d,%.2f,%.1f,%.1f", c.mType, sv,
+                        20 + (nextRandom(state) % 2500) / 100.0,
+                        (double)(5 + (sv * 7 + epoch / 60) % 85),
+                        (double)((sv * 37 + epoch / 30) % 360));
+            }
+        }
+        fprintf(file, "\n%u POS s %.7f %.7f %.1f %.1f %.2f %.1f %x\n", ms,
+                37.4219999 + epoch * 1e-6, -122.0840575 + epoch * 1e-6, 5.0 + epoch % 10,
+                3.0 + (nextRandom(state) % 50) / 10.0, 1.4, 45.0, nextRandom(state) & 0xfff);
+        // debug NMEA comes at 1 Hz, whatever the rate of fixes
+        if (0 == epoch % hz) {
+            for (auto& nmea : sDebugNmea) {
+                char sentence[LOC_REPLAY_MAX_LINE];
+                int length = snprintf(sentence, sizeof(sentence), "$%s", nmea.mTag);
+                for (int i = 0; i < nmea.mFields; i++) {
+                    length += snprintf(sentence + length, sizeof(sentence) - length,
+                                       ",%u", nextRandom(state) % 1000);
+                }
+                uint8_t checksum = 0;
+                for (int i = 1; i < length; i++) {
+                    checksum ^= sentence[i];
+                }
+                fprintf(file, "%u NMEA %s*%02X\n", ms, sentence, checksum);
+            }
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+static double usOf(const std::vector<uint64_t>& sorted, double percentile) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t i = std::min(sorted.size() - 1, (size_t)(percentile * sorted.size()));
+    return sorted[i] / 1000.0;
+}
+
+static uint64_t cpuNs(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// For Linux command line testing; LocApiReplay is not part of libloc_core,
+// it is built into the test program only, from this directory:
+// compilation:
+//     F="-std=c++11 -O2 -g -DUSE_GLIB -DFEATURE_EXTERNAL_AP -I. -Idata-items -Iobserver
+//        -I../utils -I../location -I../gnss -I../pla/oe
+//        $(pkg-config --cflags glib-2.0 libcutils)"
+//     g++ $F -fPIC -shared -o libgnss.so ../gnss/*.cpp
+//     g++ $F -D__LOC_DEBUG__ -c LocApiReplay.cpp
+//     g++ $F -rdynamic LocApiReplay.o LocApiBase.cpp LocAdapterBase.cpp ContextBase.cpp
+//        LocContext.cpp loc_core_log.cpp SystemStatus.cpp SystemStatusOsObserver.cpp
+//        data-items/DataItemsFactoryProxy.cpp ../location/LocationAPI.cpp
+//        -lgps_utils $(pkg-config --libs glib-2.0 libcutils) -lpthread -ldl
+//     LocApiReplay.o alone gets -D__LOC_DEBUG__, SystemStatus.cpp has a main() of
+//     its own under it. Run with LD_LIBRARY_PATH=. so that the LocContext finds
+//     libgnss.so; it loads the program itself as its LBS library, so that the
+//     GnssAdapter gets a LocApiReplay.
+// generate: ./a.out gen <trace> <seconds> [<hz>]
+//     writes a deterministic trace: at every epoch measurements and SV status
+//     of 24 SVs and a fix, and every second a set of debug NMEA.
+// replay: ./a.out <trace> [<speed> [<rounds> [<clients>]]]
+//     replays the trace <rounds> times into the adapters at <speed> times real
+//     time, 0 for as fast as it goes, with <clients> LocationAPI clients
+//     tracking; reports the callbacks they got, the latency from report to
+//     callback, and the CPU time spent.
+// dispatch: ./a.out dispatch <trace> [<rounds>]
+//     replays the trace <rounds> times, 10 by default, as fast as it goes to
+//     16 clients: 4 with every callback and 12 that only track, like FLP and
+//     framework clients next to a few that want everything; the CPU time per
+//     callback is the cost of the GnssAdapter handing a report to a client.
+int main(int argc, char** argv) {
+    if (argc >= 4 && 0 == strcmp(argv[1], "gen")) {
+        uint32_t hz = (argc > 4) ? atoi(argv[4]) : 1;
+        return generateTrace(argv[2], atoi(argv[3]), (hz > 0) ? hz : 1) ? 0 : 1;
+    }
+    if (argc < 2 || (argc < 3 && 0 == strcmp(argv[1], "dispatch"))) {
+        printf("usage: %s gen <trace> <seconds> [<hz>]\n"
+               "       %s <trace> [<speed> [<rounds> [<clients>]]]\n"
+               "       %s dispatch <trace> [<rounds>]\n", argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    const char* trace = argv[1];
+    float speed = (argc > 2) ? atof(argv[2]) : 0;
+    uint32_t rounds = (argc > 3) ? atoi(argv[3]) : 1;
+    int clientCount = (argc > 4) ? atoi(argv[4]) : 1;
+    // the clients past these only track
+    int fullClientCount = clientCount;
+    if (0 == strcmp(argv[1], "dispatch")) {
+        trace = argv[2];
+        speed = 0;
+        rounds = (argc > 3) ? atoi(argv[3]) : 10;
+        clientCount = 16;
+        fullClientCount = 4;
+    }
+
+    std::vector<LocReplayEvent> events;
+    if (!LocApiReplay::load(trace, events) || events.empty()) {
+        printf("no events in %s\n", trace);
+        return 1;
+    }
+    sProxy = new LocApiReplayProxy(events, speed, rounds, false);
+    LocContext::mLBSLibName = NULL;
+
+    LocationCallbacks callbacks = {};
+    callbacks.size = sizeof(LocationCallbacks);
+    callbacks.capabilitiesCb = [] (LocationCapabilitiesMask) {};
+    callbacks.responseCb = [] (LocationError, uint32_t) {
+        sCallbacks[REPLAY_CB_RESPONSE]++;
+    };
+    callbacks.collectiveResponseCb = [] (uint32_t, LocationError*, uint32_t*) {};
+    callbacks.trackingCb = [] (Location location) {
+        sCallbacks[REPLAY_CB_TRACKING]++;
+        sProxy->getLocApiReplay()->delivered(LOC_REPLAY_POSITION,
+                                             LocApiReplay::keyOf(location));
+    };
+    callbacks.gnssSvCb = [] (const GnssSvNotification& svNotify) {
+        sCallbacks[REPLAY_CB_SV]++;
+        sProxy->getLocApiReplay()->delivered(LOC_REPLAY_SV, LocApiReplay::keyOf(svNotify));
+    };
+    callbacks.gnssNmeaCb = [] (GnssNmeaNotification) {
+        sCallbacks[REPLAY_CB_NMEA]++;
+    };
+    callbacks.gnssMeasurementsCb = [] (const GnssMeasurementsNotification& measurements) {
+        sCallbacks[REPLAY_CB_MEASUREMENTS]++;
+        sProxy->getLocApiReplay()->delivered(LOC_REPLAY_MEASUREMENTS,
+                                             LocApiReplay::keyOf(measurements));
+    };
+
+    LocationCallbacks trackingCallbacks = callbacks;
+    trackingCallbacks.gnssSvCb = nullptr;
+    trackingCallbacks.gnssNmeaCb = nullptr;
+    trackingCallbacks.gnssMeasurementsCb = nullptr;
+
+    std::vector<LocationAPI*> clients;
+    std::vector<uint32_t> sessions;
+    for (int i = 0; i < clientCount; i++) {
+        LocationAPI* client = LocationAPI::createInstance(
+                (i < fullClientCount) ? callbacks : trackingCallbacks);
+        if (NULL == client) {
+            printf("can not create a client, is libgnss.so on the library path?\n");
+            return 1;
+        }
+        TrackingOptions options;
+        options.size = sizeof(TrackingOptions);
+        options.minInterval = 1000;
+        clients.push_back(client);
+        sessions.push_back(client->startTracking(options));
+    }
+    // every client tracks before the first event
+    for (int i = 0; i < 500 && sCallbacks[REPLAY_CB_RESPONSE] < (uint64_t)clientCount; i++) {
+        usleep(10000);
+    }
+    LocApiReplay* replay = sProxy->getLocApiReplay();
+    if (NULL == replay) {
+        printf("the adapters did not take the replay LocApi\n");
+        return 1;
+    }
+    replay->setListeners(LOC_REPLAY_POSITION, clientCount);
+    replay->setListeners(LOC_REPLAY_SV, fullClientCount);
+    replay->setListeners(LOC_REPLAY_MEASUREMENTS, fullClientCount);
+
+    struct rusage usageStart, usageEnd;
+    getrusage(RUSAGE_SELF, &usageStart);
+    uint64_t cpuStart = cpuNs(CLOCK_PROCESS_CPUTIME_ID);
+    uint64_t wallStart = cpuNs(CLOCK_MONOTONIC);
+    replay->play();
+    uint32_t timeoutMs = 60000 + ((speed > 0) ?
+            (uint32_t)(rounds * (events.back().mTimeMs + 1000) / speed) : 0);
+    if (!replay->waitDone(timeoutMs)) {
+        printf("timed out, the replay never started or the adapters got stuck\n");
+        return 1;
+    }
+    uint64_t wallNs = cpuNs(CLOCK_MONOTONIC) - wallStart;
+    uint64_t cpuTotalNs = cpuNs(CLOCK_PROCESS_CPUTIME_ID) - cpuStart;
+    getrusage(RUSAGE_SELF, &usageEnd);
+
+    static const char* sTypeNames[] = { "position", "sv", "measurements", "debug nmea" };
+    uint64_t dispatched = 0;
+    printf("%-12s %9s %9s %9s %9s %9s %9s %9s %9s\n", "event", "reported", "delivered",
+           "unmatched", "skipped", "p50 us", "p90 us", "p99 us", "max us");
+    for (int type = 0; type < LOC_REPLAY_EVENT_TYPE_COUNT; type++) {
+        LocReplayStats stats;
+        replay->getStats((LocReplayEventType)type, stats);
+        std::sort(stats.mLatencyNs.begin(), stats.mLatencyNs.end());
+        dispatched += stats.mDispatched;
+        printf("%-12s %9" PRIu64 " %9" PRIu64 " %9" PRIu64 " %9" PRIu64
+               " %9.1f %9.1f %9.1f %9.1f\n", sTypeNames[type], stats.mDispatched,
+               stats.mDelivered, stats.mUnmatched, stats.mSkipped,
+               usOf(stats.mLatencyNs, 0.5), usOf(stats.mLatencyNs, 0.9),
+               usOf(stats.mLatencyNs, 0.99), usOf(stats.mLatencyNs, 1));
+    }
+    uint64_t callbackCount = sCallbacks[REPLAY_CB_TRACKING] + sCallbacks[REPLAY_CB_SV] +
+            sCallbacks[REPLAY_CB_NMEA] + sCallbacks[REPLAY_CB_MEASUREMENTS];
+    printf("callbacks of %d clients, %d only tracking: tracking %" PRIu64 ", sv %" PRIu64
+           ", nmea %" PRIu64 ", measurements %" PRIu64 "\n", clientCount,
+           clientCount - fullClientCount,
+           sCallbacks[REPLAY_CB_TRACKING].load(), sCallbacks[REPLAY_CB_SV].load(),
+           sCallbacks[REPLAY_CB_NMEA].load(), sCallbacks[REPLAY_CB_MEASUREMENTS].load());
+    // the replay thread builds the reports, the rest is the adapters and clients
+    uint64_t adapterNs = cpuTotalNs - std::min(cpuTotalNs, replay->getReplayCpuNs());
+    printf("wall %.1f ms, %.0f events/s; cpu %.1f ms, replay %.1f ms, adapters %.1f ms, "
+           "%.2f us per event\n", wallNs / 1e6, dispatched * 1e9 / wallNs, cpuTotalNs / 1e6,
+           replay->getReplayCpuNs() / 1e6, adapterNs / 1e6,
+           dispatched ? adapterNs / 1e3 / dispatched : 0);
+    printf("adapters %.0f ns per callback\n",
+           callbackCount ? (double)adapterNs / callbackCount : 0);
+    printf("context switches: %ld voluntary, %ld involuntary\n",
+           usageEnd.ru_nvcsw - usageStart.ru_nvcsw, usageEnd.ru_nivcsw - usageStart.ru_nivcsw);
+
+    for (size_t i = 0; i < clients.size(); i++) {
+        clients[i]->stopTracking(sessions[i]);
+        clients[i]->destroy();
+    }
+    return 0;
+}
+
+#endif // __LOC_DEBUG__
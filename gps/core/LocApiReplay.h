@@ -0,0 +1,202 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_API_REPLAY_H
+#define LOC_API_REPLAY_H
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <LocApiBase.h>
+#include <LBSProxyBase.h>
+
+namespace loc_core {
+
+enum LocReplayEventType {
+    LOC_REPLAY_POSITION = 0,
+    LOC_REPLAY_SV,
+    LOC_REPLAY_MEASUREMENTS,
+    LOC_REPLAY_NMEA,
+    LOC_REPLAY_EVENT_TYPE_COUNT
+};
+
+struct LocReplaySv {
+    GnssSvType mType;
+    uint16_t mSvId;
+    float mCn0Dbhz;
+    float mElevation;
+    float mAzimuth;
+};
+
+/* One line of a replay trace, '#' starts a comment line:
+     <ms> POS <s|i|f> <lat> <lon> <alt> <accuracy> <speed> <bearing> [<gps sv used mask>]
+     <ms> SV <type>,<svId>,<cN0>,<elevation>,<azimuth> ...
+     <ms> MEAS <type>,<svId>,<cN0> ...
+     <ms> NMEA <sentence>
+   <ms> is the time of the event since the start of the trace; s/i/f are
+   final, intermediate and failed fixes; <type> is a GnssSvType. */
+struct LocReplayEvent {
+    uint32_t mTimeMs;
+    LocReplayEventType mType;
+    loc_sess_status mStatus;
+    double mLatitude;
+    double mLongitude;
+    double mAltitude;
+    float mAccuracy;
+    float mSpeed;
+    float mBearing;
+    uint64_t mGpsSvUsedMask;
+    std::vector<LocReplaySv> mSvs;
+    std::string mNmea;
+};
+
+struct LocReplayStats {
+    // reports made to the adapters, callbacks matched to one of them,
+    // callbacks that matched none, e.g. NMEA generated on the AP, and reports
+    // given up on before every listener got them, e.g. SV status the adapters
+    // dropped for a newer one
+    uint64_t mDispatched;
+    uint64_t mDelivered;
+    uint64_t mUnmatched;
+    uint64_t mSkipped;
+    // report to callback, one per matched callback
+    std::vector<uint64_t> mLatencyNs;
+    inline LocReplayStats() : mDispatched(0), mDelivered(0), mUnmatched(0), mSkipped(0) {}
+};
+
+/* A LocApi with no engine behind it, which replays a trace into the adapters
+   as the engine would report it, from a thread of its own, once a session is
+   started and play() was called. Events are paced at *speed* times the pace
+   of the trace, 0 for as fast as they can be reported, and the trace is played
+   *rounds* times in a row, shifted in time each round.
+   Clients of the adapters hand what they get to delivered(), which finds the
+   report it came from by key and records how long it took to get there:
+   a position by its timestamp, measurements by their clock time, SVs by
+   their signals and the time of the report, which the replay stores in the
+   carrier frequency of the SVs, as SV status has no time of its own.
+   Debug NMEA is mostly consumed by SystemStatus and never reaches a client,
+   so its report is followed by a message on the adapters' MsgTask, which is
+   delivered once all before it were processed.
+   Each type of report is delivered in order, so a report is forgotten once
+   all its listeners got it, or once a later one of its type was delivered. */
+class LocApiReplay : public LocApiBase {
+public:
+    LocApiReplay(LOC_API_ADAPTER_EVENT_MASK_T exMask, ContextBase* context,
+                 const std::vector<LocReplayEvent>& events, float speed, uint32_t rounds);
+    virtual ~LocApiReplay();
+
+    // parses the trace at *path* into *events*, false if it can not be read
+    static bool load(const char* path, std::vector<LocReplayEvent>& events);
+    static uint64_t keyOf(const Location& location);
+    static uint64_t keyOf(const GnssSvNotification& svNotify);
+    static uint64_t keyOf(const GnssMeasurementsNotification& measurements);
+
+    // the trace is played once this was called and a session is started
+    void play();
+    // waits until the trace was played and the adapters processed all of it,
+    // up to *timeoutMs*, 0 for no limit; false if it timed out
+    bool waitDone(uint32_t timeoutMs = 0);
+    // callbacks each report of *type* reaches, 1 unless set before play()
+    void setListeners(LocReplayEventType type, uint32_t listeners);
+    void delivered(LocReplayEventType type, uint64_t key);
+    void getStats(LocReplayEventType type, LocReplayStats& stats);
+    // CPU time the replay thread took to build and report the events
+    inline uint64_t getReplayCpuNs() const { return mReplayCpuNs; }
+
+protected:
+    virtual enum loc_api_adapter_err open(LOC_API_ADAPTER_EVENT_MASK_T mask);
+    virtual enum loc_api_adapter_err close();
+    virtual void startFix(const LocPosMode& fixCriteria, LocApiResponse* adapterResponse);
+    virtual void stopFix(LocApiResponse* adapterResponse);
+    virtual void startTimeBasedTracking(const TrackingOptions& options,
+                                        LocApiResponse* adapterResponse);
+    virtual void stopTimeBasedTracking(LocApiResponse* adapterResponse);
+
+private:
+    const std::vector<LocReplayEvent> mEvents;
+    const float mSpeed;
+    const uint32_t mRounds;
+    pthread_mutex_t mMutex;
+    pthread_cond_t mCond;
+    pthread_t mThread;
+    bool mThreadStarted;
+    bool mPlayRequested;
+    bool mTracking;
+    bool mStopRequested;
+    bool mDone;
+    uint64_t mReplayCpuNs;
+    uint64_t mNmeaSequence;
+    // reports still waited for, in the order they were made, per event type
+    struct Pending {
+        uint64_t mKey;
+        uint64_t mDispatchNs;
+        uint32_t mRemaining;
+    };
+    std::deque<Pending> mPending[LOC_REPLAY_EVENT_TYPE_COUNT];
+    uint32_t mListeners[LOC_REPLAY_EVENT_TYPE_COUNT];
+    LocReplayStats mStats[LOC_REPLAY_EVENT_TYPE_COUNT];
+    // reused for every report, measurements are large
+    GnssMeasurements* mMeasurements;
+    GnssSvNotification mSvNotify;
+
+    void setTracking(bool tracking, LocApiResponse* adapterResponse);
+    void startThreadLocked();
+    void replay();
+    bool waitUntil(uint64_t timeNs);
+    void dispatch(const LocReplayEvent& event, uint64_t timeOffsetMs);
+    void dispatched(LocReplayEventType type, uint64_t key);
+    static void* threadMain(void* arg);
+};
+
+/* Hands out a LocApiReplay in place of the LocApi of the engine; returned by
+   the getLBSProxy() of whichever library or program is loaded as the LBS
+   library of the LocContext. */
+class LocApiReplayProxy : public LBSProxyBase {
+public:
+    inline LocApiReplayProxy(const std::vector<LocReplayEvent>& events,
+                             float speed, uint32_t rounds, bool autoPlay) :
+        mEvents(events), mSpeed(speed), mRounds(rounds), mAutoPlay(autoPlay),
+        mLocApi(nullptr) {}
+    inline virtual ~LocApiReplayProxy() {}
+    inline LocApiReplay* getLocApiReplay() const { return mLocApi; }
+
+private:
+    const std::vector<LocReplayEvent> mEvents;
+    const float mSpeed;
+    const uint32_t mRounds;
+    const bool mAutoPlay;
+    mutable LocApiReplay* mLocApi;
+
+    virtual LocApiBase* getLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                                  ContextBase* context) const;
+};
+
+} // namespace loc_core
+
+#endif // LOC_API_REPLAY_H
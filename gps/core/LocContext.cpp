@@ -35,6 +35,7 @@
 #include <msg_q.h>
 #include <log_util.h>
 #include <loc_log.h>
+#include <LocStartupTrace.h>
 
 namespace loc_core {
 
@@ -54,7 +55,19 @@ const MsgTask* LocContext::getMsgTask(LocThread::tCreate tCreator,
                                           const char* name, bool joinable)
 {
     if (NULL == mMsgTask) {
-        mMsgTask = new MsgTask(tCreator, name, joinable);
+        // drain in batches so a backlog of SV reports collapses to the latest;
+        // off unless COALESCE_REPORTS is set in gps.conf
+        uint32_t coalesceReports = 0;
+        static const loc_param_s_type gps_conf_param_table[] =
+        {
+            {"COALESCE_REPORTS", &coalesceReports, NULL, 'n'},
+        };
+        UTIL_READ_CONF(LOC_PATH_GPS_CONF, gps_conf_param_table);
+
+        // reports are sent lock free, and spill to a list in a burst rather than
+        // block, as the adapters also send to their own queue
+        mMsgTask = new MsgTask(tCreator, name, joinable, 1024, eMSG_Q_OVERFLOW_SPILL,
+                               coalesceReports ? MsgTask::MAX_DRAIN_BATCH : 1);
     }
     return mMsgTask;
 }
@@ -71,6 +84,9 @@ ContextBase* LocContext::getLocContext(LocThread::tCreate tCreator,
     LOC_LOGD("%s:%d]: querying ContextBase with tCreator", __func__, __LINE__);
     if (NULL == mContext) {
         LOC_LOGD("%s:%d]: creating msgTask with tCreator", __func__, __LINE__);
+        loc_util::LocStartupTrace::mark("LocContext::getLocContext");
+        // the conf files are parsed while the context loads its libraries
+        ContextBase::prefetchConfig();
         const MsgTask* msgTask = getMsgTask(tCreator, name, joinable);
         mContext = new LocContext(msgTask);
     }
@@ -48,11 +48,57 @@ namespace loc_core
 /******************************************************************************
  SystemStatusNmeaBase - base class for all NMEA parsers
 ******************************************************************************/
+// A field of a debug NMEA sentence. It points into the sentence itself, and
+// is not NUL terminated, but ends at the ',' or '*' that follows. Number
+// conversions such as atoi() / atof() / strtol() stop right there too.
+class SystemStatusNmeaField
+{
+    const char* mStr;
+    uint32_t    mLen;
+public:
+    inline SystemStatusNmeaField() : mStr(""), mLen(0) {}
+    inline SystemStatusNmeaField(const char* str, uint32_t len) : mStr(str), mLen(len) {}
+    inline const char* str() const { return mStr; }
+    inline uint32_t length() const { return mLen; }
+};
+
 class SystemStatusNmeaBase
 {
+public:
+    static const uint32_t NMEA_MINSIZE = DEBUG_NMEA_MINSIZE;
+    static const uint32_t NMEA_MAXSIZE = DEBUG_NMEA_MAXSIZE;
+    // $PQWP7 is the longest one, with 2 + SV_ALL_NUM*3 fields
+    static const uint32_t NMEA_MAXFIELDS = 512;
+
+private:
+    // tokens of the sentence up to the '*', in a single pass, without copy
+    class Fields
+    {
+        SystemStatusNmeaField mField[NMEA_MAXFIELDS];
+        uint32_t mCount;
+    public:
+        inline Fields() : mCount(0) {}
+        inline size_t size() const { return mCount; }
+        inline const SystemStatusNmeaField& operator[](size_t i) const { return mField[i]; }
+        inline void push_back(const SystemStatusNmeaField& field) {
+            if (mCount < NMEA_MAXFIELDS) {
+                mField[mCount++] = field;
+            }
+        }
+        inline void clear() { mCount = 0; }
+    };
+
+    static inline int hexValue(char c) {
+        return (c >= '0' && c <= '9') ? c - '0' :
+               (c >= 'A' && c <= 'F') ? c - 'A' + 10 :
+               (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+    }
+
 protected:
-    std::vector<std::string> mField;
+    Fields mField;
 
+    // Fields are only kept if the sentence has a '*' followed by a checksum
+    // matching the XOR of all characters between '$' and '*'.
     SystemStatusNmeaBase(const char *str_in, uint32_t len_in)
     {
         // check size and talker
@@ -60,34 +106,38 @@ protected:
             return;
         }
 
-        std::string parser(str_in);
-        std::string::size_type index = 0;
+        uint8_t checksum = 0;
+        uint32_t start = 0;
+        uint32_t i = 0;
+        for (; i < len_in && '\0' != str_in[i] && '*' != str_in[i]; i++) {
+            if (i > 0) {
+                checksum ^= (uint8_t)str_in[i];
+            }
+            if (',' == str_in[i]) {
+                mField.push_back(SystemStatusNmeaField(str_in + start, i - start));
+                start = i + 1;
+            }
+        }
 
         // verify checksum field
-        index = parser.find("*");
-        if (index == std::string::npos) {
+        if (i + 2 >= len_in || '*' != str_in[i] ||
+            hexValue(str_in[i + 1]) < 0 || hexValue(str_in[i + 2]) < 0) {
+            mField.clear();
             return;
         }
-        parser[index] = ',';
-
-        // tokenize parser
-        while (1) {
-            std::string str;
-            index = parser.find(",");
-            if (index == std::string::npos) {
-                break;
-            }
-            str = parser.substr(0, index);
-            parser = parser.substr(index + 1);
-            mField.push_back(str);
+        if (checksum != (hexValue(str_in[i + 1]) << 4 | hexValue(str_in[i + 2]))) {
+            LOC_LOGE("%.6s - checksum mismatch", str_in);
+            mField.clear();
+            return;
         }
+        mField.push_back(SystemStatusNmeaField(str_in + start, i - start));
     }
 
     virtual ~SystemStatusNmeaBase() { }
 
 public:
-    static const uint32_t NMEA_MINSIZE = DEBUG_NMEA_MINSIZE;
-    static const uint32_t NMEA_MAXSIZE = DEBUG_NMEA_MAXSIZE;
+    // false if the sentence is malformed, e.g. has a bad checksum
+    inline bool isValid() const { return mField.size() > 0; }
 };
 
 /******************************************************************************
@@ -214,42 +264,42 @@ public:
             mM1.mTimeValid = 0;
             return;
         }
-        mM1.mGpsWeek = atoi(mField[eGpsWeek].c_str());
-        mM1.mGpsTowMs = atoi(mField[eGpsTowMs].c_str());
-        mM1.mTimeValid = atoi(mField[eTimeValid].c_str());
-        mM1.mTimeSource = atoi(mField[eTimeSource].c_str());
-        mM1.mTimeUnc = atoi(mField[eTimeUnc].c_str());
-        mM1.mClockFreqBias = atoi(mField[eClockFreqBias].c_str());
-        mM1.mClockFreqBiasUnc = atoi(mField[eClockFreqBiasUnc].c_str());
-        mM1.mXoState = atoi(mField[eXoState].c_str());
-        mM1.mPgaGain = atoi(mField[ePgaGain].c_str());
-        mM1.mGpsBpAmpI = atoi(mField[eGpsBpAmpI].c_str());
-        mM1.mGpsBpAmpQ = atoi(mField[eGpsBpAmpQ].c_str());
-        mM1.mAdcI = atoi(mField[eAdcI].c_str());
-        mM1.mAdcQ = atoi(mField[eAdcQ].c_str());
-        mM1.mJammerGps = atoi(mField[eJammerGps].c_str());
-        mM1.mJammerGlo = atoi(mField[eJammerGlo].c_str());
-        mM1.mJammerBds = atoi(mField[eJammerBds].c_str());
-        mM1.mJammerGal = atoi(mField[eJammerGal].c_str());
-        mM1.mRecErrorRecovery = atoi(mField[eRecErrorRecovery].c_str());
-        mM1.mAgcGps = atof(mField[eAgcGps].c_str());
-        mM1.mAgcGlo = atof(mField[eAgcGlo].c_str());
-        mM1.mAgcBds = atof(mField[eAgcBds].c_str());
-        mM1.mAgcGal = atof(mField[eAgcGal].c_str());
+        mM1.mGpsWeek = atoi(mField[eGpsWeek].str());
+        mM1.mGpsTowMs = atoi(mField[eGpsTowMs].str());
+        mM1.mTimeValid = atoi(mField[eTimeValid].str());
+        mM1.mTimeSource = atoi(mField[eTimeSource].str());
+        mM1.mTimeUnc = atoi(mField[eTimeUnc].str());
+        mM1.mClockFreqBias = atoi(mField[eClockFreqBias].str());
+        mM1.mClockFreqBiasUnc = atoi(mField[eClockFreqBiasUnc].str());
+        mM1.mXoState = atoi(mField[eXoState].str());
+        mM1.mPgaGain = atoi(mField[ePgaGain].str());
+        mM1.mGpsBpAmpI = atoi(mField[eGpsBpAmpI].str());
+        mM1.mGpsBpAmpQ = atoi(mField[eGpsBpAmpQ].str());
+        mM1.mAdcI = atoi(mField[eAdcI].str());
+        mM1.mAdcQ = atoi(mField[eAdcQ].str());
+        mM1.mJammerGps = atoi(mField[eJammerGps].str());
+        mM1.mJammerGlo = atoi(mField[eJammerGlo].str());
+        mM1.mJammerBds = atoi(mField[eJammerBds].str());
+        mM1.mJammerGal = atoi(mField[eJammerGal].str());
+        mM1.mRecErrorRecovery = atoi(mField[eRecErrorRecovery].str());
+        mM1.mAgcGps = atof(mField[eAgcGps].str());
+        mM1.mAgcGlo = atof(mField[eAgcGlo].str());
+        mM1.mAgcBds = atof(mField[eAgcBds].str());
+        mM1.mAgcGal = atof(mField[eAgcGal].str());
         if (mField.size() > eLeapSecUnc) {
-            mM1.mLeapSeconds = atoi(mField[eLeapSeconds].c_str());
-            mM1.mLeapSecUnc = atoi(mField[eLeapSecUnc].c_str());
+            mM1.mLeapSeconds = atoi(mField[eLeapSeconds].str());
+            mM1.mLeapSecUnc = atoi(mField[eLeapSecUnc].str());
         }
         if (mField.size() > eGalBpAmpQ) {
-            mM1.mGloBpAmpI = atoi(mField[eGloBpAmpI].c_str());
-            mM1.mGloBpAmpQ = atoi(mField[eGloBpAmpQ].c_str());
-            mM1.mBdsBpAmpI = atoi(mField[eBdsBpAmpI].c_str());
-            mM1.mBdsBpAmpQ = atoi(mField[eBdsBpAmpQ].c_str());
-            mM1.mGalBpAmpI = atoi(mField[eGalBpAmpI].c_str());
-            mM1.mGalBpAmpQ = atoi(mField[eGalBpAmpQ].c_str());
+            mM1.mGloBpAmpI = atoi(mField[eGloBpAmpI].str());
+            mM1.mGloBpAmpQ = atoi(mField[eGloBpAmpQ].str());
+            mM1.mBdsBpAmpI = atoi(mField[eBdsBpAmpI].str());
+            mM1.mBdsBpAmpQ = atoi(mField[eBdsBpAmpQ].str());
+            mM1.mGalBpAmpI = atoi(mField[eGalBpAmpI].str());
+            mM1.mGalBpAmpQ = atoi(mField[eGalBpAmpQ].str());
         }
         if (mField.size() > eTimeUncNs) {
-            mM1.mTimeUncNs = strtoull(mField[eTimeUncNs].c_str(), nullptr, 10);
+            mM1.mTimeUncNs = strtoull(mField[eTimeUncNs].str(), nullptr, 10);
         }
     }
 
@@ -305,13 +355,13 @@ public:
             return;
         }
         memset(&mP1, 0, sizeof(mP1));
-        mP1.mEpiValidity = strtol(mField[eEpiValidity].c_str(), NULL, 16);
-        mP1.mEpiLat = atof(mField[eEpiLat].c_str());
-        mP1.mEpiLon = atof(mField[eEpiLon].c_str());
-        mP1.mEpiAlt = atof(mField[eEpiAlt].c_str());
-        mP1.mEpiHepe = atoi(mField[eEpiHepe].c_str());
-        mP1.mEpiAltUnc = atof(mField[eEpiAltUnc].c_str());
-        mP1.mEpiSrc = atoi(mField[eEpiSrc].c_str());
+        mP1.mEpiValidity = strtol(mField[eEpiValidity].str(), NULL, 16);
+        mP1.mEpiLat = atof(mField[eEpiLat].str());
+        mP1.mEpiLon = atof(mField[eEpiLon].str());
+        mP1.mEpiAlt = atof(mField[eEpiAlt].str());
+        mP1.mEpiHepe = atoi(mField[eEpiHepe].str());
+        mP1.mEpiAltUnc = atof(mField[eEpiAltUnc].str());
+        mP1.mEpiSrc = atoi(mField[eEpiSrc].str());
     }
 
     inline SystemStatusPQWP1& get() { return mP1;}
@@ -360,11 +410,11 @@ public:
             return;
         }
         memset(&mP2, 0, sizeof(mP2));
-        mP2.mBestLat = atof(mField[eBestLat].c_str());
-        mP2.mBestLon = atof(mField[eBestLon].c_str());
-        mP2.mBestAlt = atof(mField[eBestAlt].c_str());
-        mP2.mBestHepe = atof(mField[eBestHepe].c_str());
-        mP2.mBestAltUnc = atof(mField[eBestAltUnc].c_str());
+        mP2.mBestLat = atof(mField[eBestLat].str());
+        mP2.mBestLon = atof(mField[eBestLon].str());
+        mP2.mBestAlt = atof(mField[eBestAlt].str());
+        mP2.mBestHepe = atof(mField[eBestHepe].str());
+        mP2.mBestAltUnc = atof(mField[eBestAltUnc].str());
     }
 
     inline SystemStatusPQWP2& get() { return mP2;}
@@ -437,17 +487,17 @@ public:
         }
         memset(&mP3, 0, sizeof(mP3));
         // todo: update for navic once available
-        mP3.mXtraValidMask = strtol(mField[eXtraValidMask].c_str(), NULL, 16);
-        mP3.mGpsXtraAge = atoi(mField[eGpsXtraAge].c_str());
-        mP3.mGloXtraAge = atoi(mField[eGloXtraAge].c_str());
-        mP3.mBdsXtraAge = atoi(mField[eBdsXtraAge].c_str());
-        mP3.mGalXtraAge = atoi(mField[eGalXtraAge].c_str());
-        mP3.mQzssXtraAge = atoi(mField[eQzssXtraAge].c_str());
-        mP3.mGpsXtraValid = strtol(mField[eGpsXtraValid].c_str(), NULL, 16);
-        mP3.mGloXtraValid = strtol(mField[eGloXtraValid].c_str(), NULL, 16);
-        mP3.mBdsXtraValid = strtol(mField[eBdsXtraValid].c_str(), NULL, 16);
-        mP3.mGalXtraValid = strtol(mField[eGalXtraValid].c_str(), NULL, 16);
-        mP3.mQzssXtraValid = strtol(mField[eQzssXtraValid].c_str(), NULL, 16);
+        mP3.mXtraValidMask = strtol(mField[eXtraValidMask].str(), NULL, 16);
+        mP3.mGpsXtraAge = atoi(mField[eGpsXtraAge].str());
+        mP3.mGloXtraAge = atoi(mField[eGloXtraAge].str());
+        mP3.mBdsXtraAge = atoi(mField[eBdsXtraAge].str());
+        mP3.mGalXtraAge = atoi(mField[eGalXtraAge].str());
+        mP3.mQzssXtraAge = atoi(mField[eQzssXtraAge].str());
+        mP3.mGpsXtraValid = strtol(mField[eGpsXtraValid].str(), NULL, 16);
+        mP3.mGloXtraValid = strtol(mField[eGloXtraValid].str(), NULL, 16);
+        mP3.mBdsXtraValid = strtol(mField[eBdsXtraValid].str(), NULL, 16);
+        mP3.mGalXtraValid = strtol(mField[eGalXtraValid].str(), NULL, 16);
+        mP3.mQzssXtraValid = strtol(mField[eQzssXtraValid].str(), NULL, 16);
     }
 
     inline SystemStatusPQWP3& get() { return mP3;}
@@ -496,11 +546,11 @@ public:
             return;
         }
         memset(&mP4, 0, sizeof(mP4));
-        mP4.mGpsEpheValid = strtol(mField[eGpsEpheValid].c_str(), NULL, 16);
-        mP4.mGloEpheValid = strtol(mField[eGloEpheValid].c_str(), NULL, 16);
-        mP4.mBdsEpheValid = strtol(mField[eBdsEpheValid].c_str(), NULL, 16);
-        mP4.mGalEpheValid = strtol(mField[eGalEpheValid].c_str(), NULL, 16);
-        mP4.mQzssEpheValid = strtol(mField[eQzssEpheValid].c_str(), NULL, 16);
+        mP4.mGpsEpheValid = strtol(mField[eGpsEpheValid].str(), NULL, 16);
+        mP4.mGloEpheValid = strtol(mField[eGloEpheValid].str(), NULL, 16);
+        mP4.mBdsEpheValid = strtol(mField[eBdsEpheValid].str(), NULL, 16);
+        mP4.mGalEpheValid = strtol(mField[eGalEpheValid].str(), NULL, 16);
+        mP4.mQzssEpheValid = strtol(mField[eQzssEpheValid].str(), NULL, 16);
     }
 
     inline SystemStatusPQWP4& get() { return mP4;}
@@ -587,21 +637,21 @@ public:
         }
         memset(&mP5, 0, sizeof(mP5));
         // todo: update for navic once available
-        mP5.mGpsUnknownMask = strtol(mField[eGpsUnknownMask].c_str(), NULL, 16);
-        mP5.mGloUnknownMask = strtol(mField[eGloUnknownMask].c_str(), NULL, 16);
-        mP5.mBdsUnknownMask = strtol(mField[eBdsUnknownMask].c_str(), NULL, 16);
-        mP5.mGalUnknownMask = strtol(mField[eGalUnknownMask].c_str(), NULL, 16);
-        mP5.mQzssUnknownMask = strtol(mField[eQzssUnknownMask].c_str(), NULL, 16);
-        mP5.mGpsGoodMask = strtol(mField[eGpsGoodMask].c_str(), NULL, 16);
-        mP5.mGloGoodMask = strtol(mField[eGloGoodMask].c_str(), NULL, 16);
-        mP5.mBdsGoodMask = strtol(mField[eBdsGoodMask].c_str(), NULL, 16);
-        mP5.mGalGoodMask = strtol(mField[eGalGoodMask].c_str(), NULL, 16);
-        mP5.mQzssGoodMask = strtol(mField[eQzssGoodMask].c_str(), NULL, 16);
-        mP5.mGpsBadMask = strtol(mField[eGpsBadMask].c_str(), NULL, 16);
-        mP5.mGloBadMask = strtol(mField[eGloBadMask].c_str(), NULL, 16);
-        mP5.mBdsBadMask = strtol(mField[eBdsBadMask].c_str(), NULL, 16);
-        mP5.mGalBadMask = strtol(mField[eGalBadMask].c_str(), NULL, 16);
-        mP5.mQzssBadMask = strtol(mField[eQzssBadMask].c_str(), NULL, 16);
+        mP5.mGpsUnknownMask = strtol(mField[eGpsUnknownMask].str(), NULL, 16);
+        mP5.mGloUnknownMask = strtol(mField[eGloUnknownMask].str(), NULL, 16);
+        mP5.mBdsUnknownMask = strtol(mField[eBdsUnknownMask].str(), NULL, 16);
+        mP5.mGalUnknownMask = strtol(mField[eGalUnknownMask].str(), NULL, 16);
+        mP5.mQzssUnknownMask = strtol(mField[eQzssUnknownMask].str(), NULL, 16);
+        mP5.mGpsGoodMask = strtol(mField[eGpsGoodMask].str(), NULL, 16);
+        mP5.mGloGoodMask = strtol(mField[eGloGoodMask].str(), NULL, 16);
+        mP5.mBdsGoodMask = strtol(mField[eBdsGoodMask].str(), NULL, 16);
+        mP5.mGalGoodMask = strtol(mField[eGalGoodMask].str(), NULL, 16);
+        mP5.mQzssGoodMask = strtol(mField[eQzssGoodMask].str(), NULL, 16);
+        mP5.mGpsBadMask = strtol(mField[eGpsBadMask].str(), NULL, 16);
+        mP5.mGloBadMask = strtol(mField[eGloBadMask].str(), NULL, 16);
+        mP5.mBdsBadMask = strtol(mField[eBdsBadMask].str(), NULL, 16);
+        mP5.mGalBadMask = strtol(mField[eGalBadMask].str(), NULL, 16);
+        mP5.mQzssBadMask = strtol(mField[eQzssBadMask].str(), NULL, 16);
     }
 
     inline SystemStatusPQWP5& get() { return mP5;}
@@ -638,7 +688,7 @@ public:
             return;
         }
         memset(&mP6, 0, sizeof(mP6));
-        mP6.mFixInfoMask = strtol(mField[eFixInfoMask].c_str(), NULL, 16);
+        mP6.mFixInfoMask = strtol(mField[eFixInfoMask].str(), NULL, 16);
     }
 
     inline SystemStatusPQWP6& get() { return mP6;}
@@ -664,6 +714,7 @@ private:
         eMax = 2 + SV_ALL_NUM*3
     };
     SystemStatusPQWP7 mP7;
+    static_assert(eMax <= NMEA_MAXFIELDS, "PQWP7 has more fields than NMEA_MAXFIELDS");
 
 public:
     SystemStatusPQWP7parser(const char *str_in, uint32_t len_in)
@@ -681,9 +732,9 @@ public:
 
         memset(mP7.mNav, 0, sizeof(mP7.mNav));
         for (uint32_t i=0; i<svLimit; i++) {
-            mP7.mNav[i].mType   = GnssEphemerisType(atoi(mField[i*3+2].c_str()));
-            mP7.mNav[i].mSource = GnssEphemerisSource(atoi(mField[i*3+3].c_str()));
-            mP7.mNav[i].mAgeSec = atoi(mField[i*3+4].c_str());
+            mP7.mNav[i].mType   = GnssEphemerisType(atoi(mField[i*3+2].str()));
+            mP7.mNav[i].mSource = GnssEphemerisSource(atoi(mField[i*3+3].str()));
+            mP7.mNav[i].mAgeSec = atoi(mField[i*3+4].str());
         }
     }
 
@@ -724,8 +775,8 @@ public:
             return;
         }
         memset(&mS1, 0, sizeof(mS1));
-        mS1.mFixInfoMask = atoi(mField[eFixInfoMask].c_str());
-        mS1.mHepeLimit = atoi(mField[eHepeLimit].c_str());
+        mS1.mFixInfoMask = atoi(mField[eFixInfoMask].str());
+        mS1.mHepeLimit = atoi(mField[eHepeLimit].str());
     }
 
     inline SystemStatusPQWS1& get() { return mS1;}
@@ -1343,38 +1394,25 @@ SystemStatus::SystemStatus(const MsgTask* msgTask) :
 /******************************************************************************
  SystemStatus - storing dataitems
 ******************************************************************************/
-template <typename TYPE_REPORT, typename TYPE_ITEM>
-bool SystemStatus::setIteminReport(TYPE_REPORT& report, TYPE_ITEM&& s)
+template <typename TYPE_ITEM>
+bool SystemStatus::setIteminReport(SystemStatusReportCache<TYPE_ITEM>& report, TYPE_ITEM&& s)
 {
-    if (!report.empty() && report.back().equals(static_cast<TYPE_ITEM&>(s.collate(report.back())))) {
-        // there is no change - just update reported timestamp
-        report.back().mUtcReported = s.mUtcReported;
-        return false;
-    }
-
-    // first event or updated
-    report.push_back(s);
-    if (report.size() > s.maxItem) {
-        report.erase(report.begin());
-    }
-    return true;
+    return report.set(s);
 }
 
-template <typename TYPE_REPORT, typename TYPE_ITEM>
-void SystemStatus::setDefaultIteminReport(TYPE_REPORT& report, const TYPE_ITEM& s)
+template <typename TYPE_ITEM>
+void SystemStatus::setDefaultIteminReport(SystemStatusReportCache<TYPE_ITEM>& report,
+                                          const TYPE_ITEM& s)
 {
-    report.push_back(s);
-    if (report.size() > s.maxItem) {
-        report.erase(report.begin());
-    }
+    report.setDefault(s);
 }
 
-template <typename TYPE_REPORT, typename TYPE_ITEM>
-void SystemStatus::getIteminReport(TYPE_REPORT& reportout, const TYPE_ITEM& c) const
+template <typename TYPE_ITEM>
+void SystemStatus::getIteminReport(SystemStatusReport<TYPE_ITEM>& reportout,
+                                   const SystemStatusReportCache<TYPE_ITEM>& c) const
 {
-    reportout.clear();
-    if (c.size() >= 1) {
-        reportout.push_back(c.back());
+    c.getLatest(reportout);
+    if (!reportout.empty()) {
         reportout.back().dump();
     }
 }
@@ -1393,56 +1431,69 @@ bool SystemStatus::setNmeaString(const char *data, uint32_t len)
         return false;
     }
 
-    char buf[SystemStatusNmeaBase::NMEA_MAXSIZE + 1] = { 0 };
-    strlcpy(buf, data, sizeof(buf));
-
-    pthread_mutex_lock(&mMutexSystemStatus);
-
-    // parse the received nmea strings here
+    // parse the received nmea strings here, in place
     if (0 == strncmp(data, "$PQWM1", SystemStatusNmeaBase::NMEA_MINSIZE)) {
-        SystemStatusPQWM1 s = SystemStatusPQWM1parser(buf, len).get();
-        setIteminReport(mCache.mTimeAndClock, SystemStatusTimeAndClock(s));
-        setIteminReport(mCache.mXoState, SystemStatusXoState(s));
-        setIteminReport(mCache.mRfAndParams, SystemStatusRfAndParams(s));
-        setIteminReport(mCache.mErrRecovery, SystemStatusErrRecovery(s));
+        SystemStatusPQWM1parser parser(data, len);
+        if (parser.isValid()) {
+            SystemStatusPQWM1 s = parser.get();
+            setIteminReport(mCache.mTimeAndClock, SystemStatusTimeAndClock(s));
+            setIteminReport(mCache.mXoState, SystemStatusXoState(s));
+            setIteminReport(mCache.mRfAndParams, SystemStatusRfAndParams(s));
+            setIteminReport(mCache.mErrRecovery, SystemStatusErrRecovery(s));
+        }
     }
     else if (0 == strncmp(data, "$PQWP1", SystemStatusNmeaBase::NMEA_MINSIZE)) {
-        setIteminReport(mCache.mInjectedPosition,
-                SystemStatusInjectedPosition(SystemStatusPQWP1parser(buf, len).get()));
+        SystemStatusPQWP1parser parser(data, len);
+        if (parser.isValid()) {
+            setIteminReport(mCache.mInjectedPosition, SystemStatusInjectedPosition(parser.get()));
+        }
     }
     else if (0 == strncmp(data, "$PQWP2", SystemStatusNmeaBase::NMEA_MINSIZE)) {
-        setIteminReport(mCache.mBestPosition,
-                SystemStatusBestPosition(SystemStatusPQWP2parser(buf, len).get()));
+        SystemStatusPQWP2parser parser(data, len);
+        if (parser.isValid()) {
+            setIteminReport(mCache.mBestPosition, SystemStatusBestPosition(parser.get()));
+        }
     }
     else if (0 == strncmp(data, "$PQWP3", SystemStatusNmeaBase::NMEA_MINSIZE)) {
-        setIteminReport(mCache.mXtra,
-                SystemStatusXtra(SystemStatusPQWP3parser(buf, len).get()));
+        SystemStatusPQWP3parser parser(data, len);
+        if (parser.isValid()) {
+            setIteminReport(mCache.mXtra, SystemStatusXtra(parser.get()));
+        }
     }
     else if (0 == strncmp(data, "$PQWP4", SystemStatusNmeaBase::NMEA_MINSIZE)) {
-        setIteminReport(mCache.mEphemeris,
-                SystemStatusEphemeris(SystemStatusPQWP4parser(buf, len).get()));
+        SystemStatusPQWP4parser parser(data, len);
+        if (parser.isValid()) {
+            setIteminReport(mCache.mEphemeris, SystemStatusEphemeris(parser.get()));
+        }
     }
     else if (0 == strncmp(data, "$PQWP5", SystemStatusNmeaBase::NMEA_MINSIZE)) {
-        setIteminReport(mCache.mSvHealth,
-                SystemStatusSvHealth(SystemStatusPQWP5parser(buf, len).get()));
+        SystemStatusPQWP5parser parser(data, len);
+        if (parser.isValid()) {
+            setIteminReport(mCache.mSvHealth, SystemStatusSvHealth(parser.get()));
+        }
     }
     else if (0 == strncmp(data, "$PQWP6", SystemStatusNmeaBase::NMEA_MINSIZE)) {
-        setIteminReport(mCache.mPdr,
-                SystemStatusPdr(SystemStatusPQWP6parser(buf, len).get()));
+        SystemStatusPQWP6parser parser(data, len);
+        if (parser.isValid()) {
+            setIteminReport(mCache.mPdr, SystemStatusPdr(parser.get()));
+        }
     }
     else if (0 == strncmp(data, "$PQWP7", SystemStatusNmeaBase::NMEA_MINSIZE)) {
-        setIteminReport(mCache.mNavData,
-                SystemStatusNavData(SystemStatusPQWP7parser(buf, len).get()));
+        SystemStatusPQWP7parser parser(data, len);
+        if (parser.isValid()) {
+            setIteminReport(mCache.mNavData, SystemStatusNavData(parser.get()));
+        }
     }
     else if (0 == strncmp(data, "$PQWS1", SystemStatusNmeaBase::NMEA_MINSIZE)) {
-        setIteminReport(mCache.mPositionFailure,
-                SystemStatusPositionFailure(SystemStatusPQWS1parser(buf, len).get()));
+        SystemStatusPQWS1parser parser(data, len);
+        if (parser.isValid()) {
+            setIteminReport(mCache.mPositionFailure, SystemStatusPositionFailure(parser.get()));
+        }
     }
     else {
         // do nothing
     }
 
-    pthread_mutex_unlock(&mMutexSystemStatus);
     return true;
 }
 
@@ -1457,8 +1508,6 @@ bool SystemStatus::eventPosition(const UlpLocation& location,
                                  const GpsLocationExtended& locationEx)
 {
     bool ret = false;
-    pthread_mutex_lock(&mMutexSystemStatus);
-
     ret = setIteminReport(mCache.mLocation, SystemStatusLocation(location, locationEx));
     LOC_LOGV("eventPosition - lat=%f lon=%f alt=%f speed=%f",
              location.gpsLocation.latitude,
@@ -1466,7 +1515,6 @@ bool SystemStatus::eventPosition(const UlpLocation& location,
              location.gpsLocation.altitude,
              location.gpsLocation.speed);
 
-    pthread_mutex_unlock(&mMutexSystemStatus);
     return ret;
 }
 
@@ -1480,7 +1528,6 @@ bool SystemStatus::eventPosition(const UlpLocation& location,
 bool SystemStatus::eventDataItemNotify(IDataItemCore* dataitem)
 {
     bool ret = false;
-    pthread_mutex_lock(&mMutexSystemStatus);
     switch(dataitem->getId())
     {
         case AIRPLANEMODE_DATA_ITEM_ID:
@@ -1574,7 +1621,6 @@ bool SystemStatus::eventDataItemNotify(IDataItemCore* dataitem)
         default:
             break;
     }
-    pthread_mutex_unlock(&mMutexSystemStatus);
     return ret;
 }
 
@@ -1588,10 +1634,8 @@ bool SystemStatus::eventDataItemNotify(IDataItemCore* dataitem)
 ******************************************************************************/
 bool SystemStatus::getReport(SystemStatusReports& report, bool isLatestOnly) const
 {
-    pthread_mutex_lock(&mMutexSystemStatus);
-
     if (isLatestOnly) {
-        // push back only the latest report and return it
+        // push back only the latest report and return it, without waiting
         getIteminReport(report.mLocation, mCache.mLocation);
 
         getIteminReport(report.mTimeAndClock, mCache.mTimeAndClock);
@@ -1633,51 +1677,48 @@ bool SystemStatus::getReport(SystemStatusReports& report, bool isLatestOnly) con
         getIteminReport(report.mBtLeDeviceScanDetail, mCache.mBtLeDeviceScanDetail);
     }
     else {
-        // copy entire reports and return them
-        report.mLocation.clear();
-
-        report.mTimeAndClock.clear();
-        report.mXoState.clear();
-        report.mRfAndParams.clear();
-        report.mErrRecovery.clear();
-
-        report.mInjectedPosition.clear();
-        report.mBestPosition.clear();
-        report.mXtra.clear();
-        report.mEphemeris.clear();
-        report.mSvHealth.clear();
-        report.mPdr.clear();
-        report.mNavData.clear();
-
-        report.mPositionFailure.clear();
-
-        report.mAirplaneMode.clear();
-        report.mENH.clear();
-        report.mGPSState.clear();
-        report.mNLPStatus.clear();
-        report.mWifiHardwareState.clear();
-        report.mNetworkInfo.clear();
-        report.mRilServiceInfo.clear();
-        report.mRilCellInfo.clear();
-        report.mServiceStatus.clear();
-        report.mModel.clear();
-        report.mManufacturer.clear();
-        report.mAssistedGps.clear();
-        report.mScreenState.clear();
-        report.mPowerConnectState.clear();
-        report.mTimeZoneChange.clear();
-        report.mTimeChange.clear();
-        report.mWifiSupplicantStatus.clear();
-        report.mShutdownState.clear();
-        report.mTac.clear();
-        report.mMccMnc.clear();
-        report.mBtDeviceScanDetail.clear();
-        report.mBtLeDeviceScanDetail.clear();
-
-        report = mCache;
+        // copy entire reports, each under the lock of its own type only
+        mCache.mLocation.getHistory(report.mLocation);
+
+        mCache.mTimeAndClock.getHistory(report.mTimeAndClock);
+        mCache.mXoState.getHistory(report.mXoState);
+        mCache.mRfAndParams.getHistory(report.mRfAndParams);
+        mCache.mErrRecovery.getHistory(report.mErrRecovery);
+
+        mCache.mInjectedPosition.getHistory(report.mInjectedPosition);
+        mCache.mBestPosition.getHistory(report.mBestPosition);
+        mCache.mXtra.getHistory(report.mXtra);
+        mCache.mEphemeris.getHistory(report.mEphemeris);
+        mCache.mSvHealth.getHistory(report.mSvHealth);
+        mCache.mPdr.getHistory(report.mPdr);
+        mCache.mNavData.getHistory(report.mNavData);
+
+        mCache.mPositionFailure.getHistory(report.mPositionFailure);
+
+        mCache.mAirplaneMode.getHistory(report.mAirplaneMode);
+        mCache.mENH.getHistory(report.mENH);
+        mCache.mGPSState.getHistory(report.mGPSState);
+        mCache.mNLPStatus.getHistory(report.mNLPStatus);
+        mCache.mWifiHardwareState.getHistory(report.mWifiHardwareState);
+        mCache.mNetworkInfo.getHistory(report.mNetworkInfo);
+        mCache.mRilServiceInfo.getHistory(report.mRilServiceInfo);
+        mCache.mRilCellInfo.getHistory(report.mRilCellInfo);
+        mCache.mServiceStatus.getHistory(report.mServiceStatus);
+        mCache.mModel.getHistory(report.mModel);
+        mCache.mManufacturer.getHistory(report.mManufacturer);
+        mCache.mAssistedGps.getHistory(report.mAssistedGps);
+        mCache.mScreenState.getHistory(report.mScreenState);
+        mCache.mPowerConnectState.getHistory(report.mPowerConnectState);
+        mCache.mTimeZoneChange.getHistory(report.mTimeZoneChange);
+        mCache.mTimeChange.getHistory(report.mTimeChange);
+        mCache.mWifiSupplicantStatus.getHistory(report.mWifiSupplicantStatus);
+        mCache.mShutdownState.getHistory(report.mShutdownState);
+        mCache.mTac.getHistory(report.mTac);
+        mCache.mMccMnc.getHistory(report.mMccMnc);
+        mCache.mBtDeviceScanDetail.getHistory(report.mBtDeviceScanDetail);
+        mCache.mBtLeDeviceScanDetail.getHistory(report.mBtLeDeviceScanDetail);
     }
 
-    pthread_mutex_unlock(&mMutexSystemStatus);
     return true;
 }
 
@@ -1690,8 +1731,6 @@ bool SystemStatus::getReport(SystemStatusReports& report, bool isLatestOnly) con
 ******************************************************************************/
 bool SystemStatus::setDefaultGnssEngineStates(void)
 {
-    pthread_mutex_lock(&mMutexSystemStatus);
-
     setDefaultIteminReport(mCache.mLocation, SystemStatusLocation());
 
     setDefaultIteminReport(mCache.mTimeAndClock, SystemStatusTimeAndClock());
@@ -1709,7 +1748,6 @@ bool SystemStatus::setDefaultGnssEngineStates(void)
 
     setDefaultIteminReport(mCache.mPositionFailure, SystemStatusPositionFailure());
 
-    pthread_mutex_unlock(&mMutexSystemStatus);
     return true;
 }
 
@@ -1746,3 +1784,249 @@ bool SystemStatus::updatePowerConnectState(bool charging)
 }
 } // namespace loc_core
 
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+using namespace loc_core;
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+// Concurrent producers and readers. Positions are reported with latitude ==
+// longitude, so a torn read shows up as a mismatch.
+struct SystemStatusStress {
+    SystemStatus* mSystemStatus;
+    const std::vector<std::string>* mLines;
+    int mRounds;
+    std::atomic<bool> mDone;
+    uint64_t mReads;
+    uint64_t mErrors;
+};
+
+static void* stressNmeaProducer(void* arg) {
+    SystemStatusStress* stress = (SystemStatusStress*)arg;
+    for (int r = 0; r < stress->mRounds; r++) {
+        for (size_t i = 0; i < stress->mLines->size(); i++) {
+            const std::string& nmea = (*stress->mLines)[i];
+            stress->mSystemStatus->setNmeaString(nmea.c_str(), nmea.size());
+        }
+    }
+    return NULL;
+}
+
+static void* stressPositionProducer(void* arg) {
+    SystemStatusStress* stress = (SystemStatusStress*)arg;
+    UlpLocation location = {};
+    GpsLocationExtended locationEx = {};
+    for (int i = 0; !stress->mDone; i++) {
+        location.gpsLocation.latitude = location.gpsLocation.longitude = i % 90;
+        stress->mSystemStatus->eventPosition(location, locationEx);
+    }
+    return NULL;
+}
+
+static void* stressReader(void* arg) {
+    SystemStatusStress* stress = (SystemStatusStress*)arg;
+    bool latestOnly = (0 == (__sync_fetch_and_add(&stress->mReads, 1) & 1));
+    while (!stress->mDone) {
+        std::unique_ptr<SystemStatusReports> reports(new SystemStatusReports());
+        stress->mSystemStatus->getReport(*reports, latestOnly);
+        for (size_t i = 0; i < reports->mLocation.size(); i++) {
+            const LocGpsLocation& location = reports->mLocation[i].mLocation.gpsLocation;
+            if (location.latitude != location.longitude) {
+                __sync_fetch_and_add(&stress->mErrors, 1);
+            }
+        }
+        __sync_fetch_and_add(&stress->mReads, 1);
+    }
+    return NULL;
+}
+
+static void stress(SystemStatus* systemStatus, const std::vector<std::string>& lines,
+                   int rounds) {
+    SystemStatusStress stress;
+    stress.mSystemStatus = systemStatus;
+    stress.mLines = &lines;
+    stress.mRounds = rounds;
+    stress.mDone = false;
+    stress.mReads = 0;
+    stress.mErrors = 0;
+    pthread_t producers[3], readers[4];
+    double start = getSeconds();
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&readers[i], NULL, stressReader, &stress);
+    }
+    pthread_create(&producers[0], NULL, stressPositionProducer, &stress);
+    pthread_create(&producers[1], NULL, stressNmeaProducer, &stress);
+    pthread_create(&producers[2], NULL, stressNmeaProducer, &stress);
+    pthread_join(producers[1], NULL);
+    pthread_join(producers[2], NULL);
+    stress.mDone = true;
+    pthread_join(producers[0], NULL);
+    for (int i = 0; i < 4; i++) {
+        pthread_join(readers[i], NULL);
+    }
+    double elapsed = getSeconds() - start;
+    printf("stress: 2 x %zu sentences in %.3f s, %" PRIu64 " getReport() calls, "
+           "%" PRIu64 " torn positions\n", lines.size() * rounds, elapsed,
+           stress.mReads, stress.mErrors);
+}
+
+// For Linux command line testing, link with libloc_core and libgps_utils:
+// compilation: g++ -D__LOC_DEBUG__ -g -I. -Idata-items -Iobserver -I../utils SystemStatus.cpp ...
+// replay: ./a.out <captured debug nmea file> [<rounds>]
+//     feeds every $PQW line of the capture through setNmeaString() <rounds>
+//     times, and reports the throughput, the cost of getReport(), of reading
+//     the latest RF and clock status per fix, and the resulting report counts.
+// fuzz:   ./a.out <captured debug nmea file> <rounds> fuzz
+//     same, but with random bytes of each line flipped, dropped or replaced
+//     by ',' / '*', so the tokenizer sees truncated and malformed sentences.
+// stress: ./a.out <captured debug nmea file> <rounds> stress
+//     replays the capture from 2 threads, reports positions from another,
+//     while 4 threads keep reading reports, both latest only and entire.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("usage: %s <nmea file> [<rounds> [fuzz|stress]]\n", argv[0]);
+        return 1;
+    }
+    FILE* file = fopen(argv[1], "r");
+    if (NULL == file) {
+        printf("can not open %s\n", argv[1]);
+        return 1;
+    }
+    int rounds = (argc > 2) ? atoi(argv[2]) : 1;
+    bool fuzz = (argc > 3) && (0 == strcmp(argv[3], "fuzz"));
+
+    std::vector<std::string> lines;
+    char line[SystemStatusNmeaBase::NMEA_MAXSIZE + 1];
+    while (fgets(line, sizeof(line), file)) {
+        if (loc_nmea_is_debug(line, strlen(line))) {
+            lines.push_back(line);
+        }
+    }
+    fclose(file);
+
+    MsgTask* msgTask = new MsgTask("SystemStatusTest", false);
+    SystemStatus* systemStatus = SystemStatus::getInstance(msgTask);
+    srand(time(NULL));
+
+    if ((argc > 3) && (0 == strcmp(argv[3], "stress"))) {
+        stress(systemStatus, lines, rounds);
+        SystemStatus::destroyInstance();
+        msgTask->destroy();
+        return 0;
+    }
+
+    uint64_t bytes = 0;
+    double start = getSeconds();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < lines.size(); i++) {
+            std::string nmea(lines[i]);
+            if (fuzz) {
+                for (int n = rand() % 4; n > 0 && !nmea.empty(); n--) {
+                    size_t pos = rand() % nmea.size();
+                    switch (rand() % 4) {
+                    case 0: nmea[pos] ^= (1 << (rand() % 8)); break;
+                    case 1: nmea.resize(pos); break;
+                    case 2: nmea[pos] = ','; break;
+                    default: nmea[pos] = '*'; break;
+                    }
+                }
+            }
+            systemStatus->setNmeaString(nmea.c_str(), nmea.size());
+            bytes += nmea.size();
+        }
+    }
+    double elapsed = getSeconds() - start;
+
+    // cost of copying the histories out, as a debug report would
+    start = getSeconds();
+    for (int r = 0; r < 10000; r++) {
+        std::unique_ptr<SystemStatusReports> reports(new SystemStatusReports());
+        systemStatus->getReport(*reports, true);
+    }
+    double latest = getSeconds() - start;
+    start = getSeconds();
+    for (int r = 0; r < 10000; r++) {
+        std::unique_ptr<SystemStatusReports> reports(new SystemStatusReports());
+        systemStatus->getReport(*reports);
+    }
+    double all = getSeconds() - start;
+    printf("getReport: latest only %.2f us, all %.2f us\n", latest * 100, all * 100);
+
+    // per fix cost of reading the RF and clock status for a data notification,
+    // through getReport() as it used to be, through getLatest(), through a new
+    // snapshot as getAgcInformation() and through one kept across fixes, as
+    // getDataInformation() does
+    const int fixes = 1000000;
+    double agc = 0;
+    start = getSeconds();
+    for (int r = 0; r < fixes; r++) {
+        std::unique_ptr<SystemStatusReports> reports(new SystemStatusReports());
+        systemStatus->getReport(*reports, true);
+        if (!reports->mRfAndParams.empty() && !reports->mTimeAndClock.empty()) {
+            agc += reports->mRfAndParams.back().mAgcGps + reports->mTimeAndClock.back().mGpsTowMs;
+        }
+    }
+    double perFixReport = (getSeconds() - start) / fixes;
+    start = getSeconds();
+    for (int r = 0; r < fixes; r++) {
+        SystemStatusRfAndParams rf;
+        SystemStatusTimeAndClock tc;
+        if (systemStatus->getLatest(rf) && systemStatus->getLatest(tc)) {
+            agc += rf.mAgcGps + tc.mGpsTowMs;
+        }
+    }
+    double perFixLatest = (getSeconds() - start) / fixes;
+    typedef SystemStatusSnapshot<SystemStatusTimeAndClock, SystemStatusRfAndParams> RfSnapshot;
+    start = getSeconds();
+    for (int r = 0; r < fixes; r++) {
+        RfSnapshot snapshot;
+        systemStatus->getSnapshot(snapshot);
+        if (snapshot.has<SystemStatusRfAndParams>() && snapshot.has<SystemStatusTimeAndClock>()) {
+            agc += snapshot.get<SystemStatusRfAndParams>().mAgcGps +
+                    snapshot.get<SystemStatusTimeAndClock>().mGpsTowMs;
+        }
+    }
+    double perFixSnapshot = (getSeconds() - start) / fixes;
+    RfSnapshot kept;
+    start = getSeconds();
+    for (int r = 0; r < fixes; r++) {
+        systemStatus->getSnapshot(kept);
+        if (kept.has<SystemStatusRfAndParams>() && kept.has<SystemStatusTimeAndClock>()) {
+            agc += kept.get<SystemStatusRfAndParams>().mAgcGps +
+                    kept.get<SystemStatusTimeAndClock>().mGpsTowMs;
+        }
+    }
+    double perFixKept = (getSeconds() - start) / fixes;
+    printf("rf and clock per fix: getReport %.0f ns, getLatest %.0f ns, new snapshot %.0f ns, "
+           "kept snapshot %.0f ns (%g)\n", perFixReport * 1e9, perFixLatest * 1e9,
+           perFixSnapshot * 1e9, perFixKept * 1e9, agc);
+
+    std::unique_ptr<SystemStatusReports> reports(new SystemStatusReports());
+    systemStatus->getReport(*reports);
+    printf("%zu sentences x %d rounds in %.3f s: %.0f sentences/s, %.1f MB/s\n",
+           lines.size(), rounds, elapsed, lines.size() * rounds / elapsed,
+           bytes / elapsed / 1000000);
+    printf("reports: time %zu, xo %zu, rf %zu, err %zu, injected %zu, best %zu, "
+           "xtra %zu, ephemeris %zu, sv health %zu, pdr %zu, nav %zu, failure %zu\n",
+           reports->mTimeAndClock.size(), reports->mXoState.size(),
+           reports->mRfAndParams.size(), reports->mErrRecovery.size(),
+           reports->mInjectedPosition.size(), reports->mBestPosition.size(),
+           reports->mXtra.size(), reports->mEphemeris.size(), reports->mSvHealth.size(),
+           reports->mPdr.size(), reports->mNavData.size(), reports->mPositionFailure.size());
+
+    SystemStatus::destroyInstance();
+    msgTask->destroy();
+    return 0;
+}
+
+#endif
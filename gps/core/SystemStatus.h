@@ -32,11 +32,14 @@
 #include <stdint.h>
 #include <sys/time.h>
 #include <vector>
+#include <atomic>
 #include <algorithm>
 #include <iterator>
 #include <loc_pla.h>
 #include <log_util.h>
 #include <MsgTask.h>
+#include <LocRingBuffer.h>
+#include <LocLeftRight.h>
 #include <IDataItemCore.h>
 #include <IOsObserver.h>
 #include <DataItemConcreteTypesBase.h>
@@ -817,55 +820,284 @@ public:
 /******************************************************************************
  SystemStatusReports
 ******************************************************************************/
+// history of the last maxItem items of each type, oldest first
+template <typename TYPE_ITEM>
+using SystemStatusReport = loc_util::LocRingBuffer<TYPE_ITEM, SystemStatusItemBase::maxItem>;
+
 class SystemStatusReports
 {
 public:
     // from QMI_LOC indication
-    std::vector<SystemStatusLocation>         mLocation;
+    SystemStatusReport<SystemStatusLocation>          mLocation;
+
+    // from ME debug NMEA
+    SystemStatusReport<SystemStatusTimeAndClock>      mTimeAndClock;
+    SystemStatusReport<SystemStatusXoState>           mXoState;
+    SystemStatusReport<SystemStatusRfAndParams>       mRfAndParams;
+    SystemStatusReport<SystemStatusErrRecovery>       mErrRecovery;
+
+    // from PE debug NMEA
+    SystemStatusReport<SystemStatusInjectedPosition>  mInjectedPosition;
+    SystemStatusReport<SystemStatusBestPosition>      mBestPosition;
+    SystemStatusReport<SystemStatusXtra>              mXtra;
+    SystemStatusReport<SystemStatusEphemeris>         mEphemeris;
+    SystemStatusReport<SystemStatusSvHealth>          mSvHealth;
+    SystemStatusReport<SystemStatusPdr>               mPdr;
+    SystemStatusReport<SystemStatusNavData>           mNavData;
+
+    // from SM debug NMEA
+    SystemStatusReport<SystemStatusPositionFailure>   mPositionFailure;
+
+    // from dataitems observer
+    SystemStatusReport<SystemStatusAirplaneMode>      mAirplaneMode;
+    SystemStatusReport<SystemStatusENH>               mENH;
+    SystemStatusReport<SystemStatusGpsState>          mGPSState;
+    SystemStatusReport<SystemStatusNLPStatus>         mNLPStatus;
+    SystemStatusReport<SystemStatusWifiHardwareState> mWifiHardwareState;
+    SystemStatusReport<SystemStatusNetworkInfo>       mNetworkInfo;
+    SystemStatusReport<SystemStatusServiceInfo>       mRilServiceInfo;
+    SystemStatusReport<SystemStatusRilCellInfo>       mRilCellInfo;
+    SystemStatusReport<SystemStatusServiceStatus>     mServiceStatus;
+    SystemStatusReport<SystemStatusModel>             mModel;
+    SystemStatusReport<SystemStatusManufacturer>      mManufacturer;
+    SystemStatusReport<SystemStatusAssistedGps>       mAssistedGps;
+    SystemStatusReport<SystemStatusScreenState>       mScreenState;
+    SystemStatusReport<SystemStatusPowerConnectState> mPowerConnectState;
+    SystemStatusReport<SystemStatusTimeZoneChange>    mTimeZoneChange;
+    SystemStatusReport<SystemStatusTimeChange>        mTimeChange;
+    SystemStatusReport<SystemStatusWifiSupplicantStatus> mWifiSupplicantStatus;
+    SystemStatusReport<SystemStatusShutdownState>     mShutdownState;
+    SystemStatusReport<SystemStatusTac>               mTac;
+    SystemStatusReport<SystemStatusMccMnc>            mMccMnc;
+    SystemStatusReport<SystemStatusBtDeviceScanDetail> mBtDeviceScanDetail;
+    SystemStatusReport<SystemStatusBtleDeviceScanDetail> mBtLeDeviceScanDetail;
+};
+
+/******************************************************************************
+ SystemStatusLatest
+******************************************************************************/
+// The latest item of one type, if any, along with the version it was
+// published with, so that a reader holding on to one can tell whether it is
+// still current without copying the item again.
+template <typename TYPE_ITEM>
+class SystemStatusLatest
+{
+public:
+    loc_util::LocRingBuffer<TYPE_ITEM, 1> mItem;
+    // 0 until the first item is published, then incremented on each change
+    uint64_t mVersion;
+
+    inline SystemStatusLatest() : mVersion(0) {}
+    inline bool empty() const { return mItem.empty(); }
+    inline const TYPE_ITEM& get() const { return mItem.back(); }
+};
+
+// The latest items of a few types, kept by a hot path across calls to
+// SystemStatus::getSnapshot(), which copies an item only when a newer one
+// has been published since.
+template <typename... TYPE_ITEMS>
+class SystemStatusSnapshot : public SystemStatusLatest<TYPE_ITEMS>...
+{
+public:
+    template <typename TYPE_ITEM>
+    inline const SystemStatusLatest<TYPE_ITEM>& latest() const { return *this; }
+    template <typename TYPE_ITEM>
+    inline bool has() const { return !latest<TYPE_ITEM>().empty(); }
+    template <typename TYPE_ITEM>
+    inline const TYPE_ITEM& get() const { return latest<TYPE_ITEM>().get(); }
+};
+
+/******************************************************************************
+ SystemStatusReportCache
+******************************************************************************/
+// The history of one type of report, with a lock of its own, so that reports
+// of different types are stored and copied out independently. The latest
+// item is also published through a LocLeftRight, so that reading only the
+// latest never waits, neither for writers nor for readers of the history.
+template <typename TYPE_ITEM>
+class SystemStatusReportCache
+{
+    typedef SystemStatusLatest<TYPE_ITEM> Latest;
+    mutable pthread_mutex_t mMutex;
+    SystemStatusReport<TYPE_ITEM> mHistory;
+    loc_util::LocLeftRight<Latest> mLatest;
+    // version of the latest, bumped before it is published
+    std::atomic<uint64_t> mVersion;
+
+    inline void publishLocked() {
+        const SystemStatusReport<TYPE_ITEM>& history = mHistory;
+        uint64_t version = ++mVersion;
+        mLatest.write([&history, version](Latest& latest) {
+            latest.mItem.clear();
+            if (!history.empty()) {
+                latest.mItem.push_back(history.back());
+            }
+            latest.mVersion = version;
+        });
+    }
+
+public:
+    inline SystemStatusReportCache() : mVersion(0) { pthread_mutex_init(&mMutex, NULL); }
+    inline ~SystemStatusReportCache() { pthread_mutex_destroy(&mMutex); }
+
+    // returns false if s is no change to the latest item, in which case only
+    // the reported time of the latest is updated.
+    bool set(TYPE_ITEM& s) {
+        bool changed = true;
+        pthread_mutex_lock(&mMutex);
+        if (!mHistory.empty() &&
+            mHistory.back().equals(static_cast<TYPE_ITEM&>(s.collate(mHistory.back())))) {
+            mHistory.back().mUtcReported = s.mUtcReported;
+            changed = false;
+        } else {
+            // the oldest one drops out once full
+            mHistory.push_back(s);
+        }
+        publishLocked();
+        pthread_mutex_unlock(&mMutex);
+        return changed;
+    }
+
+    inline void setDefault(const TYPE_ITEM& s) {
+        pthread_mutex_lock(&mMutex);
+        mHistory.push_back(s);
+        publishLocked();
+        pthread_mutex_unlock(&mMutex);
+    }
+
+    inline void clear() {
+        pthread_mutex_lock(&mMutex);
+        mHistory.clear();
+        publishLocked();
+        pthread_mutex_unlock(&mMutex);
+    }
+
+    // wait-free
+    inline void getLatest(SystemStatusReport<TYPE_ITEM>& reportout) const {
+        reportout.clear();
+        mLatest.read([&reportout](const Latest& latest) {
+            if (!latest.empty()) {
+                reportout.push_back(latest.get());
+            }
+        });
+    }
+
+    // wait-free; copies the latest only if latestout is not of its version
+    // already. Returns true if latestout changed.
+    inline bool getLatest(Latest& latestout) const {
+        uint64_t version = latestout.mVersion;
+        if (mVersion.load() != version) {
+            mLatest.read([&latestout](const Latest& latest) {
+                latestout = latest;
+            });
+        }
+        return (latestout.mVersion != version);
+    }
+
+    inline void getHistory(SystemStatusReport<TYPE_ITEM>& reportout) const {
+        pthread_mutex_lock(&mMutex);
+        reportout = mHistory;
+        pthread_mutex_unlock(&mMutex);
+    }
+};
+
+/******************************************************************************
+ SystemStatusReportsCache
+******************************************************************************/
+// what SystemStatus keeps of every type in SystemStatusReports
+class SystemStatusReportsCache
+{
+public:
+    // from QMI_LOC indication
+    SystemStatusReportCache<SystemStatusLocation>          mLocation;
 
     // from ME debug NMEA
-    std::vector<SystemStatusTimeAndClock>     mTimeAndClock;
-    std::vector<SystemStatusXoState>          mXoState;
-    std::vector<SystemStatusRfAndParams>      mRfAndParams;
-    std::vector<SystemStatusErrRecovery>      mErrRecovery;
+    SystemStatusReportCache<SystemStatusTimeAndClock>      mTimeAndClock;
+    SystemStatusReportCache<SystemStatusXoState>           mXoState;
+    SystemStatusReportCache<SystemStatusRfAndParams>       mRfAndParams;
+    SystemStatusReportCache<SystemStatusErrRecovery>       mErrRecovery;
 
     // from PE debug NMEA
-    std::vector<SystemStatusInjectedPosition> mInjectedPosition;
-    std::vector<SystemStatusBestPosition>     mBestPosition;
-    std::vector<SystemStatusXtra>             mXtra;
-    std::vector<SystemStatusEphemeris>        mEphemeris;
-    std::vector<SystemStatusSvHealth>         mSvHealth;
-    std::vector<SystemStatusPdr>              mPdr;
-    std::vector<SystemStatusNavData>          mNavData;
+    SystemStatusReportCache<SystemStatusInjectedPosition>  mInjectedPosition;
+    SystemStatusReportCache<SystemStatusBestPosition>      mBestPosition;
+    SystemStatusReportCache<SystemStatusXtra>              mXtra;
+    SystemStatusReportCache<SystemStatusEphemeris>         mEphemeris;
+    SystemStatusReportCache<SystemStatusSvHealth>          mSvHealth;
+    SystemStatusReportCache<SystemStatusPdr>               mPdr;
+    SystemStatusReportCache<SystemStatusNavData>           mNavData;
 
     // from SM debug NMEA
-    std::vector<SystemStatusPositionFailure>  mPositionFailure;
+    SystemStatusReportCache<SystemStatusPositionFailure>   mPositionFailure;
 
     // from dataitems observer
-    std::vector<SystemStatusAirplaneMode>     mAirplaneMode;
-    std::vector<SystemStatusENH>              mENH;
-    std::vector<SystemStatusGpsState>         mGPSState;
-    std::vector<SystemStatusNLPStatus>        mNLPStatus;
-    std::vector<SystemStatusWifiHardwareState> mWifiHardwareState;
-    std::vector<SystemStatusNetworkInfo>      mNetworkInfo;
-    std::vector<SystemStatusServiceInfo>      mRilServiceInfo;
-    std::vector<SystemStatusRilCellInfo>      mRilCellInfo;
-    std::vector<SystemStatusServiceStatus>    mServiceStatus;
-    std::vector<SystemStatusModel>            mModel;
-    std::vector<SystemStatusManufacturer>     mManufacturer;
-    std::vector<SystemStatusAssistedGps>      mAssistedGps;
-    std::vector<SystemStatusScreenState>      mScreenState;
-    std::vector<SystemStatusPowerConnectState> mPowerConnectState;
-    std::vector<SystemStatusTimeZoneChange>   mTimeZoneChange;
-    std::vector<SystemStatusTimeChange>       mTimeChange;
-    std::vector<SystemStatusWifiSupplicantStatus> mWifiSupplicantStatus;
-    std::vector<SystemStatusShutdownState>    mShutdownState;
-    std::vector<SystemStatusTac>              mTac;
-    std::vector<SystemStatusMccMnc>           mMccMnc;
-    std::vector<SystemStatusBtDeviceScanDetail> mBtDeviceScanDetail;
-    std::vector<SystemStatusBtleDeviceScanDetail> mBtLeDeviceScanDetail;
+    SystemStatusReportCache<SystemStatusAirplaneMode>      mAirplaneMode;
+    SystemStatusReportCache<SystemStatusENH>               mENH;
+    SystemStatusReportCache<SystemStatusGpsState>          mGPSState;
+    SystemStatusReportCache<SystemStatusNLPStatus>         mNLPStatus;
+    SystemStatusReportCache<SystemStatusWifiHardwareState> mWifiHardwareState;
+    SystemStatusReportCache<SystemStatusNetworkInfo>       mNetworkInfo;
+    SystemStatusReportCache<SystemStatusServiceInfo>       mRilServiceInfo;
+    SystemStatusReportCache<SystemStatusRilCellInfo>       mRilCellInfo;
+    SystemStatusReportCache<SystemStatusServiceStatus>     mServiceStatus;
+    SystemStatusReportCache<SystemStatusModel>             mModel;
+    SystemStatusReportCache<SystemStatusManufacturer>      mManufacturer;
+    SystemStatusReportCache<SystemStatusAssistedGps>       mAssistedGps;
+    SystemStatusReportCache<SystemStatusScreenState>       mScreenState;
+    SystemStatusReportCache<SystemStatusPowerConnectState> mPowerConnectState;
+    SystemStatusReportCache<SystemStatusTimeZoneChange>    mTimeZoneChange;
+    SystemStatusReportCache<SystemStatusTimeChange>        mTimeChange;
+    SystemStatusReportCache<SystemStatusWifiSupplicantStatus> mWifiSupplicantStatus;
+    SystemStatusReportCache<SystemStatusShutdownState>     mShutdownState;
+    SystemStatusReportCache<SystemStatusTac>               mTac;
+    SystemStatusReportCache<SystemStatusMccMnc>            mMccMnc;
+    SystemStatusReportCache<SystemStatusBtDeviceScanDetail> mBtDeviceScanDetail;
+    SystemStatusReportCache<SystemStatusBtleDeviceScanDetail> mBtLeDeviceScanDetail;
+
+    // the cache of TYPE_ITEM, for typed access to a single report type
+    template <typename TYPE_ITEM>
+    const SystemStatusReportCache<TYPE_ITEM>& of() const;
 };
 
+#define SYSTEM_STATUS_REPORT_CACHE_OF(TYPE_ITEM, member) \
+    template <> inline const SystemStatusReportCache<TYPE_ITEM>& \
+    SystemStatusReportsCache::of<TYPE_ITEM>() const { return member; }
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusLocation, mLocation)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusTimeAndClock, mTimeAndClock)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusXoState, mXoState)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusRfAndParams, mRfAndParams)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusErrRecovery, mErrRecovery)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusInjectedPosition, mInjectedPosition)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusBestPosition, mBestPosition)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusXtra, mXtra)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusEphemeris, mEphemeris)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusSvHealth, mSvHealth)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusPdr, mPdr)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusNavData, mNavData)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusPositionFailure, mPositionFailure)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusAirplaneMode, mAirplaneMode)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusENH, mENH)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusGpsState, mGPSState)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusNLPStatus, mNLPStatus)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusWifiHardwareState, mWifiHardwareState)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusNetworkInfo, mNetworkInfo)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusServiceInfo, mRilServiceInfo)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusRilCellInfo, mRilCellInfo)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusServiceStatus, mServiceStatus)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusModel, mModel)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusManufacturer, mManufacturer)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusAssistedGps, mAssistedGps)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusScreenState, mScreenState)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusPowerConnectState, mPowerConnectState)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusTimeZoneChange, mTimeZoneChange)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusTimeChange, mTimeChange)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusWifiSupplicantStatus, mWifiSupplicantStatus)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusShutdownState, mShutdownState)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusTac, mTac)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusMccMnc, mMccMnc)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusBtDeviceScanDetail, mBtDeviceScanDetail)
+SYSTEM_STATUS_REPORT_CACHE_OF(SystemStatusBtleDeviceScanDetail, mBtLeDeviceScanDetail)
+#undef SYSTEM_STATUS_REPORT_CACHE_OF
+
 /******************************************************************************
  SystemStatus
 ******************************************************************************/
@@ -880,18 +1112,20 @@ private:
     inline ~SystemStatus() {}
 
     // Data members
+    // only guards mInstance; each report type in mCache has its own lock
     static pthread_mutex_t                    mMutexSystemStatus;
-    SystemStatusReports mCache;
+    SystemStatusReportsCache mCache;
 
-    template <typename TYPE_REPORT, typename TYPE_ITEM>
-    bool setIteminReport(TYPE_REPORT& report, TYPE_ITEM&& s);
+    template <typename TYPE_ITEM>
+    bool setIteminReport(SystemStatusReportCache<TYPE_ITEM>& report, TYPE_ITEM&& s);
 
     // set default dataitem derived item in report cache
-    template <typename TYPE_REPORT, typename TYPE_ITEM>
-    void setDefaultIteminReport(TYPE_REPORT& report, const TYPE_ITEM& s);
+    template <typename TYPE_ITEM>
+    void setDefaultIteminReport(SystemStatusReportCache<TYPE_ITEM>& report, const TYPE_ITEM& s);
 
-    template <typename TYPE_REPORT, typename TYPE_ITEM>
-    void getIteminReport(TYPE_REPORT& reportout, const TYPE_ITEM& c) const;
+    template <typename TYPE_ITEM>
+    void getIteminReport(SystemStatusReport<TYPE_ITEM>& reportout,
+                         const SystemStatusReportCache<TYPE_ITEM>& c) const;
 
 public:
     // Static methods
@@ -904,6 +1138,30 @@ public:
     bool eventDataItemNotify(IDataItemCore* dataitem);
     bool setNmeaString(const char *data, uint32_t len);
     bool getReport(SystemStatusReports& reports, bool isLatestonly = false) const;
+
+    // Typed access to the latest item of a single type, for hot paths that
+    // need only one or two of them; none of these wait or allocate.
+    // false if no item of TYPE_ITEM has been reported yet
+    template <typename TYPE_ITEM>
+    inline bool getLatest(TYPE_ITEM& item) const {
+        SystemStatusLatest<TYPE_ITEM> latest;
+        mCache.of<TYPE_ITEM>().getLatest(latest);
+        if (latest.empty()) {
+            return false;
+        }
+        item = latest.get();
+        return true;
+    }
+
+    // brings snapshot up to date, copying only the items that changed since
+    // the last call with it. Returns true if any of them did.
+    template <typename... TYPE_ITEMS>
+    inline bool getSnapshot(SystemStatusSnapshot<TYPE_ITEMS...>& snapshot) const {
+        bool changed[] = { false, mCache.of<TYPE_ITEMS>().getLatest(
+                static_cast<SystemStatusLatest<TYPE_ITEMS>&>(snapshot))... };
+        bool* end = changed + sizeof(changed) / sizeof(changed[0]);
+        return (std::find(changed + 1, end, true) != end);
+    }
     bool setDefaultGnssEngineStates(void);
     bool eventConnectionStatus(bool connected, int8_t type,
                                bool roaming, NetworkHandle networkHandle);
@@ -34,6 +34,7 @@
 #include <DataItemsFactoryProxy.h>
 #include <loc_pla.h>
 #include <log_util.h>
+#include <LocStartupTrace.h>
 
 namespace loc_core
 {
@@ -51,6 +52,7 @@ IDataItemCore* DataItemsFactoryProxy::createNewDataItem(DataItemId id)
         // first call to this function, symbol not yet loaded
         if (NULL == dataItemLibHandle) {
             LOC_LOGD("Loaded library %s",DATA_ITEMS_LIB_NAME);
+            loc_util::LocStartupPhase phase("dlopen " DATA_ITEMS_LIB_NAME);
             dataItemLibHandle = dlopen(DATA_ITEMS_LIB_NAME, RTLD_NOW);
             if (NULL == dataItemLibHandle) {
                 // dlopen failed.
@@ -14,6 +14,8 @@ LOCAL_MODULE_TAGS := optional
 
 LOCAL_SRC_FILES:= \
     GeofenceAdapter.cpp \
+    GeofenceEvaluator.cpp \
+    GeofenceTable.cpp \
     location_geofence.cpp
 
 LOCAL_SHARED_LIBRARIES := \
@@ -31,9 +31,13 @@
 #include <GeofenceAdapter.h>
 #include "loc_log.h"
 #include <log_util.h>
+#include <LocMsgPool.h>
+#include <LocStartupTrace.h>
 #include <string>
+#include <memory>
 
 using namespace loc_core;
+using namespace loc_util;
 
 GeofenceAdapter::GeofenceAdapter() :
     LocAdapterBase(0,
@@ -45,6 +49,7 @@ GeofenceAdapter::GeofenceAdapter() :
                     true /*isMaster*/)
 {
     LOC_LOGD("%s]: Constructor", __func__);
+    loc_util::LocStartupTrace::mark("GeofenceAdapter constructed");
 }
 
 void
@@ -52,29 +57,36 @@ GeofenceAdapter::stopClientSessions(LocationAPI* client)
 {
     LOC_LOGD("%s]: client %p", __func__, client);
 
+    struct Removal {
+        std::vector<uint32_t> hwIds;
+        std::vector<uint32_t> ids;
+    };
+    auto removal = std::make_shared<Removal>();
+    for (size_t row = 0; row < mGeofences.size(); ++row) {
+        if (client == mGeofences.getKey(row).client) {
+            removal->hwIds.push_back(mGeofences.getHwId(row));
+            removal->ids.push_back(mGeofences.getKey(row).id);
+            mGeofences.detach(row);
+        }
+    }
 
-    for (auto it = mGeofenceIds.begin(); it != mGeofenceIds.end();) {
-        uint32_t hwId = it->second;
-        GeofenceKey key(it->first);
-        if (client == key.client) {
-            it = mGeofenceIds.erase(it);
-            mLocApi->removeGeofence(hwId, key.id,
-                    new LocApiResponse(*getContext(),
-                    [this, hwId] (LocationError err) {
-                if (LOCATION_ERROR_SUCCESS == err) {
-                    auto it2 = mGeofences.find(hwId);
-                    if (it2 != mGeofences.end()) {
-                        mGeofences.erase(it2);
+    if (!removal->hwIds.empty()) {
+        mLocApi->removeGeofences(removal->hwIds.size(), removal->hwIds.data(),
+                removal->ids.data(), new LocApiCollectiveResponse(*getContext(),
+                [this, removal] (std::vector<LocationError> errs) {
+            for (size_t i = 0; i < errs.size() && i < removal->hwIds.size(); ++i) {
+                if (LOCATION_ERROR_SUCCESS == errs[i]) {
+                    int32_t row = mGeofences.findByHwId(removal->hwIds[i]);
+                    if (row >= 0) {
+                        mGeofences.remove(row);
                     } else {
-                        LOC_LOGE("%s]:geofence item to erase not found. hwId %u", __func__, hwId);
+                        LOC_LOGE("%s]:geofence item to erase not found. hwId %u",
+                                 __func__, removal->hwIds[i]);
                     }
                 }
-            }));
-            continue;
-        }
-        ++it; // increment only when not erasing an iterator
+            }
+        }));
     }
-
 }
 
 void
@@ -96,10 +108,9 @@ GeofenceAdapter::updateClientsEventMask()
 LocationError
 GeofenceAdapter::getHwIdFromClient(LocationAPI* client, uint32_t clientId, uint32_t& hwId)
 {
-    GeofenceKey key(client, clientId);
-    auto it = mGeofenceIds.find(key);
-    if (it != mGeofenceIds.end()) {
-        hwId = it->second;
+    int32_t row = mGeofences.findByKey(GeofenceKey(client, clientId));
+    if (row >= 0) {
+        hwId = mGeofences.getHwId(row);
         return LOCATION_ERROR_SUCCESS;
     }
     return LOCATION_ERROR_ID_UNKNOWN;
@@ -108,9 +119,9 @@ GeofenceAdapter::getHwIdFromClient(LocationAPI* client, uint32_t clientId, uint3
 LocationError
 GeofenceAdapter::getGeofenceKeyFromHwId(uint32_t hwId, GeofenceKey& key)
 {
-    auto it = mGeofences.find(hwId);
-    if (it != mGeofences.end()) {
-        key = it->second.key;
+    int32_t row = mGeofences.findByHwId(hwId);
+    if (row >= 0) {
+        key = mGeofences.getKey(row);
         return LOCATION_ERROR_SUCCESS;
     }
     return LOCATION_ERROR_ID_UNKNOWN;
@@ -145,34 +156,71 @@ GeofenceAdapter::restartGeofences()
         return;
     }
 
-    GeofencesMap oldGeofences(mGeofences);
+    // geofences being removed for a client that is gone are not restarted
+    struct Restart {
+        std::vector<GeofenceKey> keys;
+        std::vector<uint32_t> ids;
+        std::vector<GeofenceOption> options;
+        std::vector<GeofenceInfo> infos;
+        std::vector<bool> paused;
+    };
+    auto restart = std::make_shared<Restart>();
+    for (size_t row = 0; row < mGeofences.size(); ++row) {
+        GeofenceObject object = mGeofences.get(row);
+        if (NULL == object.key.client) {
+            continue;
+        }
+        restart->keys.push_back(object.key);
+        restart->ids.push_back(object.key.id);
+        restart->options.push_back({sizeof(GeofenceOption),
+                                    object.breachMask,
+                                    object.responsiveness,
+                                    object.dwellTime});
+        restart->infos.push_back({sizeof(GeofenceInfo),
+                                  object.latitude,
+                                  object.longitude,
+                                  object.radius});
+        restart->paused.push_back(object.paused);
+    }
     mGeofences.clear();
-    mGeofenceIds.clear();
-
-    for (auto it = oldGeofences.begin(); it != oldGeofences.end(); it++) {
-        GeofenceObject object = it->second;
-        GeofenceOption options = {sizeof(GeofenceOption),
-                                   object.breachMask,
-                                   object.responsiveness,
-                                   object.dwellTime};
-        GeofenceInfo info = {sizeof(GeofenceInfo),
-                             object.latitude,
-                             object.longitude,
-                             object.radius};
-        mLocApi->addGeofence(object.key.id,
-                              options,
-                              info,
-                              new LocApiResponseData<LocApiGeofenceData>(*getContext(),
-                [this, object, options, info] (LocationError err, LocApiGeofenceData data) {
-            if (LOCATION_ERROR_SUCCESS == err) {
-                if (true == object.paused) {
-                    mLocApi->pauseGeofence(data.hwId, object.key.id,
-                            new LocApiResponse(*getContext(), [] (LocationError err ) {}));
+    if (restart->keys.empty()) {
+        return;
+    }
+
+    mLocApi->addGeofences(restart->keys.size(), restart->ids.data(),
+            restart->options.data(), restart->infos.data(),
+            new LocApiResponseData<LocApiGeofencesData>(*getContext(),
+            [this, restart] (LocationError /*err*/, LocApiGeofencesData data) {
+        struct Pause {
+            std::vector<uint32_t> hwIds;
+            std::vector<uint32_t> ids;
+        };
+        auto pause = std::make_shared<Pause>();
+        mGeofences.reserve(restart->keys.size());
+        for (size_t i = 0; i < data.errs.size() && i < restart->keys.size(); ++i) {
+            if (LOCATION_ERROR_SUCCESS == data.errs[i]) {
+                mGeofences.save(data.hwIds[i], restart->keys[i],
+                                restart->options[i], restart->infos[i]);
+                if (restart->paused[i]) {
+                    pause->hwIds.push_back(data.hwIds[i]);
+                    pause->ids.push_back(restart->ids[i]);
                 }
-                saveGeofenceItem(object.key.client, object.key.id, data.hwId, options, info);
             }
-        }));
-    }
+        }
+        if (!pause->hwIds.empty()) {
+            mLocApi->pauseGeofences(pause->hwIds.size(), pause->hwIds.data(), pause->ids.data(),
+                    new LocApiCollectiveResponse(*getContext(),
+                    [this, pause] (std::vector<LocationError> errs) {
+                for (size_t i = 0; i < errs.size() && i < pause->hwIds.size(); ++i) {
+                    int32_t row = mGeofences.findByHwId(pause->hwIds[i]);
+                    if (LOCATION_ERROR_SUCCESS == errs[i] && row >= 0) {
+                        mGeofences.setPaused(row, true);
+                    }
+                }
+            }));
+        }
+        dump();
+    }));
 }
 
 void
@@ -233,45 +281,43 @@ GeofenceAdapter::addGeofencesCommand(LocationAPI* client, size_t count, Geofence
             mOptions(options),
             mInfos(infos) {}
         inline virtual void proc() const {
-            LocationError* errs = new LocationError[mCount];
-            if (nullptr == errs) {
-                LOC_LOGE("%s]: new failed to allocate errs", __func__);
-                return;
-            }
-            for (size_t i=0; i < mCount; ++i) {
-                if (NULL == mIds || NULL == mOptions || NULL == mInfos) {
+            if (NULL == mIds || NULL == mOptions || NULL == mInfos) {
+                LocationError* errs = new LocationError[mCount];
+                for (size_t i=0; i < mCount; ++i) {
                     errs[i] = LOCATION_ERROR_INVALID_PARAMETER;
-                } else {
-                    mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
-                            [&mAdapter = mAdapter, mCount = mCount, mClient = mClient,
-                            mOptions = mOptions, mInfos = mInfos, mIds = mIds, &mApi = mApi,
-                            errs, i] (LocationError err ) {
-                        mApi.addGeofence(mIds[i], mOptions[i], mInfos[i],
-                        new LocApiResponseData<LocApiGeofenceData>(*mAdapter.getContext(),
-                        [&mAdapter = mAdapter, mOptions = mOptions, mClient = mClient,
-                        mCount = mCount, mIds = mIds, mInfos = mInfos, errs, i]
-                        (LocationError err, LocApiGeofenceData data) {
-                            if (LOCATION_ERROR_SUCCESS == err) {
-                                mAdapter.saveGeofenceItem(mClient,
-                                mIds[i],
-                                data.hwId,
-                                mOptions[i],
-                                mInfos[i]);
-                            }
-                            errs[i] = err;
-
-                            // Send aggregated response on last item and cleanup
-                            if (i == mCount-1) {
-                                mAdapter.reportResponse(mClient, mCount, errs, mIds);
-                                delete[] errs;
-                                delete[] mIds;
-                                delete[] mOptions;
-                                delete[] mInfos;
-                            }
-                        }));
-                    }));
                 }
+                mAdapter.reportResponse(mClient, mCount, errs, mIds);
+                delete[] errs;
+                delete[] mIds;
+                delete[] mOptions;
+                delete[] mInfos;
+                return;
             }
+            mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
+                    [&mAdapter = mAdapter, mCount = mCount, mClient = mClient,
+                    mOptions = mOptions, mInfos = mInfos, mIds = mIds, &mApi = mApi]
+                    (LocationError /*err*/) {
+                mApi.addGeofences(mCount, mIds, mOptions, mInfos,
+                new LocApiResponseData<LocApiGeofencesData>(*mAdapter.getContext(),
+                [&mAdapter = mAdapter, mOptions = mOptions, mClient = mClient,
+                mCount = mCount, mIds = mIds, mInfos = mInfos]
+                (LocationError /*err*/, LocApiGeofencesData data) {
+                    for (size_t i=0; i < mCount && i < data.errs.size(); ++i) {
+                        if (LOCATION_ERROR_SUCCESS == data.errs[i]) {
+                            mAdapter.mGeofences.save(data.hwIds[i],
+                                                     GeofenceKey(mClient, mIds[i]),
+                                                     mOptions[i],
+                                                     mInfos[i]);
+                        }
+                    }
+                    data.errs.resize(mCount, LOCATION_ERROR_GENERAL_FAILURE);
+                    mAdapter.dump();
+                    mAdapter.reportResponse(mClient, mCount, data.errs.data(), mIds);
+                    delete[] mIds;
+                    delete[] mOptions;
+                    delete[] mInfos;
+                }));
+            }));
         }
     };
 
@@ -338,44 +384,17 @@ GeofenceAdapter::removeGeofencesCommand(LocationAPI* client, size_t count, uint3
             mCount(count),
             mIds(ids) {}
         inline virtual void proc() const  {
-            LocationError* errs = new LocationError[mCount];
-            if (nullptr == errs) {
-                LOC_LOGE("%s]: new failed to allocate errs", __func__);
-                return;
-            }
-            for (size_t i=0; i < mCount; ++i) {
-                mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
-                        [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
-                        &mApi = mApi, errs, i] (LocationError err ) {
-                    uint32_t hwId = 0;
-                    errs[i] = mAdapter.getHwIdFromClient(mClient, mIds[i], hwId);
-                    if (LOCATION_ERROR_SUCCESS == errs[i]) {
-                        mApi.removeGeofence(hwId, mIds[i],
-                        new LocApiResponse(*mAdapter.getContext(),
-                        [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
-                        hwId, errs, i] (LocationError err ) {
-                            if (LOCATION_ERROR_SUCCESS == err) {
-                                mAdapter.removeGeofenceItem(hwId);
-                            }
-                            errs[i] = err;
-
-                            // Send aggregated response on last item and cleanup
-                            if (i == mCount-1) {
-                                mAdapter.reportResponse(mClient, mCount, errs, mIds);
-                                delete[] errs;
-                                delete[] mIds;
-                            }
-                        }));
-                    } else {
-                        // Send aggregated response on last item and cleanup
-                        if (i == mCount-1) {
-                            mAdapter.reportResponse(mClient, mCount, errs, mIds);
-                            delete[] errs;
-                            delete[] mIds;
-                        }
-                    }
-                }));
-            }
+            mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
+                    [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
+                    &mApi = mApi] (LocationError /*err*/) {
+                mAdapter.requestGeofences(mClient, mCount, mIds, nullptr,
+                        [&mApi] (size_t count, const uint32_t* hwIds, const uint32_t* ids,
+                        const GeofenceOption* /*options*/, LocApiCollectiveResponse* response) {
+                    mApi.removeGeofences(count, hwIds, ids, response);
+                }, [&mAdapter] (size_t row, size_t /*i*/) {
+                    mAdapter.mGeofences.remove(row);
+                });
+            }));
         }
     };
 
@@ -414,43 +433,17 @@ GeofenceAdapter::pauseGeofencesCommand(LocationAPI* client, size_t count, uint32
             mCount(count),
             mIds(ids) {}
         inline virtual void proc() const  {
-            LocationError* errs = new LocationError[mCount];
-            if (nullptr == errs) {
-                LOC_LOGE("%s]: new failed to allocate errs", __func__);
-                return;
-            }
-            for (size_t i=0; i < mCount; ++i) {
-                mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
-                        [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
-                        &mApi = mApi, errs, i] (LocationError err ) {
-                    uint32_t hwId = 0;
-                    errs[i] = mAdapter.getHwIdFromClient(mClient, mIds[i], hwId);
-                    if (LOCATION_ERROR_SUCCESS == errs[i]) {
-                        mApi.pauseGeofence(hwId, mIds[i], new LocApiResponse(*mAdapter.getContext(),
-                        [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
-                        hwId, errs, i] (LocationError err ) {
-                            if (LOCATION_ERROR_SUCCESS == err) {
-                                mAdapter.pauseGeofenceItem(hwId);
-                            }
-                            errs[i] = err;
-
-                            // Send aggregated response on last item and cleanup
-                            if (i == mCount-1) {
-                                mAdapter.reportResponse(mClient, mCount, errs, mIds);
-                                delete[] errs;
-                                delete[] mIds;
-                            }
-                        }));
-                    } else {
-                        // Send aggregated response on last item and cleanup
-                        if (i == mCount-1) {
-                            mAdapter.reportResponse(mClient, mCount, errs, mIds);
-                            delete[] errs;
-                            delete[] mIds;
-                        }
-                    }
-                }));
-            }
+            mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
+                    [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
+                    &mApi = mApi] (LocationError /*err*/) {
+                mAdapter.requestGeofences(mClient, mCount, mIds, nullptr,
+                        [&mApi] (size_t count, const uint32_t* hwIds, const uint32_t* ids,
+                        const GeofenceOption* /*options*/, LocApiCollectiveResponse* response) {
+                    mApi.pauseGeofences(count, hwIds, ids, response);
+                }, [&mAdapter] (size_t row, size_t /*i*/) {
+                    mAdapter.mGeofences.setPaused(row, true);
+                });
+            }));
         }
     };
 
@@ -489,44 +482,17 @@ GeofenceAdapter::resumeGeofencesCommand(LocationAPI* client, size_t count, uint3
             mCount(count),
             mIds(ids) {}
         inline virtual void proc() const  {
-            LocationError* errs = new LocationError[mCount];
-            if (nullptr == errs) {
-                LOC_LOGE("%s]: new failed to allocate errs", __func__);
-                return;
-            }
-            for (size_t i=0; i < mCount; ++i) {
-                mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
-                        [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
-                        &mApi = mApi, errs, i] (LocationError err ) {
-                    uint32_t hwId = 0;
-                    errs[i] = mAdapter.getHwIdFromClient(mClient, mIds[i], hwId);
-                    if (LOCATION_ERROR_SUCCESS == errs[i]) {
-                        mApi.resumeGeofence(hwId, mIds[i],
-                                new LocApiResponse(*mAdapter.getContext(),
-                                [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, hwId,
-                                errs, mIds = mIds, i] (LocationError err ) {
-                            if (LOCATION_ERROR_SUCCESS == err) {
-                                errs[i] = err;
-
-                                mAdapter.resumeGeofenceItem(hwId);
-                                // Send aggregated response on last item and cleanup
-                                if (i == mCount-1) {
-                                    mAdapter.reportResponse(mClient, mCount, errs, mIds);
-                                    delete[] errs;
-                                    delete[] mIds;
-                                }
-                            }
-                        }));
-                    } else {
-                        // Send aggregated response on last item and cleanup
-                        if (i == mCount-1) {
-                            mAdapter.reportResponse(mClient, mCount, errs, mIds);
-                            delete[] errs;
-                            delete[] mIds;
-                        }
-                    }
-                }));
-            }
+            mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
+                    [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
+                    &mApi = mApi] (LocationError /*err*/) {
+                mAdapter.requestGeofences(mClient, mCount, mIds, nullptr,
+                        [&mApi] (size_t count, const uint32_t* hwIds, const uint32_t* ids,
+                        const GeofenceOption* /*options*/, LocApiCollectiveResponse* response) {
+                    mApi.resumeGeofences(count, hwIds, ids, response);
+                }, [&mAdapter] (size_t row, size_t /*i*/) {
+                    mAdapter.mGeofences.setPaused(row, false);
+                });
+            }));
         }
     };
 
@@ -569,51 +535,28 @@ GeofenceAdapter::modifyGeofencesCommand(LocationAPI* client, size_t count, uint3
             mIds(ids),
             mOptions(options) {}
         inline virtual void proc() const  {
-            LocationError* errs = new LocationError[mCount];
-            if (nullptr == errs) {
-                LOC_LOGE("%s]: new failed to allocate errs", __func__);
-                return;
-            }
-            for (size_t i=0; i < mCount; ++i) {
-                if (NULL == mIds || NULL == mOptions) {
+            if (NULL == mIds || NULL == mOptions) {
+                LocationError* errs = new LocationError[mCount];
+                for (size_t i=0; i < mCount; ++i) {
                     errs[i] = LOCATION_ERROR_INVALID_PARAMETER;
-                } else {
-                    mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
-                            [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
-                            &mApi = mApi, mOptions = mOptions, errs, i] (LocationError err ) {
-                        uint32_t hwId = 0;
-                        errs[i] = mAdapter.getHwIdFromClient(mClient, mIds[i], hwId);
-                        if (LOCATION_ERROR_SUCCESS == errs[i]) {
-                            mApi.modifyGeofence(hwId, mIds[i], mOptions[i],
-                                    new LocApiResponse(*mAdapter.getContext(),
-                                    [&mAdapter = mAdapter, mCount = mCount, mClient = mClient,
-                                    mIds = mIds, mOptions = mOptions, hwId, errs, i]
-                                    (LocationError err ) {
-                                if (LOCATION_ERROR_SUCCESS == err) {
-                                    errs[i] = err;
-
-                                    mAdapter.modifyGeofenceItem(hwId, mOptions[i]);
-                                }
-                                // Send aggregated response on last item and cleanup
-                                if (i == mCount-1) {
-                                    mAdapter.reportResponse(mClient, mCount, errs, mIds);
-                                    delete[] errs;
-                                    delete[] mIds;
-                                    delete[] mOptions;
-                                }
-                            }));
-                        } else {
-                            // Send aggregated response on last item and cleanup
-                            if (i == mCount-1) {
-                                mAdapter.reportResponse(mClient, mCount, errs, mIds);
-                                delete[] errs;
-                                delete[] mIds;
-                                delete[] mOptions;
-                            }
-                        }
-                    }));
                 }
+                mAdapter.reportResponse(mClient, mCount, errs, mIds);
+                delete[] errs;
+                delete[] mIds;
+                delete[] mOptions;
+                return;
             }
+            mApi.addToCallQueue(new LocApiResponse(*mAdapter.getContext(),
+                    [&mAdapter = mAdapter, mCount = mCount, mClient = mClient, mIds = mIds,
+                    &mApi = mApi, mOptions = mOptions] (LocationError /*err*/) {
+                mAdapter.requestGeofences(mClient, mCount, mIds, mOptions,
+                        [&mApi] (size_t count, const uint32_t* hwIds, const uint32_t* ids,
+                        const GeofenceOption* options, LocApiCollectiveResponse* response) {
+                    mApi.modifyGeofences(count, hwIds, ids, options, response);
+                }, [&mAdapter, mOptions] (size_t row, size_t i) {
+                    mAdapter.mGeofences.setOptions(row, mOptions[i]);
+                });
+            }));
         }
     };
 
@@ -641,56 +584,95 @@ GeofenceAdapter::modifyGeofencesCommand(LocationAPI* client, size_t count, uint3
     sendMsg(new MsgModifyGeofences(*this, *mLocApi, client, count, idsCopy, optionsCopy));
 }
 
+void
+GeofenceAdapter::requestGeofences(LocationAPI* client, size_t count, uint32_t* ids,
+        GeofenceOption* options,
+        const std::function<void (size_t count, const uint32_t* hwIds, const uint32_t* ids,
+                                  const GeofenceOption* options,
+                                  LocApiCollectiveResponse* response)>& request,
+        const std::function<void (size_t row, size_t i)>& update)
+{
+    // ids of the client that are not known are answered right here, the rest
+    // go in one request; at[] maps them back to their place in ids
+    struct Request {
+        std::vector<LocationError> errs;
+        std::vector<uint32_t> hwIds;
+        std::vector<uint32_t> ids;
+        std::vector<GeofenceOption> options;
+        std::vector<size_t> at;
+    };
+    auto req = std::make_shared<Request>();
+    req->errs.resize(count, LOCATION_ERROR_ID_UNKNOWN);
+    for (size_t i = 0; i < count; ++i) {
+        int32_t row = mGeofences.findByKey(GeofenceKey(client, ids[i]));
+        if (row >= 0) {
+            req->hwIds.push_back(mGeofences.getHwId(row));
+            req->ids.push_back(ids[i]);
+            if (NULL != options) {
+                req->options.push_back(options[i]);
+            }
+            req->at.push_back(i);
+        }
+    }
+
+    if (req->at.empty()) {
+        reportResponse(client, count, req->errs.data(), ids);
+        delete[] ids;
+        delete[] options;
+        return;
+    }
+
+    request(req->at.size(), req->hwIds.data(), req->ids.data(),
+            (NULL != options) ? req->options.data() : NULL,
+            new LocApiCollectiveResponse(*getContext(),
+            [this, client, count, ids, options, req, update]
+            (std::vector<LocationError> errs) {
+        for (size_t k = 0; k < req->at.size(); ++k) {
+            LocationError err = (k < errs.size()) ? errs[k] : LOCATION_ERROR_GENERAL_FAILURE;
+            req->errs[req->at[k]] = err;
+            if (LOCATION_ERROR_SUCCESS == err) {
+                int32_t row = mGeofences.findByHwId(req->hwIds[k]);
+                if (row >= 0) {
+                    update(row, req->at[k]);
+                } else {
+                    LOC_LOGE("%s]: geofence item not found. hwId %u", __func__, req->hwIds[k]);
+                }
+            }
+        }
+        dump();
+        reportResponse(client, count, req->errs.data(), ids);
+        delete[] ids;
+        delete[] options;
+    }));
+}
+
 void
 GeofenceAdapter::saveGeofenceItem(LocationAPI* client, uint32_t clientId, uint32_t hwId,
         const GeofenceOption& options, const GeofenceInfo& info)
 {
     LOC_LOGD("%s]: hwId %u client %p clientId %u", __func__, hwId, client, clientId);
-    GeofenceKey key(client, clientId);
-    GeofenceObject object = {key,
-                             options.breachTypeMask,
-                             options.responsiveness,
-                             options.dwellTime,
-                             info.latitude,
-                             info.longitude,
-                             info.radius,
-                             false};
-    mGeofences[hwId] = object;
-    mGeofenceIds[key] = hwId;
+    mGeofences.save(hwId, GeofenceKey(client, clientId), options, info);
     dump();
 }
 
 void
 GeofenceAdapter::removeGeofenceItem(uint32_t hwId)
 {
-    GeofenceKey key;
-    LocationError err = getGeofenceKeyFromHwId(hwId, key);
-    if (LOCATION_ERROR_SUCCESS != err) {
-        LOC_LOGE("%s]: can not find the key for hwId %u", __func__, hwId);
+    int32_t row = mGeofences.findByHwId(hwId);
+    if (row >= 0) {
+        mGeofences.remove(row);
+        dump();
     } else {
-        auto it1 = mGeofenceIds.find(key);
-        if (it1 != mGeofenceIds.end()) {
-            mGeofenceIds.erase(it1);
-
-            auto it2 = mGeofences.find(hwId);
-            if (it2 != mGeofences.end()) {
-                mGeofences.erase(it2);
-                dump();
-            } else {
-                LOC_LOGE("%s]:geofence item to erase not found. hwId %u", __func__, hwId);
-            }
-        } else {
-            LOC_LOGE("%s]: geofence item to erase not found. hwId %u", __func__, hwId);
-        }
+        LOC_LOGE("%s]: geofence item to erase not found. hwId %u", __func__, hwId);
     }
 }
 
 void
 GeofenceAdapter::pauseGeofenceItem(uint32_t hwId)
 {
-    auto it = mGeofences.find(hwId);
-    if (it != mGeofences.end()) {
-        it->second.paused = true;
+    int32_t row = mGeofences.findByHwId(hwId);
+    if (row >= 0) {
+        mGeofences.setPaused(row, true);
         dump();
     } else {
         LOC_LOGE("%s]: geofence item to pause not found. hwId %u", __func__, hwId);
@@ -700,9 +682,9 @@ GeofenceAdapter::pauseGeofenceItem(uint32_t hwId)
 void
 GeofenceAdapter::resumeGeofenceItem(uint32_t hwId)
 {
-    auto it = mGeofences.find(hwId);
-    if (it != mGeofences.end()) {
-        it->second.paused = false;
+    int32_t row = mGeofences.findByHwId(hwId);
+    if (row >= 0) {
+        mGeofences.setPaused(row, false);
         dump();
     } else {
         LOC_LOGE("%s]: geofence item to resume not found. hwId %u", __func__, hwId);
@@ -712,11 +694,9 @@ GeofenceAdapter::resumeGeofenceItem(uint32_t hwId)
 void
 GeofenceAdapter::modifyGeofenceItem(uint32_t hwId, const GeofenceOption& options)
 {
-    auto it = mGeofences.find(hwId);
-    if (it != mGeofences.end()) {
-        it->second.breachMask = options.breachTypeMask;
-        it->second.responsiveness = options.responsiveness;
-        it->second.dwellTime = options.dwellTime;
+    int32_t row = mGeofences.findByHwId(hwId);
+    if (row >= 0) {
+        mGeofences.setOptions(row, options);
         dump();
     } else {
         LOC_LOGE("%s]: geofence item to modify not found. hwId %u", __func__, hwId);
@@ -744,7 +724,7 @@ GeofenceAdapter::geofenceBreachEvent(size_t count, uint32_t* hwIds, Location& lo
     if (0 == count || NULL == hwIds)
         return;
 
-    struct MsgGeofenceBreach : public LocMsg {
+    struct MsgGeofenceBreach : public LocPooledMsg<MsgGeofenceBreach> {
         GeofenceAdapter& mAdapter;
         size_t mCount;
         uint32_t* mHwIds;
@@ -757,7 +737,7 @@ GeofenceAdapter::geofenceBreachEvent(size_t count, uint32_t* hwIds, Location& lo
                                  Location& location,
                                  GeofenceBreachType breachType,
                                  uint64_t timestamp) :
-            LocMsg(),
+            LocPooledMsg(),
             mAdapter(adapter),
             mCount(count),
             mHwIds(new uint32_t[count]),
@@ -857,11 +837,10 @@ GeofenceAdapter::dump()
     IF_LOC_LOGV {
         LOC_LOGV(
             "HAL | hwId  | mask | respon | latitude | longitude | radius | paused |  Id  | client");
-        for (auto it = mGeofences.begin(); it != mGeofences.end(); ++it) {
-            uint32_t hwId = it->first;
-            GeofenceObject object = it->second;
+        for (size_t row = 0; row < mGeofences.size(); ++row) {
+            GeofenceObject object = mGeofences.get(row);
             LOC_LOGV("    | %5u | %4u | %6u | %8.2f | %9.2f | %6.2f | %6u | %04x | %p ",
-                    hwId, object.breachMask, object.responsiveness,
+                    mGeofences.getHwId(row), object.breachMask, object.responsiveness,
                     object.latitude, object.longitude, object.radius,
                     object.paused, object.key.id, object.key.client);
         }
@@ -32,7 +32,8 @@
 #include <LocAdapterBase.h>
 #include <LocContext.h>
 #include <LocationAPI.h>
-#include <map>
+#include <GeofenceTable.h>
+#include <functional>
 
 using namespace loc_core;
 
@@ -44,41 +45,10 @@ using namespace loc_core;
     } \
 } while (0)
 
-typedef struct GeofenceKey {
-    LocationAPI* client;
-    uint32_t id;
-    inline GeofenceKey() :
-        client(NULL), id(0) {}
-    inline GeofenceKey(LocationAPI* _client, uint32_t _id) :
-        client(_client), id(_id) {}
-} GeofenceKey;
-inline bool operator <(GeofenceKey const& left, GeofenceKey const& right) {
-    return left.id < right.id || (left.id == right.id && left.client < right.client);
-}
-inline bool operator ==(GeofenceKey const& left, GeofenceKey const& right) {
-    return left.id == right.id && left.client == right.client;
-}
-inline bool operator !=(GeofenceKey const& left, GeofenceKey const& right) {
-    return left.id != right.id || left.client != right.client;
-}
-typedef struct {
-    GeofenceKey key;
-    GeofenceBreachTypeMask breachMask;
-    uint32_t responsiveness;
-    uint32_t dwellTime;
-    double latitude;
-    double longitude;
-    double radius;
-    bool paused;
-} GeofenceObject;
-typedef std::map<uint32_t, GeofenceObject> GeofencesMap; //map of hwId to GeofenceObject
-typedef std::map<GeofenceKey, uint32_t> GeofenceIdMap; //map of GeofenceKey to hwId
-
 class GeofenceAdapter : public LocAdapterBase {
 
     /* ==== GEOFENCES ====================================================================== */
-    GeofencesMap mGeofences; //map hwId to GeofenceObject
-    GeofenceIdMap mGeofenceIds; //map of GeofenceKey to hwId
+    GeofenceTable mGeofences; //GeofenceObjects by hwId and by GeofenceKey
 
 protected:
 
@@ -118,6 +88,13 @@ public:
     void pauseGeofenceItem(uint32_t hwId);
     void resumeGeofenceItem(uint32_t hwId);
     void modifyGeofenceItem(uint32_t hwId, const GeofenceOption& options);
+    void requestGeofences(LocationAPI* client, size_t count, uint32_t* ids,
+                          GeofenceOption* options,
+                          const std::function<void (size_t count, const uint32_t* hwIds,
+                                                    const uint32_t* ids,
+                                                    const GeofenceOption* options,
+                                                    LocApiCollectiveResponse* response)>& request,
+                          const std::function<void (size_t row, size_t i)>& update);
     LocationError getHwIdFromClient(LocationAPI* client, uint32_t clientId, uint32_t& hwId);
     LocationError getGeofenceKeyFromHwId(uint32_t hwId, GeofenceKey& key);
     void dump();
@@ -0,0 +1,483 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <math.h>
+#include <GeofenceEvaluator.h>
+
+#define EARTH_RADIUS_METERS 6371008.8
+#define DEG_TO_RAD (M_PI / 180)
+#define RAD_TO_DEG (180 / M_PI)
+#define NO_ROW 0xFFFFFFFF
+
+// haversine of an angle, sin^2(angle / 2); the haversine of the angle
+// between two points on a sphere is hav(dLat) + cos(lat1) cos(lat2) hav(dLon)
+static inline double hav(double angle) {
+    double s = sin(angle / 2);
+    return s * s;
+}
+
+GeofenceEvaluator::GeofenceEvaluator(double cellDegrees) :
+    mCellDegrees((cellDegrees >= 0.0001 && cellDegrees <= 90) ? cellDegrees : 0.01),
+    mLatCells((uint32_t)ceil(180 / mCellDegrees)),
+    mLonCells((uint32_t)ceil(360 / mCellDegrees)),
+    mEpoch(0) {
+}
+
+void GeofenceEvaluator::clear() {
+    mHwIds.clear();
+    mObjects.clear();
+    mLatRad.clear();
+    mLonRad.clear();
+    mCosLat.clear();
+    mLimits.clear();
+    mInside.clear();
+    mDwellPending.clear();
+    mSince.clear();
+    mSeen.clear();
+    mActiveAt.clear();
+    mRows.clear();
+    mCells.clear();
+    mLarge.clear();
+    mActive.clear();
+}
+
+uint64_t GeofenceEvaluator::cellOf(double latitude, double longitude) const {
+    double lat = floor((latitude + 90) / mCellDegrees);
+    uint64_t latCell = (lat < 0) ? 0 : ((lat >= mLatCells) ? mLatCells - 1 : (uint64_t)lat);
+    double lon = fmod(longitude + 180, 360);
+    if (lon < 0) {
+        lon += 360;
+    }
+    uint64_t lonCell = (uint64_t)floor(lon / mCellDegrees) % mLonCells;
+    return latCell * mLonCells + lonCell;
+}
+
+// The bounding box of a cap of angular radius d around latitude lat spans
+// lat +/- d, and asin(sin(d) / cos(lat)) of longitude either side, unless it
+// reaches a pole. Returns false if that is more than MAX_FENCE_CELLS cells.
+bool GeofenceEvaluator::cellsOf(size_t row, std::vector<uint64_t>& cells) const {
+    const GeofenceObject& object = mObjects[row];
+    double angle = fmin(object.radius / EARTH_RADIUS_METERS, M_PI) * (1 + 1e-9) + 1e-12;
+    double dLat = angle * RAD_TO_DEG;
+    double latMin = object.latitude - dLat;
+    double latMax = object.latitude + dLat;
+    bool allLons = (latMin <= -90 || latMax >= 90 || sin(angle) >= mCosLat[row]);
+    double dLon = allLons ? 180 : asin(sin(angle) / mCosLat[row]) * RAD_TO_DEG;
+
+    uint64_t latCell0 = cellOf(latMin, 0) / mLonCells;
+    uint64_t latCell1 = cellOf(latMax, 0) / mLonCells;
+    int64_t lonCell0 = (int64_t)floor((object.longitude - dLon + 180) / mCellDegrees);
+    int64_t lonCell1 = (int64_t)floor((object.longitude + dLon + 180) / mCellDegrees);
+    if (allLons || lonCell1 - lonCell0 + 1 >= mLonCells) {
+        lonCell0 = 0;
+        lonCell1 = mLonCells - 1;
+    }
+    if ((latCell1 - latCell0 + 1) * (uint64_t)(lonCell1 - lonCell0 + 1) > MAX_FENCE_CELLS) {
+        return false;
+    }
+
+    cells.clear();
+    for (uint64_t latCell = latCell0; latCell <= latCell1; latCell++) {
+        for (int64_t lonCell = lonCell0; lonCell <= lonCell1; lonCell++) {
+            int64_t wrapped = ((lonCell % mLonCells) + mLonCells) % mLonCells;
+            cells.push_back(latCell * mLonCells + wrapped);
+        }
+    }
+    return true;
+}
+
+// replaces row number from with to in the cells of the fence at row, or
+// takes it out if to is NO_ROW
+void GeofenceEvaluator::relink(size_t row, uint32_t from, uint32_t to) {
+    std::vector<uint64_t> cells;
+    bool small = cellsOf(row, cells);
+    size_t count = small ? cells.size() : 1;
+    for (size_t i = 0; i < count; i++) {
+        auto it = small ? mCells.find(cells[i]) : mCells.end();
+        if (small && it == mCells.end()) {
+            continue;
+        }
+        std::vector<uint32_t>& rows = small ? it->second : mLarge;
+        for (size_t k = 0; k < rows.size(); k++) {
+            if (rows[k] == from) {
+                if (NO_ROW == to) {
+                    rows[k] = rows.back();
+                    rows.pop_back();
+                } else {
+                    rows[k] = to;
+                }
+                break;
+            }
+        }
+        if (small && rows.empty()) {
+            mCells.erase(it);
+        }
+    }
+}
+
+void GeofenceEvaluator::add(uint32_t hwId, const GeofenceObject& object) {
+    remove(hwId);
+    uint32_t row = mHwIds.size();
+    mHwIds.push_back(hwId);
+    mObjects.push_back(object);
+    mLatRad.push_back(object.latitude * DEG_TO_RAD);
+    mLonRad.push_back(object.longitude * DEG_TO_RAD);
+    mCosLat.push_back(cos(object.latitude * DEG_TO_RAD));
+    mLimits.push_back(hav(fmin(object.radius / EARTH_RADIUS_METERS, M_PI)));
+    mInside.push_back(0);
+    mDwellPending.push_back(0);
+    mSince.push_back(0);
+    mSeen.push_back(0);
+    mActiveAt.push_back(-1);
+    mRows[hwId] = row;
+
+    std::vector<uint64_t> cells;
+    if (cellsOf(row, cells)) {
+        for (size_t i = 0; i < cells.size(); i++) {
+            mCells[cells[i]].push_back(row);
+        }
+    } else {
+        mLarge.push_back(row);
+    }
+}
+
+void GeofenceEvaluator::remove(uint32_t hwId) {
+    auto it = mRows.find(hwId);
+    if (it == mRows.end()) {
+        return;
+    }
+    uint32_t row = it->second;
+    uint32_t last = mHwIds.size() - 1;
+    mRows.erase(it);
+    setActive(row, false);
+    relink(row, row, NO_ROW);
+    if (row != last) {
+        relink(last, last, row);
+        if (mActiveAt[last] >= 0) {
+            mActive[mActiveAt[last]] = row;
+        }
+        mRows[mHwIds[last]] = row;
+        mHwIds[row] = mHwIds[last];
+        mObjects[row] = mObjects[last];
+        mLatRad[row] = mLatRad[last];
+        mLonRad[row] = mLonRad[last];
+        mCosLat[row] = mCosLat[last];
+        mLimits[row] = mLimits[last];
+        mInside[row] = mInside[last];
+        mDwellPending[row] = mDwellPending[last];
+        mSince[row] = mSince[last];
+        mSeen[row] = mSeen[last];
+        mActiveAt[row] = mActiveAt[last];
+    }
+    mHwIds.pop_back();
+    mObjects.pop_back();
+    mLatRad.pop_back();
+    mLonRad.pop_back();
+    mCosLat.pop_back();
+    mLimits.pop_back();
+    mInside.pop_back();
+    mDwellPending.pop_back();
+    mSince.pop_back();
+    mSeen.pop_back();
+    mActiveAt.pop_back();
+}
+
+void GeofenceEvaluator::load(const GeofenceTable& table) {
+    clear();
+    for (size_t row = 0; row < table.size(); row++) {
+        GeofenceObject object = table.get(row);
+        if (!object.paused && NULL != object.key.client) {
+            add(table.getHwId(row), object);
+        }
+    }
+}
+
+void GeofenceEvaluator::setActive(size_t row, bool active) {
+    if (active && mActiveAt[row] < 0) {
+        mActiveAt[row] = mActive.size();
+        mActive.push_back(row);
+    } else if (!active && mActiveAt[row] >= 0) {
+        uint32_t moved = mActive.back();
+        mActive[mActiveAt[row]] = moved;
+        mActiveAt[moved] = mActiveAt[row];
+        mActive.pop_back();
+        mActiveAt[row] = -1;
+    }
+}
+
+void GeofenceEvaluator::step(size_t row, bool inside, uint64_t timestamp,
+                             std::vector<GeofenceEvaluatorBreach>& breaches) {
+    GeofenceBreachTypeMask mask = mObjects[row].breachMask;
+    if (inside != (0 != mInside[row])) {
+        mInside[row] = inside ? 1 : 0;
+        mSince[row] = timestamp;
+        if (mask & (inside ? GEOFENCE_BREACH_ENTER_BIT : GEOFENCE_BREACH_EXIT_BIT)) {
+            breaches.push_back({mHwIds[row],
+                                inside ? GEOFENCE_BREACH_ENTER : GEOFENCE_BREACH_EXIT});
+        }
+        mDwellPending[row] =
+                (mask & (inside ? GEOFENCE_BREACH_DWELL_IN_BIT : GEOFENCE_BREACH_DWELL_OUT_BIT)) ?
+                1 : 0;
+    }
+    if (mDwellPending[row] &&
+            timestamp >= mSince[row] + (uint64_t)mObjects[row].dwellTime * 1000) {
+        breaches.push_back({mHwIds[row],
+                            inside ? GEOFENCE_BREACH_DWELL_IN : GEOFENCE_BREACH_DWELL_OUT});
+        mDwellPending[row] = 0;
+    }
+    setActive(row, inside || mDwellPending[row]);
+}
+
+void GeofenceEvaluator::evaluate(const Location& location,
+                                 std::vector<GeofenceEvaluatorBreach>& breaches) {
+    if (0 == ++mEpoch) {
+        mSeen.assign(mSeen.size(), 0);
+        mEpoch = 1;
+    }
+    double lat = location.latitude * DEG_TO_RAD;
+    double lon = location.longitude * DEG_TO_RAD;
+    double cosLat = cos(lat);
+
+    auto check = [&] (uint32_t row) {
+        mSeen[row] = mEpoch;
+        double a = hav(lat - mLatRad[row]) + cosLat * mCosLat[row] * hav(lon - mLonRad[row]);
+        step(row, a <= mLimits[row], location.timestamp, breaches);
+    };
+    auto it = mCells.find(cellOf(location.latitude, location.longitude));
+    if (it != mCells.end()) {
+        for (uint32_t row : it->second) {
+            check(row);
+        }
+    }
+    for (uint32_t row : mLarge) {
+        check(row);
+    }
+    // the rest are outside; step() taking one out of mActive moves the last
+    // one into its place, which going backwards has already been passed
+    for (size_t i = mActive.size(); i-- > 0;) {
+        uint32_t row = mActive[i];
+        if (mSeen[row] != mEpoch) {
+            step(row, false, location.timestamp, breaches);
+        }
+    }
+}
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+static double debugRandom(double min, double max) {
+    return min + (max - min) * rand() / RAND_MAX;
+}
+
+// a fix with only its time and coordinates set
+static Location debugLocation(uint64_t timestamp, double latitude, double longitude) {
+    Location location;
+    memset(&location, 0, sizeof(location));
+    location.size = sizeof(Location);
+    location.timestamp = timestamp;
+    location.latitude = latitude;
+    location.longitude = longitude;
+    return location;
+}
+
+// checks every fence with every position, by distance in meters
+struct GeofenceEvaluatorDebugRef {
+    struct Fence {
+        uint32_t hwId;
+        GeofenceObject object;
+        bool inside;
+        bool pending;
+        uint64_t since;
+    };
+    std::vector<Fence> mFences;
+
+    void add(uint32_t hwId, const GeofenceObject& object) {
+        mFences.push_back({hwId, object, false, false, 0});
+    }
+    void remove(uint32_t hwId) {
+        for (size_t i = 0; i < mFences.size(); i++) {
+            if (mFences[i].hwId == hwId) {
+                mFences.erase(mFences.begin() + i);
+                return;
+            }
+        }
+    }
+    void evaluate(const Location& location, std::vector<GeofenceEvaluatorBreach>& breaches) {
+        for (Fence& fence : mFences) {
+            double lat1 = location.latitude * DEG_TO_RAD;
+            double lat2 = fence.object.latitude * DEG_TO_RAD;
+            double dLon = (location.longitude - fence.object.longitude) * DEG_TO_RAD;
+            double a = hav(lat1 - lat2) + cos(lat1) * cos(lat2) * hav(dLon);
+            double meters = 2 * EARTH_RADIUS_METERS * asin(sqrt(fmin(a, 1)));
+            bool inside = meters <= fence.object.radius;
+            GeofenceBreachTypeMask mask = fence.object.breachMask;
+            if (inside != fence.inside) {
+                fence.inside = inside;
+                fence.since = location.timestamp;
+                if (mask & (inside ? GEOFENCE_BREACH_ENTER_BIT : GEOFENCE_BREACH_EXIT_BIT)) {
+                    breaches.push_back({fence.hwId,
+                                        inside ? GEOFENCE_BREACH_ENTER : GEOFENCE_BREACH_EXIT});
+                }
+                fence.pending = 0 != (mask & (inside ? GEOFENCE_BREACH_DWELL_IN_BIT :
+                                                       GEOFENCE_BREACH_DWELL_OUT_BIT));
+            }
+            if (fence.pending &&
+                    location.timestamp >= fence.since + fence.object.dwellTime * 1000ULL) {
+                breaches.push_back({fence.hwId, inside ? GEOFENCE_BREACH_DWELL_IN :
+                                                         GEOFENCE_BREACH_DWELL_OUT});
+                fence.pending = false;
+            }
+        }
+    }
+};
+
+static bool breachLess(const GeofenceEvaluatorBreach& a, const GeofenceEvaluatorBreach& b) {
+    return a.hwId < b.hwId || (a.hwId == b.hwId && a.type < b.type);
+}
+
+static bool sameBreaches(std::vector<GeofenceEvaluatorBreach>& a,
+                         std::vector<GeofenceEvaluatorBreach>& b) {
+    std::sort(a.begin(), a.end(), breachLess);
+    std::sort(b.begin(), b.end(), breachLess);
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].hwId != b[i].hwId || a[i].type != b[i].type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// For Linux command line testing:
+// compilation: g++ -O2 -c -I. -I../location GeofenceTable.cpp &&
+//     g++ -D__LOC_DEBUG__ -O2 -I. -I../location GeofenceEvaluator.cpp GeofenceTable.o
+// test: ./a.out 20000 10000
+// Puts *count* geofences of 50 to 500 m, and a few of 20 km, over a 0.5 by
+// 0.5 degree area, then replays a track of *fixes* positions a second apart
+// at driving speed through it, taking a tenth of the fences out half way.
+// Every breach is checked against evaluating each fence with each position,
+// and both are timed.
+int main(int argc, char** argv) {
+    uint32_t count = (argc > 1) ? atoi(argv[1]) : 20000;
+    uint32_t fixes = (argc > 2) ? atoi(argv[2]) : 10000;
+    srand(time(NULL));
+
+    GeofenceEvaluator evaluator;
+    GeofenceEvaluatorDebugRef ref;
+    for (uint32_t i = 0; i < count; i++) {
+        GeofenceObject object = {GeofenceKey(NULL, i),
+                                 (GeofenceBreachTypeMask)(1 + rand() % 15),
+                                 0,
+                                 (uint32_t)(rand() % 30),
+                                 debugRandom(37.0, 37.5),
+                                 debugRandom(-122.5, -122.0),
+                                 (i % 1000) ? debugRandom(50, 500) : 20000,
+                                 false};
+        evaluator.add(1000 + i, object);
+        ref.add(1000 + i, object);
+    }
+
+    // fences around the antimeridian and the pole
+    GeofenceObject edge = {GeofenceKey(NULL, 0), 0xF, 0, 0, 10.0, 179.9995, 300, false};
+    GeofenceObject pole = {GeofenceKey(NULL, 0), 0xF, 0, 0, 89.999, 0, 500, false};
+    GeofenceEvaluator edges;
+    std::vector<GeofenceEvaluatorBreach> edgeBreaches;
+    edges.add(1, edge);
+    edges.add(2, pole);
+    Location there = debugLocation(1000, 10.0, -179.9995);
+    edges.evaluate(there, edgeBreaches);
+    there.timestamp = 2000;
+    there.latitude = 89.9999;
+    there.longitude = 135;
+    edges.evaluate(there, edgeBreaches);
+    // both entered and dwelt in at once, then the first one left
+    std::vector<GeofenceEvaluatorBreach> edgeExpected = {
+        {1, GEOFENCE_BREACH_ENTER}, {1, GEOFENCE_BREACH_EXIT},
+        {1, GEOFENCE_BREACH_DWELL_IN}, {1, GEOFENCE_BREACH_DWELL_OUT},
+        {2, GEOFENCE_BREACH_ENTER}, {2, GEOFENCE_BREACH_DWELL_IN}};
+    bool edgesPass = sameBreaches(edgeBreaches, edgeExpected);
+    printf("antimeridian and pole: %s\n", edgesPass ? "PASS" : "FAIL");
+
+    std::vector<Location> track(fixes);
+    double lat = 37.25, lon = -122.25, heading = 0;
+    for (uint32_t i = 0; i < fixes; i++) {
+        heading += debugRandom(-0.3, 0.3);
+        lat += 15 * cos(heading) / EARTH_RADIUS_METERS * RAD_TO_DEG;
+        lon += 15 * sin(heading) / EARTH_RADIUS_METERS * RAD_TO_DEG / cos(lat * DEG_TO_RAD);
+        if (lat < 37.0 || lat > 37.5 || lon < -122.5 || lon > -122.0) {
+            heading += M_PI;
+        }
+        track[i] = debugLocation(1000ULL * i, lat, lon);
+    }
+
+    std::vector<GeofenceEvaluatorBreach> breaches, refBreaches;
+    size_t total = 0;
+    uint32_t wrong = 0;
+    double evaluatorSeconds = 0, refSeconds = 0;
+    for (uint32_t i = 0; i < fixes; i++) {
+        if (fixes / 2 == i) {
+            for (uint32_t k = 0; k < count; k += 10) {
+                evaluator.remove(1000 + k);
+                ref.remove(1000 + k);
+            }
+        }
+        breaches.clear();
+        refBreaches.clear();
+        double t0 = getSeconds();
+        evaluator.evaluate(track[i], breaches);
+        double t1 = getSeconds();
+        ref.evaluate(track[i], refBreaches);
+        double t2 = getSeconds();
+        evaluatorSeconds += t1 - t0;
+        refSeconds += t2 - t1;
+        total += breaches.size();
+        if (!sameBreaches(breaches, refBreaches)) {
+            wrong++;
+        }
+    }
+    printf("%u fences, %u fixes, %zu breaches, %u fixes wrong: %s\n",
+           count, fixes, total, wrong, wrong ? "FAIL" : "PASS");
+    printf("evaluator: %.2f us per fix\n", evaluatorSeconds * 1000000 / fixes);
+    printf("all fences: %.2f us per fix\n", refSeconds * 1000000 / fixes);
+    return 0;
+}
+
+#endif
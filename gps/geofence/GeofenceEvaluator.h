@@ -0,0 +1,105 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef GEOFENCE_EVALUATOR_H
+#define GEOFENCE_EVALUATOR_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include <GeofenceTable.h>
+
+typedef struct {
+    uint32_t hwId;
+    GeofenceBreachType type;
+} GeofenceEvaluatorBreach;
+
+/* Evaluates positions against circular geofences on the AP, the way the modem
+   does, for replaying recorded tracks and for checking the breaches the modem
+   reports.
+   A fence is entered when the position is within its radius and exited when
+   it is not; dwell in is reported once the position has stayed inside for
+   the fence's dwellTime, and dwell out once it has stayed outside for as
+   long. Only the breach types in the fence's breachMask are reported.
+   Fences are indexed by the cells of a latitude / longitude grid their
+   bounding boxes touch, so a position is only checked against the fences of
+   its own cell, and against the ones it is inside of or still has a dwell
+   pending with. */
+class GeofenceEvaluator {
+public:
+    /* fences touching more than this many cells are checked every time */
+    static const size_t MAX_FENCE_CELLS = 256;
+
+    GeofenceEvaluator(double cellDegrees = 0.01);
+    inline size_t size() const { return mHwIds.size(); }
+    void clear();
+    /* adds the fence of hwId, or replaces it; either way it starts outside */
+    void add(uint32_t hwId, const GeofenceObject& object);
+    void remove(uint32_t hwId);
+    /* replaces all fences with the ones of table that are not paused and
+       still have a client */
+    void load(const GeofenceTable& table);
+    /* appends the breaches caused by location to breaches; locations are
+       expected in timestamp order */
+    void evaluate(const Location& location, std::vector<GeofenceEvaluatorBreach>& breaches);
+
+private:
+    double mCellDegrees;
+    uint32_t mLatCells;
+    uint32_t mLonCells;
+    uint32_t mEpoch;
+
+    std::vector<uint32_t> mHwIds;
+    std::vector<GeofenceObject> mObjects;
+    // center in radians, cos of its latitude, and the haversine of the
+    // angle the radius spans, which a position's haversine is compared with
+    std::vector<double> mLatRad;
+    std::vector<double> mLonRad;
+    std::vector<double> mCosLat;
+    std::vector<double> mLimits;
+    std::vector<uint8_t> mInside;
+    std::vector<uint8_t> mDwellPending;
+    std::vector<uint64_t> mSince;
+    std::vector<uint32_t> mSeen;
+    std::vector<int32_t> mActiveAt;
+
+    std::unordered_map<uint32_t, uint32_t> mRows;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> mCells;
+    std::vector<uint32_t> mLarge;
+    // rows inside their fence, or with a dwell pending
+    std::vector<uint32_t> mActive;
+
+    bool cellsOf(size_t row, std::vector<uint64_t>& cells) const;
+    uint64_t cellOf(double latitude, double longitude) const;
+    void relink(size_t row, uint32_t from, uint32_t to);
+    void setActive(size_t row, bool active);
+    void step(size_t row, bool inside, uint64_t timestamp,
+              std::vector<GeofenceEvaluatorBreach>& breaches);
+};
+
+#endif /* GEOFENCE_EVALUATOR_H */
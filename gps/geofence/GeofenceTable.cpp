@@ -0,0 +1,477 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <GeofenceTable.h>
+
+#define MIN_SLOTS 16
+
+static inline uint32_t mix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85EBCA6B;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35;
+    h ^= h >> 16;
+    return h;
+}
+
+static inline uint32_t hashOf(uint32_t hwId) {
+    return mix(hwId);
+}
+
+static inline uint32_t hashOf(const GeofenceKey& key) {
+    uint64_t client = (uint64_t)(uintptr_t)key.client;
+    return mix(key.id ^ mix((uint32_t)client ^ (uint32_t)(client >> 32)));
+}
+
+GeofenceTable::GeofenceTable() : mMask(0) {
+    reindex(MIN_SLOTS);
+}
+
+void GeofenceTable::reserve(size_t count) {
+    mHwIds.reserve(count);
+    mKeys.reserve(count);
+    mBreachMasks.reserve(count);
+    mResponsiveness.reserve(count);
+    mDwellTimes.reserve(count);
+    mLatitudes.reserve(count);
+    mLongitudes.reserve(count);
+    mRadii.reserve(count);
+    mPaused.reserve(count);
+    size_t capacity = mHwIdSlots.size();
+    while (count * 2 > capacity) {
+        capacity *= 2;
+    }
+    if (capacity != mHwIdSlots.size()) {
+        reindex(capacity);
+    }
+}
+
+void GeofenceTable::clear() {
+    mHwIds.clear();
+    mKeys.clear();
+    mBreachMasks.clear();
+    mResponsiveness.clear();
+    mDwellTimes.clear();
+    mLatitudes.clear();
+    mLongitudes.clear();
+    mRadii.clear();
+    mPaused.clear();
+    reindex(MIN_SLOTS);
+}
+
+size_t GeofenceTable::hwIdSlot(uint32_t hwId) const {
+    size_t slot = hashOf(hwId) & mMask;
+    while (mHwIdSlots[slot] >= 0 && mHwIds[mHwIdSlots[slot]] != hwId) {
+        slot = (slot + 1) & mMask;
+    }
+    return slot;
+}
+
+size_t GeofenceTable::keySlot(const GeofenceKey& key) const {
+    size_t slot = hashOf(key) & mMask;
+    while (mKeySlots[slot] >= 0 && mKeys[mKeySlots[slot]] != key) {
+        slot = (slot + 1) & mMask;
+    }
+    return slot;
+}
+
+uint32_t GeofenceTable::homeOf(bool byKey, int32_t row) const {
+    return (byKey ? hashOf(mKeys[row]) : hashOf(mHwIds[row])) & mMask;
+}
+
+// Empties slot, then moves back each entry further down the probe run that
+// would no longer be found past the hole, so no tombstones are needed.
+void GeofenceTable::unindex(bool byKey, size_t slot) {
+    std::vector<int32_t>& slots = byKey ? mKeySlots : mHwIdSlots;
+    size_t hole = slot;
+    slots[hole] = -1;
+    for (size_t next = (hole + 1) & mMask; slots[next] >= 0; next = (next + 1) & mMask) {
+        size_t home = homeOf(byKey, slots[next]);
+        if (((next - home) & mMask) >= ((next - hole) & mMask)) {
+            slots[hole] = slots[next];
+            slots[next] = -1;
+            hole = next;
+        }
+    }
+}
+
+void GeofenceTable::reindex(size_t capacity) {
+    mHwIdSlots.assign(capacity, -1);
+    mKeySlots.assign(capacity, -1);
+    mMask = capacity - 1;
+    for (size_t row = 0; row < mHwIds.size(); row++) {
+        mHwIdSlots[hwIdSlot(mHwIds[row])] = row;
+        if (NULL != mKeys[row].client) {
+            mKeySlots[keySlot(mKeys[row])] = row;
+        }
+    }
+}
+
+int32_t GeofenceTable::findByHwId(uint32_t hwId) const {
+    return mHwIdSlots[hwIdSlot(hwId)];
+}
+
+int32_t GeofenceTable::findByKey(const GeofenceKey& key) const {
+    return (NULL == key.client) ? -1 : mKeySlots[keySlot(key)];
+}
+
+size_t GeofenceTable::save(uint32_t hwId, const GeofenceKey& key,
+                           const GeofenceOption& options, const GeofenceInfo& info) {
+    int32_t row = findByHwId(hwId);
+    int32_t other = findByKey(key);
+    if (other >= 0 && other != row) {
+        remove(other);
+        row = findByHwId(hwId);
+    }
+    if (row < 0) {
+        if ((mHwIds.size() + 1) * 2 > mHwIdSlots.size()) {
+            reindex(mHwIdSlots.size() * 2);
+        }
+        row = mHwIds.size();
+        mHwIds.push_back(hwId);
+        mKeys.push_back(GeofenceKey());
+        mBreachMasks.push_back(0);
+        mResponsiveness.push_back(0);
+        mDwellTimes.push_back(0);
+        mLatitudes.push_back(0);
+        mLongitudes.push_back(0);
+        mRadii.push_back(0);
+        mPaused.push_back(0);
+        mHwIdSlots[hwIdSlot(hwId)] = row;
+    }
+    bool indexed = (NULL != mKeys[row].client);
+    if (mKeys[row] != key || !indexed) {
+        if (indexed) {
+            unindex(true, keySlot(mKeys[row]));
+        }
+        mKeys[row] = key;
+        if (NULL != key.client) {
+            mKeySlots[keySlot(key)] = row;
+        }
+    }
+    setOptions(row, options);
+    mLatitudes[row] = info.latitude;
+    mLongitudes[row] = info.longitude;
+    mRadii[row] = info.radius;
+    mPaused[row] = 0;
+    return row;
+}
+
+void GeofenceTable::remove(size_t row) {
+    size_t last = mHwIds.size() - 1;
+    unindex(false, hwIdSlot(mHwIds[row]));
+    if (NULL != mKeys[row].client) {
+        unindex(true, keySlot(mKeys[row]));
+    }
+    if (row != last) {
+        mHwIdSlots[hwIdSlot(mHwIds[last])] = row;
+        if (NULL != mKeys[last].client) {
+            mKeySlots[keySlot(mKeys[last])] = row;
+        }
+        mHwIds[row] = mHwIds[last];
+        mKeys[row] = mKeys[last];
+        mBreachMasks[row] = mBreachMasks[last];
+        mResponsiveness[row] = mResponsiveness[last];
+        mDwellTimes[row] = mDwellTimes[last];
+        mLatitudes[row] = mLatitudes[last];
+        mLongitudes[row] = mLongitudes[last];
+        mRadii[row] = mRadii[last];
+        mPaused[row] = mPaused[last];
+    }
+    mHwIds.pop_back();
+    mKeys.pop_back();
+    mBreachMasks.pop_back();
+    mResponsiveness.pop_back();
+    mDwellTimes.pop_back();
+    mLatitudes.pop_back();
+    mLongitudes.pop_back();
+    mRadii.pop_back();
+    mPaused.pop_back();
+}
+
+void GeofenceTable::detach(size_t row) {
+    if (NULL != mKeys[row].client) {
+        unindex(true, keySlot(mKeys[row]));
+        mKeys[row].client = NULL;
+    }
+}
+
+GeofenceObject GeofenceTable::get(size_t row) const {
+    GeofenceObject object = {mKeys[row],
+                             mBreachMasks[row],
+                             mResponsiveness[row],
+                             mDwellTimes[row],
+                             mLatitudes[row],
+                             mLongitudes[row],
+                             mRadii[row],
+                             0 != mPaused[row]};
+    return object;
+}
+
+void GeofenceTable::setOptions(size_t row, const GeofenceOption& options) {
+    mBreachMasks[row] = options.breachTypeMask;
+    mResponsiveness[row] = options.responsiveness;
+    mDwellTimes[row] = options.dwellTime;
+}
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <map>
+
+typedef std::map<uint32_t, GeofenceObject> LocGeofenceDebugMap;
+typedef std::map<GeofenceKey, uint32_t> LocGeofenceDebugIdMap;
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+static LocationAPI* debugClient(uint32_t n) {
+    return (LocationAPI*)(uintptr_t)(0x7f0000001000 + n * 0x40);
+}
+
+static GeofenceOption debugOption(uint32_t n) {
+    GeofenceOption option = {sizeof(GeofenceOption), (GeofenceBreachTypeMask)(n & 0xF),
+                             n % 1000, n % 60};
+    return option;
+}
+
+static GeofenceInfo debugInfo(uint32_t n) {
+    GeofenceInfo info = {sizeof(GeofenceInfo), (double)(n % 18000) / 100 - 90,
+                         (double)(n % 36000) / 100 - 180, (double)(100 + n % 900)};
+    return info;
+}
+
+static bool sameObject(const GeofenceObject& a, const GeofenceObject& b) {
+    return a.key == b.key && a.breachMask == b.breachMask &&
+            a.responsiveness == b.responsiveness && a.dwellTime == b.dwellTime &&
+            a.latitude == b.latitude && a.longitude == b.longitude &&
+            a.radius == b.radius && a.paused == b.paused;
+}
+
+// random saves, removes by hwId or by key, pauses and detaches, on the table
+// and on the maps GeofenceAdapter used to keep, which have to agree throughout
+static int checkAgainstMaps(int rounds) {
+    GeofenceTable table;
+    LocGeofenceDebugMap objects;
+    LocGeofenceDebugIdMap ids;
+    int wrong = 0;
+    for (int i = 0; i < rounds; i++) {
+        uint32_t hwId = 1 + rand() % 2000;
+        GeofenceKey key(debugClient(rand() % 4), 1 + rand() % 500);
+        int op = rand() % 8;
+        if (op < 4) {
+            // a key moving to another hwId leaves the old hwId behind in the
+            // maps; the table drops it, so the maps do the same here
+            auto old = ids.find(key);
+            if (old != ids.end() && old->second != hwId) {
+                objects.erase(old->second);
+            }
+            auto prev = objects.find(hwId);
+            if (prev != objects.end() && NULL != prev->second.key.client) {
+                ids.erase(prev->second.key);
+            }
+            GeofenceOption option = debugOption(i);
+            GeofenceInfo info = debugInfo(i);
+            GeofenceObject object = {key, option.breachTypeMask, option.responsiveness,
+                                     option.dwellTime, info.latitude, info.longitude,
+                                     info.radius, false};
+            objects[hwId] = object;
+            ids[key] = hwId;
+            table.save(hwId, key, option, info);
+        } else if (op == 4) {
+            auto it = objects.find(hwId);
+            int32_t row = table.findByHwId(hwId);
+            wrong += ((it != objects.end()) != (row >= 0)) ? 1 : 0;
+            if (row >= 0) {
+                if (NULL != it->second.key.client) {
+                    ids.erase(it->second.key);
+                }
+                objects.erase(it);
+                table.remove(row);
+            }
+        } else if (op == 5) {
+            auto it = ids.find(key);
+            int32_t row = table.findByKey(key);
+            wrong += ((it != ids.end()) != (row >= 0)) ? 1 : 0;
+            if (row >= 0) {
+                wrong += (table.getHwId(row) != it->second) ? 1 : 0;
+                objects.erase(it->second);
+                ids.erase(it);
+                table.remove(row);
+            }
+        } else if (op == 6) {
+            int32_t row = table.findByHwId(hwId);
+            if (row >= 0) {
+                table.setPaused(row, !table.isPaused(row));
+                objects[hwId].paused = table.isPaused(row);
+            }
+        } else {
+            int32_t row = table.findByHwId(hwId);
+            if (row >= 0 && 0 == rand() % 4) {
+                GeofenceObject& object = objects[hwId];
+                if (NULL != object.key.client) {
+                    ids.erase(object.key);
+                }
+                object.key.client = NULL;
+                table.detach(row);
+            }
+        }
+        if (0 == i % 97 || i == rounds - 1) {
+            wrong += (table.size() != objects.size()) ? 1 : 0;
+            for (auto& it : objects) {
+                int32_t row = table.findByHwId(it.first);
+                wrong += (row < 0 || !sameObject(table.get(row), it.second)) ? 1 : 0;
+            }
+            for (auto& it : ids) {
+                int32_t row = table.findByKey(it.first);
+                wrong += (row < 0 || table.getHwId(row) != it.second) ? 1 : 0;
+            }
+        }
+    }
+    return wrong;
+}
+
+// For Linux command line testing:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../location GeofenceTable.cpp
+// test: ./a.out 10000
+// Checks the table against the maps it replaces in GeofenceAdapter, then
+// times loading *count* geofences over a few clients, looking them all up by
+// key and by hwId, restoring them all as restartGeofences() does, and
+// removing them, on the table and on the maps.
+int main(int argc, char** argv) {
+    uint32_t count = (argc > 1) ? atoi(argv[1]) : 10000;
+    srand(time(NULL));
+    int wrong = checkAgainstMaps(200000);
+    printf("random ops against maps: %d wrong: %s\n", wrong, wrong ? "FAIL" : "PASS");
+
+    std::vector<GeofenceKey> keys(count);
+    std::vector<uint32_t> hwIds(count);
+    std::vector<GeofenceOption> options(count);
+    std::vector<GeofenceInfo> infos(count);
+    for (uint32_t i = 0; i < count; i++) {
+        keys[i] = GeofenceKey(debugClient(i % 8), 1000 + i);
+        hwIds[i] = 100000 + ((i * 7919) % count);
+        options[i] = debugOption(i);
+        infos[i] = debugInfo(i);
+    }
+    uint64_t sum = 0;
+    int reps = 20;
+
+    double t[5] = {};
+    for (int r = 0; r < reps; r++) {
+        GeofenceTable table;
+        double t0 = getSeconds();
+        for (uint32_t i = 0; i < count; i++) {
+            table.save(hwIds[i], keys[i], options[i], infos[i]);
+        }
+        double t1 = getSeconds();
+        for (uint32_t i = 0; i < count; i++) {
+            sum += table.getHwId(table.findByKey(keys[i]));
+            sum += table.getKey(table.findByHwId(hwIds[i])).id;
+        }
+        double t2 = getSeconds();
+        std::vector<GeofenceObject> old(table.size());
+        std::vector<uint32_t> oldHwIds(table.size());
+        for (size_t row = 0; row < table.size(); row++) {
+            old[row] = table.get(row);
+            oldHwIds[row] = table.getHwId(row);
+        }
+        table.clear();
+        table.reserve(old.size());
+        for (size_t n = 0; n < old.size(); n++) {
+            GeofenceOption option = {sizeof(GeofenceOption), old[n].breachMask,
+                                     old[n].responsiveness, old[n].dwellTime};
+            GeofenceInfo info = {sizeof(GeofenceInfo), old[n].latitude,
+                                 old[n].longitude, old[n].radius};
+            table.save(oldHwIds[n], old[n].key, option, info);
+        }
+        double t3 = getSeconds();
+        for (uint32_t i = 0; i < count; i++) {
+            table.remove(table.findByKey(keys[i]));
+        }
+        double t4 = getSeconds();
+        t[0] += t1 - t0;
+        t[1] += t2 - t1;
+        t[2] += t3 - t2;
+        t[3] += t4 - t3;
+    }
+    printf("table: %u fences, load %.3f ms, lookup %.3f ms, restore %.3f ms, remove %.3f ms\n",
+           count, t[0] * 1000 / reps, t[1] * 1000 / reps, t[2] * 1000 / reps,
+           t[3] * 1000 / reps);
+
+    t[0] = t[1] = t[2] = t[3] = 0;
+    for (int r = 0; r < reps; r++) {
+        LocGeofenceDebugMap objects;
+        LocGeofenceDebugIdMap ids;
+        double t0 = getSeconds();
+        for (uint32_t i = 0; i < count; i++) {
+            GeofenceObject object = {keys[i], options[i].breachTypeMask,
+                                     options[i].responsiveness, options[i].dwellTime,
+                                     infos[i].latitude, infos[i].longitude, infos[i].radius,
+                                     false};
+            objects[hwIds[i]] = object;
+            ids[keys[i]] = hwIds[i];
+        }
+        double t1 = getSeconds();
+        for (uint32_t i = 0; i < count; i++) {
+            sum += ids.find(keys[i])->second;
+            sum += objects.find(hwIds[i])->second.key.id;
+        }
+        double t2 = getSeconds();
+        LocGeofenceDebugMap old(objects);
+        objects.clear();
+        ids.clear();
+        for (auto& it : old) {
+            objects[it.first] = it.second;
+            ids[it.second.key] = it.first;
+        }
+        double t3 = getSeconds();
+        for (uint32_t i = 0; i < count; i++) {
+            auto it = ids.find(keys[i]);
+            objects.erase(it->second);
+            ids.erase(it);
+        }
+        double t4 = getSeconds();
+        t[0] += t1 - t0;
+        t[1] += t2 - t1;
+        t[2] += t3 - t2;
+        t[3] += t4 - t3;
+    }
+    printf("maps:  %u fences, load %.3f ms, lookup %.3f ms, restore %.3f ms, remove %.3f ms\n",
+           count, t[0] * 1000 / reps, t[1] * 1000 / reps, t[2] * 1000 / reps,
+           t[3] * 1000 / reps);
+
+    return (0 == wrong && 0 != sum) ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,119 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef GEOFENCE_TABLE_H
+#define GEOFENCE_TABLE_H
+
+#include <stdint.h>
+#include <vector>
+#include <LocationDataTypes.h>
+
+class LocationAPI;
+
+typedef struct GeofenceKey {
+    LocationAPI* client;
+    uint32_t id;
+    inline GeofenceKey() :
+        client(NULL), id(0) {}
+    inline GeofenceKey(LocationAPI* _client, uint32_t _id) :
+        client(_client), id(_id) {}
+} GeofenceKey;
+inline bool operator <(GeofenceKey const& left, GeofenceKey const& right) {
+    return left.id < right.id || (left.id == right.id && left.client < right.client);
+}
+inline bool operator ==(GeofenceKey const& left, GeofenceKey const& right) {
+    return left.id == right.id && left.client == right.client;
+}
+inline bool operator !=(GeofenceKey const& left, GeofenceKey const& right) {
+    return left.id != right.id || left.client != right.client;
+}
+typedef struct {
+    GeofenceKey key;
+    GeofenceBreachTypeMask breachMask;
+    uint32_t responsiveness;
+    uint32_t dwellTime;
+    double latitude;
+    double longitude;
+    double radius;
+    bool paused;
+} GeofenceObject;
+
+/* Geofences in rows, stored a column per field, so that going over one field
+   of all of them stays within a few cache lines; with open addressing indexes
+   from hwId and from GeofenceKey to the row.
+   Rows are kept dense, removing one moves the last row into its place, so a
+   row number is only good until the next save() or remove(). */
+class GeofenceTable {
+public:
+    GeofenceTable();
+    inline size_t size() const { return mHwIds.size(); }
+    inline bool empty() const { return mHwIds.empty(); }
+    void reserve(size_t count);
+    void clear();
+
+    /* adds a row, or updates the one of hwId; any other row with key is
+       removed, a key belongs to one geofence only. Returns the row */
+    size_t save(uint32_t hwId, const GeofenceKey& key,
+                const GeofenceOption& options, const GeofenceInfo& info);
+    void remove(size_t row);
+    /* row stays until remove(), but no longer has a client to be found by */
+    void detach(size_t row);
+    /* row of hwId / key, -1 if none */
+    int32_t findByHwId(uint32_t hwId) const;
+    int32_t findByKey(const GeofenceKey& key) const;
+
+    GeofenceObject get(size_t row) const;
+    inline uint32_t getHwId(size_t row) const { return mHwIds[row]; }
+    inline const GeofenceKey& getKey(size_t row) const { return mKeys[row]; }
+    inline bool isPaused(size_t row) const { return 0 != mPaused[row]; }
+    inline void setPaused(size_t row, bool paused) { mPaused[row] = paused ? 1 : 0; }
+    void setOptions(size_t row, const GeofenceOption& options);
+
+private:
+    std::vector<uint32_t> mHwIds;
+    std::vector<GeofenceKey> mKeys;
+    std::vector<GeofenceBreachTypeMask> mBreachMasks;
+    std::vector<uint32_t> mResponsiveness;
+    std::vector<uint32_t> mDwellTimes;
+    std::vector<double> mLatitudes;
+    std::vector<double> mLongitudes;
+    std::vector<double> mRadii;
+    std::vector<uint8_t> mPaused;
+    /* slots hold row numbers, or -1; linear probing, at most half full */
+    std::vector<int32_t> mHwIdSlots;
+    std::vector<int32_t> mKeySlots;
+    uint32_t mMask;
+
+    size_t hwIdSlot(uint32_t hwId) const;
+    size_t keySlot(const GeofenceKey& key) const;
+    uint32_t homeOf(bool byKey, int32_t row) const;
+    void unindex(bool byKey, size_t slot);
+    void reindex(size_t capacity);
+};
+
+#endif /* GEOFENCE_TABLE_H */
@@ -40,19 +40,25 @@
 #include <netdb.h>
 #include <GnssAdapter.h>
 #include <string>
-#include <sstream>
 #include <loc_log.h>
 #include <loc_nmea.h>
 #include <Agps.h>
 #include <SystemStatus.h>
+#include <LocMsgPool.h>
+#include <LocSvUsedMask.h>
+#include <LocStartupTrace.h>
 
 #include <vector>
+#include <atomic>
+#include <algorithm>
+#include <memory>
 
 #define RAD2DEG    (180.0 / M_PI)
 #define PROCESS_NAME_ENGINE_SERVICE "engine-service"
 #define MIN_TRACKING_INTERVAL (100) // 100 msec
 
 using namespace loc_core;
+using namespace loc_util;
 
 /* Method to fetch status cb from loc_net_iface library */
 typedef AgpsCbInfo& (*LocAgpsGetAgpsCbInfo)(LocAgpsOpenResultCb openResultCb,
@@ -62,6 +68,78 @@ static void agpsOpenResultCb (bool isSuccess, AGpsExtType agpsType, const char*
         AGpsBearerType bearerType, void* userDataPtr);
 static void agpsCloseResultCb (bool isSuccess, AGpsExtType agpsType, void* userDataPtr);
 
+/* SV and measurement reports are copied into their message only up to count;
+   clients get the whole struct by value, so what is past count is zeroed
+   rather than left as the last message in the pooled block had it */
+static void copySvNotification(GnssSvNotification& out, const GnssSvNotification& in)
+{
+    uint32_t count = std::min(in.count, (uint32_t)GNSS_SV_MAX);
+    out.size = in.size;
+    out.count = count;
+    out.gnssSignalTypeMaskValid = in.gnssSignalTypeMaskValid;
+    memcpy(out.gnssSvs, in.gnssSvs, count * sizeof(GnssSv));
+    memset(out.gnssSvs + count, 0, (GNSS_SV_MAX - count) * sizeof(GnssSv));
+}
+
+static void copyMeasurementsNotification(GnssMeasurementsNotification& out,
+                                         const GnssMeasurementsNotification& in)
+{
+    uint32_t count = std::min(in.count, (uint32_t)GNSS_MEASUREMENTS_MAX);
+    out.size = in.size;
+    out.count = count;
+    memcpy(out.measurements, in.measurements, count * sizeof(GnssMeasurementsData));
+    memset(out.measurements + count, 0,
+           (GNSS_MEASUREMENTS_MAX - count) * sizeof(GnssMeasurementsData));
+    out.clock = in.clock;
+}
+
+// runs on mEngHubLib's thread; NULL if no plugin daemon is enabled for this
+// platform, or if libloc_eng_hub.so is not present
+static void* loadEngHubLib() {
+    const char *error = nullptr;
+    unsigned int processListLength = 0;
+    loc_process_info_s_type* processInfoList = nullptr;
+    void *handle = nullptr;
+
+    do {
+        int rc = loc_read_process_conf(LOC_PATH_IZAT_CONF, &processListLength,
+                                       &processInfoList);
+        if (rc != 0) {
+            LOC_LOGE("%s]: failed to parse conf file", __func__);
+            break;
+        }
+
+        bool pluginDaemonEnabled = false;
+        // go over the conf table to see whether any plugin daemon is enabled
+        for (unsigned int i = 0; i < processListLength; i++) {
+            if ((strncmp(processInfoList[i].name[0], PROCESS_NAME_ENGINE_SERVICE,
+                         strlen(PROCESS_NAME_ENGINE_SERVICE)) == 0) &&
+                (processInfoList[i].proc_status == ENABLED)) {
+                pluginDaemonEnabled = true;
+                break;
+            }
+        }
+
+        // no plugin daemon is enabled for this platform, no need to load eng hub .so
+        if (pluginDaemonEnabled == false) {
+            break;
+        }
+
+        // load the engine hub .so
+        if ((handle = dlopen("libloc_eng_hub.so", RTLD_NOW)) == nullptr) {
+            if ((error = dlerror()) != nullptr) {
+                LOC_LOGE("%s]: libloc_eng_hub.so not found %s !", __func__, error);
+            }
+        }
+    } while (0);
+
+    if (processInfoList != nullptr) {
+        free (processInfoList);
+        processInfoList = nullptr;
+    }
+    return handle;
+}
+
 GnssAdapter::GnssAdapter() :
     LocAdapterBase(0,
                    LocContext::getLocContext(NULL,
@@ -69,6 +147,11 @@ GnssAdapter::GnssAdapter() :
                                                    LocContext::mLocationHalName,
                                                    false), true, nullptr),
     mEngHubProxy(new EngineHubProxyBase()),
+    mEngHubProxyLoaded(false),
+    mEngHubLib("dlopen libloc_eng_hub.so", loadEngHubLib),
+    mNetIfaceLib("dlopen libloc_net_iface.so", []() -> void* {
+        return dlopen("libloc_net_iface.so", RTLD_NOW);
+    }),
     mLocPositionMode(),
     mGnssSvIdUsedInPosition(),
     mGnssSvIdUsedInPosAvail(false),
@@ -125,8 +208,15 @@ GnssAdapter::GnssAdapter() :
     mAgpsManager.registerATLCallbacks(atlOpenStatusCb, atlCloseStatusCb);
 
     readConfigCommand();
-    initDefaultAgpsCommand();
-    initEngHubProxyCommand();
+    // each library gets initialized on the MsgTask once loaded; until then
+    // the MsgTask goes on with its requests
+    if (!mNetIfaceLib.start([this]() { initDefaultAgpsCommand(); })) {
+        initDefaultAgpsCommand();
+    }
+    if (!mEngHubLib.start([this]() { initEngHubProxyCommand(); })) {
+        initEngHubProxyCommand();
+    }
+    loc_util::LocStartupTrace::mark("GnssAdapter constructed");
 }
 
 void
@@ -1825,7 +1915,7 @@ GnssAdapter::gnssDeleteAidingDataCommand(GnssAidingData& data)
                 }
             }
 
-            mAdapter.mEngHubProxy->gnssDeleteAidingData(mData);
+            mAdapter.getEngHubProxy()->gnssDeleteAidingData(mData);
         }
     };
 
@@ -2051,9 +2141,63 @@ GnssAdapter::stopClientSessions(LocationAPI* client)
 
 }
 
+void
+GnssAdapter::updateClientDispatch()
+{
+    GnssClientDispatch& dispatch = mClientDispatch;
+    for (int i = 0; i < 2; i++) {
+        dispatch.locationInfoCbs[i].clear();
+        dispatch.engineLocationInfoCbs[i].clear();
+        dispatch.engineTrackingCbs[i].clear();
+        dispatch.trackingCbs[i].clear();
+    }
+    dispatch.engineLocationsCbs.clear();
+    dispatch.svCbs.clear();
+    dispatch.nmeaCbs.clear();
+    dispatch.dataCbs.clear();
+    dispatch.measurementsCbs.clear();
+    dispatch.systemInfoCbs.clear();
+
+    for (auto it=mClientData.begin(); it != mClientData.end(); ++it) {
+        const LocationCallbacks& callbacks = it->second;
+        int flp = isFlpClient(callbacks) ? 1 : 0;
+        if (nullptr != callbacks.gnssLocationInfoCb) {
+            dispatch.locationInfoCbs[flp].push_back(callbacks.gnssLocationInfoCb);
+        } else if (nullptr != callbacks.engineLocationsInfoCb) {
+            dispatch.engineLocationInfoCbs[flp].push_back(callbacks.engineLocationsInfoCb);
+            if (nullptr != callbacks.trackingCb) {
+                dispatch.engineTrackingCbs[flp].push_back(callbacks.trackingCb);
+            }
+        } else if (nullptr != callbacks.trackingCb) {
+            dispatch.trackingCbs[flp].push_back(callbacks.trackingCb);
+        }
+        if (nullptr != callbacks.engineLocationsInfoCb) {
+            dispatch.engineLocationsCbs.push_back(callbacks.engineLocationsInfoCb);
+        }
+        if (nullptr != callbacks.gnssSvCb) {
+            dispatch.svCbs.push_back(callbacks.gnssSvCb);
+        }
+        if (nullptr != callbacks.gnssNmeaCb) {
+            dispatch.nmeaCbs.push_back(callbacks.gnssNmeaCb);
+        }
+        if (nullptr != callbacks.gnssDataCb) {
+            dispatch.dataCbs.push_back(callbacks.gnssDataCb);
+        }
+        if (nullptr != callbacks.gnssMeasurementsCb) {
+            dispatch.measurementsCbs.push_back(callbacks.gnssMeasurementsCb);
+        }
+        if (nullptr != callbacks.locationSystemInfoCb) {
+            dispatch.systemInfoCbs.push_back(callbacks.locationSystemInfoCb);
+        }
+    }
+}
+
 void
 GnssAdapter::updateClientsEventMask()
 {
+    // called whenever a client is added or removed, or changes its callbacks
+    updateClientDispatch();
+
     LOC_API_ADAPTER_EVENT_MASK_T mask = 0;
     for (auto it=mClientData.begin(); it != mClientData.end(); ++it) {
         if (it->second.trackingCb != nullptr || it->second.gnssLocationInfoCb != nullptr) {
@@ -2082,7 +2226,7 @@ GnssAdapter::updateClientsEventMask()
     ** Note: this need to be called from msg queue thread.
     */
     if((1 == ContextBase::mGps_conf.EXTERNAL_DR_ENABLED) ||
-       (true == initEngHubProxy())) {
+       (true == isEngHubProxyLoaded())) {
         mask |= LOC_API_ADAPTER_BIT_GNSS_MEASUREMENT;
         mask |= LOC_API_ADAPTER_BIT_GNSS_NHZ_MEASUREMENT;
         mask |= LOC_API_ADAPTER_BIT_GNSS_SV_POLYNOMIAL_REPORT;
@@ -2135,6 +2279,8 @@ GnssAdapter::handleEngineUpEvent()
                 mAdapter.sendMsg(msg);
             }
             mAdapter.mPendingMsgs.clear();
+            loc_util::LocStartupTrace::mark("GnssAdapter engine up");
+            loc_util::LocStartupTrace::dump();
         }
     };
 
@@ -2516,8 +2662,8 @@ GnssAdapter::startTimeBasedTracking(LocationAPI* client, uint32_t sessionId,
     convertOptions(locPosMode, trackingOptions);
 
     // inform engine hub that GNSS session is about to start
-    mEngHubProxy->gnssSetFixMode(locPosMode);
-    mEngHubProxy->gnssStartFix();
+    getEngHubProxy()->gnssSetFixMode(locPosMode);
+    getEngHubProxy()->gnssStartFix();
 
     mLocApi->startTimeBasedTracking(trackingOptions, new LocApiResponse(*getContext(),
                       [this, client, sessionId] (LocationError err) {
@@ -2538,8 +2684,8 @@ GnssAdapter::updateTracking(LocationAPI* client, uint32_t sessionId,
     convertOptions(locPosMode, updatedOptions);
 
     // inform engine hub that GNSS session is about to start
-    mEngHubProxy->gnssSetFixMode(locPosMode);
-    mEngHubProxy->gnssStartFix();
+    getEngHubProxy()->gnssSetFixMode(locPosMode);
+    getEngHubProxy()->gnssStartFix();
 
     mLocApi->startTimeBasedTracking(updatedOptions, new LocApiResponse(*getContext(),
                       [this, client, sessionId, oldOptions] (LocationError err) {
@@ -2845,7 +2991,7 @@ void
 GnssAdapter::stopTracking(LocationAPI* client, uint32_t id)
 {
     // inform engine hub that GNSS session has stopped
-    mEngHubProxy->gnssStopFix();
+    getEngHubProxy()->gnssStopFix();
 
     mLocApi->stopFix(new LocApiResponse(*getContext(),
                      [this, client, id] (LocationError err) {
@@ -3074,8 +3220,8 @@ GnssAdapter::reportPositionEvent(const UlpLocation& ulpLocation,
     // if sending is successful, we return as we will wait for final report from engine hub
     // if the position is called from engine hub, then send it out directly
 
-    if (true == initEngHubProxy()){
-        mEngHubProxy->gnssReportPosition(ulpLocation, locationExtended, status);
+    if (true == isEngHubProxyLoaded()){
+        getEngHubProxy()->gnssReportPosition(ulpLocation, locationExtended, status);
         return;
     }
 
@@ -3086,7 +3232,7 @@ GnssAdapter::reportPositionEvent(const UlpLocation& ulpLocation,
     // Fix is from QMI, and it is not an
     // unpropagated position and engine hub is not loaded, queue the msg
     // when message is queued, the position can be dispatched to requesting client
-    struct MsgReportPosition : public LocMsg {
+    struct MsgReportPosition : public LocPooledMsg<MsgReportPosition> {
         GnssAdapter& mAdapter;
         const UlpLocation mUlpLocation;
         const GpsLocationExtended mLocationExtended;
@@ -3102,7 +3248,7 @@ GnssAdapter::reportPositionEvent(const UlpLocation& ulpLocation,
                                  LocPosTechMask techMask,
                                  GnssDataNotification* pDataNotify,
                                  int msInWeek) :
-            LocMsg(),
+            LocPooledMsg(),
             mAdapter(adapter),
             mUlpLocation(ulpLocation),
             mLocationExtended(locationExtended),
@@ -3144,14 +3290,14 @@ void
 GnssAdapter::reportEnginePositionsEvent(unsigned int count,
                                         EngineLocationInfo* locationArr)
 {
-    struct MsgReportEnginePositions : public LocMsg {
+    struct MsgReportEnginePositions : public LocPooledMsg<MsgReportEnginePositions> {
         GnssAdapter& mAdapter;
         unsigned int mCount;
         EngineLocationInfo mEngLocInfo[LOC_OUTPUT_ENGINE_COUNT];
         inline MsgReportEnginePositions(GnssAdapter& adapter,
                                         unsigned int count,
                                         EngineLocationInfo* locationArr) :
-            LocMsg(),
+            LocPooledMsg(),
             mAdapter(adapter),
             mCount(count) {
             if (mCount > LOC_OUTPUT_ENGINE_COUNT) {
@@ -3177,7 +3323,7 @@ GnssAdapter::needReportForGnssClient(const UlpLocation& ulpLocation,
 
     // if engine hub is enabled, aka, any of the engine services is enabled,
     // then always output position reported by engine hub to requesting client
-    if (true == initEngHubProxy()) {
+    if (true == isEngHubProxyLoaded()) {
         reported = true;
     } else {
         reported = LocApiBase::needReport(ulpLocation, status, techMask);
@@ -3198,7 +3344,7 @@ GnssAdapter::needReportForFlpClient(enum loc_sess_status status,
 }
 
 bool
-GnssAdapter::isFlpClient(LocationCallbacks& locationCallbacks)
+GnssAdapter::isFlpClient(const LocationCallbacks& locationCallbacks)
 {
     return (locationCallbacks.gnssLocationInfoCb == nullptr &&
             locationCallbacks.gnssSvCb == nullptr &&
@@ -3221,26 +3367,39 @@ GnssAdapter::reportPosition(const UlpLocation& ulpLocation,
         convertLocationInfo(locationInfo, locationExtended);
         convertLocation(locationInfo.location, ulpLocation, locationExtended, techMask);
 
-        for (auto it=mClientData.begin(); it != mClientData.end(); ++it) {
-            if ((reportToFlpClient && isFlpClient(it->second)) ||
-                    (reportToGnssClient && !isFlpClient(it->second))) {
-                if (nullptr != it->second.gnssLocationInfoCb) {
-                    it->second.gnssLocationInfoCb(locationInfo);
-                } else if ((nullptr != it->second.engineLocationsInfoCb) &&
-                        (false == initEngHubProxy())) {
-                    // if engine hub is disabled, this is SPE fix from modem
-                    // we need to mark one copy marked as fused and one copy marked as PPE
-                    // and dispatch it to the engineLocationsInfoCb
-                    GnssLocationInfoNotification engLocationsInfo[2];
+        const GnssClientDispatch& dispatch = mClientDispatch;
+        bool engHubLoaded = isEngHubProxyLoaded();
+        GnssLocationInfoNotification engLocationsInfo[2];
+        bool engLocationsInfoReady = false;
+        for (int flp = 0; flp < 2; flp++) {
+            if (!(flp ? reportToFlpClient : reportToGnssClient)) {
+                continue;
+            }
+            for (auto& cb : dispatch.locationInfoCbs[flp]) {
+                cb(locationInfo);
+            }
+            if (engHubLoaded) {
+                for (auto& cb : dispatch.engineTrackingCbs[flp]) {
+                    cb(locationInfo.location);
+                }
+            } else if (!dispatch.engineLocationInfoCbs[flp].empty()) {
+                // if engine hub is disabled, this is SPE fix from modem
+                // we need to mark one copy marked as fused and one copy marked as PPE
+                // and dispatch it to the engineLocationsInfoCb
+                if (!engLocationsInfoReady) {
                     engLocationsInfo[0] = locationInfo;
                     engLocationsInfo[0].locOutputEngType = LOC_OUTPUT_ENGINE_FUSED;
                     engLocationsInfo[0].flags |= GNSS_LOCATION_INFO_OUTPUT_ENG_TYPE_BIT;
                     engLocationsInfo[1] = locationInfo;
-                    it->second.engineLocationsInfoCb(2, engLocationsInfo);
-                } else if (nullptr != it->second.trackingCb) {
-                    it->second.trackingCb(locationInfo.location);
+                    engLocationsInfoReady = true;
+                }
+                for (auto& cb : dispatch.engineLocationInfoCbs[flp]) {
+                    cb(2, engLocationsInfo);
                 }
             }
+            for (auto& cb : dispatch.trackingCbs[flp]) {
+                cb(locationInfo.location);
+            }
         }
 
         mGnssSvIdUsedInPosAvail = false;
@@ -3258,7 +3417,7 @@ GnssAdapter::reportPosition(const UlpLocation& ulpLocation,
             // if engine hub is running and the fix is from sensor, e.g.: DRE,
             // inject DRE fix to modem
             if ((1 == ContextBase::mGps_conf.POSITION_ASSISTED_CLOCK_ESTIMATOR_ENABLED) &&
-                    (true == initEngHubProxy()) && (LOC_POS_TECH_MASK_SENSORS & techMask)) {
+                    (true == engHubLoaded) && (LOC_POS_TECH_MASK_SENSORS & techMask)) {
                 mLocApi->injectPosition(locationInfo, false);
             }
         }
@@ -3273,15 +3432,11 @@ GnssAdapter::reportPosition(const UlpLocation& ulpLocation,
                           (LOC_RELIABILITY_NOT_SET == locationExtended.horizontal_reliability));
         uint8_t generate_nmea = (reportToGnssClient && status != LOC_SESS_FAILURE && !blank_fix);
         bool custom_nmea_gga = (1 == ContextBase::mGps_conf.CUSTOM_NMEA_GGA_FIX_QUALITY_ENABLED);
-        std::vector<std::string> nmeaArraystr;
-        loc_nmea_generate_pos(ulpLocation, locationExtended, mLocSystemInfo,
-                              generate_nmea, custom_nmea_gga, nmeaArraystr);
-        stringstream ss;
-        for (auto itor = nmeaArraystr.begin(); itor != nmeaArraystr.end(); ++itor) {
-            ss << *itor;
-        }
-        string s = ss.str();
-        reportNmea(s.c_str(), s.length());
+        char nmea[NMEA_POS_MAX_LENGTH];
+        size_t length = loc_nmea_generate_pos(ulpLocation, locationExtended, mLocSystemInfo,
+                                              generate_nmea, custom_nmea_gga,
+                                              nmea, sizeof(nmea));
+        reportNmea(nmea, length);
     }
 }
 
@@ -3289,13 +3444,7 @@ void
 GnssAdapter::reportEnginePositions(unsigned int count,
                                    const EngineLocationInfo* locationArr)
 {
-    bool needReportEnginePositions = false;
-    for (auto it=mClientData.begin(); it != mClientData.end(); ++it) {
-        if (nullptr != it->second.engineLocationsInfoCb) {
-            needReportEnginePositions = true;
-            break;
-        }
-    }
+    bool needReportEnginePositions = !mClientDispatch.engineLocationsCbs.empty();
 
     GnssLocationInfoNotification locationInfo[LOC_OUTPUT_ENGINE_COUNT] = {};
     for (unsigned int i = 0; i < count; i++) {
@@ -3319,10 +3468,8 @@ GnssAdapter::reportEnginePositions(unsigned int count,
     }
 
     if (needReportEnginePositions) {
-        for (auto it=mClientData.begin(); it != mClientData.end(); ++it) {
-            if (nullptr != it->second.engineLocationsInfoCb) {
-                it->second.engineLocationsInfoCb(count, locationInfo);
-            }
+        for (auto& cb : mClientDispatch.engineLocationsCbs) {
+            cb(count, locationInfo);
         }
     }
 }
@@ -3332,23 +3479,29 @@ GnssAdapter::reportSvEvent(const GnssSvNotification& svNotify,
                            bool fromEngineHub)
 {
     if (!fromEngineHub) {
-        mEngHubProxy->gnssReportSv(svNotify);
-        if (true == initEngHubProxy()){
+        getEngHubProxy()->gnssReportSv(svNotify);
+        if (true == isEngHubProxyLoaded()){
             return;
         }
     }
 
-    struct MsgReportSv : public LocMsg {
+    struct MsgReportSv : public LocPooledMsg<MsgReportSv, 8, LocCoalescableMsg> {
         GnssAdapter& mAdapter;
-        const GnssSvNotification mSvNotify;
+        GnssSvNotification mSvNotify;
         inline MsgReportSv(GnssAdapter& adapter,
                            const GnssSvNotification& svNotify) :
-            LocMsg(),
-            mAdapter(adapter),
-            mSvNotify(svNotify) {}
+            LocPooledMsg(),
+            mAdapter(adapter) {
+            copySvNotification(mSvNotify, svNotify);
+        }
         inline virtual void proc() const {
             mAdapter.reportSv((GnssSvNotification&)mSvNotify);
         }
+        // SV status is a snapshot; if several are queued, only the newest matters
+        inline virtual const void* coalesceKey() const {
+            static const char sKey = 0;
+            return &sKey;
+        }
     };
 
     sendMsg(new MsgReportSv(*this, svNotify));
@@ -3360,127 +3513,23 @@ GnssAdapter::reportSv(GnssSvNotification& svNotify)
     int numSv = svNotify.count;
     int16_t gnssSvId = 0;
     uint64_t svUsedIdMask = 0;
+    LocSvUsedMasks svUsedMasks;
+    if (mGnssSvIdUsedInPosAvail) {
+        svUsedMasks.load(mGnssSvIdUsedInPosition,
+                         mGnssMbSvIdUsedInPosAvail ? &mGnssMbSvIdUsedInPosition : nullptr);
+    }
     for (int i=0; i < numSv; i++) {
-        svUsedIdMask = 0;
         gnssSvId = svNotify.gnssSvs[i].svId;
-        GnssSignalTypeMask signalTypeMask = svNotify.gnssSvs[i].gnssSignalTypeMask;
-        switch (svNotify.gnssSvs[i].type) {
-            case GNSS_SV_TYPE_GPS:
-                if (mGnssSvIdUsedInPosAvail) {
-                    if (mGnssMbSvIdUsedInPosAvail) {
-                        switch (signalTypeMask) {
-                        case GNSS_SIGNAL_GPS_L1CA:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.gps_l1ca_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_GPS_L1C:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.gps_l1c_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_GPS_L2:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.gps_l2_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_GPS_L5:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.gps_l5_sv_used_ids_mask;
-                            break;
-                        }
-                    } else {
-                        svUsedIdMask = mGnssSvIdUsedInPosition.gps_sv_used_ids_mask;
-                    }
-                }
-                break;
-            case GNSS_SV_TYPE_GLONASS:
-                if (mGnssSvIdUsedInPosAvail) {
-                    if (mGnssMbSvIdUsedInPosAvail) {
-                        switch (signalTypeMask) {
-                        case GNSS_SIGNAL_GLONASS_G1:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.glo_g1_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_GLONASS_G2:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.glo_g2_sv_used_ids_mask;
-                            break;
-                        }
-                    } else {
-                        svUsedIdMask = mGnssSvIdUsedInPosition.glo_sv_used_ids_mask;
-                    }
-                }
-                break;
-            case GNSS_SV_TYPE_BEIDOU:
-                if (mGnssSvIdUsedInPosAvail) {
-                    if (mGnssMbSvIdUsedInPosAvail) {
-                        switch (signalTypeMask) {
-                        case GNSS_SIGNAL_BEIDOU_B1I:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.bds_b1i_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_BEIDOU_B1C:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.bds_b1c_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_BEIDOU_B2I:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.bds_b2i_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_BEIDOU_B2AI:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.bds_b2ai_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_BEIDOU_B2AQ:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.bds_b2aq_sv_used_ids_mask;
-                            break;
-                        }
-                    } else {
-                        svUsedIdMask = mGnssSvIdUsedInPosition.bds_sv_used_ids_mask;
-                    }
-                }
-                break;
-            case GNSS_SV_TYPE_GALILEO:
-                if (mGnssSvIdUsedInPosAvail) {
-                    if (mGnssMbSvIdUsedInPosAvail) {
-                        switch (signalTypeMask) {
-                        case GNSS_SIGNAL_GALILEO_E1:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.gal_e1_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_GALILEO_E5A:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.gal_e5a_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_GALILEO_E5B:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.gal_e5b_sv_used_ids_mask;
-                            break;
-                        }
-                    } else {
-                        svUsedIdMask = mGnssSvIdUsedInPosition.gal_sv_used_ids_mask;
-                    }
-                }
-                break;
-            case GNSS_SV_TYPE_QZSS:
-                if (mGnssSvIdUsedInPosAvail) {
-                    if (mGnssMbSvIdUsedInPosAvail) {
-                        switch (signalTypeMask) {
-                        case GNSS_SIGNAL_QZSS_L1CA:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.qzss_l1ca_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_QZSS_L1S:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.qzss_l1s_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_QZSS_L2:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.qzss_l2_sv_used_ids_mask;
-                            break;
-                        case GNSS_SIGNAL_QZSS_L5:
-                            svUsedIdMask = mGnssMbSvIdUsedInPosition.qzss_l5_sv_used_ids_mask;
-                            break;
-                        }
-                    } else {
-                        svUsedIdMask = mGnssSvIdUsedInPosition.qzss_sv_used_ids_mask;
-                    }
-                }
-                // QZSS SV id's need to reported as it is to framework, since
-                // framework expects it as it is. See GnssStatus.java.
-                // SV id passed to here by LocApi is 1-based.
-                svNotify.gnssSvs[i].svId += (QZSS_SV_PRN_MIN - 1);
-                break;
-            case GNSS_SV_TYPE_NAVIC:
-                if (mGnssSvIdUsedInPosAvail) {
-                    svUsedIdMask = mGnssSvIdUsedInPosition.navic_sv_used_ids_mask;
-                }
-                break;
-            default:
-                svUsedIdMask = 0;
-                break;
+        // mask of the constellation, or of the signal when the fix has one per signal
+        uint32_t slot = LocSvUsedMasks::slotOf(svNotify.gnssSvs[i].type,
+                                               svNotify.gnssSvs[i].gnssSignalTypeMask,
+                                               mGnssMbSvIdUsedInPosAvail);
+        svUsedIdMask = svUsedMasks.get(slot);
+        if (GNSS_SV_TYPE_QZSS == svNotify.gnssSvs[i].type) {
+            // QZSS SV id's need to reported as it is to framework, since
+            // framework expects it as it is. See GnssStatus.java.
+            // SV id passed to here by LocApi is 1-based.
+            svNotify.gnssSvs[i].svId += (QZSS_SV_PRN_MIN - 1);
         }
 
         // If SV ID was used in previous position fix, then set USED_IN_FIX
@@ -3490,22 +3539,17 @@ GnssAdapter::reportSv(GnssSvNotification& svNotify)
         }
     }
 
-    for (auto it=mClientData.begin(); it != mClientData.end(); ++it) {
-        if (nullptr != it->second.gnssSvCb) {
-            it->second.gnssSvCb(svNotify);
-        }
+    // svNotify is the one in the message; the only copy from here on is the
+    // one each client takes by value
+    for (auto& cb : mClientDispatch.svCbs) {
+        cb(svNotify);
     }
 
     if (NMEA_PROVIDER_AP == ContextBase::mGps_conf.NMEA_PROVIDER &&
         !mTimeBasedTrackingSessions.empty()) {
-        std::vector<std::string> nmeaArraystr;
-        loc_nmea_generate_sv(svNotify, nmeaArraystr);
-        stringstream ss;
-        for (auto itor = nmeaArraystr.begin(); itor != nmeaArraystr.end(); ++itor) {
-            ss << *itor;
-        }
-        string s = ss.str();
-        reportNmea(s.c_str(), s.length());
+        char nmea[NMEA_SV_MAX_LENGTH];
+        size_t length = loc_nmea_generate_sv(svNotify, nmea, sizeof(nmea));
+        reportNmea(nmea, length);
     }
 
     mGnssSvIdUsedInPosAvail = false;
@@ -3519,14 +3563,14 @@ GnssAdapter::reportNmeaEvent(const char* nmea, size_t length)
         return;
     }
 
-    struct MsgReportNmea : public LocMsg {
+    struct MsgReportNmea : public LocPooledMsg<MsgReportNmea> {
         GnssAdapter& mAdapter;
         const char* mNmea;
         size_t mLength;
         inline MsgReportNmea(GnssAdapter& adapter,
                              const char* nmea,
                              size_t length) :
-            LocMsg(),
+            LocPooledMsg(),
             mAdapter(adapter),
             mNmea(new char[length+1]),
             mLength(length) {
@@ -3570,10 +3614,8 @@ GnssAdapter::reportNmea(const char* nmea, size_t length)
     nmeaNotification.nmea = nmea;
     nmeaNotification.length = length;
 
-    for (auto it=mClientData.begin(); it != mClientData.end(); ++it) {
-        if (nullptr != it->second.gnssNmeaCb) {
-            it->second.gnssNmeaCb(nmeaNotification);
-        }
+    for (auto& cb : mClientDispatch.nmeaCbs) {
+        cb(nmeaNotification);
     }
 }
 
@@ -3581,14 +3623,14 @@ void
 GnssAdapter::reportDataEvent(const GnssDataNotification& dataNotify,
                              int msInWeek)
 {
-    struct MsgReportData : public LocMsg {
+    struct MsgReportData : public LocPooledMsg<MsgReportData> {
         GnssAdapter& mAdapter;
         GnssDataNotification mDataNotify;
         int mMsInWeek;
         inline MsgReportData(GnssAdapter& adapter,
             const GnssDataNotification& dataNotify,
             int msInWeek) :
-            LocMsg(),
+            LocPooledMsg(),
             mAdapter(adapter),
             mDataNotify(dataNotify),
             mMsInWeek(msInWeek) {
@@ -3618,10 +3660,8 @@ GnssAdapter::reportData(GnssDataNotification& dataNotify)
             LOC_LOGv("agc[%d]=%f", sig, dataNotify.agc[sig]);
         }
     }
-    for (auto it = mClientData.begin(); it != mClientData.end(); ++it) {
-        if (nullptr != it->second.gnssDataCb) {
-            it->second.gnssDataCb(dataNotify);
-        }
+    for (auto& cb : mClientDispatch.dataCbs) {
+        cb(dataNotify);
     }
 }
 
@@ -3691,7 +3731,7 @@ void
 GnssAdapter::reportLocationSystemInfoEvent(const LocationSystemInfo & locationSystemInfo) {
 
     // send system info to engine hub
-    mEngHubProxy->gnssReportSystemInfo(locationSystemInfo);
+    getEngHubProxy()->gnssReportSystemInfo(locationSystemInfo);
 
     struct MsgLocationSystemInfo : public LocMsg {
         GnssAdapter& mAdapter;
@@ -3735,10 +3775,8 @@ GnssAdapter::reportLocationSystemInfo(const LocationSystemInfo & locationSystemI
 
     // we received new info, inform client of the newly received info
     if (locationSystemInfo.systemInfoMask) {
-        for (auto it=mClientData.begin(); it != mClientData.end(); ++it) {
-            if (it->second.locationSystemInfoCb != nullptr) {
-                it->second.locationSystemInfoCb(locationSystemInfo);
-            }
+        for (auto& cb : mClientDispatch.systemInfoCbs) {
+            cb(locationSystemInfo);
         }
     }
 }
@@ -3898,16 +3936,16 @@ GnssAdapter::reportGnssMeasurementsEvent(const GnssMeasurements& gnssMeasurement
     LOC_LOGD("%s]: msInWeek=%d", __func__, msInWeek);
 
     if (0 != gnssMeasurements.gnssMeasNotification.count) {
-        struct MsgReportGnssMeasurementData : public LocMsg {
+        struct MsgReportGnssMeasurementData : public LocPooledMsg<MsgReportGnssMeasurementData> {
             GnssAdapter& mAdapter;
-            GnssMeasurements mGnssMeasurements;
             GnssMeasurementsNotification mMeasurementsNotify;
             inline MsgReportGnssMeasurementData(GnssAdapter& adapter,
                                                 const GnssMeasurements& gnssMeasurements,
                                                 int msInWeek) :
-                    LocMsg(),
-                    mAdapter(adapter),
-                    mMeasurementsNotify(gnssMeasurements.gnssMeasNotification) {
+                    LocPooledMsg(),
+                    mAdapter(adapter) {
+                copyMeasurementsNotification(mMeasurementsNotify,
+                                             gnssMeasurements.gnssMeasNotification);
                 if (-1 != msInWeek) {
                     mAdapter.getAgcInformation(mMeasurementsNotify, msInWeek);
                 }
@@ -3919,16 +3957,14 @@ GnssAdapter::reportGnssMeasurementsEvent(const GnssMeasurements& gnssMeasurement
 
         sendMsg(new MsgReportGnssMeasurementData(*this, gnssMeasurements, msInWeek));
     }
-    mEngHubProxy->gnssReportSvMeasurement(gnssMeasurements.gnssSvMeasurementSet);
+    getEngHubProxy()->gnssReportSvMeasurement(gnssMeasurements.gnssSvMeasurementSet);
 }
 
 void
 GnssAdapter::reportGnssMeasurementData(const GnssMeasurementsNotification& measurements)
 {
-    for (auto it=mClientData.begin(); it != mClientData.end(); ++it) {
-        if (nullptr != it->second.gnssMeasurementsCb) {
-            it->second.gnssMeasurementsCb(measurements);
-        }
+    for (auto& cb : mClientDispatch.measurementsCbs) {
+        cb(measurements);
     }
 }
 
@@ -3936,14 +3972,14 @@ void
 GnssAdapter::reportSvPolynomialEvent(GnssSvPolynomial &svPolynomial)
 {
     LOC_LOGD("%s]: ", __func__);
-    mEngHubProxy->gnssReportSvPolynomial(svPolynomial);
+    getEngHubProxy()->gnssReportSvPolynomial(svPolynomial);
 }
 
 void
 GnssAdapter::reportSvEphemerisEvent(GnssSvEphemerisReport & svEphemeris)
 {
     LOC_LOGD("%s]:", __func__);
-    mEngHubProxy->gnssReportSvEphemeris(svEphemeris);
+    getEngHubProxy()->gnssReportSvEphemeris(svEphemeris);
 }
 
 
@@ -4014,14 +4050,14 @@ void GnssAdapter::requestOdcpi(const OdcpiRequestInfo& request)
 bool GnssAdapter::reportDeleteAidingDataEvent(GnssAidingData& aidingData)
 {
     LOC_LOGD("%s]:", __func__);
-    mEngHubProxy->gnssDeleteAidingData(aidingData);
+    getEngHubProxy()->gnssDeleteAidingData(aidingData);
     return true;
 }
 
 bool GnssAdapter::reportKlobucharIonoModelEvent(GnssKlobucharIonoModel & ionoModel)
 {
     LOC_LOGD("%s]:", __func__);
-    mEngHubProxy->gnssReportKlobucharIonoModel(ionoModel);
+    getEngHubProxy()->gnssReportKlobucharIonoModel(ionoModel);
     return true;
 }
 
@@ -4029,7 +4065,7 @@ bool GnssAdapter::reportGnssAdditionalSystemInfoEvent(
         GnssAdditionalSystemInfo & additionalSystemInfo)
 {
     LOC_LOGD("%s]:", __func__);
-    mEngHubProxy->gnssReportAdditionalSystemInfo(additionalSystemInfo);
+    getEngHubProxy()->gnssReportAdditionalSystemInfo(additionalSystemInfo);
     return true;
 }
 
@@ -4155,9 +4191,11 @@ GnssAdapter::reportGnssEngEnergyConsumedEvent(uint64_t energyConsumedSinceFirstB
 
 void GnssAdapter::initDefaultAgps() {
     LOC_LOGD("%s]: ", __func__);
+    loc_util::LocStartupPhase phase("GnssAdapter::initDefaultAgps");
 
+    // loaded by mNetIfaceLib, on a thread of its own unless that could not start
     void *handle = nullptr;
-    if ((handle = dlopen("libloc_net_iface.so", RTLD_NOW)) == nullptr) {
+    if ((handle = mNetIfaceLib.get()) == nullptr) {
         LOC_LOGD("%s]: libloc_net_iface.so not found !", __func__);
         return;
     }
@@ -4594,49 +4632,55 @@ bool GnssAdapter::getDebugReport(GnssDebugReport& r)
         return false;
     }
 
-    SystemStatusReports reports = {};
-    systemstatus->getReport(reports, true);
+    // about 54 KB, too much for the stack of a binder thread
+    std::unique_ptr<SystemStatusReports> reports(new SystemStatusReports());
+    systemstatus->getReport(*reports, true);
+
+    LocMsgPool::logAllStats();
+    if (nullptr != mMsgTask) {
+        mMsgTask->logStats();
+    }
 
     r.size = sizeof(r);
 
     // location block
     r.mLocation.size = sizeof(r.mLocation);
-    if(!reports.mLocation.empty() && reports.mLocation.back().mValid) {
+    if(!reports->mLocation.empty() && reports->mLocation.back().mValid) {
         r.mLocation.mValid = true;
         r.mLocation.mLocation.latitude =
-            reports.mLocation.back().mLocation.gpsLocation.latitude;
+            reports->mLocation.back().mLocation.gpsLocation.latitude;
         r.mLocation.mLocation.longitude =
-            reports.mLocation.back().mLocation.gpsLocation.longitude;
+            reports->mLocation.back().mLocation.gpsLocation.longitude;
         r.mLocation.mLocation.altitude =
-            reports.mLocation.back().mLocation.gpsLocation.altitude;
+            reports->mLocation.back().mLocation.gpsLocation.altitude;
         r.mLocation.mLocation.speed =
-            (double)(reports.mLocation.back().mLocation.gpsLocation.speed);
+            (double)(reports->mLocation.back().mLocation.gpsLocation.speed);
         r.mLocation.mLocation.bearing =
-            (double)(reports.mLocation.back().mLocation.gpsLocation.bearing);
+            (double)(reports->mLocation.back().mLocation.gpsLocation.bearing);
         r.mLocation.mLocation.accuracy =
-            (double)(reports.mLocation.back().mLocation.gpsLocation.accuracy);
+            (double)(reports->mLocation.back().mLocation.gpsLocation.accuracy);
 
         r.mLocation.verticalAccuracyMeters =
-            reports.mLocation.back().mLocationEx.vert_unc;
+            reports->mLocation.back().mLocationEx.vert_unc;
         r.mLocation.speedAccuracyMetersPerSecond =
-            reports.mLocation.back().mLocationEx.speed_unc;
+            reports->mLocation.back().mLocationEx.speed_unc;
         r.mLocation.bearingAccuracyDegrees =
-            reports.mLocation.back().mLocationEx.bearing_unc;
+            reports->mLocation.back().mLocationEx.bearing_unc;
 
         r.mLocation.mUtcReported =
-            reports.mLocation.back().mUtcReported;
+            reports->mLocation.back().mUtcReported;
     }
-    else if(!reports.mBestPosition.empty() && reports.mBestPosition.back().mValid) {
+    else if(!reports->mBestPosition.empty() && reports->mBestPosition.back().mValid) {
         r.mLocation.mValid = true;
         r.mLocation.mLocation.latitude =
-                (double)(reports.mBestPosition.back().mBestLat) * RAD2DEG;
+                (double)(reports->mBestPosition.back().mBestLat) * RAD2DEG;
         r.mLocation.mLocation.longitude =
-                (double)(reports.mBestPosition.back().mBestLon) * RAD2DEG;
-        r.mLocation.mLocation.altitude = reports.mBestPosition.back().mBestAlt;
+                (double)(reports->mBestPosition.back().mBestLon) * RAD2DEG;
+        r.mLocation.mLocation.altitude = reports->mBestPosition.back().mBestAlt;
         r.mLocation.mLocation.accuracy =
-                (double)(reports.mBestPosition.back().mBestHepe);
+                (double)(reports->mBestPosition.back().mBestHepe);
 
-        r.mLocation.mUtcReported = reports.mBestPosition.back().mUtcReported;
+        r.mLocation.mUtcReported = reports->mBestPosition.back().mUtcReported;
     }
     else {
         r.mLocation.mValid = false;
@@ -4652,28 +4696,28 @@ bool GnssAdapter::getDebugReport(GnssDebugReport& r)
 
     // time block
     r.mTime.size = sizeof(r.mTime);
-    if(!reports.mTimeAndClock.empty() && reports.mTimeAndClock.back().mTimeValid) {
+    if(!reports->mTimeAndClock.empty() && reports->mTimeAndClock.back().mTimeValid) {
         r.mTime.mValid = true;
         r.mTime.timeEstimate =
-            (((int64_t)(reports.mTimeAndClock.back().mGpsWeek)*7 +
+            (((int64_t)(reports->mTimeAndClock.back().mGpsWeek)*7 +
                         GNSS_UTC_TIME_OFFSET)*24*60*60 -
-              (int64_t)(reports.mTimeAndClock.back().mLeapSeconds))*1000ULL +
-              (int64_t)(reports.mTimeAndClock.back().mGpsTowMs);
+              (int64_t)(reports->mTimeAndClock.back().mLeapSeconds))*1000ULL +
+              (int64_t)(reports->mTimeAndClock.back().mGpsTowMs);
 
-        if (reports.mTimeAndClock.back().mTimeUncNs > 0) {
+        if (reports->mTimeAndClock.back().mTimeUncNs > 0) {
             // TimeUncNs value is available
             r.mTime.timeUncertaintyNs =
-                    (float)(reports.mTimeAndClock.back().mLeapSecUnc)*1000.0f +
-                    (float)(reports.mTimeAndClock.back().mTimeUncNs);
+                    (float)(reports->mTimeAndClock.back().mLeapSecUnc)*1000.0f +
+                    (float)(reports->mTimeAndClock.back().mTimeUncNs);
         } else {
             // fall back to legacy TimeUnc
             r.mTime.timeUncertaintyNs =
-                    ((float)(reports.mTimeAndClock.back().mTimeUnc) +
-                     (float)(reports.mTimeAndClock.back().mLeapSecUnc))*1000.0f;
+                    ((float)(reports->mTimeAndClock.back().mTimeUnc) +
+                     (float)(reports->mTimeAndClock.back().mLeapSecUnc))*1000.0f;
         }
 
         r.mTime.frequencyUncertaintyNsPerSec =
-            (float)(reports.mTimeAndClock.back().mClockFreqBiasUnc);
+            (float)(reports->mTimeAndClock.back().mClockFreqBiasUnc);
         LOC_LOGV("getDebugReport - timeestimate=%" PRIu64 " unc=%f frequnc=%f",
                 r.mTime.timeEstimate,
                 r.mTime.timeUncertaintyNs, r.mTime.frequencyUncertaintyNsPerSec);
@@ -4683,12 +4727,12 @@ bool GnssAdapter::getDebugReport(GnssDebugReport& r)
     }
 
     // satellite info block
-    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_GPS, reports);
-    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_GLONASS, reports);
-    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_QZSS, reports);
-    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_BEIDOU, reports);
-    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_GALILEO, reports);
-    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_NAVIC, reports);
+    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_GPS, *reports);
+    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_GLONASS, *reports);
+    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_QZSS, *reports);
+    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_BEIDOU, *reports);
+    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_GALILEO, *reports);
+    convertSatelliteInfo(r.mSatelliteInfo, GNSS_SV_TYPE_NAVIC, *reports);
     LOC_LOGV("getDebugReport - satellite=%zu", r.mSatelliteInfo.size());
 
     return true;
@@ -4701,39 +4745,43 @@ GnssAdapter::getAgcInformation(GnssMeasurementsNotification& measurements, int m
     SystemStatus* systemstatus = getSystemStatus();
 
     if (nullptr != systemstatus) {
-        SystemStatusReports reports = {};
-        systemstatus->getReport(reports, true);
+        // runs on the LocApi thread, so it can not share mRfSnapshot
+        RfSnapshot snapshot;
+        systemstatus->getSnapshot(snapshot);
 
-        if ((!reports.mRfAndParams.empty()) && (!reports.mTimeAndClock.empty()) &&
-            (abs(msInWeek - (int)reports.mTimeAndClock.back().mGpsTowMs) < 2000)) {
+        if (snapshot.has<SystemStatusRfAndParams>() &&
+            snapshot.has<SystemStatusTimeAndClock>() &&
+            (abs(msInWeek - (int)snapshot.get<SystemStatusTimeAndClock>().mGpsTowMs)
+                    < 2000)) {
+            const SystemStatusRfAndParams& rf = snapshot.get<SystemStatusRfAndParams>();
 
             for (size_t i = 0; i < measurements.count; i++) {
                 switch (measurements.measurements[i].svType) {
                 case GNSS_SV_TYPE_GPS:
                 case GNSS_SV_TYPE_QZSS:
                     measurements.measurements[i].agcLevelDb =
-                            reports.mRfAndParams.back().mAgcGps;
+                            rf.mAgcGps;
                     measurements.measurements[i].flags |=
                             GNSS_MEASUREMENTS_DATA_AUTOMATIC_GAIN_CONTROL_BIT;
                     break;
 
                 case GNSS_SV_TYPE_GALILEO:
                     measurements.measurements[i].agcLevelDb =
-                            reports.mRfAndParams.back().mAgcGal;
+                            rf.mAgcGal;
                     measurements.measurements[i].flags |=
                             GNSS_MEASUREMENTS_DATA_AUTOMATIC_GAIN_CONTROL_BIT;
                     break;
 
                 case GNSS_SV_TYPE_GLONASS:
                     measurements.measurements[i].agcLevelDb =
-                            reports.mRfAndParams.back().mAgcGlo;
+                            rf.mAgcGlo;
                     measurements.measurements[i].flags |=
                             GNSS_MEASUREMENTS_DATA_AUTOMATIC_GAIN_CONTROL_BIT;
                     break;
 
                 case GNSS_SV_TYPE_BEIDOU:
                     measurements.measurements[i].agcLevelDb =
-                            reports.mRfAndParams.back().mAgcBds;
+                            rf.mAgcBds;
                     measurements.measurements[i].flags |=
                             GNSS_MEASUREMENTS_DATA_AUTOMATIC_GAIN_CONTROL_BIT;
                     break;
@@ -4756,11 +4804,14 @@ GnssAdapter::getDataInformation(GnssDataNotification& data, int msInWeek)
 
     LOC_LOGV("%s]: msInWeek=%d", __func__, msInWeek);
     if (nullptr != systemstatus) {
-        SystemStatusReports reports = {};
-        systemstatus->getReport(reports, true);
+        // copies the items only when they changed since the last fix
+        systemstatus->getSnapshot(mRfSnapshot);
 
-        if ((!reports.mRfAndParams.empty()) && (!reports.mTimeAndClock.empty()) &&
-            (abs(msInWeek - (int)reports.mTimeAndClock.back().mGpsTowMs) < 2000)) {
+        if (mRfSnapshot.has<SystemStatusRfAndParams>() &&
+            mRfSnapshot.has<SystemStatusTimeAndClock>() &&
+            (abs(msInWeek - (int)mRfSnapshot.get<SystemStatusTimeAndClock>().mGpsTowMs)
+                    < 2000)) {
+            const SystemStatusRfAndParams& rf = mRfSnapshot.get<SystemStatusRfAndParams>();
 
             for (int sig = GNSS_LOC_SIGNAL_TYPE_GPS_L1CA;
                  sig < GNSS_LOC_MAX_NUMBER_OF_SIGNAL_TYPES; sig++) {
@@ -4768,69 +4819,69 @@ GnssAdapter::getDataInformation(GnssDataNotification& data, int msInWeek)
                 data.jammerInd[sig] = 0.0;
                 data.agc[sig] = 0.0;
             }
-            if (GNSS_INVALID_JAMMER_IND != reports.mRfAndParams.back().mAgcGps) {
+            if (GNSS_INVALID_JAMMER_IND != rf.mAgcGps) {
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_GPS_L1CA] |=
                         GNSS_LOC_DATA_AGC_BIT;
                 data.agc[GNSS_LOC_SIGNAL_TYPE_GPS_L1CA] =
-                        reports.mRfAndParams.back().mAgcGps;
+                        rf.mAgcGps;
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_QZSS_L1CA] |=
                         GNSS_LOC_DATA_AGC_BIT;
                 data.agc[GNSS_LOC_SIGNAL_TYPE_QZSS_L1CA] =
-                        reports.mRfAndParams.back().mAgcGps;
+                        rf.mAgcGps;
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_SBAS_L1_CA] |=
                         GNSS_LOC_DATA_AGC_BIT;
                 data.agc[GNSS_LOC_SIGNAL_TYPE_SBAS_L1_CA] =
-                    reports.mRfAndParams.back().mAgcGps;
+                    rf.mAgcGps;
             }
-            if (GNSS_INVALID_JAMMER_IND != reports.mRfAndParams.back().mJammerGps) {
+            if (GNSS_INVALID_JAMMER_IND != rf.mJammerGps) {
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_GPS_L1CA] |=
                         GNSS_LOC_DATA_JAMMER_IND_BIT;
                 data.jammerInd[GNSS_LOC_SIGNAL_TYPE_GPS_L1CA] =
-                        (double)reports.mRfAndParams.back().mJammerGps;
+                        (double)rf.mJammerGps;
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_QZSS_L1CA] |=
                         GNSS_LOC_DATA_JAMMER_IND_BIT;
                 data.jammerInd[GNSS_LOC_SIGNAL_TYPE_QZSS_L1CA] =
-                        (double)reports.mRfAndParams.back().mJammerGps;
+                        (double)rf.mJammerGps;
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_SBAS_L1_CA] |=
                         GNSS_LOC_DATA_JAMMER_IND_BIT;
                 data.jammerInd[GNSS_LOC_SIGNAL_TYPE_SBAS_L1_CA] =
-                    (double)reports.mRfAndParams.back().mJammerGps;
+                    (double)rf.mJammerGps;
             }
-            if (GNSS_INVALID_JAMMER_IND != reports.mRfAndParams.back().mAgcGlo) {
+            if (GNSS_INVALID_JAMMER_IND != rf.mAgcGlo) {
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_GLONASS_G1] |=
                         GNSS_LOC_DATA_AGC_BIT;
                 data.agc[GNSS_LOC_SIGNAL_TYPE_GLONASS_G1] =
-                        reports.mRfAndParams.back().mAgcGlo;
+                        rf.mAgcGlo;
             }
-            if (GNSS_INVALID_JAMMER_IND != reports.mRfAndParams.back().mJammerGlo) {
+            if (GNSS_INVALID_JAMMER_IND != rf.mJammerGlo) {
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_GLONASS_G1] |=
                         GNSS_LOC_DATA_JAMMER_IND_BIT;
                 data.jammerInd[GNSS_LOC_SIGNAL_TYPE_GLONASS_G1] =
-                        (double)reports.mRfAndParams.back().mJammerGlo;
+                        (double)rf.mJammerGlo;
             }
-            if (GNSS_INVALID_JAMMER_IND != reports.mRfAndParams.back().mAgcBds) {
+            if (GNSS_INVALID_JAMMER_IND != rf.mAgcBds) {
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_BEIDOU_B1_I] |=
                         GNSS_LOC_DATA_AGC_BIT;
                 data.agc[GNSS_LOC_SIGNAL_TYPE_BEIDOU_B1_I] =
-                        reports.mRfAndParams.back().mAgcBds;
+                        rf.mAgcBds;
             }
-            if (GNSS_INVALID_JAMMER_IND != reports.mRfAndParams.back().mJammerBds) {
+            if (GNSS_INVALID_JAMMER_IND != rf.mJammerBds) {
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_BEIDOU_B1_I] |=
                         GNSS_LOC_DATA_JAMMER_IND_BIT;
                 data.jammerInd[GNSS_LOC_SIGNAL_TYPE_BEIDOU_B1_I] =
-                        (double)reports.mRfAndParams.back().mJammerBds;
+                        (double)rf.mJammerBds;
             }
-            if (GNSS_INVALID_JAMMER_IND != reports.mRfAndParams.back().mAgcGal) {
+            if (GNSS_INVALID_JAMMER_IND != rf.mAgcGal) {
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_GALILEO_E1_C] |=
                         GNSS_LOC_DATA_AGC_BIT;
                 data.agc[GNSS_LOC_SIGNAL_TYPE_GALILEO_E1_C] =
-                        reports.mRfAndParams.back().mAgcGal;
+                        rf.mAgcGal;
             }
-            if (GNSS_INVALID_JAMMER_IND != reports.mRfAndParams.back().mJammerGal) {
+            if (GNSS_INVALID_JAMMER_IND != rf.mJammerGal) {
                 data.gnssDataMask[GNSS_LOC_SIGNAL_TYPE_GALILEO_E1_C] |=
                         GNSS_LOC_DATA_JAMMER_IND_BIT;
                 data.jammerInd[GNSS_LOC_SIGNAL_TYPE_GALILEO_E1_C] =
-                        (double)reports.mRfAndParams.back().mJammerGal;
+                        (double)rf.mJammerGal;
             }
         }
     }
@@ -4943,7 +4994,10 @@ GnssAdapter::initEngHubProxyCommand() {
             LocMsg(),
             mAdapter(adapter) {}
         inline virtual void proc() const {
-            mAdapter->initEngHubProxy();
+            // the event mask asks for more reports once the hub is there
+            if (mAdapter->initEngHubProxy()) {
+                mAdapter->updateClientsEventMask();
+            }
         }
     };
 
@@ -4952,49 +5006,29 @@ GnssAdapter::initEngHubProxyCommand() {
 
 bool
 GnssAdapter::initEngHubProxy() {
-    static bool firstTime = true;
+    // called on the MsgTask once mEngHubLib is done, see initEngHubProxyCommand();
+    // report paths only look at isEngHubProxyLoaded()
+    static std::atomic<bool> initDone(false);
+    static pthread_mutex_t initMutex = PTHREAD_MUTEX_INITIALIZER;
     static bool engHubLoadSuccessful = false;
 
-    const char *error = nullptr;
-    unsigned int processListLength = 0;
-    loc_process_info_s_type* processInfoList = nullptr;
+    if (initDone.load(std::memory_order_acquire)) {
+        return engHubLoadSuccessful;
+    }
 
+    pthread_mutex_lock(&initMutex);
     do {
         // load eng hub only once
-        if (firstTime == false) {
+        if (initDone.load(std::memory_order_relaxed)) {
             break;
         }
+        loc_util::LocStartupPhase phase("GnssAdapter::initEngHubProxy");
 
-        int rc = loc_read_process_conf(LOC_PATH_IZAT_CONF, &processListLength,
-                                       &processInfoList);
-        if (rc != 0) {
-            LOC_LOGE("%s]: failed to parse conf file", __func__);
-            break;
-        }
-
-        bool pluginDaemonEnabled = false;
-        // go over the conf table to see whether any plugin daemon is enabled
-        for (unsigned int i = 0; i < processListLength; i++) {
-            if ((strncmp(processInfoList[i].name[0], PROCESS_NAME_ENGINE_SERVICE,
-                         strlen(PROCESS_NAME_ENGINE_SERVICE)) == 0) &&
-                (processInfoList[i].proc_status == ENABLED)) {
-                pluginDaemonEnabled = true;
-                break;
-            }
-        }
-
-        // no plugin daemon is enabled for this platform, no need to load eng hub .so
-        if (pluginDaemonEnabled == false) {
-            break;
-        }
-
-        // load the engine hub .so, if the .so is not present
-        // all EngHubProxyBase calls will turn into no-op.
-        void *handle = nullptr;
-        if ((handle = dlopen("libloc_eng_hub.so", RTLD_NOW)) == nullptr) {
-            if ((error = dlerror()) != nullptr) {
-                LOC_LOGE("%s]: libloc_eng_hub.so not found %s !", __func__, error);
-            }
+        // loaded by mEngHubLib, on a thread of its own unless that is not
+        // done yet; if it is not loaded, all EngHubProxyBase calls turn into
+        // no-op.
+        void *handle = mEngHubLib.get();
+        if (handle == nullptr) {
             break;
         }
 
@@ -5024,7 +5058,9 @@ GnssAdapter::initEngHubProxy() {
                                                       reportPositionEventCb,
                                                       reportSvEventCb, reqAidingDataCb);
             if (hubProxy != nullptr) {
-                mEngHubProxy = hubProxy;
+                // the no-op proxy is kept, a report may be calling it right now
+                mEngHubProxy.store(hubProxy, std::memory_order_release);
+                mEngHubProxyLoaded.store(true, std::memory_order_release);
                 engHubLoadSuccessful = true;
             }
         }
@@ -5032,16 +5068,12 @@ GnssAdapter::initEngHubProxy() {
             LOC_LOGD("%s]: entered, did not find function", __func__);
         }
 
-        LOC_LOGD("%s]: first time initialization %d, returned %d",
-                 __func__, firstTime, engHubLoadSuccessful);
+        LOC_LOGD("%s]: first time initialization, returned %d",
+                 __func__, engHubLoadSuccessful);
 
     } while (0);
+    initDone.store(true, std::memory_order_release);
+    pthread_mutex_unlock(&initMutex);
 
-    if (processInfoList != nullptr) {
-        free (processInfoList);
-        processInfoList = nullptr;
-    }
-
-    firstTime = false;
     return engHubLoadSuccessful;
 }
@@ -37,7 +37,9 @@
 #include <Agps.h>
 #include <SystemStatus.h>
 #include <XtraSystemStatusObserver.h>
+#include <LocInitTask.h>
 #include <map>
+#include <atomic>
 
 #define MAX_URL_LEN 256
 #define NMEA_SENTENCE_MAX_LENGTH 200
@@ -134,10 +136,40 @@ typedef std::function<void(
 
 typedef void (*powerStateCallback)(bool on);
 
+/* the callbacks of all clients, by the report they take, so that a report goes
+   over a flat array rather than over every client. Position callbacks are kept
+   apart for gnss [0] and flp [1] clients, and a client only gets one of them:
+   gnssLocationInfoCb, else engineLocationsInfoCb, else trackingCb. */
+typedef struct {
+    std::vector<gnssLocationInfoCallback> locationInfoCbs[2];
+    std::vector<engineLocationsInfoCallback> engineLocationInfoCbs[2];
+    // trackingCb of the clients in engineLocationInfoCbs, for when engine hub is up
+    std::vector<trackingCallback> engineTrackingCbs[2];
+    std::vector<trackingCallback> trackingCbs[2];
+    std::vector<engineLocationsInfoCallback> engineLocationsCbs;
+    std::vector<gnssSvCallback> svCbs;
+    std::vector<gnssNmeaCallback> nmeaCbs;
+    std::vector<gnssDataCallback> dataCbs;
+    std::vector<gnssMeasurementsCallback> measurementsCbs;
+    std::vector<locationSystemInfoCallback> systemInfoCbs;
+} GnssClientDispatch;
+
 class GnssAdapter : public LocAdapterBase {
 
     /* ==== Engine Hub ===================================================================== */
-    EngineHubProxyBase* mEngHubProxy;
+    // a no-op EngineHubProxyBase until initEngHubProxy() swaps in the one from
+    // libloc_eng_hub.so; read on the LocApi thread too, so never waited for
+    std::atomic<EngineHubProxyBase*> mEngHubProxy;
+    std::atomic<bool> mEngHubProxyLoaded;
+    // libloc_eng_hub.so and libloc_net_iface.so, loaded on threads of their own
+    // while the MsgTask goes on, or by initEngHubProxy() / initDefaultAgps()
+    // if they are needed before that is done
+    loc_util::LocInitTask mEngHubLib;
+    loc_util::LocInitTask mNetIfaceLib;
+
+    /* ==== CLIENT ========================================================================= */
+    // rebuilt from mClientData by updateClientsEventMask()
+    GnssClientDispatch mClientDispatch;
 
     /* ==== TRACKING ======================================================================= */
     TrackingOptionsMap mTimeBasedTrackingSessions;
@@ -182,6 +214,9 @@ class GnssAdapter : public LocAdapterBase {
 
     /* === SystemStatus ===================================================================== */
     SystemStatus* mSystemStatus;
+    typedef SystemStatusSnapshot<SystemStatusTimeAndClock, SystemStatusRfAndParams> RfSnapshot;
+    // RF and clock status as of the last data notification, MsgTask thread only
+    RfSnapshot mRfSnapshot;
     std::string mServerUrl;
     std::string mMoServerUrl;
     XtraSystemStatusObserver mXtraObserver;
@@ -210,7 +245,8 @@ class GnssAdapter : public LocAdapterBase {
     /* ======== UTILITIES ================================================================== */
     inline void initOdcpi(const OdcpiRequestCallback& callback);
     inline void injectOdcpi(const Location& location);
-    static bool isFlpClient(LocationCallbacks& locationCallbacks);
+    static bool isFlpClient(const LocationCallbacks& locationCallbacks);
+    void updateClientDispatch();
 
 protected:
 
@@ -342,6 +378,14 @@ public:
     virtual bool isInSession() { return !mTimeBasedTrackingSessions.empty(); }
     void initDefaultAgps();
     bool initEngHubProxy();
+    // whether initEngHubProxy() got the proxy from its library yet; report
+    // paths ask this instead of waiting for the library to load
+    inline bool isEngHubProxyLoaded() const {
+        return mEngHubProxyLoaded.load(std::memory_order_acquire);
+    }
+    inline EngineHubProxyBase* getEngHubProxy() {
+        return mEngHubProxy.load(std::memory_order_acquire);
+    }
     void odcpiTimerExpireEvent();
 
     /* ==== REPORTS ======================================================================== */
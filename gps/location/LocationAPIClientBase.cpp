@@ -40,14 +40,11 @@
 
 // LocationAPIControlClient
 LocationAPIControlClient::LocationAPIControlClient() :
+    mRequests((1 << CTRL_REQUEST_DELETEAIDINGDATA) | (1 << CTRL_REQUEST_CONTROL)),
     mEnabled(false)
 {
     pthread_mutex_init(&mMutex, nullptr);
 
-    for (int i = 0; i < CTRL_REQUEST_MAX; i++) {
-        mRequestQueues[i].reset((uint32_t)0);
-    }
-
     memset(&mConfig, 0, sizeof(GnssConfig));
 
     LocationControlCallbacks locationControlCallbacks;
@@ -75,7 +72,7 @@ LocationAPIControlClient::~LocationAPIControlClient()
     }
 
     for (int i = 0; i < CTRL_REQUEST_MAX; i++) {
-        mRequestQueues[i].reset((uint32_t)0);
+        mRequests.reset(i, (uint32_t)0);
     }
 
     pthread_mutex_unlock(&mMutex);
@@ -88,10 +85,12 @@ uint32_t LocationAPIControlClient::locAPIGnssDeleteAidingData(GnssAidingData& da
     uint32_t retVal = LOCATION_ERROR_GENERAL_FAILURE;
     pthread_mutex_lock(&mMutex);
     if (mLocationControlAPI) {
+        mRequests.lock();
         uint32_t session = mLocationControlAPI->gnssDeleteAidingData(data);
         LOC_LOGI("%s:%d] start new session: %d", __FUNCTION__, __LINE__, session);
-        mRequestQueues[CTRL_REQUEST_DELETEAIDINGDATA].reset(session);
-        mRequestQueues[CTRL_REQUEST_DELETEAIDINGDATA].push(new GnssDeleteAidingDataRequest(*this));
+        mRequests.reset(CTRL_REQUEST_DELETEAIDINGDATA, session);
+        mRequests.push(CTRL_REQUEST_DELETEAIDINGDATA, new GnssDeleteAidingDataRequest(*this));
+        mRequests.unlock();
 
         retVal = LOCATION_ERROR_SUCCESS;
     }
@@ -108,10 +107,12 @@ uint32_t LocationAPIControlClient::locAPIEnable(LocationTechnologyType techType)
         // just return success if already enabled
         retVal = LOCATION_ERROR_SUCCESS;
     } else if (mLocationControlAPI) {
+        mRequests.lock();
         uint32_t session = mLocationControlAPI->enable(techType);
         LOC_LOGI("%s:%d] start new session: %d", __FUNCTION__, __LINE__, session);
-        mRequestQueues[CTRL_REQUEST_CONTROL].reset(session);
-        mRequestQueues[CTRL_REQUEST_CONTROL].push(new EnableRequest(*this));
+        mRequests.reset(CTRL_REQUEST_CONTROL, session);
+        mRequests.push(CTRL_REQUEST_CONTROL, new EnableRequest(*this));
+        mRequests.unlock();
         retVal = LOCATION_ERROR_SUCCESS;
         mEnabled = true;
     } else {
@@ -127,9 +128,9 @@ void LocationAPIControlClient::locAPIDisable()
     pthread_mutex_lock(&mMutex);
     if (mEnabled && mLocationControlAPI) {
         uint32_t session = 0;
-        session = mRequestQueues[CTRL_REQUEST_CONTROL].getSession();
+        session = mRequests.getSession(CTRL_REQUEST_CONTROL);
         if (session > 0) {
-            mRequestQueues[CTRL_REQUEST_CONTROL].push(new DisableRequest(*this));
+            mRequests.push(CTRL_REQUEST_CONTROL, new DisableRequest(*this));
             mLocationControlAPI->disable(session);
             mEnabled = false;
         } else {
@@ -150,15 +151,17 @@ uint32_t LocationAPIControlClient::locAPIGnssUpdateConfig(GnssConfig config)
             retVal = LOCATION_ERROR_SUCCESS;
         } else {
             mConfig = config;
+            mRequests.lock();
             uint32_t* idArray = mLocationControlAPI->gnssUpdateConfig(config);
             LOC_LOGv("gnssUpdateConfig return array: %p", idArray);
             if (nullptr != idArray) {
-                if (nullptr != mRequestQueues[CTRL_REQUEST_CONFIG_UPDATE].getSessionArrayPtr()) {
-                    mRequestQueues[CTRL_REQUEST_CONFIG_UPDATE].reset(idArray);
+                if (nullptr != mRequests.getSessionArrayPtr(CTRL_REQUEST_CONFIG_UPDATE)) {
+                    mRequests.reset(CTRL_REQUEST_CONFIG_UPDATE, idArray);
                 }
-                mRequestQueues[CTRL_REQUEST_CONFIG_UPDATE].push(new GnssUpdateConfigRequest(*this));
+                mRequests.push(CTRL_REQUEST_CONFIG_UPDATE, new GnssUpdateConfigRequest(*this));
                 retVal = LOCATION_ERROR_SUCCESS;
             }
+            mRequests.unlock();
         }
     }
     pthread_mutex_unlock(&mMutex);
@@ -172,15 +175,17 @@ uint32_t LocationAPIControlClient::locAPIGnssGetConfig(GnssConfigFlagsMask mask)
     pthread_mutex_lock(&mMutex);
     if (mLocationControlAPI) {
 
+        mRequests.lock();
         uint32_t* idArray = mLocationControlAPI->gnssGetConfig(mask);
         LOC_LOGv("gnssGetConfig return array: %p", idArray);
         if (nullptr != idArray) {
-            if (nullptr != mRequestQueues[CTRL_REQUEST_CONFIG_GET].getSessionArrayPtr()) {
-                mRequestQueues[CTRL_REQUEST_CONFIG_GET].reset(idArray);
+            if (nullptr != mRequests.getSessionArrayPtr(CTRL_REQUEST_CONFIG_GET)) {
+                mRequests.reset(CTRL_REQUEST_CONFIG_GET, idArray);
             }
-            mRequestQueues[CTRL_REQUEST_CONFIG_GET].push(new GnssGetConfigRequest(*this));
+            mRequests.push(CTRL_REQUEST_CONFIG_GET, new GnssGetConfigRequest(*this));
             retVal = LOCATION_ERROR_SUCCESS;
         }
+        mRequests.unlock();
     }
     pthread_mutex_unlock(&mMutex);
     return retVal;
@@ -219,33 +224,23 @@ void LocationAPIControlClient::onCtrlCollectiveResponseCb(
 
 LocationAPIRequest* LocationAPIControlClient::getRequestBySession(uint32_t session)
 {
-    pthread_mutex_lock(&mMutex);
-    LocationAPIRequest* request = nullptr;
-
-    if (mRequestQueues[CTRL_REQUEST_DELETEAIDINGDATA].getSession() == session) {
-        request = mRequestQueues[CTRL_REQUEST_DELETEAIDINGDATA].pop();
-    } else if (mRequestQueues[CTRL_REQUEST_CONTROL].getSession() == session) {
-        request = mRequestQueues[CTRL_REQUEST_CONTROL].pop();
-    }
-
-    pthread_mutex_unlock(&mMutex);
-    return request;
+    return mRequests.popBySession(session);
 }
 
 LocationAPIRequest*
 LocationAPIControlClient::getRequestBySessionArrayPtr(
         uint32_t* sessionArrayPtr)
 {
-    pthread_mutex_lock(&mMutex);
+    mRequests.lock();
     LocationAPIRequest* request = nullptr;
 
-    if (mRequestQueues[CTRL_REQUEST_CONFIG_UPDATE].getSessionArrayPtr() == sessionArrayPtr) {
-        request = mRequestQueues[CTRL_REQUEST_CONFIG_UPDATE].pop();
-    } else if (mRequestQueues[CTRL_REQUEST_CONFIG_GET].getSessionArrayPtr() == sessionArrayPtr) {
-        request = mRequestQueues[CTRL_REQUEST_CONFIG_GET].pop();
+    if (mRequests.getSessionArrayPtr(CTRL_REQUEST_CONFIG_UPDATE) == sessionArrayPtr) {
+        request = mRequests.pop(CTRL_REQUEST_CONFIG_UPDATE);
+    } else if (mRequests.getSessionArrayPtr(CTRL_REQUEST_CONFIG_GET) == sessionArrayPtr) {
+        request = mRequests.pop(CTRL_REQUEST_CONFIG_GET);
     }
 
-    pthread_mutex_unlock(&mMutex);
+    mRequests.unlock();
     return request;
 }
 
@@ -254,6 +249,7 @@ LocationAPIClientBase::LocationAPIClientBase() :
     mGeofenceBreachCallback(nullptr),
     mBatchingStatusCallback(nullptr),
     mLocationAPI(nullptr),
+    mRequests((1 << REQUEST_TRACKING) | (1 << REQUEST_NIRESPONSE)),
     mBatchSize(-1),
     mTracking(false)
 {
@@ -263,10 +259,6 @@ LocationAPIClientBase::LocationAPIClientBase() :
     pthread_mutexattr_init(&attr);
     pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
     pthread_mutex_init(&mMutex, &attr);
-
-    for (int i = 0; i < REQUEST_MAX; i++) {
-        mRequestQueues[i].reset((uint32_t)0);
-    }
 }
 
 void LocationAPIClientBase::locAPISetCallbacks(LocationCallbacks& locationCallbacks)
@@ -322,7 +314,7 @@ LocationAPIClientBase::~LocationAPIClientBase()
     }
 
     for (int i = 0; i < REQUEST_MAX; i++) {
-        mRequestQueues[i].reset((uint32_t)0);
+        mRequests.reset(i, (uint32_t)0);
     }
 
     pthread_mutex_unlock(&mMutex);
@@ -338,13 +330,15 @@ uint32_t LocationAPIClientBase::locAPIStartTracking(TrackingOptions& options)
         if (mTracking) {
             LOC_LOGW("%s:%d] Existing tracking session present", __FUNCTION__, __LINE__);
         } else {
+            // onResponseCb might be called from other thread immediately after
+            // startTracking returns, so we are not going to unlock mRequests
+            // until StartTrackingRequest is pushed into it for REQUEST_TRACKING
+            mRequests.lock();
             uint32_t session = mLocationAPI->startTracking(options);
             LOC_LOGI("%s:%d] start new session: %d", __FUNCTION__, __LINE__, session);
-            // onResponseCb might be called from other thread immediately after
-            // startTracking returns, so we are not going to unlock mutex
-            // until StartTrackingRequest is pushed into mRequestQueues[REQUEST_TRACKING]
-            mRequestQueues[REQUEST_TRACKING].reset(session);
-            mRequestQueues[REQUEST_TRACKING].push(new StartTrackingRequest(*this));
+            mRequests.reset(REQUEST_TRACKING, session);
+            mRequests.push(REQUEST_TRACKING, new StartTrackingRequest(*this));
+            mRequests.unlock();
             mTracking = true;
         }
 
@@ -360,9 +354,9 @@ void LocationAPIClientBase::locAPIStopTracking()
     pthread_mutex_lock(&mMutex);
     if (mLocationAPI) {
         uint32_t session = 0;
-        session = mRequestQueues[REQUEST_TRACKING].getSession();
+        session = mRequests.getSession(REQUEST_TRACKING);
         if (session > 0) {
-            mRequestQueues[REQUEST_TRACKING].push(new StopTrackingRequest(*this));
+            mRequests.push(REQUEST_TRACKING, new StopTrackingRequest(*this));
             mLocationAPI->stopTracking(session);
             mTracking = false;
         } else {
@@ -377,9 +371,9 @@ void LocationAPIClientBase::locAPIUpdateTrackingOptions(TrackingOptions& options
     pthread_mutex_lock(&mMutex);
     if (mLocationAPI) {
         uint32_t session = 0;
-        session = mRequestQueues[REQUEST_TRACKING].getSession();
+        session = mRequests.getSession(REQUEST_TRACKING);
         if (session > 0) {
-            mRequestQueues[REQUEST_TRACKING].push(new UpdateTrackingOptionsRequest(*this));
+            mRequests.push(REQUEST_TRACKING, new UpdateTrackingOptionsRequest(*this));
             mLocationAPI->updateTrackingOptions(session, options);
         } else {
             LOC_LOGE("%s:%d] invalid session: %d.", __FUNCTION__, __LINE__, session);
@@ -418,10 +412,11 @@ uint32_t LocationAPIClientBase::locAPIStartSession(
             uint32_t trackingSession = 0;
             uint32_t batchingSession = 0;
 
+            mRequests.lock();
             if (sessionMode == SESSION_MODE_ON_FIX) {
                 trackingSession = mLocationAPI->startTracking(options);
                 LOC_LOGI("%s:%d] start new session: %d", __FUNCTION__, __LINE__, trackingSession);
-                mRequestQueues[REQUEST_SESSION].push(new StartTrackingRequest(*this));
+                mRequests.push(REQUEST_SESSION, new StartTrackingRequest(*this));
             } else {
                 // Fill in the batch mode
                 BatchingOptions batchOptions = {};
@@ -445,8 +440,7 @@ uint32_t LocationAPIClientBase::locAPIStartSession(
 
                 batchingSession = mLocationAPI->startBatching(batchOptions);
                 LOC_LOGI("%s:%d] start new session: %d", __FUNCTION__, __LINE__, batchingSession);
-                mRequestQueues[REQUEST_SESSION].setSession(batchingSession);
-                mRequestQueues[REQUEST_SESSION].push(new StartBatchingRequest(*this));
+                mRequests.push(REQUEST_SESSION, new StartBatchingRequest(*this));
             }
 
             uint32_t session = ((sessionMode != SESSION_MODE_ON_FIX) ?
@@ -458,6 +452,8 @@ uint32_t LocationAPIClientBase::locAPIStartSession(
             entity.batchingSession = batchingSession;
             entity.sessionMode = sessionMode;
             mSessionBiDict.set(id, session, entity);
+            mRequests.bind(session, REQUEST_SESSION);
+            mRequests.unlock();
 
             retVal = LOCATION_ERROR_SUCCESS;
         }
@@ -482,10 +478,10 @@ uint32_t LocationAPIClientBase::locAPIStopSession(uint32_t id)
             uint32_t sMode = entity.sessionMode;
 
             if (sMode == SESSION_MODE_ON_FIX) {
-                mRequestQueues[REQUEST_SESSION].push(new StopTrackingRequest(*this));
+                mRequests.push(REQUEST_SESSION, new StopTrackingRequest(*this));
                 mLocationAPI->stopTracking(trackingSession);
             } else {
-                mRequestQueues[REQUEST_SESSION].push(new StopBatchingRequest(*this));
+                mRequests.push(REQUEST_SESSION, new StopBatchingRequest(*this));
                 mLocationAPI->stopBatching(batchingSession);
             }
 
@@ -513,20 +509,24 @@ uint32_t LocationAPIClientBase::locAPIUpdateSessionOptions(
             uint32_t trackingSession = entity.trackingSession;
             uint32_t batchingSession = entity.batchingSession;
             uint32_t sMode = entity.sessionMode;
+            uint32_t oldSession = ((sMode != SESSION_MODE_ON_FIX) ?
+                    batchingSession : trackingSession);
 
+            // responses to stopping the old session must not find the requests
+            // queued for the new one, until the old session is unbound
+            mRequests.lock();
             if (sessionMode == SESSION_MODE_ON_FIX) {
-                // we only add an UpdateTrackingOptionsRequest to mRequestQueues[REQUEST_SESSION],
+                // we only add an UpdateTrackingOptionsRequest to mRequests for REQUEST_SESSION,
                 // even if this update request will stop batching and then start tracking.
-                mRequestQueues[REQUEST_SESSION].push(new UpdateTrackingOptionsRequest(*this));
+                mRequests.push(REQUEST_SESSION, new UpdateTrackingOptionsRequest(*this));
                 if (sMode == SESSION_MODE_ON_FIX) {
                     mLocationAPI->updateTrackingOptions(trackingSession, options);
                 } else  {
                     // stop batching
                     // batchingSession will be removed from mSessionBiDict soon,
-                    // so we don't need to add a new request to mRequestQueues[REQUEST_SESSION].
+                    // so we don't need to add a new request to mRequests for REQUEST_SESSION.
                     mLocationAPI->stopBatching(batchingSession);
                     batchingSession = 0;
-                    mRequestQueues[REQUEST_SESSION].setSession(batchingSession);
 
                     // start tracking
                     trackingSession = mLocationAPI->startTracking(options);
@@ -534,9 +534,9 @@ uint32_t LocationAPIClientBase::locAPIUpdateSessionOptions(
                             __FUNCTION__, __LINE__, trackingSession);
                 }
             } else {
-                // we only add an UpdateBatchingOptionsRequest to mRequestQueues[REQUEST_SESSION],
+                // we only add an UpdateBatchingOptionsRequest to mRequests for REQUEST_SESSION,
                 // even if this update request will stop tracking and then start batching.
-                mRequestQueues[REQUEST_SESSION].push(new UpdateBatchingOptionsRequest(*this));
+                mRequests.push(REQUEST_SESSION, new UpdateBatchingOptionsRequest(*this));
                 BatchingOptions batchOptions = {};
                 batchOptions.size = sizeof(BatchingOptions);
                 switch (sessionMode) {
@@ -554,7 +554,7 @@ uint32_t LocationAPIClientBase::locAPIUpdateSessionOptions(
                 if (sMode == SESSION_MODE_ON_FIX) {
                     // stop tracking
                     // trackingSession will be removed from mSessionBiDict soon,
-                    // so we don't need to add a new request to mRequestQueues[REQUEST_SESSION].
+                    // so we don't need to add a new request to mRequests for REQUEST_SESSION.
                     mLocationAPI->stopTracking(trackingSession);
                     trackingSession = 0;
 
@@ -567,7 +567,6 @@ uint32_t LocationAPIClientBase::locAPIUpdateSessionOptions(
                     batchingSession = mLocationAPI->startBatching(batchOptions);
                     LOC_LOGI("%s:%d] start new session: %d",
                             __FUNCTION__, __LINE__, batchingSession);
-                    mRequestQueues[REQUEST_SESSION].setSession(batchingSession);
                 } else {
                     mLocationAPI->updateBatchingOptions(batchingSession, batchOptions);
                 }
@@ -583,6 +582,9 @@ uint32_t LocationAPIClientBase::locAPIUpdateSessionOptions(
             // remove the old values from mSessionBiDict before we add a new one.
             mSessionBiDict.rmById(id);
             mSessionBiDict.set(id, session, entity);
+            mRequests.unbind(oldSession, REQUEST_SESSION);
+            mRequests.bind(session, REQUEST_SESSION);
+            mRequests.unlock();
 
             retVal = LOCATION_ERROR_SUCCESS;
         } else {
@@ -603,7 +605,7 @@ uint32_t LocationAPIClientBase::locAPIGetBatchedLocations(uint32_t id, size_t co
             SessionEntity entity = mSessionBiDict.getExtById(id);
             if (entity.sessionMode != SESSION_MODE_ON_FIX) {
                 uint32_t batchingSession = entity.batchingSession;
-                mRequestQueues[REQUEST_SESSION].push(new GetBatchedLocationsRequest(*this));
+                mRequests.push(REQUEST_SESSION, new GetBatchedLocationsRequest(*this));
                 mLocationAPI->getBatchedLocations(batchingSession, count);
                 retVal = LOCATION_ERROR_SUCCESS;
             }  else {
@@ -627,19 +629,21 @@ uint32_t LocationAPIClientBase::locAPIAddGeofences(
     uint32_t retVal = LOCATION_ERROR_GENERAL_FAILURE;
     pthread_mutex_lock(&mMutex);
     if (mLocationAPI) {
-        if (mRequestQueues[REQUEST_GEOFENCE].getSession() != GEOFENCE_SESSION_ID) {
-            mRequestQueues[REQUEST_GEOFENCE].reset(GEOFENCE_SESSION_ID);
+        mRequests.lock();
+        if (mRequests.getSession(REQUEST_GEOFENCE) != GEOFENCE_SESSION_ID) {
+            mRequests.reset(REQUEST_GEOFENCE, GEOFENCE_SESSION_ID);
         }
         uint32_t* sessions = mLocationAPI->addGeofences(count, options, data);
         if (sessions) {
             LOC_LOGI("%s:%d] start new sessions: %p", __FUNCTION__, __LINE__, sessions);
-            mRequestQueues[REQUEST_GEOFENCE].push(new AddGeofencesRequest(*this));
+            mRequests.push(REQUEST_GEOFENCE, new AddGeofencesRequest(*this));
 
             for (size_t i = 0; i < count; i++) {
                 mGeofenceBiDict.set(ids[i], sessions[i], options[i].breachTypeMask);
             }
             retVal = LOCATION_ERROR_SUCCESS;
         }
+        mRequests.unlock();
     }
     pthread_mutex_unlock(&mMutex);
 
@@ -658,7 +662,7 @@ void LocationAPIClientBase::locAPIRemoveGeofences(size_t count, uint32_t* ids)
             return;
         }
 
-        if (mRequestQueues[REQUEST_GEOFENCE].getSession() == GEOFENCE_SESSION_ID) {
+        if (mRequests.getSession(REQUEST_GEOFENCE) == GEOFENCE_SESSION_ID) {
             BiDict<GeofenceBreachTypeMask>* removedGeofenceBiDict =
                     new BiDict<GeofenceBreachTypeMask>();
             size_t j = 0;
@@ -672,7 +676,7 @@ void LocationAPIClientBase::locAPIRemoveGeofences(size_t count, uint32_t* ids)
                 }
             }
             if (j > 0) {
-                mRequestQueues[REQUEST_GEOFENCE].push(new RemoveGeofencesRequest(*this,
+                mRequests.push(REQUEST_GEOFENCE, new RemoveGeofencesRequest(*this,
                         removedGeofenceBiDict));
                 mLocationAPI->removeGeofences(j, sessions);
             } else {
@@ -680,7 +684,7 @@ void LocationAPIClientBase::locAPIRemoveGeofences(size_t count, uint32_t* ids)
             }
         } else {
             LOC_LOGE("%s:%d] invalid session: %d.", __FUNCTION__, __LINE__,
-                    mRequestQueues[REQUEST_GEOFENCE].getSession());
+                    mRequests.getSession(REQUEST_GEOFENCE));
         }
 
         free(sessions);
@@ -701,7 +705,7 @@ void LocationAPIClientBase::locAPIModifyGeofences(
             return;
         }
 
-        if (mRequestQueues[REQUEST_GEOFENCE].getSession() == GEOFENCE_SESSION_ID) {
+        if (mRequests.getSession(REQUEST_GEOFENCE) == GEOFENCE_SESSION_ID) {
             size_t j = 0;
             for (size_t i = 0; i < count; i++) {
                 sessions[j] = mGeofenceBiDict.getSession(ids[i]);
@@ -711,12 +715,12 @@ void LocationAPIClientBase::locAPIModifyGeofences(
                 }
             }
             if (j > 0) {
-                mRequestQueues[REQUEST_GEOFENCE].push(new ModifyGeofencesRequest(*this));
+                mRequests.push(REQUEST_GEOFENCE, new ModifyGeofencesRequest(*this));
                 mLocationAPI->modifyGeofences(j, sessions, options);
             }
         } else {
             LOC_LOGE("%s:%d] invalid session: %d.", __FUNCTION__, __LINE__,
-                    mRequestQueues[REQUEST_GEOFENCE].getSession());
+                    mRequests.getSession(REQUEST_GEOFENCE));
         }
 
         free(sessions);
@@ -736,7 +740,7 @@ void LocationAPIClientBase::locAPIPauseGeofences(size_t count, uint32_t* ids)
             return;
         }
 
-        if (mRequestQueues[REQUEST_GEOFENCE].getSession() == GEOFENCE_SESSION_ID) {
+        if (mRequests.getSession(REQUEST_GEOFENCE) == GEOFENCE_SESSION_ID) {
             size_t j = 0;
             for (size_t i = 0; i < count; i++) {
                 sessions[j] = mGeofenceBiDict.getSession(ids[i]);
@@ -745,12 +749,12 @@ void LocationAPIClientBase::locAPIPauseGeofences(size_t count, uint32_t* ids)
                 }
             }
             if (j > 0) {
-                mRequestQueues[REQUEST_GEOFENCE].push(new PauseGeofencesRequest(*this));
+                mRequests.push(REQUEST_GEOFENCE, new PauseGeofencesRequest(*this));
                 mLocationAPI->pauseGeofences(j, sessions);
             }
         } else {
             LOC_LOGE("%s:%d] invalid session: %d.", __FUNCTION__, __LINE__,
-                    mRequestQueues[REQUEST_GEOFENCE].getSession());
+                    mRequests.getSession(REQUEST_GEOFENCE));
         }
 
         free(sessions);
@@ -771,7 +775,7 @@ void LocationAPIClientBase::locAPIResumeGeofences(
             return;
         }
 
-        if (mRequestQueues[REQUEST_GEOFENCE].getSession() == GEOFENCE_SESSION_ID) {
+        if (mRequests.getSession(REQUEST_GEOFENCE) == GEOFENCE_SESSION_ID) {
             size_t j = 0;
             for (size_t i = 0; i < count; i++) {
                 sessions[j] = mGeofenceBiDict.getSession(ids[i]);
@@ -783,12 +787,12 @@ void LocationAPIClientBase::locAPIResumeGeofences(
                 }
             }
             if (j > 0) {
-                mRequestQueues[REQUEST_GEOFENCE].push(new ResumeGeofencesRequest(*this));
+                mRequests.push(REQUEST_GEOFENCE, new ResumeGeofencesRequest(*this));
                 mLocationAPI->resumeGeofences(j, sessions);
             }
         } else {
             LOC_LOGE("%s:%d] invalid session: %d.", __FUNCTION__, __LINE__,
-                    mRequestQueues[REQUEST_GEOFENCE].getSession());
+                    mRequests.getSession(REQUEST_GEOFENCE));
         }
 
         free(sessions);
@@ -807,10 +811,12 @@ void LocationAPIClientBase::locAPIGnssNiResponse(uint32_t id, GnssNiResponse res
     pthread_mutex_lock(&mMutex);
     if (mLocationAPI) {
         uint32_t session = id;
+        mRequests.lock();
         mLocationAPI->gnssNiResponse(id, response);
         LOC_LOGI("%s:%d] start new session: %d", __FUNCTION__, __LINE__, session);
-        mRequestQueues[REQUEST_NIRESPONSE].reset(session);
-        mRequestQueues[REQUEST_NIRESPONSE].push(new GnssNiResponseRequest(*this));
+        mRequests.reset(REQUEST_NIRESPONSE, session);
+        mRequests.push(REQUEST_NIRESPONSE, new GnssNiResponseRequest(*this));
+        mRequests.unlock();
     }
     pthread_mutex_unlock(&mMutex);
 }
@@ -880,6 +886,7 @@ void LocationAPIClientBase::beforeBatchingStatusCb(BatchingStatusInfo batchStatu
                 if (sessEntity.sessionMode == SESSION_MODE_ON_TRIP_COMPLETED) {
                     tripCompletedClientIdList.push_back(sessEntity.id);
                     mSessionBiDict.rmBySession(*itt);
+                    mRequests.unbind(*itt, REQUEST_SESSION);
                 }
             }
         }
@@ -913,11 +920,11 @@ void LocationAPIClientBase::onCollectiveResponseCb(
         }
     }
     LocationAPIRequest* request = nullptr;
-    pthread_mutex_lock(&mMutex);
-    if (mRequestQueues[REQUEST_GEOFENCE].getSession() == GEOFENCE_SESSION_ID) {
-        request = mRequestQueues[REQUEST_GEOFENCE].pop();
+    mRequests.lock();
+    if (mRequests.getSession(REQUEST_GEOFENCE) == GEOFENCE_SESSION_ID) {
+        request = mRequests.pop(REQUEST_GEOFENCE);
     }
-    pthread_mutex_unlock(&mMutex);
+    mRequests.unlock();
     if (request) {
         request->onCollectiveResponse(count, errors, ids);
         delete request;
@@ -927,28 +934,251 @@ void LocationAPIClientBase::onCollectiveResponseCb(
 void LocationAPIClientBase::removeSession(uint32_t session) {
     if (mSessionBiDict.hasSession(session)) {
         mSessionBiDict.rmBySession(session);
+        mRequests.unbind(session, REQUEST_SESSION);
     }
 }
 
+// sessions of REQUEST_TRACKING and REQUEST_NIRESPONSE are indexed as they are
+// reset, and those of REQUEST_SESSION as long as mSessionBiDict has them
 LocationAPIRequest* LocationAPIClientBase::getRequestBySession(uint32_t session)
 {
-    pthread_mutex_lock(&mMutex);
-    LocationAPIRequest* request = nullptr;
-    for (int i = 0; i < REQUEST_MAX; i++) {
-        if (i != REQUEST_GEOFENCE &&
-                i != REQUEST_SESSION &&
-                mRequestQueues[i].getSession() == session) {
-            request = mRequestQueues[i].pop();
-            break;
+    return mRequests.popBySession(session);
+}
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+// Stands in for LocationAPI and the adapter thread behind it: every call is
+// answered once, in the order of the calls, from another thread, and every
+// so often before the caller has even returned from the call.
+struct LocTrackerDebugApi {
+    std::mutex mLock;
+    std::condition_variable mCond;
+    std::deque<uint32_t> mCalls;
+    uint32_t mNextSession = 0;
+    bool mDone = false;
+    uint32_t call(uint32_t session = 0) {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (0 == session) {
+            session = ++mNextSession;
+        }
+        mCalls.push_back(session);
+        mCond.notify_one();
+        return session;
+    }
+    void finish() {
+        std::lock_guard<std::mutex> lock(mLock);
+        mDone = true;
+        mCond.notify_one();
+    }
+    bool next(uint32_t& session) {
+        std::unique_lock<std::mutex> lock(mLock);
+        mCond.wait(lock, [this] { return mDone || !mCalls.empty(); });
+        bool has = !mCalls.empty();
+        if (has) {
+            session = mCalls.front();
+            mCalls.pop_front();
         }
+        return has;
     }
-    if (request == nullptr) {
-        // Can't find a request with correct session,
-        // try to find it from mSessionBiDict
-        if (mSessionBiDict.hasSession(session)) {
-            request = mRequestQueues[REQUEST_SESSION].pop();
+};
+
+struct LocTrackerDebugStats {
+    std::atomic<int> issued{0};
+    std::atomic<int> answered{0};
+    std::atomic<int> mismatched{0};
+    std::atomic<int> dropped{0};
+    std::atomic<int> unmatched{0};
+};
+
+// knows the session it was queued for, which its response has to come with
+struct LocTrackerDebugRequest : public LocationAPIRequest {
+    LocTrackerDebugRequest(LocTrackerDebugStats& stats, uint32_t session,
+                           std::atomic<int>& pending,
+                           RequestTracker<REQUEST_MAX>* unbindOnResponse = nullptr) :
+        mStats(stats), mSession(session), mPending(pending), mUnbind(unbindOnResponse),
+        mAnswered(false) {
+        mStats.issued++;
+        mPending++;
+    }
+    ~LocTrackerDebugRequest() {
+        if (!mAnswered) {
+            mStats.dropped++;
         }
+        mPending--;
     }
-    pthread_mutex_unlock(&mMutex);
-    return request;
+    void onResponse(LocationError /*error*/, uint32_t id) {
+        mAnswered = true;
+        if (id != mSession) {
+            mStats.mismatched++;
+        } else {
+            mStats.answered++;
+        }
+        if (mUnbind) {
+            mUnbind->unbind(id, REQUEST_SESSION);
+        }
+    }
+    LocTrackerDebugStats& mStats;
+    uint32_t mSession;
+    std::atomic<int>& mPending;
+    RequestTracker<REQUEST_MAX>* mUnbind;
+    bool mAnswered;
+};
+
+// For Linux command line testing:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../utils -I../pla/oe LocationAPIClientBase.cpp
+//              LocationAPI.cpp -lpthread, link with libgps_utils
+// test: ./a.out 20000
+// Runs tracking, batching session and NI response clients on their own
+// threads against one tracker, the way LocationAPIClientBase queues them,
+// while the fake API answers from another thread. Each response has to find
+// the request queued for its session; the only requests left unanswered are
+// the ones a new tracking / NI session dropped, whose responses find nothing.
+int main(int argc, char** argv) {
+    int rounds = (argc > 1) ? atoi(argv[1]) : 20000;
+    RequestTracker<REQUEST_MAX>* tracker =
+            new RequestTracker<REQUEST_MAX>((1 << REQUEST_TRACKING) | (1 << REQUEST_NIRESPONSE));
+    LocTrackerDebugApi api;
+    LocTrackerDebugStats stats;
+    std::atomic<int> trackingPending{0};
+    std::atomic<int> sessionPending{0};
+    std::atomic<int> niPending{0};
+    auto settle = [](std::atomic<int>& pending) {
+        while (pending > 0) {
+            usleep(1);
+        }
+    };
+
+    double t0 = getSeconds();
+    std::thread responder([&] {
+        uint32_t session;
+        for (int n = 0; api.next(session); n++) {
+            if (0 == n % 7) {
+                usleep(1);
+            }
+            LocationAPIRequest* request = tracker->popBySession(session);
+            if (request) {
+                request->onResponse(LOCATION_ERROR_SUCCESS, session);
+                delete request;
+            } else {
+                stats.unmatched++;
+            }
+        }
+    });
+
+    // start, update and stop, but every few rounds start over without waiting
+    // for the responses, the way locAPIStartTracking() resets REQUEST_TRACKING
+    std::thread tracking([&] {
+        for (int i = 0; i < rounds; i++) {
+            tracker->lock();
+            uint32_t session = api.call();
+            tracker->reset(REQUEST_TRACKING, session);
+            tracker->push(REQUEST_TRACKING,
+                    new LocTrackerDebugRequest(stats, session, trackingPending));
+            tracker->unlock();
+            tracker->push(REQUEST_TRACKING,
+                    new LocTrackerDebugRequest(stats, session, trackingPending));
+            api.call(session);
+            if (i % 5) {
+                tracker->push(REQUEST_TRACKING,
+                        new LocTrackerDebugRequest(stats, session, trackingPending));
+                api.call(session);
+            }
+            if (i % 4) {
+                settle(trackingPending);
+            }
+        }
+    });
+
+    // several batching sessions open at once, each stopped in turn, which
+    // unbinds it on the response, as removeSession() does
+    std::thread sessions([&] {
+        std::deque<uint32_t> open;
+        for (int i = 0; i < rounds; i++) {
+            tracker->lock();
+            uint32_t session = api.call();
+            tracker->push(REQUEST_SESSION,
+                    new LocTrackerDebugRequest(stats, session, sessionPending));
+            tracker->bind(session, REQUEST_SESSION);
+            tracker->unlock();
+            open.push_back(session);
+            if (open.size() > (size_t)(i % 8)) {
+                uint32_t stopping = open.front();
+                open.pop_front();
+                tracker->push(REQUEST_SESSION,
+                        new LocTrackerDebugRequest(stats, stopping, sessionPending, tracker));
+                api.call(stopping);
+            }
+        }
+        for (uint32_t stopping : open) {
+            tracker->push(REQUEST_SESSION,
+                    new LocTrackerDebugRequest(stats, stopping, sessionPending, tracker));
+            api.call(stopping);
+        }
+    });
+
+    std::thread ni([&] {
+        for (int i = 0; i < rounds; i++) {
+            tracker->lock();
+            uint32_t session = api.call();
+            tracker->reset(REQUEST_NIRESPONSE, session);
+            tracker->push(REQUEST_NIRESPONSE,
+                    new LocTrackerDebugRequest(stats, session, niPending));
+            tracker->unlock();
+            if (i % 4) {
+                settle(niPending);
+            }
+        }
+    });
+
+    tracking.join();
+    sessions.join();
+    ni.join();
+    api.finish();
+    responder.join();
+    double t1 = getSeconds();
+
+    int left = stats.issued - stats.answered - stats.mismatched - stats.dropped;
+    delete tracker;
+    bool ok = (0 == stats.mismatched && 0 == left && stats.unmatched == stats.dropped);
+    printf("%d requests in %.3f s: %d answered, %d mismatched, %d dropped by a reset, "
+           "%d responses unmatched, %d left behind: %s\n",
+           stats.issued.load(), t1 - t0, stats.answered.load(), stats.mismatched.load(),
+           stats.dropped.load(), stats.unmatched.load(), left, ok ? "PASS" : "FAIL");
+
+    // open addressing index on its own: bind, look up and unbind many
+    // sessions, with erased entries piling up in between
+    RequestSessionIndex index;
+    int wrong = 0;
+    t0 = getSeconds();
+    for (uint32_t s = 1; s <= (uint32_t)rounds * 10; s++) {
+        index.set(s, s % REQUEST_MAX);
+        if (s > 64) {
+            index.erase(s - 64, (s - 64) % REQUEST_MAX);
+        }
+        wrong += (index.get(s) != (int)(s % REQUEST_MAX)) ? 1 : 0;
+        wrong += (s > 64 && index.get(s - 64) != -1) ? 1 : 0;
+        wrong += (s > 32 && index.get(s - 32) != (int)((s - 32) % REQUEST_MAX)) ? 1 : 0;
+    }
+    t1 = getSeconds();
+    printf("index: %d sessions in %.3f s, %d wrong: %s\n",
+           rounds * 10, t1 - t0, wrong, wrong ? "FAIL" : "PASS");
+
+    return (ok && 0 == wrong) ? 0 : 1;
 }
+
+#endif
@@ -32,8 +32,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <pthread.h>
-#include <queue>
 #include <map>
+#include <vector>
 
 #include "LocationAPI.h"
 #include <loc_pla.h>
@@ -66,16 +66,20 @@ class LocationAPIClientBase;
 
 class LocationAPIRequest {
 public:
-    LocationAPIRequest() {}
+    LocationAPIRequest() : mNext(nullptr) {}
     virtual ~LocationAPIRequest() {}
     virtual void onResponse(LocationError /*error*/, uint32_t /*id*/) {}
     virtual void onCollectiveResponse(
             size_t /*count*/, LocationError* /*errors*/, uint32_t* /*ids*/) {}
+private:
+    // RequestQueue links its requests through here, so queueing never allocates
+    friend class RequestQueue;
+    LocationAPIRequest* mNext;
 };
 
 class RequestQueue {
 public:
-    RequestQueue(): mSession(0), mSessionArrayPtr(nullptr) {
+    RequestQueue(): mSession(0), mSessionArrayPtr(nullptr), mHead(nullptr), mTail(nullptr) {
     }
     virtual ~RequestQueue() {
         reset((uint32_t)0);
@@ -84,9 +88,7 @@ public:
     void inline setSessionArrayPtr(uint32_t* ptr) { mSessionArrayPtr = ptr; }
     void reset(uint32_t session) {
         LocationAPIRequest* request = nullptr;
-        while (!mQueue.empty()) {
-            request = mQueue.front();
-            mQueue.pop();
+        while ((request = pop()) != nullptr) {
             delete request;
         }
         mSession = session;
@@ -96,13 +98,22 @@ public:
         mSessionArrayPtr = sessionArrayPtr;
     }
     void push(LocationAPIRequest* request) {
-        mQueue.push(request);
+        request->mNext = nullptr;
+        if (mTail) {
+            mTail->mNext = request;
+        } else {
+            mHead = request;
+        }
+        mTail = request;
     }
     LocationAPIRequest* pop() {
-        LocationAPIRequest* request = nullptr;
-        if (!mQueue.empty()) {
-            request = mQueue.front();
-            mQueue.pop();
+        LocationAPIRequest* request = mHead;
+        if (request) {
+            mHead = request->mNext;
+            if (nullptr == mHead) {
+                mTail = nullptr;
+            }
+            request->mNext = nullptr;
         }
         return request;
     }
@@ -111,7 +122,187 @@ public:
 private:
     uint32_t mSession;
     uint32_t* mSessionArrayPtr;
-    std::queue<LocationAPIRequest*> mQueue;
+    LocationAPIRequest* mHead;
+    LocationAPIRequest* mTail;
+};
+
+// Open addressing map from a session id to the type of the requests waiting
+// on it. Session 0 is never handed out, so it marks an empty entry; an erased
+// entry keeps its session with type -1, so that probing goes on past it.
+class RequestSessionIndex {
+public:
+    RequestSessionIndex() : mUsed(0) {
+        rehash(MIN_BITS);
+    }
+    void set(uint32_t session, int type) {
+        if (0 == session) {
+            return;
+        }
+        uint32_t i = find(session);
+        if (mEntries[i].session != session) {
+            if ((mUsed + 1) * 4 > mEntries.size() * 3) {
+                grow();
+                i = find(session);
+            }
+            if (0 == mEntries[i].session) {
+                mUsed++;
+            }
+            mEntries[i].session = session;
+        }
+        mEntries[i].type = type;
+    }
+    // type of session, or -1 if it has none
+    int get(uint32_t session) const {
+        int type = -1;
+        if (0 != session) {
+            type = mEntries[find(session)].type;
+        }
+        return type;
+    }
+    // only if session is still with type, a later set() may have moved it on
+    void erase(uint32_t session, int type) {
+        if (0 != session) {
+            uint32_t i = find(session);
+            if (mEntries[i].session == session && mEntries[i].type == type) {
+                mEntries[i].type = -1;
+            }
+        }
+    }
+private:
+    static const uint32_t MIN_BITS = 4;
+    struct Entry {
+        uint32_t session;
+        int32_t type;
+    };
+    // entry holding session, or else the first erased or empty entry on its probe
+    uint32_t find(uint32_t session) const {
+        uint32_t mask = mEntries.size() - 1;
+        uint32_t reuse = UINT32_MAX;
+        uint32_t i = (session * 0x9E3779B1u) >> (32 - mBits);
+        for (; mEntries[i].session != 0; i = (i + 1) & mask) {
+            if (mEntries[i].session == session) {
+                return i;
+            }
+            if (mEntries[i].type < 0 && UINT32_MAX == reuse) {
+                reuse = i;
+            }
+        }
+        return (UINT32_MAX == reuse) ? i : reuse;
+    }
+    // drops the erased entries, and doubles only if at least half are live
+    void grow() {
+        uint32_t live = 0;
+        for (auto& entry : mEntries) {
+            live += (entry.type >= 0) ? 1 : 0;
+        }
+        rehash((live * 2 >= mEntries.size() / 2) ? mBits + 1 : mBits);
+    }
+    void rehash(uint32_t bits) {
+        std::vector<Entry> entries(1u << bits, Entry{0, -1});
+        entries.swap(mEntries);
+        mBits = bits;
+        mUsed = 0;
+        for (auto& entry : entries) {
+            if (entry.type >= 0) {
+                set(entry.session, entry.type);
+            }
+        }
+    }
+    std::vector<Entry> mEntries;
+    uint32_t mBits;
+    uint32_t mUsed;
+};
+
+// The request queues of a client by request type, and an index from session
+// id to the queue that its responses are for, so a response callback finds
+// its request in O(1) without taking the client mutex.
+// Types in indexedTypes have the session given to reset() indexed; any other
+// sessions are indexed with bind() / unbind().
+// A client that can only queue a request after the call returns the session
+// holds lock() across the call, so that a response racing back on another
+// thread waits for its request. The lock is recursive, in case the callback
+// comes from the same thread.
+template <int N>
+class RequestTracker {
+public:
+    RequestTracker(uint32_t indexedTypes) : mIndexedTypes(indexedTypes) {
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&mLock, &attr);
+        pthread_mutexattr_destroy(&attr);
+    }
+    virtual ~RequestTracker() {
+        for (int i = 0; i < N; i++) {
+            mQueues[i].reset((uint32_t)0);
+        }
+        pthread_mutex_destroy(&mLock);
+    }
+    inline void lock() { pthread_mutex_lock(&mLock); }
+    inline void unlock() { pthread_mutex_unlock(&mLock); }
+    void reset(int type, uint32_t session) {
+        lock();
+        if (mIndexedTypes & (1 << type)) {
+            mIndex.erase(mQueues[type].getSession(), type);
+            mIndex.set(session, type);
+        }
+        mQueues[type].reset(session);
+        unlock();
+    }
+    void reset(int type, uint32_t* sessionArrayPtr) {
+        lock();
+        reset(type, (uint32_t)0);
+        mQueues[type].setSessionArrayPtr(sessionArrayPtr);
+        unlock();
+    }
+    void push(int type, LocationAPIRequest* request) {
+        lock();
+        mQueues[type].push(request);
+        unlock();
+    }
+    LocationAPIRequest* pop(int type) {
+        lock();
+        LocationAPIRequest* request = mQueues[type].pop();
+        unlock();
+        return request;
+    }
+    void bind(uint32_t session, int type) {
+        lock();
+        mIndex.set(session, type);
+        unlock();
+    }
+    void unbind(uint32_t session, int type) {
+        lock();
+        mIndex.erase(session, type);
+        unlock();
+    }
+    LocationAPIRequest* popBySession(uint32_t session) {
+        LocationAPIRequest* request = nullptr;
+        lock();
+        int type = mIndex.get(session);
+        if (type >= 0) {
+            request = mQueues[type].pop();
+        }
+        unlock();
+        return request;
+    }
+    uint32_t getSession(int type) {
+        lock();
+        uint32_t session = mQueues[type].getSession();
+        unlock();
+        return session;
+    }
+    uint32_t* getSessionArrayPtr(int type) {
+        lock();
+        uint32_t* sessionArrayPtr = mQueues[type].getSessionArrayPtr();
+        unlock();
+        return sessionArrayPtr;
+    }
+private:
+    pthread_mutex_t mLock;
+    uint32_t mIndexedTypes;
+    RequestQueue mQueues[N];
+    RequestSessionIndex mIndex;
 };
 
 class LocationAPIControlClient {
@@ -192,7 +383,7 @@ public:
 private:
     pthread_mutex_t mMutex;
     LocationControlAPI* mLocationControlAPI;
-    RequestQueue mRequestQueues[CTRL_REQUEST_MAX];
+    RequestTracker<CTRL_REQUEST_MAX> mRequests;
     bool mEnabled;
     GnssConfig mConfig;
 };
@@ -577,7 +768,7 @@ private:
 
     LocationAPI* mLocationAPI;
 
-    RequestQueue mRequestQueues[REQUEST_MAX];
+    RequestTracker<REQUEST_MAX> mRequests;
     BiDict<GeofenceBreachTypeMask> mGeofenceBiDict;
     BiDict<SessionEntity> mSessionBiDict;
     int32_t mBatchSize;
@@ -57,6 +57,7 @@ extern "C" {
 #define LOC_PATH_SAP_CONF_STR      "/vendor/etc/sap.conf"
 #define LOC_PATH_APDR_CONF_STR     "/vendor/etc/apdr.conf"
 #define LOC_PATH_XTWIFI_CONF_STR   "/vendor/etc/xtwifi.conf"
+#define LOC_PATH_BATCH_LOG_STR     "/data/vendor/location/batch.log"
 #define LOC_PATH_QUIPC_CONF_STR    "/vendor/etc/quipc.conf"
 
 #ifdef __cplusplus
@@ -81,6 +81,7 @@ extern "C" {
 #define LOC_PATH_SAP_CONF_STR      "/etc/sap.conf"
 #define LOC_PATH_APDR_CONF_STR     "/etc/apdr.conf"
 #define LOC_PATH_XTWIFI_CONF_STR   "/etc/xtwifi.conf"
+#define LOC_PATH_BATCH_LOG_STR     "/data/location/batch.log"
 #define LOC_PATH_QUIPC_CONF_STR    "/etc/quipc.conf"
 
 #ifdef FEATURE_EXTERNAL_AP
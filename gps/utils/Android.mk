@@ -23,6 +23,13 @@ LOCAL_SRC_FILES += \
     loc_target.cpp \
     LocHeap.cpp \
     LocTimer.cpp \
+    LocTimerWheel.cpp \
+    LocBatch.cpp \
+    LocBatchLog.cpp \
+    LocSvUsedMask.cpp \
+    LocStartupTrace.cpp \
+    LocInitTask.cpp \
+    LocMsgPool.cpp \
     LocThread.cpp \
     MsgTask.cpp \
     loc_misc_utils.cpp \
@@ -0,0 +1,184 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <LocBatch.h>
+#include <log_util.h>
+
+namespace loc_util {
+
+// the locations follow the header, aligned for Location
+size_t LocBatch::headerSize() {
+    return (sizeof(LocBatch) + alignof(Location) - 1) / alignof(Location) * alignof(Location);
+}
+
+LocBatch* LocBatch::create(size_t count) {
+    void* memory = malloc(headerSize() + count * sizeof(Location));
+    if (NULL == memory) {
+        LOC_LOGe("malloc failed for %zu locations", count);
+        return NULL;
+    }
+    return new (memory) LocBatch(count);
+}
+
+LocBatch* LocBatch::create(const Location* locations, size_t count) {
+    LocBatch* batch = create(count);
+    if (NULL != batch && NULL != locations) {
+        memcpy(batch->edit(), locations, count * sizeof(Location));
+    } else if (NULL != batch) {
+        memset(batch->edit(), 0, count * sizeof(Location));
+    }
+    return batch;
+}
+
+void LocBatch::drop() {
+    if (1 == mRef.fetch_sub(1, std::memory_order_acq_rel)) {
+        this->~LocBatch();
+        free(this);
+    }
+}
+
+} // namespace loc_util
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <vector>
+
+using namespace loc_util;
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+// what a LocApi does with each fix of a flush it decodes
+static void debugFill(Location& location, size_t i) {
+    memset(&location, 0, sizeof(Location));
+    location.size = sizeof(Location);
+    location.flags = LOCATION_HAS_LAT_LONG_BIT | LOCATION_HAS_ACCURACY_BIT;
+    location.timestamp = 1600000000000ULL + i * 1000;
+    location.latitude = 37.0 + i * 1e-5;
+    location.longitude = -122.0 - i * 1e-5;
+    location.accuracy = 5;
+}
+
+// a client reading the whole batch, as the HIDL converter does
+static double debugClient(const Location* locations, size_t count) {
+    double sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += locations[i].latitude + locations[i].longitude;
+    }
+    return sum;
+}
+
+struct LocBatchDebugShare {
+    LocBatch* batch;
+    double sum;
+};
+
+static void* debugShareThread(void* arg) {
+    LocBatchDebugShare* share = (LocBatchDebugShare*)arg;
+    for (int i = 0; i < 100000; i++) {
+        LocBatch* batch = share->batch->share();
+        share->sum += batch->locations()[i % batch->count()].latitude;
+        batch->drop();
+    }
+    share->batch->drop();
+    return NULL;
+}
+
+// For Linux command line testing:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../location -I../pla/oe LocBatch.cpp,
+//     link with libgps_utils
+// test: ./a.out 10000 3
+// Flushes a batch of *count* fixes to *clients* clients, the way it used to
+// go, decoded into the LocApi's array and copied into the message, and as a
+// LocBatch filled in once and shared; then has threads share and drop one
+// batch at once, which has to be freed only by the last of them.
+int main(int argc, char** argv) {
+    size_t count = (argc > 1) ? atoi(argv[1]) : 10000;
+    int clients = (argc > 2) ? atoi(argv[2]) : 3;
+    int rounds = 200;
+    double sum = 0;
+
+    double t0 = getSeconds();
+    for (int r = 0; r < rounds; r++) {
+        Location* decoded = new Location[count];
+        for (size_t i = 0; i < count; i++) {
+            debugFill(decoded[i], i);
+        }
+        Location* message = new Location[count];
+        for (size_t i = 0; i < count; i++) {
+            message[i] = decoded[i];
+        }
+        delete[] decoded;
+        for (int c = 0; c < clients; c++) {
+            sum += debugClient(message, count);
+        }
+        delete[] message;
+    }
+    double t1 = getSeconds();
+    for (int r = 0; r < rounds; r++) {
+        LocBatch* batch = LocBatch::create(count);
+        Location* locations = batch->edit();
+        for (size_t i = 0; i < count; i++) {
+            debugFill(locations[i], i);
+        }
+        LocBatch* message = batch->share();
+        batch->drop();
+        for (int c = 0; c < clients; c++) {
+            sum += debugClient(message->locations(), message->count());
+        }
+        message->drop();
+    }
+    double t2 = getSeconds();
+    printf("%zu fixes to %d clients: copied %.1f us, shared %.1f us per flush (%g)\n",
+           count, clients, (t1 - t0) * 1000000 / rounds, (t2 - t1) * 1000000 / rounds, sum);
+
+    LocBatch* batch = LocBatch::create(NULL, count);
+    std::vector<pthread_t> threads(4);
+    std::vector<LocBatchDebugShare> shares(threads.size());
+    for (size_t i = 0; i < threads.size(); i++) {
+        shares[i] = {batch->share(), 0};
+        pthread_create(&threads[i], NULL, debugShareThread, &shares[i]);
+    }
+    batch->drop();
+    for (size_t i = 0; i < threads.size(); i++) {
+        pthread_join(threads[i], NULL);
+    }
+    printf("shared across %zu threads: done\n", threads.size());
+    return 0;
+}
+
+#endif
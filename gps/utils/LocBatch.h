@@ -0,0 +1,76 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_BATCH_H__
+#define __LOC_BATCH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <LocationDataTypes.h>
+
+namespace loc_util {
+
+// The locations of one batch flush, in a single allocation along with a
+// reference count. The LocApi that creates it fills it in through edit(),
+// after which it is read only and shared, not copied, by every adapter,
+// message and client it is reported to. share() adds a reference, drop()
+// takes one away, and the last drop() frees it.
+class LocBatch {
+    std::atomic<int32_t> mRef;
+    const size_t mCount;
+    inline LocBatch(size_t count) : mRef(1), mCount(count) {}
+    inline ~LocBatch() {}
+    static size_t headerSize();
+
+public:
+    // a batch of *count* locations, to be filled in, holding one reference
+    // for the caller; NULL if it can not be allocated
+    static LocBatch* create(size_t count);
+    // same, with a copy of *locations* in it
+    static LocBatch* create(const Location* locations, size_t count);
+
+    inline LocBatch* share() {
+        mRef.fetch_add(1, std::memory_order_relaxed);
+        return this;
+    }
+    void drop();
+
+    inline size_t count() const { return mCount; }
+    inline const Location* locations() const {
+        return (const Location*)((const char*)this + headerSize());
+    }
+    // only for the creator, before the batch is shared
+    inline Location* edit() {
+        return (Location*)((char*)this + headerSize());
+    }
+};
+
+} // namespace loc_util
+
+#endif // __LOC_BATCH_H__
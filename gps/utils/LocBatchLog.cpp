@@ -0,0 +1,660 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <LocBatchLog.h>
+#include <log_util.h>
+
+#define FILE_MAGIC 0x31474F4C42434F4CULL // "LOCBLOG1"
+#define CHUNK_MAGIC 0x4B4E4843           // "CHNK"
+#define FILE_HEADER_BYTES 16
+#define GROW_BYTES (64 * 1024)
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+
+namespace loc_util {
+
+struct LocBatchLogChunkHeader {
+    uint32_t magic;
+    uint32_t bytes;
+    uint32_t count;
+    uint32_t crc;
+    uint64_t minTime;
+    uint64_t maxTime;
+};
+
+struct LocBatchLogCrcTable {
+    uint32_t entries[256];
+    LocBatchLogCrcTable() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length) {
+    static const LocBatchLogCrcTable table;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t crcOf(const LocBatchLogChunkHeader& header, const uint8_t* payload) {
+    uint32_t crc = crc32(0, (const uint8_t*)&header.count, sizeof(header.count));
+    crc = crc32(crc, (const uint8_t*)&header.minTime, sizeof(header.minTime));
+    crc = crc32(crc, (const uint8_t*)&header.maxTime, sizeof(header.maxTime));
+    return crc32(crc, payload, header.bytes);
+}
+
+static inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)value | 0x80);
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t byte = *p++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (0 == (byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// floating point fields go as the difference of their bit patterns, which is
+// small for values close to each other, and exact. Values often carry fewer
+// bits than their type has room for, a float's worth in a double or a whole
+// number in a float, so the difference goes without its trailing zeros, with
+// the count of those in the low 6 bits (5 for floats); a double's difference
+// too wide for that follows a lone 63 as it is.
+#define DELTA_AS_IS 63
+
+static inline void putDelta(std::vector<uint8_t>& out, double value, double prev) {
+    uint64_t bits, prevBits;
+    memcpy(&bits, &value, sizeof(bits));
+    memcpy(&prevBits, &prev, sizeof(prevBits));
+    int64_t delta = (int64_t)(bits - prevBits);
+    int zeros = (0 == delta) ? 0 : __builtin_ctzll(delta);
+    uint64_t shifted = zigzag(delta >> zeros);
+    if (shifted >> 58) {
+        putVarint(out, DELTA_AS_IS);
+        putVarint(out, zigzag(delta));
+    } else {
+        putVarint(out, (shifted << 6) | zeros);
+    }
+}
+
+static inline void putDelta(std::vector<uint8_t>& out, float value, float prev) {
+    uint32_t bits, prevBits;
+    memcpy(&bits, &value, sizeof(bits));
+    memcpy(&prevBits, &prev, sizeof(prevBits));
+    int32_t delta = (int32_t)(bits - prevBits);
+    int zeros = (0 == delta) ? 0 : __builtin_ctz(delta);
+    putVarint(out, (zigzag(delta >> zeros) << 5) | zeros);
+}
+
+static inline bool getDelta(const uint8_t*& p, const uint8_t* end, double& value) {
+    uint64_t delta, bits;
+    bool ok = getVarint(p, end, delta);
+    memcpy(&bits, &value, sizeof(bits));
+    if (DELTA_AS_IS == delta) {
+        ok = ok && getVarint(p, end, delta);
+        bits += (uint64_t)unzigzag(delta);
+    } else {
+        bits += (uint64_t)unzigzag(delta >> 6) << (delta & 0x3F);
+    }
+    memcpy(&value, &bits, sizeof(bits));
+    return ok;
+}
+
+static inline bool getDelta(const uint8_t*& p, const uint8_t* end, float& value) {
+    uint64_t delta;
+    uint32_t bits;
+    bool ok = getVarint(p, end, delta);
+    memcpy(&bits, &value, sizeof(bits));
+    bits += (uint32_t)unzigzag(delta >> 5) << (delta & 0x1F);
+    memcpy(&value, &bits, sizeof(bits));
+    return ok;
+}
+
+static void encodeLocation(const Location& location, const Location& prev, std::vector<uint8_t>& out) {
+    putVarint(out, location.flags ^ prev.flags);
+    putVarint(out, zigzag((int64_t)(location.timestamp - prev.timestamp)));
+    putDelta(out, location.latitude, prev.latitude);
+    putDelta(out, location.longitude, prev.longitude);
+    putDelta(out, location.altitude, prev.altitude);
+    putDelta(out, location.speed, prev.speed);
+    putDelta(out, location.bearing, prev.bearing);
+    putDelta(out, location.accuracy, prev.accuracy);
+    putDelta(out, location.verticalAccuracy, prev.verticalAccuracy);
+    putDelta(out, location.speedAccuracy, prev.speedAccuracy);
+    putDelta(out, location.bearingAccuracy, prev.bearingAccuracy);
+    putVarint(out, location.techMask ^ prev.techMask);
+    putVarint(out, location.spoofMask ^ prev.spoofMask);
+}
+
+// location comes in holding the one before it
+static bool decodeLocation(const uint8_t*& p, const uint8_t* end, Location& location) {
+    uint64_t value;
+    bool ok = getVarint(p, end, value);
+    location.flags ^= (LocationFlagsMask)value;
+    ok = ok && getVarint(p, end, value);
+    location.timestamp += (uint64_t)unzigzag(value);
+    ok = ok && getDelta(p, end, location.latitude);
+    ok = ok && getDelta(p, end, location.longitude);
+    ok = ok && getDelta(p, end, location.altitude);
+    ok = ok && getDelta(p, end, location.speed);
+    ok = ok && getDelta(p, end, location.bearing);
+    ok = ok && getDelta(p, end, location.accuracy);
+    ok = ok && getDelta(p, end, location.verticalAccuracy);
+    ok = ok && getDelta(p, end, location.speedAccuracy);
+    ok = ok && getDelta(p, end, location.bearingAccuracy);
+    ok = ok && getVarint(p, end, value);
+    location.techMask ^= (LocationTechnologyMask)value;
+    ok = ok && getVarint(p, end, value);
+    location.spoofMask ^= (LocationSpoofMask)value;
+    location.size = sizeof(Location);
+    return ok;
+}
+
+LocBatchLog::LocBatchLog(const char* path, size_t maxBytes) :
+    mPath(path), mMaxBytes((maxBytes < 4 * GROW_BYTES) ? 4 * GROW_BYTES : maxBytes) {
+    for (int i = PREVIOUS; i <= CURRENT; i++) {
+        mSegments[i].fd = -1;
+        mSegments[i].map = NULL;
+        mSegments[i].mapped = 0;
+        mSegments[i].used = 0;
+    }
+    std::string previous = mPath + ".1";
+    if (0 == access(previous.c_str(), F_OK)) {
+        openSegment(previous.c_str(), mSegments[PREVIOUS]);
+    }
+    if (!openSegment(mPath.c_str(), mSegments[CURRENT])) {
+        LOC_LOGe("can not open %s", mPath.c_str());
+    }
+}
+
+LocBatchLog::~LocBatchLog() {
+    closeSegment(mSegments[PREVIOUS]);
+    closeSegment(mSegments[CURRENT]);
+}
+
+bool LocBatchLog::openSegment(const char* path, Segment& segment) {
+    segment.fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0660);
+    struct stat st;
+    if (segment.fd < 0 || 0 != fstat(segment.fd, &st)) {
+        LOC_LOGe("%s: %s", path, strerror(errno));
+        closeSegment(segment);
+        return false;
+    }
+    size_t size = ALIGN8((size_t)st.st_size);
+    if (!mapSegment(segment, (size < GROW_BYTES) ? GROW_BYTES : size)) {
+        closeSegment(segment);
+        return false;
+    }
+    uint64_t magic;
+    memcpy(&magic, segment.map, sizeof(magic));
+    if (FILE_MAGIC != magic) {
+        memset(segment.map, 0, segment.mapped);
+        magic = FILE_MAGIC;
+        memcpy(segment.map, &magic, sizeof(magic));
+    }
+    recover(segment);
+    return true;
+}
+
+void LocBatchLog::closeSegment(Segment& segment) {
+    if (NULL != segment.map) {
+        munmap(segment.map, segment.mapped);
+    }
+    if (segment.fd >= 0) {
+        close(segment.fd);
+    }
+    segment.fd = -1;
+    segment.map = NULL;
+    segment.mapped = 0;
+    segment.used = 0;
+    segment.chunks.clear();
+}
+
+bool LocBatchLog::mapSegment(Segment& segment, size_t size) {
+    if (NULL != segment.map) {
+        munmap(segment.map, segment.mapped);
+        segment.map = NULL;
+        segment.mapped = 0;
+    }
+    struct stat st;
+    if (0 != fstat(segment.fd, &st) ||
+            ((size_t)st.st_size < size && 0 != ftruncate(segment.fd, size))) {
+        LOC_LOGe("can not size to %zu: %s", size, strerror(errno));
+        return false;
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (MAP_FAILED == map) {
+        LOC_LOGe("mmap of %zu failed: %s", size, strerror(errno));
+        return false;
+    }
+    segment.map = (uint8_t*)map;
+    segment.mapped = size;
+    return true;
+}
+
+// takes every chunk that is whole, up to the first that is not, and clears
+// whatever is after it, so that a chunk appended over it is not mistaken
+// for the remains of one that was not
+void LocBatchLog::recover(Segment& segment) {
+    size_t offset = FILE_HEADER_BYTES;
+    segment.chunks.clear();
+    while (offset + sizeof(LocBatchLogChunkHeader) <= segment.mapped) {
+        LocBatchLogChunkHeader header;
+        memcpy(&header, segment.map + offset, sizeof(header));
+        const uint8_t* payload = segment.map + offset + sizeof(header);
+        if (CHUNK_MAGIC != header.magic ||
+                header.bytes > segment.mapped - offset - sizeof(header) ||
+                header.crc != crcOf(header, payload)) {
+            break;
+        }
+        segment.chunks.push_back({offset, header.count, header.minTime, header.maxTime});
+        offset += sizeof(header) + ALIGN8(header.bytes);
+    }
+    if (offset < segment.mapped) {
+        memset(segment.map + offset, 0, segment.mapped - offset);
+    }
+    segment.used = offset;
+}
+
+bool LocBatchLog::append(const Location* locations, size_t count) {
+    bool ok = isOpen() && NULL != locations;
+    for (size_t i = 0; ok && i < count; i += CHUNK_LOCATIONS) {
+        ok = appendChunk(locations + i,
+                         (count - i < CHUNK_LOCATIONS) ? count - i : CHUNK_LOCATIONS);
+    }
+    return ok;
+}
+
+bool LocBatchLog::appendChunk(const Location* locations, uint32_t count) {
+    LocBatchLogChunkHeader header = {0, 0, count, 0, UINT64_MAX, 0};
+    Location prev;
+    memset(&prev, 0, sizeof(prev));
+    mScratch.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        encodeLocation(locations[i], prev, mScratch);
+        prev = locations[i];
+        if (locations[i].timestamp < header.minTime) {
+            header.minTime = locations[i].timestamp;
+        }
+        if (locations[i].timestamp > header.maxTime) {
+            header.maxTime = locations[i].timestamp;
+        }
+    }
+    header.bytes = mScratch.size();
+    size_t need = sizeof(header) + ALIGN8(header.bytes);
+
+    if (mSegments[CURRENT].used + need > mMaxBytes && !rotate()) {
+        return false;
+    }
+    Segment& segment = mSegments[CURRENT];
+    if (segment.used + need > segment.mapped) {
+        size_t size = segment.mapped * 2;
+        if (size > mMaxBytes) {
+            size = mMaxBytes;
+        }
+        if (size < segment.used + need) {
+            size = ALIGN8(segment.used + need);
+        }
+        if (!mapSegment(segment, size)) {
+            return false;
+        }
+    }
+
+    // all but the magic first, then the magic, which makes it a chunk
+    uint8_t* at = segment.map + segment.used;
+    memcpy(at + sizeof(header), mScratch.data(), header.bytes);
+    header.crc = crcOf(header, at + sizeof(header));
+    memcpy(at, &header, sizeof(header));
+    std::atomic_thread_fence(std::memory_order_release);
+    ((volatile LocBatchLogChunkHeader*)at)->magic = CHUNK_MAGIC;
+
+    segment.chunks.push_back({segment.used, count, header.minTime, header.maxTime});
+    segment.used += need;
+    return true;
+}
+
+// the current file, still open and mapped, becomes the previous one under
+// its new name
+bool LocBatchLog::rotate() {
+    std::string previous = mPath + ".1";
+    if (0 != rename(mPath.c_str(), previous.c_str())) {
+        LOC_LOGe("rename to %s: %s", previous.c_str(), strerror(errno));
+        return false;
+    }
+    closeSegment(mSegments[PREVIOUS]);
+    mSegments[PREVIOUS] = mSegments[CURRENT];
+    mSegments[CURRENT].fd = -1;
+    mSegments[CURRENT].map = NULL;
+    mSegments[CURRENT].chunks.clear();
+    return openSegment(mPath.c_str(), mSegments[CURRENT]);
+}
+
+size_t LocBatchLog::decode(const Segment& segment, const Chunk& chunk, uint64_t from, uint64_t to,
+                           size_t skip, size_t max, std::vector<Location>& locations) {
+    LocBatchLogChunkHeader header;
+    memcpy(&header, segment.map + chunk.offset, sizeof(header));
+    const uint8_t* p = segment.map + chunk.offset + sizeof(header);
+    const uint8_t* end = p + header.bytes;
+    Location location;
+    memset(&location, 0, sizeof(location));
+    size_t added = 0;
+    for (uint32_t i = 0; i < chunk.count && added < max; i++) {
+        if (!decodeLocation(p, end, location)) {
+            LOC_LOGe("chunk at %zu does not decode", chunk.offset);
+            break;
+        }
+        if (i >= skip && location.timestamp >= from && location.timestamp <= to) {
+            locations.push_back(location);
+            added++;
+        }
+    }
+    return added;
+}
+
+size_t LocBatchLog::read(uint64_t from, uint64_t to, std::vector<Location>& locations,
+                         size_t max) const {
+    size_t added = 0;
+    for (int i = PREVIOUS; i <= CURRENT && added < max; i++) {
+        const Segment& segment = mSegments[i];
+        for (size_t k = 0; k < segment.chunks.size() && added < max; k++) {
+            const Chunk& chunk = segment.chunks[k];
+            if (chunk.maxTime >= from && chunk.minTime <= to) {
+                added += decode(segment, chunk, from, to, 0, max - added, locations);
+            }
+        }
+    }
+    return added;
+}
+
+size_t LocBatchLog::readLast(size_t count, std::vector<Location>& locations) const {
+    // find the chunk the last *count* start in, going backwards
+    int i = CURRENT;
+    size_t k = mSegments[CURRENT].chunks.size();
+    size_t found = 0;
+    while (found < count) {
+        if (k > 0) {
+            found += mSegments[i].chunks[--k].count;
+        } else if (PREVIOUS == i) {
+            break;
+        } else {
+            i = PREVIOUS;
+            k = mSegments[PREVIOUS].chunks.size();
+        }
+    }
+
+    size_t skip = (found > count) ? found - count : 0;
+    size_t added = 0;
+    for (; i <= CURRENT; i++, k = 0) {
+        const Segment& segment = mSegments[i];
+        for (; k < segment.chunks.size(); k++) {
+            added += decode(segment, segment.chunks[k], 0, UINT64_MAX, skip, SIZE_MAX, locations);
+            skip = 0;
+        }
+    }
+    return added;
+}
+
+size_t LocBatchLog::count() const {
+    size_t count = 0;
+    for (int i = PREVIOUS; i <= CURRENT; i++) {
+        for (const Chunk& chunk : mSegments[i].chunks) {
+            count += chunk.count;
+        }
+    }
+    return count;
+}
+
+size_t LocBatchLog::bytes() const {
+    return mSegments[PREVIOUS].used + mSegments[CURRENT].used;
+}
+
+} // namespace loc_util
+
+#ifdef __LOC_DEBUG__
+
+#include <stdlib.h>
+#include <time.h>
+#include <math.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+using namespace loc_util;
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+// a drive at 1 Hz, the same for the same seed; altitude comes from the
+// modem as a float
+static std::vector<Location> debugTrack(size_t count, unsigned seed) {
+    std::vector<Location> track(count);
+    double lat = 37.4, lon = -122.1, alt = 30, heading = 0, speed = 12;
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        heading += ((double)(seed >> 16 & 0x7FFF) / 0x7FFF - 0.5) * 0.2;
+        speed = fmax(0, speed + ((double)(seed & 0xFF) / 0xFF - 0.5));
+        lat += speed * cos(heading) / 6371008.8 * 180 / M_PI;
+        lon += speed * sin(heading) / 6371008.8 * 180 / M_PI / cos(lat * M_PI / 180);
+        alt += ((double)(seed >> 8 & 0xFF) / 0xFF - 0.5) * 0.5;
+        Location& location = track[i];
+        memset(&location, 0, sizeof(location));
+        location.size = sizeof(Location);
+        location.flags = (i % 10) ? 0x3F : 0x7F;
+        location.timestamp = 1600000000000ULL + i * 1000;
+        location.latitude = lat;
+        location.longitude = lon;
+        location.altitude = (float)alt;
+        location.speed = (float)speed;
+        location.bearing = (float)fmod(heading * 180 / M_PI + 720, 360);
+        location.accuracy = 3 + (float)(i % 7);
+        location.verticalAccuracy = 5;
+        location.speedAccuracy = 0.5f;
+        location.bearingAccuracy = 10;
+        location.techMask = 1;
+    }
+    return track;
+}
+
+static bool sameLocations(const Location* a, const Location* b, size_t count) {
+    return 0 == memcmp(a, b, count * sizeof(Location));
+}
+
+// appends the track in batches of 1 to 600 until killed
+static void debugAppender(const char* path, const std::vector<Location>& track) {
+    LocBatchLog log(path, 64 * 1024 * 1024);
+    for (size_t i = 0; i < track.size();) {
+        size_t count = 1 + rand() % 600;
+        count = (count > track.size() - i) ? track.size() - i : count;
+        log.append(&track[i], count);
+        i += count;
+    }
+    pause();
+}
+
+// For Linux command line testing:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../location -I../pla/oe LocBatchLog.cpp,
+//     link with libgps_utils
+// test: ./a.out /tmp/batch.log 100000
+// Logs a synthetic drive of *count* fixes and reads it back, whole, by time
+// ranges and after reopening; drops a chunk that got corrupted; kills a
+// process in the middle of appending, which has to leave a whole prefix of
+// what it appended; rotates a small log; and reports the compression ratio
+// and append / read rates.
+int main(int argc, char** argv) {
+    const char* path = (argc > 1) ? argv[1] : "/tmp/batch.log";
+    size_t count = (argc > 2) ? atoi(argv[2]) : 100000;
+    std::string previous = std::string(path) + ".1";
+    std::vector<Location> track = debugTrack(count, 1);
+    std::vector<Location> out;
+    srand(time(NULL));
+    int failed = 0;
+
+    unlink(path);
+    unlink(previous.c_str());
+    LocBatchLog* log = new LocBatchLog(path, 64 * 1024 * 1024);
+    double t0 = getSeconds();
+    for (size_t i = 0; i < count; i += 500) {
+        log->append(&track[i], (count - i < 500) ? count - i : 500);
+    }
+    double t1 = getSeconds();
+    log->readLast(count, out);
+    double t2 = getSeconds();
+    bool whole = (out.size() == count && sameLocations(out.data(), track.data(), count));
+    printf("%zu fixes: %zu bytes, %.2f bytes per fix, %.1fx smaller than Location\n",
+           count, log->bytes(), (double)log->bytes() / count,
+           (double)count * sizeof(Location) / log->bytes());
+    printf("append %.1f M fixes/s, read %.1f M fixes/s\n",
+           count / (t1 - t0) / 1000000, count / (t2 - t1) / 1000000);
+    printf("read back whole: %s\n", whole ? "PASS" : "FAIL");
+    failed += !whole;
+
+    bool ranges = true;
+    for (int r = 0; r < 1000 && ranges; r++) {
+        size_t from = rand() % count, to = from + rand() % 2000;
+        to = (to >= count) ? count - 1 : to;
+        out.clear();
+        log->read(track[from].timestamp, track[to].timestamp, out);
+        ranges = (out.size() == to - from + 1 &&
+                  sameLocations(out.data(), &track[from], out.size()));
+    }
+    printf("time ranges: %s\n", ranges ? "PASS" : "FAIL");
+    failed += !ranges;
+
+    delete log;
+    log = new LocBatchLog(path, 64 * 1024 * 1024);
+    out.clear();
+    log->readLast(count, out);
+    bool reopened = (out.size() == count && sameLocations(out.data(), track.data(), count));
+    printf("reopened: %s\n", reopened ? "PASS" : "FAIL");
+    failed += !reopened;
+
+    // flip a byte in the last chunk's locations, it has to go, and only it
+    size_t before = log->count();
+    size_t bytes = log->bytes();
+    delete log;
+    int fd = open(path, O_RDWR);
+    uint8_t byte;
+    pread(fd, &byte, 1, bytes - 9);
+    byte ^= 0x5A;
+    pwrite(fd, &byte, 1, bytes - 9);
+    close(fd);
+    log = new LocBatchLog(path, 64 * 1024 * 1024);
+    size_t lastChunk = (0 == count % 500) ? 500 : count % 500;
+    lastChunk = (0 == lastChunk % LocBatchLog::CHUNK_LOCATIONS) ?
+            LocBatchLog::CHUNK_LOCATIONS : lastChunk % LocBatchLog::CHUNK_LOCATIONS;
+    bool dropped = (log->count() == before - lastChunk);
+    log->append(&track[count - lastChunk], lastChunk);
+    delete log;
+    log = new LocBatchLog(path, 64 * 1024 * 1024);
+    out.clear();
+    log->readLast(count, out);
+    dropped = dropped && out.size() == count && sameLocations(out.data(), track.data(), count);
+    printf("corrupted chunk dropped: %s\n", dropped ? "PASS" : "FAIL");
+    failed += !dropped;
+    delete log;
+
+    int torn = 0, partial = 0;
+    for (int r = 0; r < 20; r++) {
+        unlink(path);
+        pid_t pid = fork();
+        if (0 == pid) {
+            debugAppender(path, track);
+            _exit(0);
+        }
+        usleep(1000 + rand() % 30000);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        log = new LocBatchLog(path, 64 * 1024 * 1024);
+        out.clear();
+        log->readLast(count, out);
+        if (!sameLocations(out.data(), track.data(), out.size())) {
+            torn++;
+        }
+        partial += (out.size() < count);
+        delete log;
+    }
+    printf("killed while appending: %d of 20 cut short, %d not a prefix: %s\n",
+           partial, torn, torn ? "FAIL" : "PASS");
+    failed += (0 != torn);
+
+    unlink(path);
+    log = new LocBatchLog(path, 256 * 1024);
+    for (size_t i = 0; i < count; i += 100) {
+        log->append(&track[i], (count - i < 100) ? count - i : 100);
+    }
+    size_t kept = log->count();
+    out.clear();
+    log->readLast(kept, out);
+    bool rotated = (0 == access(previous.c_str(), F_OK) && kept <= count &&
+                    log->bytes() <= 2 * 256 * 1024 && out.size() == kept &&
+                    sameLocations(out.data(), &track[count - kept], kept));
+    printf("rotated, kept the last %zu in %zu bytes: %s\n", kept, log->bytes(),
+           rotated ? "PASS" : "FAIL");
+    failed += !rotated;
+    delete log;
+
+    unlink(path);
+    unlink(previous.c_str());
+    return failed;
+}
+
+#endif
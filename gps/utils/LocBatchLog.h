@@ -0,0 +1,106 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_BATCH_LOG_H__
+#define __LOC_BATCH_LOG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <LocationDataTypes.h>
+
+namespace loc_util {
+
+// An append only log of batched locations, in a memory mapped file that
+// outlives modem restarts and the process itself.
+// Locations go in chunks of up to CHUNK_LOCATIONS. Each is encoded as varints
+// of its fields' differences from the location before it, bit exact, with the
+// first one of a chunk taken against all zeros so that every chunk decodes on
+// its own. A chunk header carries its count, time span and a CRC, and is
+// written last, its magic after everything else; so a chunk cut short by a
+// crash is found out and dropped when the log is opened again.
+// Reads are served by chunk time spans kept in memory, decoding only the
+// chunks that overlap what is asked for.
+// Once the file reaches *maxBytes* it is renamed to *path*.1, replacing the
+// one before, and a new one started; reads go over both.
+// Not thread safe, it belongs to the thread of the adapter that keeps it.
+class LocBatchLog {
+public:
+    static const uint32_t CHUNK_LOCATIONS = 256;
+
+    LocBatchLog(const char* path, size_t maxBytes);
+    ~LocBatchLog();
+    inline bool isOpen() const { return NULL != mSegments[CURRENT].map; }
+
+    bool append(const Location* locations, size_t count);
+    // appends to *locations* the logged ones with timestamps in [from, to],
+    // oldest first, up to *max* of them; returns how many
+    size_t read(uint64_t from, uint64_t to, std::vector<Location>& locations,
+                size_t max = SIZE_MAX) const;
+    // appends to *locations* the last *count* logged, oldest first
+    size_t readLast(size_t count, std::vector<Location>& locations) const;
+
+    size_t count() const;
+    // bytes used in both files, headers included
+    size_t bytes() const;
+
+private:
+    struct Chunk {
+        size_t offset;
+        uint32_t count;
+        uint64_t minTime;
+        uint64_t maxTime;
+    };
+    struct Segment {
+        int fd;
+        uint8_t* map;
+        size_t mapped;
+        size_t used;
+        std::vector<Chunk> chunks;
+    };
+    enum { PREVIOUS = 0, CURRENT = 1 };
+
+    std::string mPath;
+    size_t mMaxBytes;
+    Segment mSegments[2];
+    std::vector<uint8_t> mScratch;
+
+    static bool openSegment(const char* path, Segment& segment);
+    static void closeSegment(Segment& segment);
+    static bool mapSegment(Segment& segment, size_t size);
+    static void recover(Segment& segment);
+    static size_t decode(const Segment& segment, const Chunk& chunk, uint64_t from, uint64_t to,
+                         size_t skip, size_t max, std::vector<Location>& locations);
+    bool appendChunk(const Location* locations, uint32_t count);
+    bool rotate();
+};
+
+} // namespace loc_util
+
+#endif // __LOC_BATCH_LOG_H__
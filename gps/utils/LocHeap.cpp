@@ -26,252 +26,115 @@
  * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *
  */
+#include <stdlib.h>
 #include <LocHeap.h>
 
-class LocHeapNode {
-    friend class LocHeap;
-
-    // size of of the subtree, excluding self, 1 if no subtree
-    int mSize;
-    LocHeapNode* mLeft;
-    LocHeapNode* mRight;
-    LocRankable* mData;
-public:
-    inline LocHeapNode(LocRankable& data) :
-        mSize(1), mLeft(NULL), mRight(NULL), mData(&data) {}
-    ~LocHeapNode();
-
-    // this only swaps the data of the two nodes, so no
-    // detach / re-attached is necessary
-    void swap(LocHeapNode& node);
-
-    LocRankable* detachData();
-
-    // push a node into the tree stucture, keeping sorted by rank
-    void push(LocHeapNode& node);
-
-    // pop the head node out of the tree stucture. keeping sorted by rank
-    static LocHeapNode* pop(LocHeapNode*& top);
-
-    // remove a specific node from the tree
-    // returns the pointer to the node removed, which would be either the
-    //         same as input (if successfully removed); or NULL (if failed).
-    static LocHeapNode* remove(LocHeapNode*& top, LocRankable& data);
-
-    // convenience method to compare data ranking
-    inline bool outRanks(LocHeapNode& node) { return mData->outRanks(*node.mData); }
-    inline bool outRanks(LocRankable& data) { return mData->outRanks(data); }
-
-    // checks if mSize is correct, AND this node is the highest ranking
-    // of the entire subtree
-    bool checkNodes();
-
-    inline int getSize() { return mSize; }
-};
-
-inline
-LocHeapNode::~LocHeapNode() {
-    if (mLeft) {
-        delete mLeft;
-        mLeft = NULL;
-    }
-    if (mRight) {
-        delete mRight;
-        mRight = NULL;
-    }
-    if (mData) {
-        mData = NULL;
-    }
-}
-
-inline
-void LocHeapNode::swap(LocHeapNode& node) {
-    LocRankable* tmpData = node.mData;
-    node.mData = mData;
-    mData = tmpData;
-}
-
-inline
-LocRankable* LocHeapNode::detachData()  {
-    LocRankable* data = mData;
-    mData = NULL;
-    return data;
-}
-
-// push keeps the tree sorted by rank, it also tries to balance the
-// tree by adding the new node to the smaller of the subtrees.
-// The pointer to the tree and internal links never change. If the
-// mData of tree top ranks lower than that of the incoming node,
-// mData will be swapped with that of the incoming node to ensure
-// ranking, no restructuring the container nodes.
-void LocHeapNode::push(LocHeapNode& node) {
-    // ensure the current node ranks higher than in the incoming one
-    if (node.outRanks(*this)) {
-        swap(node);
-    }
-
-    // now drop the new node (ensured lower than *this) into a subtree
-    if (NULL == mLeft) {
-        mLeft = &node;
-    } else if (NULL == mRight) {
-        mRight = &node;
-    } else if (mLeft->mSize <= mRight->mSize) {
-        mLeft->push(node);
-    } else {
-        mRight->push(node);
+LocHeap::~LocHeap() {
+    // the objs are managed by the client, just let go of them
+    for (uint32_t i = 0; i < mSize; i++) {
+        mArray[i]->mHeapIndex = -1;
     }
-    mSize++;
+    free(mArray);
 }
 
-// pop keeps the tree sorted by rank, but it does not try to balance
-// the tree. It recursively swaps with the higher ranked top of the
-// subtrees.
-// The return is a popped out node from leaf level, that has the data
-// swapped all the way down from the top. The pinter to the tree and
-// internal links will not be changed or restructured, except for the
-// node that is popped out.
-// If the return pointer == this, this the last node in the tree.
-LocHeapNode* LocHeapNode::pop(LocHeapNode*& top) {
-    // we know the top has the highest ranking at this point, else
-    // the tree is broken. This top will be popped out.  But we need
-    // a node from the left or right child, whichever ranks higher,
-    // to replace the current top. This then will need to be done
-    // recursively to the leaf level. So we swap the mData of the
-    // current top node all the way down to the leaf level.
-    LocHeapNode* poppedNode = top;
-    // top is losing a node in its subtree
-    top->mSize--;
-    if (top->mLeft || top->mRight) {
-        // if mLeft is NULL, mRight for sure is NOT NULL, take that;
-        // else if mRight is NULL, mLeft for sure is NOT, take that;
-        // else we take the address of whatever has higher ranking mData
-        LocHeapNode*& subTop = (NULL == top->mLeft) ? top->mRight :
-            ((NULL == top->mRight) ? top->mLeft :
-             (top->mLeft->outRanks(*(top->mRight)) ? top->mLeft : top->mRight));
-        // swap mData, the tree top gets updated with the new data.
-        top->swap(*subTop);
-        // pop out from the subtree
-        poppedNode = pop(subTop);
-    } else {
-        // if the top has only single node
-        // detach the poppedNode from the tree
-        // subTop is the reference of ether mLeft or mRight
-        // NOT a local stack pointer. so it MUST be NULL'ed here.
-        top = NULL;
-    }
-
-    return poppedNode;
-}
-
-// navigating through the tree and find the node that hass the input
-// data. Since this is a heap, we do recursive linear search.
-// returns the pointer to the node removed, which would be either the
-//         same as input (if successfully removed); or NULL (if failed).
-LocHeapNode* LocHeapNode::remove(LocHeapNode*& top, LocRankable& data) {
-    LocHeapNode* removedNode = NULL;
-    // this is the node, by address
-    if (&data == (LocRankable*)(top->mData)) {
-        // pop this node out
-        removedNode = pop(top);
-    } else if (!data.outRanks(*top->mData)) {
-        // subtrees might have this node
-        if (top->mLeft) {
-            removedNode = remove(top->mLeft, data);
-        }
-        // if we did not find in mLeft, and mRight is not empty
-        if (!removedNode && top->mRight) {
-            removedNode = remove(top->mRight, data);
-        }
-
-        // top lost a node in its subtree
-        if (removedNode) {
-            top->mSize--;
+// moves the node at index up, until its parent outranks or equally ranks it
+void LocHeap::siftUp(uint32_t index) {
+    LocRankable* node = mArray[index];
+    while (index > 0) {
+        uint32_t parent = (index - 1) / ARITY;
+        if (!node->outRanks(*mArray[parent])) {
+            break;
         }
+        place(*mArray[parent], index);
+        index = parent;
     }
-
-    return removedNode;
+    place(*node, index);
 }
 
-// checks if mSize is correct, AND this node is the highest ranking
-// of the entire subtree
-bool LocHeapNode::checkNodes() {
-    // size of the current subtree
-    int totalSize = mSize;
-    if (mLeft) {
-        // check the consistency of left subtree
-        if (mLeft->outRanks(*this) || !mLeft->checkNodes()) {
-            return false;
+// moves the node at index down, swapping with the highest ranking child,
+// until no child outranks it
+void LocHeap::siftDown(uint32_t index) {
+    LocRankable* node = mArray[index];
+    for (uint32_t first = index * ARITY + 1; first < mSize; first = index * ARITY + 1) {
+        uint32_t last = (first + ARITY < mSize) ? first + ARITY : mSize;
+        uint32_t top = first;
+        for (uint32_t child = first + 1; child < last; child++) {
+            if (mArray[child]->outRanks(*mArray[top])) {
+                top = child;
+            }
         }
-        // subtract the size of left subtree (with subtree head)
-        totalSize -= mLeft->mSize;
-    }
-
-    if (mRight) {
-        // check the consistency of right subtree
-        if (mRight->outRanks(*this) || !mRight->checkNodes()) {
-            return false;
+        if (!mArray[top]->outRanks(*node)) {
+            break;
         }
-        // subtract the size of right subtree (with subtree head)
-        totalSize -= mRight->mSize;
+        place(*mArray[top], index);
+        index = top;
     }
-
-    // for the tree nodes to consistent, totalSize must be 1 now
-    return totalSize == 1;
+    place(*node, index);
 }
 
-LocHeap::~LocHeap() {
-    if (mTree) {
-        delete mTree;
+// fills the hole at index with the last node, and then restores the order
+// from there; the last node goes up if it outranks its new parent, else down
+LocRankable* LocHeap::removeAt(uint32_t index) {
+    LocRankable* node = mArray[index];
+    node->mHeapIndex = -1;
+    mSize--;
+    if (index < mSize) {
+        place(*mArray[mSize], index);
+        if (index > 0 && mArray[index]->outRanks(*mArray[(index - 1) / ARITY])) {
+            siftUp(index);
+        } else {
+            siftDown(index);
+        }
     }
+    mArray[mSize] = NULL;
+    return node;
 }
 
-void LocHeap::push(LocRankable& node) {
-    LocHeapNode* heapNode = new LocHeapNode(node);
-    if (!mTree) {
-        mTree = heapNode;
-    } else {
-        mTree->push(*heapNode);
+bool LocHeap::push(LocRankable& node) {
+    if (node.isInHeap()) {
+        return false;
     }
-}
-
-LocRankable* LocHeap::peek() {
-    LocRankable* top = NULL;
-    if (mTree) {
-        top = mTree->mData;
+    if (mSize == mCapacity) {
+        uint32_t capacity = mCapacity ? mCapacity * 2 : MIN_CAPACITY;
+        LocRankable** array = (LocRankable**)realloc(mArray, capacity * sizeof(LocRankable*));
+        if (NULL == array) {
+            return false;
+        }
+        mArray = array;
+        mCapacity = capacity;
     }
-    return top;
+    place(node, mSize++);
+    siftUp(mSize - 1);
+    return true;
 }
 
 LocRankable* LocHeap::pop() {
-    LocRankable* locNode = NULL;
-    if (mTree) {
-        // mTree may become NULL after this call
-        LocHeapNode* heapNode = LocHeapNode::pop(mTree);
-        locNode = heapNode->detachData();
-        delete heapNode;
-    }
-    return locNode;
+    return mSize ? removeAt(0) : NULL;
 }
 
 LocRankable* LocHeap::remove(LocRankable& rankable) {
     LocRankable* locNode = NULL;
-    if (mTree) {
-        // mTree may become NULL after this call
-        LocHeapNode* heapNode = LocHeapNode::remove(mTree, rankable);
-        if (heapNode) {
-            locNode = heapNode->detachData();
-            delete heapNode;
-        }
+    int index = rankable.mHeapIndex;
+    // the handle might be that of another heap
+    if (index >= 0 && (uint32_t)index < mSize && mArray[index] == &rankable) {
+        locNode = removeAt(index);
     }
     return locNode;
 }
 
-#ifdef __LOC_UNIT_TEST__
+#if defined(__LOC_UNIT_TEST__) || defined(__LOC_DEBUG__)
+// checks that no node outranks its parent, AND every node knows its index
 bool LocHeap::checkTree() {
-    return ((NULL == mTree) || mTree->checkNodes());
+    for (uint32_t i = 0; i < mSize; i++) {
+        if (mArray[i]->mHeapIndex != (int)i ||
+            (i > 0 && mArray[i]->outRanks(*mArray[(i - 1) / ARITY]))) {
+            return false;
+        }
+    }
+    return true;
 }
 uint32_t LocHeap::getTreeSize() {
-    return (NULL == mTree) ? 0 : mTree->getSize();
+    return mSize;
 }
 #endif
 
@@ -281,17 +144,6 @@ uint32_t LocHeap::getTreeSize() {
 #include <stdlib.h>
 #include <time.h>
 
-class LocHeapDebug : public LocHeap {
-public:
-    bool checkTree() {
-        return ((NULL == mTree) || mTree->checkNodes());
-    }
-
-    uint32_t getTreeSize() {
-        return (NULL == mTree) ? 0 : (mTree->getSize());
-    }
-};
-
 class LocHeapDebugData : public LocRankable {
     const int mID;
 public:
@@ -300,16 +152,59 @@ public:
         LocHeapDebugData* testData = dynamic_cast<LocHeapDebugData*>(&rankable);
         return testData->mID - mID;
     }
+    inline int getID() { return mID; }
 };
 
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+// push / remove / pop throughput, with every other node removed by handle
+static void benchmark(int count) {
+    LocHeapDebugData** data = new LocHeapDebugData*[count];
+    for (int i = 0; i < count; i++) {
+        data[i] = new LocHeapDebugData(rand());
+    }
+    LocHeap heap;
+
+    double t0 = getSeconds();
+    for (int i = 0; i < count; i++) {
+        heap.push(*data[i]);
+    }
+    double t1 = getSeconds();
+    for (int i = 0; i < count; i += 2) {
+        heap.remove(*data[i]);
+    }
+    double t2 = getSeconds();
+    while (heap.pop()) {}
+    double t3 = getSeconds();
+
+    printf("%d nodes: push %.4f s, remove %.4f s, pop %.4f s\n",
+           count, t1 - t0, t2 - t1, t3 - t2);
+    for (int i = 0; i < count; i++) {
+        delete data[i];
+    }
+    delete[] data;
+}
+
 // For Linux command line testing:
-// compilation: g++ -D__LOC_HOST_DEBUG__ -D__LOC_DEBUG__ -g -I. -I../../../../vendor/qcom/proprietary/gps-internal/unit-tests/fakes_for_host -I../../../../system/core/include LocHeap.cpp
+// compilation: g++ -D__LOC_DEBUG__ -g -I. LocHeap.cpp
 // test: valgrind --leak-check=full ./a.out 100
+// benchmark: ./a.out 100000 bench
 int main(int argc, char** argv) {
     srand(time(NULL));
     int tries = atoi(argv[1]);
-    int checks = tries >> 3;
-    LocHeapDebug heap;
+    if (argc > 2) {
+        benchmark(tries);
+        return 0;
+    }
+
+    int checks = (tries >> 3) ? (tries >> 3) : 1;
+    LocHeap heap;
+    // nodes currently in the heap, for random removal
+    LocHeapDebugData** nodes = new LocHeapDebugData*[tries];
     int treeSize = 0;
 
     for (int i = 0; i < tries; i++) {
@@ -317,21 +212,45 @@ int main(int argc, char** argv) {
             printf("tree check failed before %dth op\n", i);
         }
         int r = rand();
+        const char* op = "push";
 
-        if (r & 1) {
-            LocHeapDebugData* data = new LocHeapDebugData(r >> 1);
-            heap.push(dynamic_cast<LocRankable&>(*data));
-            treeSize++;
-        } else {
-            LocRankable* rankable = heap.pop();
-            if (rankable) {
-                delete rankable;
+        if (r % 3 == 0) {
+            LocHeapDebugData* data = new LocHeapDebugData(r >> 2);
+            // a node can be pushed only once
+            if (!heap.push(*data) || heap.push(*data)) {
+                printf("!!!!!!!!!!push of %d failed!!!!!!!\n", data->getID());
+            }
+            nodes[treeSize++] = data;
+        } else if (r % 3 == 1) {
+            op = "pop";
+            LocHeapDebugData* data = (LocHeapDebugData*)heap.pop();
+            if (data) {
+                // nothing left in the heap may outrank the popped node
+                if (heap.peek() && heap.peek()->outRanks(*data)) {
+                    printf("!!!!!!!!!!popped %d out of order!!!!!!!\n", data->getID());
+                }
+                for (int j = 0; j < treeSize; j++) {
+                    if (nodes[j] == data) {
+                        nodes[j] = nodes[--treeSize];
+                        break;
+                    }
+                }
+                delete data;
+            }
+        } else if (treeSize) {
+            op = "remove";
+            int j = (r >> 2) % treeSize;
+            LocHeapDebugData* data = nodes[j];
+            if ((LocRankable*)data != heap.remove(*data) || data->isInHeap() ||
+                NULL != heap.remove(*data)) {
+                printf("!!!!!!!!!!remove of %d failed!!!!!!!\n", data->getID());
             }
-            treeSize ? treeSize-- : 0;
+            nodes[j] = nodes[--treeSize];
+            delete data;
         }
 
-        printf("%s: %d == %d\n", (r&1)?"push":"pop", treeSize, heap.getTreeSize());
-        if (treeSize != heap.getTreeSize()) {
+        printf("%s: %d == %d\n", op, treeSize, heap.getTreeSize());
+        if (treeSize != (int)heap.getTreeSize()) {
             printf("!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!\n");
             tries = i+1;
             break;
@@ -347,6 +266,7 @@ int main(int argc, char** argv) {
     for (LocRankable* data = heap.pop(); NULL != data; data = heap.pop()) {
         delete data;
     }
+    delete[] nodes;
 
     return 0;
 }
@@ -30,11 +30,19 @@
 #define __LOC_HEAP__
 
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 // abstract class to be implemented by client to provide a rankable class
 class LocRankable {
+    friend class LocHeap;
+    // index of this obj in the array of the LocHeap it is in, -1 if none.
+    // This is the handle that makes LocHeap::remove() O(log n).
+    int mHeapIndex;
 public:
+    inline LocRankable() : mHeapIndex(-1) {}
+    inline LocRankable(const LocRankable&) : mHeapIndex(-1) {}
+    inline LocRankable& operator=(const LocRankable&) { return *this; }
     virtual inline ~LocRankable() {}
 
     // method to rank objects of such type for sorting purposes.
@@ -46,48 +54,61 @@ public:
 
     // convenient method to rank objects of such type for sorting purposes.
     inline bool outRanks(LocRankable& rankable) { return ranks(rankable) > 0; }
-};
 
-// opaque class to provide service implementation.
-class LocHeapNode;
+    // true if the obj is currently in a heap
+    inline bool isInHeap() { return mHeapIndex >= 0; }
+};
 
-// a heap whose left and right children are not sorted. It is sorted only vertically,
-// i.e. parent always ranks higher than children, if they exist. Ranking algorithm is
-// implemented in Rankable. The reason that there is no sort between children is to
-// help beter balance the tree with lower cost. When a node is pushed to the tree,
-// it is guaranteed that the subtree that is smaller gets to have the new node.
+// a d-ary heap, kept in a contiguous array of pointers to the client objs.
+// Parent always ranks higher than or equal to its children, children are not
+// sorted among themselves. Ranking algorithm is implemented in Rankable. Each
+// obj remembers its own index in the array, so that it can be removed without
+// searching the heap. An obj can be in only one heap at a time.
 class LocHeap {
-protected:
-    LocHeapNode* mTree;
+    static const uint32_t ARITY = 4;
+    static const uint32_t MIN_CAPACITY = 8;
+
+    LocRankable** mArray;
+    uint32_t mSize;
+    uint32_t mCapacity;
+
+    inline void place(LocRankable& node, uint32_t index) {
+        mArray[index] = &node;
+        node.mHeapIndex = index;
+    }
+    void siftUp(uint32_t index);
+    void siftDown(uint32_t index);
+    LocRankable* removeAt(uint32_t index);
 public:
-    inline LocHeap() : mTree(NULL) {}
+    inline LocHeap() : mArray(NULL), mSize(0), mCapacity(0) {}
     ~LocHeap();
 
-    // push keeps the tree sorted by rank, it also tries to balance the
-    // tree by adding the new node to the smaller of the subtrees.
+    // push keeps the heap sorted by rank.
     // node is reference to an obj that is managed by client, that client
     //      creates and destroyes. The destroy should happen after the
     //      node is popped out from the heap.
-    void push(LocRankable& node);
+    // Returns false if the node could not be added, i.e. it is in a heap
+    //         already, or the array could not grow to hold it.
+    bool push(LocRankable& node);
 
-    // Peeks the node data on tree top, which has currently the highest ranking
-    // There is no change the tree structure with this operation
-    // Returns NULL if the tree is empty, otherwise pointer to the node data of
-    //         the tree top.
-    LocRankable* peek();
+    // Peeks the node data on heap top, which has currently the highest ranking
+    // There is no change the heap structure with this operation
+    // Returns NULL if the heap is empty, otherwise pointer to the node data of
+    //         the heap top.
+    inline LocRankable* peek() { return mSize ? mArray[0] : NULL; }
 
-    // pop keeps the tree sorted by rank, but it does not try to balance
-    // the tree.
+    // pop keeps the heap sorted by rank.
     // Return - pointer to the node popped out, or NULL if heap is already empty
     LocRankable* pop();
 
-    // navigating through the tree and find the node that ranks the same
-    // as the input data, then remove it from the tree. Rank is implemented
-    // by rankable obj.
-    // returns the pointer to the node removed; or NULL (if failed).
+    // removes the input obj from the heap, in O(log n) time.
+    // returns the pointer to the node removed; or NULL (if it is not in
+    //         this heap).
     LocRankable* remove(LocRankable& rankable);
 
-#ifdef __LOC_UNIT_TEST__
+    inline uint32_t getSize() { return mSize; }
+
+#if defined(__LOC_UNIT_TEST__) || defined(__LOC_DEBUG__)
     bool checkTree();
     uint32_t getTreeSize();
 #endif
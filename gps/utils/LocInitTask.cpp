@@ -0,0 +1,265 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_TAG "LocSvc_InitTask"
+
+#include <LocInitTask.h>
+#include <LocStartupTrace.h>
+#include <log_util.h>
+
+namespace loc_util {
+
+LocInitTask::LocInitTask(const char* name, Runnable run) :
+    mName(name), mRun(run), mState(IDLE), mResult(NULL) {
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mCond, NULL);
+}
+
+LocInitTask::~LocInitTask() {
+    pthread_mutex_lock(&mMutex);
+    while (RUNNING == mState) {
+        pthread_cond_wait(&mCond, &mMutex);
+    }
+    pthread_mutex_unlock(&mMutex);
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void LocInitTask::run(const Done& done) {
+    void* result = NULL;
+    {
+        LocStartupPhase phase(mName);
+        result = mRun();
+    }
+    if (nullptr != done) {
+        done();
+    }
+    pthread_mutex_lock(&mMutex);
+    mResult = result;
+    mState = DONE;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void* LocInitTask::threadMain(void* arg) {
+    LocInitTask* task = (LocInitTask*)arg;
+    task->run(task->mDone);
+    return NULL;
+}
+
+bool LocInitTask::start(Done done) {
+    pthread_mutex_lock(&mMutex);
+    bool idle = (IDLE == mState);
+    if (idle) {
+        mState = RUNNING;
+        mDone = done;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    bool started = false;
+    if (idle) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        int result = pthread_create(&thread, &attr, threadMain, this);
+        pthread_attr_destroy(&attr);
+        if (0 == result) {
+            started = true;
+        } else {
+            // left to the first get()
+            LOC_LOGw("%s: pthread_create failed %d", mName, result);
+            pthread_mutex_lock(&mMutex);
+            mState = IDLE;
+            pthread_mutex_unlock(&mMutex);
+        }
+    }
+    return started;
+}
+
+void* LocInitTask::get() {
+    pthread_mutex_lock(&mMutex);
+    if (IDLE == mState) {
+        mState = RUNNING;
+        pthread_mutex_unlock(&mMutex);
+        run(nullptr);
+        pthread_mutex_lock(&mMutex);
+    }
+    while (RUNNING == mState) {
+        pthread_cond_wait(&mCond, &mMutex);
+    }
+    void* result = mResult;
+    pthread_mutex_unlock(&mMutex);
+    return result;
+}
+
+} // namespace loc_util
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <vector>
+#include <loc_cfg.h>
+
+using namespace loc_util;
+
+struct LocInitDebug {
+    bool scheduled;
+    std::vector<const char*> contextLibs;
+    std::vector<LocInitTask*> adapterLibs;
+    LocInitTask* confTask;
+    int openMs;
+};
+
+static void* debugDlopen(const char* lib) {
+    void* handle = dlopen(lib, RTLD_NOW);
+    if (NULL == handle) {
+        printf("dlopen %s failed: %s\n", lib, dlerror());
+    }
+    return handle;
+}
+
+// the LocApi connecting to the modem, on a thread of its own
+static void* debugLocApiOpen(void* arg) {
+    LocStartupPhase phase("LocApi open");
+    usleep(((LocInitDebug*)arg)->openMs * 1000);
+    return NULL;
+}
+
+// the adapter MsgTask: reads the config and, unless they load on threads of
+// their own, loads the libraries, before it gets to the start of a session
+static void* debugAdapterThread(void* arg) {
+    LocInitDebug* init = (LocInitDebug*)arg;
+    {
+        LocStartupPhase phase("readConfig");
+        init->confTask->get();
+    }
+    if (!init->scheduled) {
+        for (LocInitTask* lib : init->adapterLibs) {
+            lib->get();
+        }
+    }
+    LocStartupTrace::mark("adapter ready");
+    return NULL;
+}
+
+static uint64_t debugTimeOf(const LocStartupTrace::Phase* phases, size_t count,
+                            const char* name) {
+    for (size_t i = 0; i < count; i++) {
+        if (0 == strcmp(phases[i].mName, name)) {
+            return phases[i].mEndNs - phases[0].mStartNs;
+        }
+    }
+    return 0;
+}
+
+// For Linux command line testing, link with libgps_utils:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../pla/oe LocInitTask.cpp ... -ldl
+// stubs: for l in lbs api net hub; do echo "#include <unistd.h>
+//            static int s = usleep(20000);" | g++ -x c++ -shared -fPIC -o lib$l.so -; done
+// test: ./a.out serial|scheduled <conf file> <open ms>
+//           ./liblbs.so ./libapi.so ./libnet.so ./libhub.so
+// Brings up a model of the stack: the first two libraries are loaded by the
+// context, on the main thread; then a LocApi thread connects to the modem for
+// <open ms>, while the adapter thread reads <conf file> and, in serial, loads
+// the other libraries. scheduled parses <conf file> on a thread of its own
+// from the start, and loads the other libraries on threads of their own once
+// the context is up, as GnssAdapter does. The first fix is ready to be asked
+// for once the LocApi is open and the adapter got through its init.
+// Run each mode in a process of its own, as loads and parsing are cached.
+int main(int argc, char** argv) {
+    if (argc < 6) {
+        printf("usage: %s serial|scheduled <conf> <open ms> <lib> <lib> [<lib>...]\n",
+               argv[0]);
+        return 1;
+    }
+    LocInitDebug init;
+    init.scheduled = (0 == strcmp(argv[1], "scheduled"));
+    const char* conf = argv[2];
+    init.openMs = atoi(argv[3]);
+    init.contextLibs.push_back(argv[4]);
+    init.contextLibs.push_back(argv[5]);
+    init.confTask = new LocInitTask("parse conf", [conf]() -> void* {
+        UTIL_READ_CONF_DEFAULT(conf);
+        return NULL;
+    });
+    for (int i = 6; i < argc; i++) {
+        const char* lib = argv[i];
+        init.adapterLibs.push_back(new LocInitTask(lib, [lib]() -> void* {
+            return debugDlopen(lib);
+        }));
+    }
+
+    LocStartupTrace::mark("HAL entry");
+    if (init.scheduled) {
+        init.confTask->start();
+    }
+    for (const char* lib : init.contextLibs) {
+        LocStartupPhase phase(lib);
+        debugDlopen(lib);
+    }
+    if (init.scheduled) {
+        for (LocInitTask* lib : init.adapterLibs) {
+            lib->start();
+        }
+    }
+    pthread_t api, adapter;
+    pthread_create(&api, NULL, debugLocApiOpen, &init);
+    pthread_create(&adapter, NULL, debugAdapterThread, &init);
+    pthread_join(api, NULL);
+    pthread_join(adapter, NULL);
+    LocStartupTrace::mark("first fix ready");
+    for (LocInitTask* lib : init.adapterLibs) {
+        lib->get();
+    }
+    LocStartupTrace::mark("all loaded");
+
+    LocStartupTrace::Phase phases[LocStartupTrace::MAX_PHASES];
+    size_t count = LocStartupTrace::get(phases, LocStartupTrace::MAX_PHASES);
+    for (size_t i = 0; i < count; i++) {
+        printf("+%7.2f ms %7.2f ms  tid %5d  %s\n",
+               (phases[i].mStartNs - phases[0].mStartNs) / 1e6,
+               (phases[i].mEndNs - phases[i].mStartNs) / 1e6,
+               phases[i].mTid, phases[i].mName);
+    }
+    printf("%s: first fix ready in %.2f ms, all loaded in %.2f ms\n", argv[1],
+           debugTimeOf(phases, count, "first fix ready") / 1e6,
+           debugTimeOf(phases, count, "all loaded") / 1e6);
+
+    for (LocInitTask* lib : init.adapterLibs) {
+        delete lib;
+    }
+    delete init.confTask;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_INIT_TASK_H__
+#define __LOC_INIT_TASK_H__
+
+#include <pthread.h>
+#include <functional>
+
+namespace loc_util {
+
+// One step of the bring up of the location stack that depends on no other,
+// such as loading a library or parsing a conf file, run at most once: on a
+// thread of its own once start() is called, so that it overlaps with the rest
+// of the bring up, or else lazily, on the thread of the first get(). Either
+// way it is traced as a LocStartupTrace phase by its name, a string literal.
+class LocInitTask {
+public:
+    typedef std::function<void*()> Runnable;
+    typedef std::function<void()> Done;
+
+    LocInitTask(const char* name, Runnable run);
+    // waits for a run started by start() to finish, *done* included
+    ~LocInitTask();
+
+    // runs the task on a thread of its own, followed there by *done*, if any,
+    // which must not get() the task. false if it did not, as it ran or runs
+    // already, or as no thread could be created, in which case it is left to
+    // the first get()
+    bool start(Done done = nullptr);
+    // the result of the task; runs it now if it never was, waits for it to
+    // finish if it runs on the thread of start() or of another get()
+    void* get();
+
+private:
+    enum State { IDLE, RUNNING, DONE };
+    const char* mName;
+    Runnable mRun;
+    Done mDone;
+    pthread_mutex_t mMutex;
+    pthread_cond_t mCond;
+    State mState;
+    void* mResult;
+
+    // the result is published only once *done* returned
+    void run(const Done& done);
+    static void* threadMain(void* arg);
+};
+
+} // namespace loc_util
+
+#endif // __LOC_INIT_TASK_H__
@@ -32,10 +32,17 @@
 #include <errno.h>
 #include <netinet/in.h>
 #include <netdb.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
 #include <loc_misc_utils.h>
 #include <log_util.h>
 #include <LocIpc.h>
 #include <algorithm>
+#include <mutex>
+#include <vector>
+#include <atomic>
 
 using namespace std;
 
@@ -58,6 +65,25 @@ namespace loc_util {
         } \
     }
 
+// Binary frame header, in front of every message a framing Sock sends. A
+// message that does not fit in one datagram goes out as the header plus as
+// much of it as fits, and the rest follows in datagrams of raw data, same as
+// after a LOC_IPC_HEAD. Fields are in host order, both ends run on one host.
+// The 0xFF leading byte keeps the magic apart from any text message.
+struct LocIpcFrameHead {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint32_t length;    // of the message, not counting this header
+    int32_t msgId;
+};
+#define LOC_IPC_FRAME_MAGIC       0x43504CFF  // "\xFFLPC"
+#define LOC_IPC_FRAME_VERSION     1
+#define LOC_IPC_FRAME_FLAG_SPLIT  0x0001      // rest of the message follows
+// datagrams handed to / taken from the kernel per sendmmsg() / recvmmsg() call
+#define LOC_IPC_TX_BATCH          16
+#define LOC_IPC_RX_BATCH_MAX      16
+
 const char Sock::MSG_ABORT[] = "LocIpc::Sock::ABORT";
 const char Sock::LOC_IPC_HEAD[] = "$MSGLEN$";
 ssize_t Sock::send(const void *buf, uint32_t len, int flags, const struct sockaddr *destAddr,
@@ -129,17 +155,329 @@ ssize_t Sock::sendAbort(int flags, const struct sockaddr *destAddr, socklen_t ad
     return send(MSG_ABORT, sizeof(MSG_ABORT), flags, destAddr, addrlen);
 }
 
+
+// Sock plus what framing and batched receiving need. Sock keeps the layout
+// it has in LocIpc.h, which prebuilt libraries are built against, so this
+// state lives here, and every transport in this file uses a LocIpcSock.
+class LocIpcSock : public Sock {
+    // sending side, also set by the receiving side once the peer sent a frame
+    mutable atomic<bool> mFramed;
+    // receiving side, only ever touched by the listening thread
+    mutable int mSockType;
+    mutable uint32_t mRxBatch;
+    mutable vector<char> mRxBufs;
+    mutable string mLongMsg;
+    mutable size_t mLongMsgReceived;
+    mutable int32_t mLongMsgId;
+    ssize_t sendto(const void *buf, size_t len, int flags, const struct sockaddr *destAddr,
+                   socklen_t addrlen, int32_t msgId) const;
+    ssize_t recvfrom(const LocIpcRecver& recver, const shared_ptr<ILocIpcListener>& dataCb,
+                     int sid, int flags, struct sockaddr *srcAddr, socklen_t *addrlen) const;
+    void onLongMsgData(const LocIpcRecver& recver, const shared_ptr<ILocIpcListener>& dataCb,
+                       const char* data, size_t len) const;
+public:
+    inline LocIpcSock(int sid, const uint32_t maxTxSize = 8192) : Sock(sid, maxTxSize),
+            mFramed(false), mSockType(-1), mRxBatch(2), mLongMsgReceived(0), mLongMsgId(-1) {}
+    inline void setFramed(bool framed) { mFramed = framed; }
+    inline uint32_t getMaxTxSize() const { return mMaxTxSize; }
+    // for recvers that take datagrams off the socket themselves
+    bool onDatagram(const LocIpcRecver& recver, const shared_ptr<ILocIpcListener>& dataCb,
+                    char* data, size_t len) const;
+    ssize_t send(const void *buf, uint32_t len, int flags, const struct sockaddr *destAddr,
+                 socklen_t addrlen, int32_t msgId = -1) const;
+    ssize_t sendBatch(const LocIpcMsgData msgs[], uint32_t count, int flags,
+                      const struct sockaddr *destAddr, socklen_t addrlen) const;
+    ssize_t recv(const LocIpcRecver& recver, const shared_ptr<ILocIpcListener>& dataCb, int flags,
+                 struct sockaddr *srcAddr, socklen_t *addrlen, int sid = -1) const;
+};
+
+class LocIpcSockRecver : public LocIpcRecver {
+    shared_ptr<LocIpcSock> mSock;
+protected:
+    inline virtual ssize_t recv() const override {
+        return mSock->recv(*this, mDataCb, 0, nullptr, nullptr);
+    }
+public:
+    inline LocIpcSockRecver(const shared_ptr<ILocIpcListener>& listener,
+                            LocIpcSender& sender, shared_ptr<LocIpcSock> sock) :
+            LocIpcRecver(listener, sender), mSock(sock) {
+    }
+    inline virtual const char* getName() const override {
+        return "SockRecver";
+    }
+    inline virtual void abort() const override {}
+};
+
+ssize_t LocIpcSock::send(const void *buf, uint32_t len, int flags, const struct sockaddr *destAddr,
+                   socklen_t addrlen, int32_t msgId) const {
+    ssize_t rtv = -1;
+    SOCK_OP_AND_LOG(buf, len, isValid(), rtv, sendto(buf, len, flags, destAddr, addrlen, msgId));
+    return rtv;
+}
+ssize_t LocIpcSock::recv(const LocIpcRecver& recver, const shared_ptr<ILocIpcListener>& dataCb, int flags,
+                   struct sockaddr *srcAddr, socklen_t *addrlen, int sid) const {
+    ssize_t rtv = -1;
+    if (-1 == sid) {
+        sid = mSid;
+    } // else it sid would be connection based socket id for recv
+    SOCK_OP_AND_LOG(dataCb.get(), mMaxTxSize, isValid(), rtv,
+                    recvfrom(recver, dataCb, sid, flags, srcAddr, addrlen));
+    return rtv;
+}
+ssize_t LocIpcSock::sendto(const void *buf, size_t len, int flags, const struct sockaddr *destAddr,
+                     socklen_t addrlen, int32_t msgId) const {
+    ssize_t rtv = -1;
+    size_t headLen = 0;
+    size_t offset = 0;
+    if (mFramed) {
+        LocIpcFrameHead head = {LOC_IPC_FRAME_MAGIC, LOC_IPC_FRAME_VERSION, 0,
+                                (uint32_t)len, msgId};
+        offset = min(len, (size_t)mMaxTxSize - sizeof(head));
+        if (offset < len) {
+            head.flags |= LOC_IPC_FRAME_FLAG_SPLIT;
+        }
+        struct iovec iov[2] = {{&head, sizeof(head)}, {(void*)buf, offset}};
+        struct msghdr msg = {};
+        msg.msg_name = (void*)destAddr;
+        msg.msg_namelen = addrlen;
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 2;
+        rtv = ::sendmsg(mSid, &msg, flags);
+        headLen = sizeof(head);
+    } else if (len <= mMaxTxSize) {
+        rtv = ::sendto(mSid, buf, len, flags, destAddr, addrlen);
+        offset = len;
+    } else {
+        char head[sizeof(LOC_IPC_HEAD) + 20];
+        headLen = snprintf(head, sizeof(head), "%s%zu", LOC_IPC_HEAD, len);
+        rtv = ::sendto(mSid, head, headLen, flags, destAddr, addrlen);
+    }
+    if (rtv > 0 && offset < len) {
+        for (; offset < len && rtv > 0; offset += rtv) {
+            rtv = ::sendto(mSid, (char*)buf + offset, min(len - offset, (size_t)mMaxTxSize),
+                           flags, destAddr, addrlen);
+        }
+        rtv = (rtv > 0) ? (headLen + len) : -1;
+    }
+    return rtv;
+}
+// Sends all of msgs, resuming where a partial sendmmsg() stopped.
+static ssize_t sendmmsgAll(int sid, struct mmsghdr* msgs, uint32_t count, int flags) {
+    ssize_t rtv = 0;
+    for (uint32_t sent = 0; sent < count && rtv >= 0; ) {
+        int n = ::sendmmsg(sid, msgs + sent, count - sent, flags);
+        if (n <= 0) {
+            rtv = -1;
+        } else {
+            for (int i = 0; i < n; i++) {
+                rtv += msgs[sent + i].msg_len;
+            }
+            sent += n;
+        }
+    }
+    return rtv;
+}
+ssize_t LocIpcSock::sendBatch(const LocIpcMsgData msgs[], uint32_t count, int flags,
+                        const struct sockaddr *destAddr, socklen_t addrlen) const {
+    struct mmsghdr hdrs[LOC_IPC_TX_BATCH];
+    struct iovec iovs[LOC_IPC_TX_BATCH][2];
+    LocIpcFrameHead heads[LOC_IPC_TX_BATCH];
+    const bool framed = mFramed;
+    const size_t headLen = framed ? sizeof(LocIpcFrameHead) : 0;
+    ssize_t rtv = isValid() ? 0 : -1;
+
+    for (uint32_t i = 0; i < count && rtv >= 0; i++) {
+        if (nullptr == msgs[i].data || 0 == msgs[i].length) {
+            LOC_LOGe("Invalid inputs: msgs[%u] - %p, length - %u",
+                     i, msgs[i].data, msgs[i].length);
+            rtv = -1;
+        }
+    }
+    if (rtv < 0) {
+        return rtv;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i <= count && rtv >= 0; i++) {
+        // whatever does not fit in one datagram goes alone, through sendto()
+        bool alone = (i < count) && (msgs[i].length + headLen > mMaxTxSize);
+        if (n > 0 && (count == i || alone || LOC_IPC_TX_BATCH == n)) {
+            ssize_t sent = sendmmsgAll(mSid, hdrs, n, flags);
+            rtv = (sent > 0) ? (rtv + sent) : -1;
+            n = 0;
+        }
+        if (count == i || rtv < 0) {
+            break;
+        } else if (alone) {
+            ssize_t sent = sendto(msgs[i].data, msgs[i].length, flags, destAddr, addrlen,
+                                  msgs[i].msgId);
+            rtv = (sent > 0) ? (rtv + sent) : -1;
+        } else {
+            struct msghdr& msg = hdrs[n].msg_hdr;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name = (void*)destAddr;
+            msg.msg_namelen = addrlen;
+            msg.msg_iov = iovs[n];
+            if (framed) {
+                heads[n] = {LOC_IPC_FRAME_MAGIC, LOC_IPC_FRAME_VERSION, 0,
+                            msgs[i].length, msgs[i].msgId};
+                iovs[n][0] = {&heads[n], sizeof(heads[n])};
+                iovs[n][1] = {(void*)msgs[i].data, msgs[i].length};
+                msg.msg_iovlen = 2;
+            } else {
+                iovs[n][0] = {(void*)msgs[i].data, msgs[i].length};
+                msg.msg_iovlen = 1;
+            }
+            n++;
+        }
+    }
+    if (rtv < 0) {
+        LOC_LOGw("failed reason: %s", strerror(errno));
+    }
+    return rtv;
+}
+void LocIpcSock::onLongMsgData(const LocIpcRecver& recver, const shared_ptr<ILocIpcListener>& dataCb,
+                         const char* data, size_t len) const {
+    if (nullptr != data) {
+        len = min(len, mLongMsg.size() - mLongMsgReceived);
+        memcpy(&mLongMsg[mLongMsgReceived], data, len);
+    }
+    mLongMsgReceived += len;
+    if (mLongMsgReceived == mLongMsg.size()) {
+        dataCb->onReceiveWithId(mLongMsg.data(), mLongMsg.size(), &recver, mLongMsgId);
+        // keeps the capacity for the next long message
+        mLongMsg.clear();
+        mLongMsgReceived = 0;
+    }
+}
+// data holds one datagram of len bytes, with room for one more byte after
+// it, so that messages can be handed out NUL terminated like they always
+// were. Returns false on the abort message.
+bool LocIpcSock::onDatagram(const LocIpcRecver& recver, const shared_ptr<ILocIpcListener>& dataCb,
+                      char* data, size_t len) const {
+    const uint32_t magic = LOC_IPC_FRAME_MAGIC;
+    LocIpcFrameHead head;
+    data[len] = 0;
+    if (mLongMsgReceived < mLongMsg.size()) {
+        onLongMsgData(recver, dataCb, data, len);
+    } else if (strncmp(data, MSG_ABORT, sizeof(MSG_ABORT)) == 0) {
+        LOC_LOGi("recvd abort msg.data %s", data);
+        return false;
+    } else if (len >= sizeof(head) && 0 == memcmp(data, &magic, sizeof(magic))) {
+        memcpy(&head, data, sizeof(head));
+        size_t carried = len - sizeof(head);
+        if (LOC_IPC_FRAME_VERSION != head.version) {
+            LOC_LOGw("dropped frame of unknown version %u", head.version);
+        } else if (head.length <= carried) {
+            // the peer speaks frames, so it takes them too
+            mFramed = true;
+            data[sizeof(head) + head.length] = 0;
+            dataCb->onReceiveWithId(data + sizeof(head), head.length, &recver, head.msgId);
+        } else if (head.flags & LOC_IPC_FRAME_FLAG_SPLIT) {
+            mFramed = true;
+            mLongMsg.resize(head.length);
+            mLongMsgId = head.msgId;
+            onLongMsgData(recver, dataCb, data + sizeof(head), carried);
+        } else {
+            LOC_LOGw("dropped short frame: %zu of %u bytes", carried, head.length);
+        }
+    } else if (strncmp(data, LOC_IPC_HEAD, sizeof(LOC_IPC_HEAD) - 1)) {
+        // short message
+        dataCb->onReceiveWithId(data, len, &recver, -1);
+    } else {
+        // long message
+        size_t msgLen = strtoul(data + sizeof(LOC_IPC_HEAD) - 1, nullptr, 10);
+        if (msgLen > 0) {
+            mLongMsg.resize(msgLen);
+            mLongMsgId = -1;
+        }
+    }
+    return true;
+}
+ssize_t LocIpcSock::recvfrom(const LocIpcRecver& recver, const shared_ptr<ILocIpcListener>& dataCb,
+                       int sid, int flags, struct sockaddr *srcAddr, socklen_t *addrlen) const  {
+    ssize_t nBytes = -1;
+    if (mLongMsgReceived < mLongMsg.size()) {
+        // the rest of a long message goes straight in place
+        nBytes = ::recvfrom(sid, &mLongMsg[mLongMsgReceived], mLongMsg.size() - mLongMsgReceived,
+                            flags, srcAddr, addrlen);
+        if (nBytes > 0) {
+            onLongMsgData(recver, dataCb, nullptr, nBytes);
+        }
+        return nBytes;
+    }
+
+    if (-1 == mSockType) {
+        socklen_t optLen = sizeof(mSockType);
+        if (getsockopt(sid, SOL_SOCKET, SO_TYPE, &mSockType, &optLen) < 0) {
+            mSockType = 0;
+        }
+    }
+    // Datagram sockets take whatever is queued up, up to mRxBatch datagrams per
+    // call. mRxBatch doubles each time a call comes back full, so that a quiet
+    // socket holds on to just a couple of buffers. The buffers are kept from
+    // call to call.
+    const size_t bufSize = mMaxTxSize + 1;
+    uint32_t batch = (SOCK_DGRAM == mSockType) ? mRxBatch : 1;
+    if (mRxBufs.size() < batch * bufSize) {
+        mRxBufs.resize(batch * bufSize);
+    }
+    if (SOCK_DGRAM != mSockType) {
+        nBytes = ::recvfrom(sid, mRxBufs.data(), mMaxTxSize, flags, srcAddr, addrlen);
+        if (nBytes > 0 && !onDatagram(recver, dataCb, mRxBufs.data(), nBytes)) {
+            nBytes = 0;
+        }
+    } else {
+        struct mmsghdr hdrs[LOC_IPC_RX_BATCH_MAX];
+        struct iovec iovs[LOC_IPC_RX_BATCH_MAX];
+        memset(hdrs, 0, sizeof(hdrs[0]) * batch);
+        for (uint32_t i = 0; i < batch; i++) {
+            iovs[i] = {mRxBufs.data() + i * bufSize, mMaxTxSize};
+            hdrs[i].msg_hdr.msg_iov = &iovs[i];
+            hdrs[i].msg_hdr.msg_iovlen = 1;
+            // the last sender is what counts, same as with recvfrom()
+            hdrs[i].msg_hdr.msg_name = srcAddr;
+            hdrs[i].msg_hdr.msg_namelen = (nullptr == addrlen) ? 0 : *addrlen;
+        }
+        int n = ::recvmmsg(sid, hdrs, batch, flags | MSG_WAITFORONE, nullptr);
+        if (n > 0) {
+            if (nullptr != addrlen) {
+                *addrlen = hdrs[n - 1].msg_hdr.msg_namelen;
+            }
+            nBytes = 0;
+            for (int i = 0; i < n && nBytes >= 0; i++) {
+                // an abort ends the listening, whatever came before it
+                nBytes = onDatagram(recver, dataCb, (char*)iovs[i].iov_base, hdrs[i].msg_len) ?
+                        (nBytes + hdrs[i].msg_len) : -1;
+            }
+            nBytes = max(nBytes, (ssize_t)0);
+        }
+        if ((uint32_t)n == batch) {
+            mRxBatch = min(batch * 2, (uint32_t)LOC_IPC_RX_BATCH_MAX);
+        }
+    }
+
+    return nBytes;
+}
+
 class LocIpcLocalSender : public LocIpcSender {
 protected:
-    shared_ptr<Sock> mSock;
+    shared_ptr<LocIpcSock> mSock;
     struct sockaddr_un mAddr;
     inline virtual bool isOperable() const override { return mSock != nullptr && mSock->isValid(); }
-    inline virtual ssize_t send(const uint8_t data[], uint32_t length, int32_t /* msgId */) const {
-        return mSock->send(data, length, 0, (struct sockaddr*)&mAddr, sizeof(mAddr));
+    inline virtual ssize_t send(const uint8_t data[], uint32_t length, int32_t msgId) const {
+        return mSock->send(data, length, 0, (struct sockaddr*)&mAddr, sizeof(mAddr), msgId);
+    }
+    inline virtual ssize_t sendBatch(const LocIpcMsgData msgs[], uint32_t count) const override {
+        return mSock->sendBatch(msgs, count, 0, (struct sockaddr*)&mAddr, sizeof(mAddr));
     }
 public:
+    inline virtual bool setFramed(bool framed) override {
+        mSock->setFramed(framed);
+        return true;
+    }
     inline LocIpcLocalSender(const char* name) : LocIpcSender(),
-            mSock(make_shared<Sock>((nullptr == name) ? -1 : (::socket(AF_UNIX, SOCK_DGRAM, 0)))),
+            mSock(make_shared<LocIpcSock>((nullptr == name) ? -1 : (::socket(AF_UNIX, SOCK_DGRAM, 0)))),
             mAddr({.sun_family = AF_UNIX, {}}) {
         if (mSock != nullptr && mSock->isValid()) {
             snprintf(mAddr.sun_path, sizeof(mAddr.sun_path), "%s", name);
@@ -177,24 +515,441 @@ public:
     }
 };
 
+// Shared memory transport. The sender owns a single producer / single
+// consumer ring in a memfd, and hands the memfd plus two eventfd doorbells
+// to the recver over the recver's local socket, once. After that messages
+// are written straight into the ring and read out of it in place. A doorbell
+// is rung only when the other side went to sleep on it, so a busy stream
+// moves without system calls. The recver's socket still takes datagrams
+// from LocIpcLocalSender, and abort.
+//
+// Positions in the ring only ever grow; a record that would cross the end
+// of the ring is preceded by a pad record up to the end.
+struct LocIpcShmRing {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                          // of the data, a power of 2
+    alignas(64) atomic<uint64_t> head;      // written by the sender
+    atomic<uint32_t> recverWaiting;
+    alignas(64) atomic<uint64_t> tail;      // written by the recver
+    atomic<uint32_t> senderWaiting;
+    // the data follows right after, aligned by the alignas above
+    inline uint8_t* data() { return (uint8_t*)(this + 1); }
+};
+struct LocIpcShmRecord {
+    uint32_t length;                        // of the payload, which is followed by a NUL
+    int32_t msgId;
+    uint32_t flags;
+    uint32_t reserved;
+};
+#define LOC_IPC_SHM_MAGIC          0x4D48534C  // "LSHM"
+#define LOC_IPC_SHM_VERSION        1
+#define LOC_IPC_SHM_FLAG_PAD       0x0001
+#define LOC_IPC_SHM_FLAG_MORE      0x0002      // the message goes on in the next record
+#define LOC_IPC_SHM_FLAG_DETACH    0x0004      // the sender is gone
+#define LOC_IPC_SHM_ALIGN(n)       (((n) + sizeof(LocIpcShmRecord) - 1) & \
+                                    ~(sizeof(LocIpcShmRecord) - 1))
+#define LOC_IPC_SHM_RECORD_SIZE(n) LOC_IPC_SHM_ALIGN(sizeof(LocIpcShmRecord) + (n) + 1)
+// how long a sender waits for room in a full ring before it fails the send
+#define LOC_IPC_SHM_FULL_WAIT_MS   1000
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC                0x0001U
+#endif
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "LocIpcShmRing needs address free atomics");
+
+static const char LOC_IPC_SHM_ATTACH[] = "LocIpc::Shm::ATTACH";
+
+class LocIpcShmSender : public LocIpcLocalSender {
+    LocIpcShmRing* mRing;
+    size_t mMapSize;
+    int mMemFd;
+    int mDataFd;
+    int mSpaceFd;
+    uint32_t mMaxChunk;
+    mutable mutex mLock;
+    mutable uint64_t mHead;
+    mutable bool mAttached;
+    mutable bool mStalled;
+
+    bool attach() const {
+        int fds[3] = {mMemFd, mDataFd, mSpaceFd};
+        char control[CMSG_SPACE(sizeof(fds))] = {};
+        struct iovec iov = {(void*)LOC_IPC_SHM_ATTACH, sizeof(LOC_IPC_SHM_ATTACH)};
+        struct msghdr msg = {};
+        msg.msg_name = (void*)&mAddr;
+        msg.msg_namelen = sizeof(mAddr);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+        mAttached = (::sendmsg(mSock->mSid, &msg, 0) > 0);
+        if (!mAttached) {
+            LOC_LOGw("attach to %s failed: %s", mAddr.sun_path, strerror(errno));
+        }
+        return mAttached;
+    }
+    // makes what was written so far visible, and wakes up the recver if it sleeps
+    inline void publish() const {
+        mRing->head.store(mHead, memory_order_release);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (mRing->recverWaiting.load(memory_order_relaxed)) {
+            eventfd_write(mDataFd, 1);
+        }
+    }
+    // makes room for a record of size bytes at mHead, padding up to the end
+    // of the ring if it would not fit in before it
+    bool reserve(uint32_t size) const {
+        uint32_t index = mHead & (mRing->size - 1);
+        uint32_t pad = (mRing->size - index < size) ? (mRing->size - index) : 0;
+        while (mRing->size - (mHead - mRing->tail.load(memory_order_acquire)) < pad + size) {
+            // after a timeout, fail right away until the recver catches up
+            if (mStalled) {
+                return false;
+            }
+            publish();
+            mRing->senderWaiting.store(1, memory_order_relaxed);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (mRing->size - (mHead - mRing->tail.load(memory_order_acquire)) >= pad + size) {
+                break;
+            }
+            struct pollfd pfd = {mSpaceFd, POLLIN, 0};
+            if (0 == poll(&pfd, 1, LOC_IPC_SHM_FULL_WAIT_MS)) {
+                LOC_LOGw("%s: ring full for %d ms", mAddr.sun_path, LOC_IPC_SHM_FULL_WAIT_MS);
+                mStalled = true;
+            } else {
+                eventfd_t count;
+                eventfd_read(mSpaceFd, &count);
+            }
+        }
+        mRing->senderWaiting.store(0, memory_order_relaxed);
+        mStalled = false;
+        if (pad > 0) {
+            LocIpcShmRecord record = {pad, -1, LOC_IPC_SHM_FLAG_PAD, 0};
+            memcpy(mRing->data() + index, &record, sizeof(record));
+            mHead += pad;
+        }
+        return true;
+    }
+    // writes one message, in as many records as it takes; returns false if
+    // the ring stayed full
+    bool write(const uint8_t data[], uint32_t length, int32_t msgId) const {
+        uint32_t offset = 0;
+        do {
+            uint32_t chunk = min(length - offset, mMaxChunk);
+            uint32_t size = LOC_IPC_SHM_RECORD_SIZE(chunk);
+            if (!reserve(size)) {
+                return false;
+            }
+            uint8_t* dest = mRing->data() + (mHead & (mRing->size - 1));
+            LocIpcShmRecord record = {chunk, msgId,
+                    (offset + chunk < length) ? (uint32_t)LOC_IPC_SHM_FLAG_MORE : 0, 0};
+            memcpy(dest, &record, sizeof(record));
+            memcpy(dest + sizeof(record), data + offset, chunk);
+            dest[sizeof(record) + chunk] = 0;
+            mHead += size;
+            offset += chunk;
+        } while (offset < length);
+        return true;
+    }
+
+protected:
+    inline virtual bool isOperable() const override {
+        return LocIpcLocalSender::isOperable() && nullptr != mRing;
+    }
+    virtual ssize_t send(const uint8_t data[], uint32_t length, int32_t msgId) const override {
+        LocIpcMsgData msg = {data, length, msgId};
+        return sendBatch(&msg, 1);
+    }
+    virtual ssize_t sendBatch(const LocIpcMsgData msgs[], uint32_t count) const override {
+        ssize_t rtv = 0;
+        lock_guard<mutex> lock(mLock);
+        if (!mAttached && !attach()) {
+            return -1;
+        }
+        for (uint32_t i = 0; i < count && rtv >= 0; i++) {
+            if (nullptr == msgs[i].data || 0 == msgs[i].length) {
+                LOC_LOGe("Invalid inputs: buf - %p, length - %u", msgs[i].data, msgs[i].length);
+                rtv = -1;
+            } else {
+                rtv = write(msgs[i].data, msgs[i].length, msgs[i].msgId) ?
+                        (rtv + msgs[i].length) : -1;
+            }
+        }
+        publish();
+        return rtv;
+    }
+
+public:
+    LocIpcShmSender(const char* name, uint32_t ringSize) : LocIpcLocalSender(name),
+            mRing(nullptr), mMapSize(0), mMemFd(-1), mDataFd(-1), mSpaceFd(-1),
+            mMaxChunk(0), mHead(0), mAttached(false), mStalled(false) {
+        // round up to a power of 2
+        ringSize = (ringSize <= 4096) ? 4096 : (2u << (31 - __builtin_clz(ringSize - 1)));
+        mMapSize = sizeof(LocIpcShmRing) + ringSize;
+        if (LocIpcLocalSender::isOperable()) {
+            mMemFd = syscall(__NR_memfd_create, "LocIpcShm", MFD_CLOEXEC);
+            mDataFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            mSpaceFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            void* addr = MAP_FAILED;
+            if (mMemFd >= 0 && mDataFd >= 0 && mSpaceFd >= 0 && ftruncate(mMemFd, mMapSize) == 0) {
+                addr = mmap(nullptr, mMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, mMemFd, 0);
+            }
+            if (MAP_FAILED == addr) {
+                LOC_LOGe("ring setup failed: %s", strerror(errno));
+            } else {
+                mRing = new (addr) LocIpcShmRing();
+                mRing->magic = LOC_IPC_SHM_MAGIC;
+                mRing->version = LOC_IPC_SHM_VERSION;
+                mRing->size = ringSize;
+                mRing->head = mRing->tail = 0;
+                mRing->recverWaiting = mRing->senderWaiting = 0;
+                // a quarter of the ring, so that big messages still stream
+                mMaxChunk = ringSize / 4 - LOC_IPC_SHM_RECORD_SIZE(0);
+            }
+        }
+    }
+    virtual ~LocIpcShmSender() {
+        if (nullptr != mRing) {
+            lock_guard<mutex> lock(mLock);
+            if (mAttached && reserve(LOC_IPC_SHM_RECORD_SIZE(0))) {
+                LocIpcShmRecord record = {0, -1, LOC_IPC_SHM_FLAG_DETACH, 0};
+                memcpy(mRing->data() + (mHead & (mRing->size - 1)), &record, sizeof(record));
+                mHead += LOC_IPC_SHM_RECORD_SIZE(0);
+                publish();
+            }
+            munmap(mRing, mMapSize);
+        }
+        for (int fd : {mMemFd, mDataFd, mSpaceFd}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+    inline virtual bool setFramed(bool /* framed */) override { return false; }
+    // the old recver took the ring along, start over on a fresh one
+    virtual void informRecverRestarted() override {
+        lock_guard<mutex> lock(mLock);
+        if (nullptr != mRing) {
+            mHead = 0;
+            mRing->head = mRing->tail = 0;
+            mRing->recverWaiting = mRing->senderWaiting = 0;
+            mStalled = false;
+        }
+        mAttached = false;
+    }
+};
+
+class LocIpcShmRecver : public LocIpcLocalRecver {
+    struct Peer {
+        LocIpcShmRing* mRing;
+        size_t mMapSize;
+        int mDataFd;
+        int mSpaceFd;
+        string mLongMsg;
+    };
+    mutable vector<Peer> mPeers;
+    mutable vector<char> mBuf;
+    mutable vector<struct pollfd> mPollFds;
+
+    static void closePeer(Peer& peer) {
+        munmap(peer.mRing, peer.mMapSize);
+        ::close(peer.mDataFd);
+        ::close(peer.mSpaceFd);
+    }
+    void attach(const int fds[3]) const {
+        Peer peer = {nullptr, 0, fds[1], fds[2], string()};
+        struct stat st;
+        void* addr = MAP_FAILED;
+        if (fstat(fds[0], &st) == 0 && (size_t)st.st_size > sizeof(LocIpcShmRing)) {
+            peer.mMapSize = st.st_size;
+            addr = mmap(nullptr, peer.mMapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+        }
+        ::close(fds[0]);
+        peer.mRing = (LocIpcShmRing*)addr;
+        if (MAP_FAILED == addr || LOC_IPC_SHM_MAGIC != peer.mRing->magic ||
+                LOC_IPC_SHM_VERSION != peer.mRing->version ||
+                0 != (peer.mRing->size & (peer.mRing->size - 1)) ||
+                peer.mMapSize < sizeof(LocIpcShmRing) + peer.mRing->size) {
+            LOC_LOGe("%s: bad ring, dropped", mAddr.sun_path);
+            if (MAP_FAILED != addr) {
+                munmap(addr, peer.mMapSize);
+            }
+            ::close(fds[1]);
+            ::close(fds[2]);
+        } else {
+            mPeers.push_back(move(peer));
+        }
+    }
+    // Hands out everything in the ring, in place. Returns the bytes handed
+    // out, or -1 once the sender detached.
+    ssize_t drain(Peer& peer) const {
+        LocIpcShmRing* ring = peer.mRing;
+        uint64_t tail = ring->tail.load(memory_order_relaxed);
+        uint64_t head = ring->head.load(memory_order_acquire);
+        ssize_t rtv = 0;
+        while (tail != head && rtv >= 0) {
+            uint32_t index = tail & (ring->size - 1);
+            LocIpcShmRecord record;
+            memcpy(&record, ring->data() + index, sizeof(record));
+            uint32_t size = (record.flags & LOC_IPC_SHM_FLAG_PAD) ?
+                    record.length : LOC_IPC_SHM_RECORD_SIZE(record.length);
+            if (0 == size || size > ring->size - index || size > head - tail) {
+                LOC_LOGe("%s: corrupt ring, dropped", mAddr.sun_path);
+                rtv = -1;
+            } else if (record.flags & LOC_IPC_SHM_FLAG_DETACH) {
+                rtv = -1;
+            } else if (0 == (record.flags & LOC_IPC_SHM_FLAG_PAD)) {
+                char* payload = (char*)ring->data() + index + sizeof(record);
+                payload[record.length] = 0;
+                if ((record.flags & LOC_IPC_SHM_FLAG_MORE) || !peer.mLongMsg.empty()) {
+                    peer.mLongMsg.append(payload, record.length);
+                    if (0 == (record.flags & LOC_IPC_SHM_FLAG_MORE)) {
+                        mDataCb->onReceiveWithId(peer.mLongMsg.data(), peer.mLongMsg.size(),
+                                                 this, record.msgId);
+                        rtv += peer.mLongMsg.size();
+                        peer.mLongMsg.clear();
+                    }
+                } else {
+                    mDataCb->onReceiveWithId(payload, record.length, this, record.msgId);
+                    rtv += record.length;
+                }
+            }
+            tail += size;
+            // give the space back right away, the sender may be waiting on it
+            ring->tail.store(tail, memory_order_release);
+        }
+        atomic_thread_fence(memory_order_seq_cst);
+        if (ring->senderWaiting.load(memory_order_relaxed)) {
+            eventfd_write(peer.mSpaceFd, 1);
+        }
+        return rtv;
+    }
+    // Takes one datagram off the socket. Returns 0 on abort.
+    ssize_t recvSock() const {
+        int fds[3];
+        char control[CMSG_SPACE(sizeof(fds))];
+        struct iovec iov = {mBuf.data(), mBuf.size() - 1};
+        struct msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        ssize_t nBytes = ::recvmsg(mSock->mSid, &msg, MSG_CMSG_CLOEXEC);
+        if (nBytes <= 0) {
+            return nBytes;
+        }
+        uint32_t fdCount = 0;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (nullptr != cmsg && SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type) {
+            fdCount = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(fds, CMSG_DATA(cmsg), fdCount * sizeof(int));
+        }
+        if (3 == fdCount && sizeof(LOC_IPC_SHM_ATTACH) == nBytes &&
+                0 == memcmp(mBuf.data(), LOC_IPC_SHM_ATTACH, nBytes)) {
+            attach(fds);
+        } else {
+            for (uint32_t i = 0; i < fdCount; i++) {
+                ::close(fds[i]);
+            }
+            if (!mSock->onDatagram(*this, mDataCb, mBuf.data(), nBytes)) {
+                nBytes = 0;
+            }
+        }
+        return nBytes;
+    }
+
+protected:
+    virtual ssize_t recv() const override {
+        if (mBuf.empty()) {
+            mBuf.resize(mSock->getMaxTxSize() + 1);
+        }
+        for (;;) {
+            ssize_t rtv = 0;
+            bool pending = false;
+            for (size_t i = 0; i < mPeers.size(); ) {
+                ssize_t nBytes = drain(mPeers[i]);
+                if (nBytes < 0) {
+                    closePeer(mPeers[i]);
+                    mPeers.erase(mPeers.begin() + i);
+                } else {
+                    rtv += nBytes;
+                    i++;
+                }
+            }
+            if (rtv > 0) {
+                return rtv;
+            }
+            // ask for the doorbells, then look once more before sleeping
+            for (Peer& peer : mPeers) {
+                peer.mRing->recverWaiting.store(1, memory_order_relaxed);
+            }
+            atomic_thread_fence(memory_order_seq_cst);
+            mPollFds.assign(1, {mSock->mSid, POLLIN, 0});
+            for (Peer& peer : mPeers) {
+                pending = pending || (peer.mRing->head.load(memory_order_relaxed) !=
+                                      peer.mRing->tail.load(memory_order_relaxed));
+                mPollFds.push_back({peer.mDataFd, POLLIN, 0});
+            }
+            if (!pending && poll(mPollFds.data(), mPollFds.size(), -1) < 0 && EINTR != errno) {
+                LOC_LOGw("failed reason: %s", strerror(errno));
+                return -1;
+            }
+            for (size_t i = 0; i < mPeers.size(); i++) {
+                mPeers[i].mRing->recverWaiting.store(0, memory_order_relaxed);
+                if (!pending && (mPollFds[i + 1].revents & POLLIN)) {
+                    eventfd_t count;
+                    eventfd_read(mPeers[i].mDataFd, &count);
+                }
+            }
+            if (!pending && (mPollFds[0].revents & POLLIN)) {
+                rtv = recvSock();
+                if (rtv <= 0) {
+                    return rtv;
+                }
+            }
+        }
+    }
+public:
+    inline LocIpcShmRecver(const shared_ptr<ILocIpcListener>& listener, const char* name) :
+            LocIpcLocalRecver(listener, name) {}
+    virtual ~LocIpcShmRecver() {
+        for (Peer& peer : mPeers) {
+            closePeer(peer);
+        }
+    }
+};
+
 class LocIpcInetSender : public LocIpcSender {
 protected:
     int mSockType;
-    shared_ptr<Sock> mSock;
+    shared_ptr<LocIpcSock> mSock;
     const string mName;
     sockaddr_in mAddr;
     inline virtual bool isOperable() const override { return mSock != nullptr && mSock->isValid(); }
-    virtual ssize_t send(const uint8_t data[], uint32_t length, int32_t /* msgId */) const {
-        return mSock->send(data, length, 0, (struct sockaddr*)&mAddr, sizeof(mAddr));
+    virtual ssize_t send(const uint8_t data[], uint32_t length, int32_t msgId) const {
+        return mSock->send(data, length, 0, (struct sockaddr*)&mAddr, sizeof(mAddr), msgId);
+    }
+    virtual ssize_t sendBatch(const LocIpcMsgData msgs[], uint32_t count) const override {
+        return mSock->sendBatch(msgs, count, 0, (struct sockaddr*)&mAddr, sizeof(mAddr));
     }
 public:
+    inline virtual bool setFramed(bool framed) override {
+        mSock->setFramed(framed);
+        return true;
+    }
     inline LocIpcInetSender(const LocIpcInetSender& sender) :
             mSockType(sender.mSockType), mSock(sender.mSock),
             mName(sender.mName), mAddr(sender.mAddr) {
     }
     inline LocIpcInetSender(const char* name, int32_t port, int sockType) : LocIpcSender(),
             mSockType(sockType),
-            mSock(make_shared<Sock>((nullptr == name) ? -1 : (::socket(AF_INET, mSockType, 0)))),
+            mSock(make_shared<LocIpcSock>((nullptr == name) ? -1 : (::socket(AF_INET, mSockType, 0)))),
             mName((nullptr == name) ? "" : name),
             mAddr({.sin_family = AF_INET, .sin_port = htons(port),
                     .sin_addr = {htonl(INADDR_ANY)}}) {
@@ -207,7 +962,7 @@ public:
     }
 
     unique_ptr<LocIpcRecver> getRecver(const shared_ptr<ILocIpcListener>& listener) override {
-        return make_unique<SockRecver>(listener, *this, mSock);
+        return make_unique<LocIpcSockRecver>(listener, *this, mSock);
     }
 };
 
@@ -215,12 +970,19 @@ class LocIpcInetTcpSender : public LocIpcInetSender {
 protected:
     mutable bool mFirstTime;
 
-    virtual ssize_t send(const uint8_t data[], uint32_t length, int32_t /* msgId */) const {
+    inline void connectOnce() const {
         if (mFirstTime) {
             mFirstTime = false;
             ::connect(mSock->mSid, (const struct sockaddr*)&mAddr, sizeof(mAddr));
         }
-        return mSock->send(data, length, 0, (struct sockaddr*)&mAddr, sizeof(mAddr));
+    }
+    virtual ssize_t send(const uint8_t data[], uint32_t length, int32_t msgId) const {
+        connectOnce();
+        return LocIpcInetSender::send(data, length, msgId);
+    }
+    virtual ssize_t sendBatch(const LocIpcMsgData msgs[], uint32_t count) const override {
+        connectOnce();
+        return LocIpcInetSender::sendBatch(msgs, count);
     }
 
 public:
@@ -360,6 +1122,10 @@ bool LocIpc::send(LocIpcSender& sender, const uint8_t data[], uint32_t length, i
     return sender.sendData(data, length, msgId);
 }
 
+bool LocIpc::send(LocIpcSender& sender, const LocIpcMsgData msgs[], uint32_t count) {
+    return sender.sendDataBatch(msgs, count);
+}
+
 shared_ptr<LocIpcSender> LocIpc::getLocIpcLocalSender(const char* localSockName) {
     return make_shared<LocIpcLocalSender>(localSockName);
 }
@@ -367,6 +1133,14 @@ unique_ptr<LocIpcRecver> LocIpc::getLocIpcLocalRecver(const shared_ptr<ILocIpcLi
                                                       const char* localSockName) {
     return make_unique<LocIpcLocalRecver>(listener, localSockName);
 }
+shared_ptr<LocIpcSender> LocIpc::getLocIpcShmSender(const char* localSockName,
+                                                     uint32_t ringSize) {
+    return make_shared<LocIpcShmSender>(localSockName, ringSize);
+}
+unique_ptr<LocIpcRecver> LocIpc::getLocIpcShmRecver(const shared_ptr<ILocIpcListener>& listener,
+                                                    const char* localSockName) {
+    return make_unique<LocIpcShmRecver>(listener, localSockName);
+}
 static void* sLibQrtrHandle = nullptr;
 static const char* sLibQrtrName = "libloc_socket.so";
 shared_ptr<LocIpcSender> LocIpc::getLocIpcQrtrSender(int service, int instance) {
@@ -412,3 +1186,253 @@ pair<shared_ptr<LocIpcSender>, unique_ptr<LocIpcRecver>>
 }
 
 }
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <mutex>
+#include <condition_variable>
+
+using namespace loc_util;
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+// Test messages start with the time they were sent, the rest is a pattern
+// that depends on the length, and framed ones go with the length as msgId.
+static void fillMsg(uint8_t* msg, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        msg[i] = (uint8_t)(i ^ length);
+    }
+}
+
+static void stampMsg(uint8_t* msg) {
+    double now = getSeconds();
+    memcpy(msg, &now, sizeof(now));
+}
+
+struct LocIpcDebugListener : public ILocIpcListener {
+    mutex mLock;
+    condition_variable mCond;
+    bool mReady = false;
+    uint32_t mCount = 0;
+    uint32_t mBad = 0;
+    double mLatency = 0;
+    double mLastSent = 0;
+
+    virtual void onListenerReady() override {
+        lock_guard<mutex> lock(mLock);
+        mReady = true;
+        mCond.notify_all();
+    }
+    virtual void onReceive(const char* data, uint32_t len, const LocIpcRecver* recver) override {
+        onReceiveWithId(data, len, recver, -1);
+    }
+    virtual void onReceiveWithId(const char* data, uint32_t len, const LocIpcRecver*,
+                                 int32_t msgId) override {
+        double sent;
+        memcpy(&sent, data, sizeof(sent));
+        bool good = (0 == data[len]) && (-1 == msgId || (int32_t)len == msgId);
+        for (uint32_t i = sizeof(sent); i < len && good; i++) {
+            good = ((uint8_t)data[i] == (uint8_t)(i ^ len));
+        }
+        double latency = getSeconds() - sent;
+        lock_guard<mutex> lock(mLock);
+        // stamps only ever grow, unless messages got out of order
+        good = good && (sent >= mLastSent);
+        mLastSent = sent;
+        mBad += good ? 0 : 1;
+        mLatency += latency;
+        mCount++;
+        mCond.notify_all();
+    }
+    void waitFor(uint32_t count) {
+        unique_lock<mutex> lock(mLock);
+        mCond.wait(lock, [&] { return mCount >= count; });
+    }
+    void reset() {
+        lock_guard<mutex> lock(mLock);
+        mCount = mBad = 0;
+        mLatency = mLastSent = 0;
+    }
+};
+
+// The thread, and with it the recver, goes away with ipc.
+static bool startListening(LocIpc& ipc, unique_ptr<LocIpcRecver> recver,
+                           LocIpcDebugListener& listener) {
+    listener.mReady = false;
+    if (!ipc.startNonBlockingListening(recver)) {
+        return false;
+    }
+    unique_lock<mutex> lock(listener.mLock);
+    listener.mCond.wait(lock, [&] { return listener.mReady; });
+    return true;
+}
+
+// An unframed sender must put on the wire exactly what it always did, for
+// receivers that predate frames.
+static bool checkLegacyWire(const char* name) {
+    int sid = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    struct sockaddr_un addr = {.sun_family = AF_UNIX, {}};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", name);
+    unlink(name);
+    bool ok = (::bind(sid, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    auto sender = LocIpc::getLocIpcLocalSender(name);
+    static uint8_t msg[20000];
+    static char buf[8192];
+    fillMsg(msg, sizeof(msg));
+    ok = ok && LocIpc::send(*sender, msg, 100, 5);
+    ok = ok && (::recv(sid, buf, sizeof(buf), 0) == 100) && (0 == memcmp(buf, msg, 100));
+    ok = ok && LocIpc::send(*sender, msg, sizeof(msg));
+    ok = ok && (::recv(sid, buf, sizeof(buf), 0) == 13) && (0 == memcmp(buf, "$MSGLEN$20000", 13));
+    for (uint32_t offset = 0; ok && offset < sizeof(msg); offset += sizeof(buf)) {
+        ssize_t length = min(sizeof(msg) - offset, sizeof(buf));
+        ok = (::recv(sid, buf, sizeof(buf), 0) == length) && (0 == memcmp(buf, msg + offset, length));
+    }
+    ::close(sid);
+    unlink(name);
+    printf("legacy wire format: %s\n", ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// Sends count messages of length bytes, batch of them per LocIpc::send() if
+// batch is not 0, and reports the throughput. Then sends one message at a
+// time and waits for it, and reports the latency.
+static bool bench(const char* label, LocIpcSender& sender, LocIpcDebugListener& listener,
+                  uint32_t length, uint32_t count, uint32_t batch) {
+    static LocIpcMsgData msgs[64];
+    static uint8_t* data[64];
+    for (uint32_t i = 0; i < 64; i++) {
+        data[i] = (uint8_t*)realloc(data[i], length);
+        fillMsg(data[i], length);
+        msgs[i] = {data[i], length, (int32_t)length};
+    }
+    bool ok = true;
+    listener.reset();
+    double start = getSeconds();
+    for (uint32_t i = 0; i < count && ok; ) {
+        if (batch > 0) {
+            uint32_t n = min(batch, count - i);
+            for (uint32_t k = 0; k < n; k++) {
+                stampMsg(data[k]);
+            }
+            ok = LocIpc::send(sender, msgs, n);
+            i += n;
+        } else {
+            stampMsg(data[0]);
+            ok = LocIpc::send(sender, data[0], length, length);
+            i++;
+        }
+    }
+    if (ok) {
+        listener.waitFor(count);
+    }
+    double elapsed = getSeconds() - start;
+    uint32_t bad = listener.mBad;
+
+    uint32_t pings = count / 10;
+    listener.reset();
+    for (uint32_t i = 0; i < pings && ok; i++) {
+        stampMsg(data[0]);
+        ok = LocIpc::send(sender, data[0], length, length);
+        listener.waitFor(i + 1);
+    }
+    bad += listener.mBad;
+    printf("%-14s %6u B: %8.0f msgs/s %8.1f MB/s, latency %6.1f us%s\n", label, length,
+           count / elapsed, (double)count * length / elapsed / 1000000,
+           listener.mLatency * 1000000 / pings, (ok && 0 == bad) ? "" : ", FAILED");
+    return ok && 0 == bad;
+}
+
+// Messages of all sizes, up to several times the ring, from a shared
+// memory sender and a socket sender into one shared memory recver, and a
+// recver that goes away and comes back.
+static bool checkShmLoopback(const char* name, uint32_t count) {
+    const uint32_t lengths[] = {1, 8, 63, 64, 100, 1000, 8192, 65536, 300000};
+    static uint8_t msg[300000];
+    auto listener = make_shared<LocIpcDebugListener>();
+    auto shmSender = LocIpc::getLocIpcShmSender(name, 64 * 1024);
+    auto localSender = LocIpc::getLocIpcLocalSender(name);
+    bool ok = true;
+    uint32_t sent = 0;
+    for (int restart = 0; restart < 2; restart++) {
+        // the old recver is gone by the end of this block
+        {
+            LocIpc ipc;
+            ok = startListening(ipc, LocIpc::getLocIpcShmRecver(listener, name), *listener) && ok;
+            listener->reset();
+            sent = 0;
+            for (uint32_t i = 0; i < count && ok; i++) {
+                uint32_t length = max(lengths[i % 9], (uint32_t)sizeof(double));
+                fillMsg(msg, length);
+                stampMsg(msg);
+                // the socket is a path of its own, so keep it in order by hand
+                bool local = (0 == i % 7);
+                if (local) {
+                    listener->waitFor(sent);
+                }
+                ok = LocIpc::send(local ? *localSender : *shmSender, msg, length, length);
+                sent++;
+                if (local) {
+                    listener->waitFor(sent);
+                }
+            }
+            listener->waitFor(sent);
+            ok = ok && 0 == listener->mBad && sent == listener->mCount;
+        }
+        shmSender->informRecverRestarted();
+    }
+    printf("shm loopback: %u messages, %s\n", sent, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+// For Linux command line testing:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../pla/oe LocIpc.cpp, link with libgps_utils
+// test: ./a.out 100000
+// Checks that unframed senders keep the old wire format, then measures
+// throughput and latency over a local socket, unframed, framed, and framed
+// in batches, and over shared memory, for short messages and ones longer than
+// a datagram.
+int main(int argc, char** argv) {
+    uint32_t count = (argc > 1) ? atoi(argv[1]) : 100000;
+    char name[64];
+    snprintf(name, sizeof(name), "/tmp/locipc_debug.%d", getpid());
+    bool ok = checkLegacyWire(name);
+    ok = checkShmLoopback(name, count / 10) && ok;
+
+    const uint32_t lengths[] = {64, 1024, 20000};
+    {
+        auto listener = make_shared<LocIpcDebugListener>();
+        LocIpc ipc;
+        ok = startListening(ipc, LocIpc::getLocIpcLocalRecver(listener, name), *listener) && ok;
+        auto sender = LocIpc::getLocIpcLocalSender(name);
+        for (uint32_t length : lengths) {
+            uint32_t n = (length > 8192) ? count / 20 : count;
+            sender->setFramed(false);
+            ok = bench("unframed", *sender, *listener, length, n, 0) && ok;
+            sender->setFramed(true);
+            ok = bench("framed", *sender, *listener, length, n, 0) && ok;
+            ok = bench("framed x16", *sender, *listener, length, n, 16) && ok;
+        }
+    }
+    {
+        auto listener = make_shared<LocIpcDebugListener>();
+        LocIpc ipc;
+        ok = startListening(ipc, LocIpc::getLocIpcShmRecver(listener, name), *listener) && ok;
+        auto sender = LocIpc::getLocIpcShmSender(name);
+        for (uint32_t length : lengths) {
+            uint32_t n = (length > 8192) ? count / 20 : count;
+            ok = bench("shm", *sender, *listener, length, n, 0) && ok;
+            ok = bench("shm x16", *sender, *listener, length, n, 16) && ok;
+        }
+    }
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+#endif
@@ -54,6 +54,19 @@ public:
     // when the socket for LocIpc is ready to receive messages.
     inline virtual void onListenerReady() {}
     virtual void onReceive(const char* data, uint32_t len, const LocIpcRecver* recver) = 0;
+    // Same as onReceive(), plus the msgId a framing sender sent the message with,
+    // or -1 if the message came without a frame. Keep it the last virtual.
+    inline virtual void onReceiveWithId(const char* data, uint32_t len,
+                                        const LocIpcRecver* recver, int32_t /* msgId */) {
+        onReceive(data, len, recver);
+    }
+};
+
+// one message of a batch for LocIpc::send()
+struct LocIpcMsgData {
+    const uint8_t* data;
+    uint32_t length;
+    int32_t msgId;
 };
 
 
@@ -72,6 +85,11 @@ public:
             getLocIpcInetTcpSender(const char* serverName, int32_t port);
     static shared_ptr<LocIpcSender>
             getLocIpcQrtrSender(int service, int instance);
+    // Same host only. Messages go through a ring of ringSize bytes in shared
+    // memory, set up over the local socket localSockName. The recver also
+    // takes messages from a getLocIpcLocalSender() sender on the same name.
+    static shared_ptr<LocIpcSender>
+            getLocIpcShmSender(const char* localSockName, uint32_t ringSize = 256 * 1024);
 
     static unique_ptr<LocIpcRecver>
             getLocIpcLocalRecver(const shared_ptr<ILocIpcListener>& listener,
@@ -85,6 +103,9 @@ public:
     static unique_ptr<LocIpcRecver>
             getLocIpcQrtrRecver(const shared_ptr<ILocIpcListener>& listener,
                                 int service, int instance);
+    static unique_ptr<LocIpcRecver>
+            getLocIpcShmRecver(const shared_ptr<ILocIpcListener>& listener,
+                               const char* localSockName);
 
     static pair<shared_ptr<LocIpcSender>, unique_ptr<LocIpcRecver>>
             getLocIpcQmiLocServiceSenderRecverPair(const shared_ptr<ILocIpcListener>& listener,
@@ -111,6 +132,9 @@ public:
     // The function will return true on success, and false on failure.
     static bool send(LocIpcSender& sender, const uint8_t data[],
                      uint32_t length, int32_t msgId = -1);
+    // Send out a batch of messages, in order. Socket based senders hand the
+    // whole batch to the kernel in as few system calls as they can.
+    static bool send(LocIpcSender& sender, const LocIpcMsgData msgs[], uint32_t count);
 
 private:
     LocThread mThread;
@@ -132,9 +156,28 @@ public:
     inline bool sendData(const uint8_t data[], uint32_t length, int32_t msgId) const {
         return isSendable() && (send(data, length, msgId) > 0);
     }
+    inline bool sendDataBatch(const LocIpcMsgData msgs[], uint32_t count) const {
+        return isSendable() && (sendBatch(msgs, count) > 0);
+    }
     virtual unique_ptr<LocIpcRecver> getRecver(const shared_ptr<ILocIpcListener>& listener) {
         return nullptr;
     }
+    // The virtuals below come after every older one, so that the vtable of a
+    // prebuilt sender keeps its layout.
+    // Put each message behind a binary frame header carrying its length and
+    // msgId. Only turn this on towards a peer known to understand frames; a
+    // receiver answers in frames by itself once it got a framed message.
+    // Returns false if this sender has no framed format.
+    virtual bool setFramed(bool /* framed */) { return false; }
+protected:
+    virtual ssize_t sendBatch(const LocIpcMsgData msgs[], uint32_t count) const {
+        ssize_t rtv = 0;
+        for (uint32_t i = 0; i < count && rtv >= 0; i++) {
+            ssize_t sent = send(msgs[i].data, msgs[i].length, msgs[i].msgId);
+            rtv = (sent > 0) ? (rtv + sent) : -1;
+        }
+        return rtv;
+    }
 };
 
 class LocIpcRecver {
@@ -162,6 +205,8 @@ class Sock {
     static const char MSG_ABORT[];
     static const char LOC_IPC_HEAD[];
     const uint32_t mMaxTxSize;
+    // adds what framing and batching need, see LocIpc.cpp
+    friend class LocIpcSock;
     ssize_t sendto(const void *buf, size_t len, int flags, const struct sockaddr *destAddr,
                    socklen_t addrlen) const;
     ssize_t recvfrom(const LocIpcRecver& recver, const shared_ptr<ILocIpcListener>& dataCb,
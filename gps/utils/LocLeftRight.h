@@ -0,0 +1,99 @@
+/* Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_LEFT_RIGHT_H__
+#define __LOC_LEFT_RIGHT_H__
+
+#include <stdint.h>
+#include <sched.h>
+#include <pthread.h>
+#include <atomic>
+
+namespace loc_util {
+
+// Left-Right concurrency control over an obj of T: two copies of the obj
+// are kept, readers always read the one that writers are not modifying.
+// read() never waits and never blocks writers out; write() is serialized,
+// applies the change to both copies, and, in between, waits for readers
+// still on the copy it is about to modify to finish. So readers have to be
+// short, such as copying the obj out. The change passed to write() is
+// applied twice, and must leave both copies the same.
+template <typename T>
+class LocLeftRight {
+    T mInstances[2];
+    // index of the copy that readers go to
+    std::atomic<uint32_t> mLeftRight;
+    // index of the reader count that new readers arrive at
+    std::atomic<uint32_t> mVersion;
+    mutable std::atomic<uint32_t> mReaders[2];
+    pthread_mutex_t mWriterMutex;
+
+    inline void waitForReaders(uint32_t version) {
+        while (mReaders[version].load() > 0) {
+            sched_yield();
+        }
+    }
+
+public:
+    inline LocLeftRight() : mLeftRight(0), mVersion(0) {
+        mReaders[0] = 0;
+        mReaders[1] = 0;
+        pthread_mutex_init(&mWriterMutex, NULL);
+    }
+    inline ~LocLeftRight() { pthread_mutex_destroy(&mWriterMutex); }
+
+    // reader is called with a const T&
+    template <typename READER>
+    inline void read(READER reader) const {
+        uint32_t version = mVersion.load();
+        mReaders[version]++;
+        reader(mInstances[mLeftRight.load()]);
+        mReaders[version]--;
+    }
+
+    // writer is called with a T&, once for each copy
+    template <typename WRITER>
+    inline void write(WRITER writer) {
+        pthread_mutex_lock(&mWriterMutex);
+        uint32_t leftRight = mLeftRight.load();
+        writer(mInstances[1 - leftRight]);
+        // new readers go to the copy just modified
+        mLeftRight.store(1 - leftRight);
+        // wait for readers that might have seen the old mLeftRight
+        uint32_t version = mVersion.load();
+        waitForReaders(1 - version);
+        mVersion.store(1 - version);
+        waitForReaders(version);
+        writer(mInstances[leftRight]);
+        pthread_mutex_unlock(&mWriterMutex);
+    }
+};
+
+} // namespace loc_util
+
+#endif // __LOC_LEFT_RIGHT_H__
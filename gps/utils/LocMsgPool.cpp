@@ -0,0 +1,151 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_TAG "LocSvc_MsgPool"
+
+#include <LocMsgPool.h>
+
+namespace loc_util {
+
+void LocMsgPool::logStats() {
+    uint64_t hits, misses;
+    uint32_t cached;
+    getStats(hits, misses, cached);
+    LOC_LOGd("%s: block %zu, hits %" PRIu64 ", misses %" PRIu64 ", cached %u",
+             mName, mBlockSize, hits, misses, cached);
+}
+
+void LocMsgPool::logAllStats() {
+    pthread_mutex_lock(registryMutex());
+    for (LocMsgPool* pool = registryHead(); nullptr != pool; pool = pool->mNextPool) {
+        pool->logStats();
+    }
+    pthread_mutex_unlock(registryMutex());
+}
+
+} // namespace loc_util
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+
+using namespace loc_util;
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+static std::atomic<uint32_t> sProcessed(0);
+
+// the size of a report message: SV status is about 6 KB, measurements 21 KB
+template <size_t SIZE>
+struct DebugHeapMsg : public LocMsg {
+    char mPayload[SIZE];
+    inline DebugHeapMsg(char c) { mPayload[0] = c; mPayload[SIZE - 1] = c; }
+    inline virtual void proc() const { sProcessed++; }
+};
+
+template <size_t SIZE>
+struct DebugPooledMsg : public LocPooledMsg<DebugPooledMsg<SIZE>> {
+    char mPayload[SIZE];
+    inline DebugPooledMsg(char c) { mPayload[0] = c; mPayload[SIZE - 1] = c; }
+    inline virtual void proc() const { sProcessed++; }
+};
+
+// ns per message sent from this thread and deleted on the MsgTask, the way
+// the LocApi thread reports to the adapters, at most *burst* in flight
+template <typename M>
+static double debugSend(MsgTask* msgTask, uint32_t count, uint32_t burst) {
+    sProcessed = 0;
+    double t0 = getSeconds();
+    for (uint32_t i = 0; i < count; i++) {
+        while (i - sProcessed.load() >= burst) {
+            sched_yield();
+        }
+        msgTask->sendMsg(new M((char)i));
+    }
+    while (sProcessed.load() < count) {
+        sched_yield();
+    }
+    return (getSeconds() - t0) * 1e9 / count;
+}
+
+// ns per new / delete on one thread, no queue
+template <typename M>
+static double debugAlloc(uint32_t count) {
+    double t0 = getSeconds();
+    for (uint32_t i = 0; i < count; i++) {
+        M* msg = new M((char)i);
+        msg->proc();
+        delete msg;
+    }
+    return (getSeconds() - t0) * 1e9 / count;
+}
+
+template <size_t SIZE>
+static void debugRun(MsgTask* msgTask, uint32_t count, uint32_t burst) {
+    printf("%6zu B  alloc: heap %7.1f ns, pooled %7.1f ns   "
+           "through MsgTask: heap %7.1f ns, pooled %7.1f ns\n", SIZE,
+           debugAlloc<DebugHeapMsg<SIZE>>(count), debugAlloc<DebugPooledMsg<SIZE>>(count),
+           debugSend<DebugHeapMsg<SIZE>>(msgTask, count, burst),
+           debugSend<DebugPooledMsg<SIZE>>(msgTask, count, burst));
+}
+
+// For Linux command line testing:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../pla/oe LocMsgPool.cpp, link with libgps_utils
+// test: ./a.out [<messages> [<burst>]]
+// Allocates and frees report sized messages on one thread, then sends them
+// to a MsgTask which deletes them, with up to *burst* of them queued, each
+// from the heap and from a LocMsgPool; then logs the counters of the pools.
+int main(int argc, char** argv) {
+    uint32_t count = (argc > 1) ? atoi(argv[1]) : 200000;
+    uint32_t burst = (argc > 2) ? atoi(argv[2]) : 4;
+    MsgTask* msgTask = new MsgTask("LocMsgPoolTest", false);
+
+    debugRun<256>(msgTask, count, burst);
+    debugRun<6 * 1024>(msgTask, count, burst);
+    debugRun<21 * 1024>(msgTask, count, burst);
+    debugRun<160 * 1024>(msgTask, count / 10, burst);
+
+    uint64_t hits, misses;
+    uint32_t cached;
+    DebugPooledMsg<6 * 1024>::pool().getStats(hits, misses, cached);
+    printf("6 KB pool: hits %" PRIu64 ", misses %" PRIu64 ", cached %u\n",
+           hits, misses, cached);
+    LocMsgPool::logAllStats();
+    msgTask->destroy();
+    return 0;
+}
+
+#endif // __LOC_DEBUG__
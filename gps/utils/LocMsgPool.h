@@ -0,0 +1,156 @@
+/* Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_MSG_POOL_H__
+#define __LOC_MSG_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <new>
+#include <MsgTask.h>
+#include <log_util.h>
+
+namespace loc_util {
+
+// A free list of fixed size blocks. Blocks released by the consumer thread
+// are kept, up to *maxFree* of them, and handed back to the next alloc()
+// instead of going through the heap. Blocks of any other size, or beyond
+// the cap, go straight to the heap.
+// Every pool links itself into a process wide list so that logAllStats()
+// can dump hit / miss counters, e.g. along with a debug report.
+class LocMsgPool {
+    struct FreeNode {
+        FreeNode* next;
+    };
+    inline static pthread_mutex_t* registryMutex() {
+        static pthread_mutex_t sMutex = PTHREAD_MUTEX_INITIALIZER;
+        return &sMutex;
+    }
+    inline static LocMsgPool*& registryHead() {
+        static LocMsgPool* sHead = nullptr;
+        return sHead;
+    }
+    const char* mName;
+    LocMsgPool* mNextPool;
+    const size_t mBlockSize;
+    const uint32_t mMaxFree;
+    pthread_mutex_t mMutex;
+    FreeNode* mFreeList;
+    uint32_t mFreeCount;
+    uint64_t mHits;
+    uint64_t mMisses;
+
+public:
+    inline LocMsgPool(const char* name, size_t blockSize, uint32_t maxFree) :
+        mName(name), mNextPool(nullptr),
+        mBlockSize(blockSize < sizeof(FreeNode) ? sizeof(FreeNode) : blockSize),
+        mMaxFree(maxFree), mFreeList(nullptr), mFreeCount(0), mHits(0), mMisses(0) {
+        pthread_mutex_init(&mMutex, NULL);
+        pthread_mutex_lock(registryMutex());
+        mNextPool = registryHead();
+        registryHead() = this;
+        pthread_mutex_unlock(registryMutex());
+    }
+
+    inline void* alloc(size_t size) {
+        if (size != mBlockSize) {
+            return ::operator new(size);
+        }
+        FreeNode* node = nullptr;
+        pthread_mutex_lock(&mMutex);
+        if (nullptr != mFreeList) {
+            node = mFreeList;
+            mFreeList = node->next;
+            mFreeCount--;
+            mHits++;
+        } else {
+            mMisses++;
+        }
+        pthread_mutex_unlock(&mMutex);
+        return (nullptr != node) ? node : ::operator new(size);
+    }
+
+    inline void release(void* p, size_t size) {
+        if (nullptr == p) {
+            return;
+        }
+        if (size == mBlockSize) {
+            pthread_mutex_lock(&mMutex);
+            if (mFreeCount < mMaxFree) {
+                FreeNode* node = (FreeNode*)p;
+                node->next = mFreeList;
+                mFreeList = node;
+                mFreeCount++;
+                p = nullptr;
+            }
+            pthread_mutex_unlock(&mMutex);
+        }
+        if (nullptr != p) {
+            ::operator delete(p);
+        }
+    }
+
+    // allocations served from the free list / from the heap, blocks cached
+    inline void getStats(uint64_t& hits, uint64_t& misses, uint32_t& cached) {
+        pthread_mutex_lock(&mMutex);
+        hits = mHits;
+        misses = mMisses;
+        cached = mFreeCount;
+        pthread_mutex_unlock(&mMutex);
+    }
+
+    void logStats();
+    static void logAllStats();
+};
+
+// Base for LocMsg subclasses that are created on every report from the
+// modem. new / delete of *T* go through one LocMsgPool per type, e.g.
+//     struct MsgReportPosition : public LocPooledMsg<MsgReportPosition> {...};
+// *BASE* may be LocCoalescableMsg for messages that can be coalesced.
+// The pool is never destructed, so messages still queued at exit are safe
+// to delete.
+template <typename T, uint32_t MAX_FREE = 8, typename BASE = LocMsg>
+struct LocPooledMsg : public BASE {
+    inline static LocMsgPool& pool() {
+        // __PRETTY_FUNCTION__ spells out T, which names the pool in logs
+        static LocMsgPool* sPool = new LocMsgPool(__PRETTY_FUNCTION__, sizeof(T), MAX_FREE);
+        return *sPool;
+    }
+    inline static void* operator new(size_t size) {
+        return pool().alloc(size);
+    }
+    inline static void operator delete(void* p, size_t size) {
+        pool().release(p, size);
+    }
+};
+
+} // namespace loc_util
+
+#endif // __LOC_MSG_POOL_H__
@@ -0,0 +1,134 @@
+/* Copyright (c) 2020 The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_RING_BUFFER_H__
+#define __LOC_RING_BUFFER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
+
+namespace loc_util {
+
+// A fixed capacity FIFO of up to N copies of T, stored inline. Once full,
+// push_back() evicts the oldest item, in O(1), without moving the others or
+// ever allocating. Indexing and iteration go from the oldest to the newest.
+// Only the live items are constructed, and copied along with the container.
+template <typename T, uint32_t N>
+class LocRingBuffer {
+    struct alignas(T) Slot {
+        unsigned char mBytes[sizeof(T)];
+    };
+    Slot mSlots[N];
+    // index of the oldest item
+    uint32_t mHead;
+    uint32_t mSize;
+
+    inline T* slot(uint32_t i) {
+        return reinterpret_cast<T*>(mSlots[(mHead + i) % N].mBytes);
+    }
+    inline const T* slot(uint32_t i) const {
+        return reinterpret_cast<const T*>(mSlots[(mHead + i) % N].mBytes);
+    }
+
+    template <typename RING, typename ITEM>
+    class Iterator {
+        RING* mRing;
+        uint32_t mIndex;
+    public:
+        inline Iterator(RING* ring, uint32_t index) : mRing(ring), mIndex(index) {}
+        inline ITEM& operator*() const { return (*mRing)[mIndex]; }
+        inline ITEM* operator->() const { return &(*mRing)[mIndex]; }
+        inline Iterator& operator++() { mIndex++; return *this; }
+        inline bool operator==(const Iterator& it) const { return mIndex == it.mIndex; }
+        inline bool operator!=(const Iterator& it) const { return mIndex != it.mIndex; }
+    };
+
+public:
+    typedef T value_type;
+    typedef Iterator<LocRingBuffer, T> iterator;
+    typedef Iterator<const LocRingBuffer, const T> const_iterator;
+
+    inline LocRingBuffer() : mHead(0), mSize(0) {}
+    inline LocRingBuffer(const LocRingBuffer& ring) : mHead(0), mSize(0) {
+        for (uint32_t i = 0; i < ring.mSize; i++) {
+            push_back(ring[i]);
+        }
+    }
+    inline LocRingBuffer& operator=(const LocRingBuffer& ring) {
+        if (this != &ring) {
+            clear();
+            for (uint32_t i = 0; i < ring.mSize; i++) {
+                push_back(ring[i]);
+            }
+        }
+        return *this;
+    }
+    inline ~LocRingBuffer() { clear(); }
+
+    inline void push_back(const T& item) {
+        if (mSize < N) {
+            new (slot(mSize)) T(item);
+            mSize++;
+        } else {
+            // the oldest slot becomes the newest
+            slot(0)->~T();
+            new (slot(0)) T(item);
+            mHead = (mHead + 1) % N;
+        }
+    }
+
+    inline void clear() {
+        for (uint32_t i = 0; i < mSize; i++) {
+            slot(i)->~T();
+        }
+        mHead = 0;
+        mSize = 0;
+    }
+
+    inline bool empty() const { return 0 == mSize; }
+    inline size_t size() const { return mSize; }
+    inline static size_t capacity() { return N; }
+
+    // i-th oldest item
+    inline T& operator[](size_t i) { return *slot(i); }
+    inline const T& operator[](size_t i) const { return *slot(i); }
+    inline T& front() { return *slot(0); }
+    inline const T& front() const { return *slot(0); }
+    inline T& back() { return *slot(mSize - 1); }
+    inline const T& back() const { return *slot(mSize - 1); }
+
+    inline iterator begin() { return iterator(this, 0); }
+    inline iterator end() { return iterator(this, mSize); }
+    inline const_iterator begin() const { return const_iterator(this, 0); }
+    inline const_iterator end() const { return const_iterator(this, mSize); }
+};
+
+} // namespace loc_util
+
+#endif // __LOC_RING_BUFFER_H__
@@ -0,0 +1,127 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_TAG "LocSvc_StartupTrace"
+
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <algorithm>
+#include <LocStartupTrace.h>
+#include <loc_pla.h>
+#include <log_util.h>
+
+namespace loc_util {
+
+// a slot is claimed by bumping sCount, and is readable once its name is set
+struct LocStartupSlot {
+    std::atomic<const char*> mName;
+    int32_t mTid;
+    uint64_t mStartNs;
+    std::atomic<uint64_t> mEndNs;
+};
+
+static LocStartupSlot sSlots[LocStartupTrace::MAX_PHASES];
+static std::atomic<uint32_t> sCount(0);
+
+static uint64_t nowNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+int32_t LocStartupTrace::begin(const char* name) {
+    uint32_t index = sCount.fetch_add(1, std::memory_order_relaxed);
+    if (index >= MAX_PHASES) {
+        return -1;
+    }
+    LocStartupSlot& slot = sSlots[index];
+    slot.mTid = gettid();
+    slot.mEndNs.store(0, std::memory_order_relaxed);
+    slot.mStartNs = nowNs();
+    slot.mName.store(name, std::memory_order_release);
+    return (int32_t)index;
+}
+
+void LocStartupTrace::end(int32_t phase) {
+    if (phase >= 0 && phase < (int32_t)MAX_PHASES) {
+        sSlots[phase].mEndNs.store(nowNs(), std::memory_order_release);
+    }
+}
+
+void LocStartupTrace::mark(const char* name) {
+    int32_t phase = begin(name);
+    if (phase >= 0) {
+        sSlots[phase].mEndNs.store(sSlots[phase].mStartNs, std::memory_order_release);
+    }
+}
+
+size_t LocStartupTrace::get(Phase* phases, size_t count) {
+    size_t recorded = std::min<size_t>(sCount.load(std::memory_order_relaxed), MAX_PHASES);
+    size_t copied = 0;
+    for (size_t i = 0; i < recorded && copied < count; i++) {
+        const char* name = sSlots[i].mName.load(std::memory_order_acquire);
+        if (NULL != name) {
+            phases[copied].mName = name;
+            phases[copied].mTid = sSlots[i].mTid;
+            phases[copied].mStartNs = sSlots[i].mStartNs;
+            phases[copied].mEndNs = sSlots[i].mEndNs.load(std::memory_order_acquire);
+            copied++;
+        }
+    }
+    // slots are claimed in about the order phases begin, but not exactly so
+    std::sort(phases, phases + copied, [](const Phase& a, const Phase& b) {
+        return a.mStartNs < b.mStartNs;
+    });
+    return copied;
+}
+
+void LocStartupTrace::dump() {
+    Phase phases[MAX_PHASES];
+    size_t count = get(phases, MAX_PHASES);
+    if (0 == count) {
+        return;
+    }
+    uint64_t origin = phases[0].mStartNs;
+    for (size_t i = 0; i < count; i++) {
+        if (0 == phases[i].mEndNs) {
+            LOC_LOGI("startup: +%7.2f ms  running    tid %5d  %s",
+                     (phases[i].mStartNs - origin) / 1e6, phases[i].mTid, phases[i].mName);
+        } else {
+            LOC_LOGI("startup: +%7.2f ms  %7.2f ms  tid %5d  %s",
+                     (phases[i].mStartNs - origin) / 1e6,
+                     (phases[i].mEndNs - phases[i].mStartNs) / 1e6,
+                     phases[i].mTid, phases[i].mName);
+        }
+    }
+    if (sCount.load(std::memory_order_relaxed) > MAX_PHASES) {
+        LOC_LOGW("startup: %u phases dropped", sCount.load() - MAX_PHASES);
+    }
+}
+
+} // namespace loc_util
@@ -0,0 +1,77 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_STARTUP_TRACE_H__
+#define __LOC_STARTUP_TRACE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace loc_util {
+
+// Timeline of the bring up of the location stack: each init phase is
+// recorded with the thread it ran on, and when it started and ended. Phases
+// are recorded lock-free into a fixed table, so that tracing costs a couple
+// of clock reads; the ones past MAX_PHASES are dropped. Names must be string
+// literals, only their pointers are kept.
+class LocStartupTrace {
+public:
+    static const uint32_t MAX_PHASES = 64;
+
+    struct Phase {
+        const char* mName;
+        int32_t mTid;
+        // CLOCK_MONOTONIC; mEndNs is 0 while the phase is still running
+        uint64_t mStartNs;
+        uint64_t mEndNs;
+    };
+
+    // returns what to pass to end(), -1 if the table is full
+    static int32_t begin(const char* name);
+    static void end(int32_t phase);
+    // a phase with no duration, such as a milestone of the bring up
+    static void mark(const char* name);
+
+    // copies up to *count* of the phases recorded so far, in the order they
+    // began; returns the number copied
+    static size_t get(Phase* phases, size_t count);
+    // logs the timeline, relative to the start of the first phase
+    static void dump();
+};
+
+// traces the scope it lives in as a phase
+class LocStartupPhase {
+    int32_t mPhase;
+public:
+    inline LocStartupPhase(const char* name) : mPhase(LocStartupTrace::begin(name)) {}
+    inline ~LocStartupPhase() { LocStartupTrace::end(mPhase); }
+};
+
+} // namespace loc_util
+
+#endif // __LOC_STARTUP_TRACE_H__
@@ -0,0 +1,356 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <LocSvUsedMask.h>
+
+namespace loc_util {
+
+#define SV_USED_MB_SLOT(field) (offsetof(GnssSvMbUsedInPosition, field) / sizeof(uint64_t))
+#define SV_USED_SB_SLOT(field) \
+        (SV_USED_GPS + offsetof(GnssSvUsedInPosition, field) / sizeof(uint64_t))
+
+// slots have to stay in the order of the structs they are loaded from
+static_assert(sizeof(GnssSvMbUsedInPosition) == SV_USED_GPS * sizeof(uint64_t),
+              "GnssSvMbUsedInPosition does not match LocSvUsedSlot");
+static_assert(sizeof(GnssSvUsedInPosition) ==
+              (SV_USED_NONE - SV_USED_GPS) * sizeof(uint64_t),
+              "GnssSvUsedInPosition does not match LocSvUsedSlot");
+static_assert(SV_USED_MB_SLOT(gps_l5_sv_used_ids_mask) == SV_USED_GPS_L5 &&
+              SV_USED_MB_SLOT(glo_g2_sv_used_ids_mask) == SV_USED_GLO_G2 &&
+              SV_USED_MB_SLOT(gal_e5b_sv_used_ids_mask) == SV_USED_GAL_E5B &&
+              SV_USED_MB_SLOT(bds_b2ai_sv_used_ids_mask) == SV_USED_BDS_B2AI &&
+              SV_USED_MB_SLOT(qzss_l5_sv_used_ids_mask) == SV_USED_QZSS_L5 &&
+              SV_USED_MB_SLOT(bds_b2aq_sv_used_ids_mask) == SV_USED_BDS_B2AQ,
+              "GnssSvMbUsedInPosition does not match LocSvUsedSlot");
+static_assert(SV_USED_SB_SLOT(glo_sv_used_ids_mask) == SV_USED_GLO &&
+              SV_USED_SB_SLOT(gal_sv_used_ids_mask) == SV_USED_GAL &&
+              SV_USED_SB_SLOT(bds_sv_used_ids_mask) == SV_USED_BDS &&
+              SV_USED_SB_SLOT(qzss_sv_used_ids_mask) == SV_USED_QZSS &&
+              SV_USED_SB_SLOT(navic_sv_used_ids_mask) == SV_USED_NAVIC,
+              "GnssSvUsedInPosition does not match LocSvUsedSlot");
+
+struct SvUsedSignal {
+    GnssSvType svType;
+    GnssSignalTypeMask signalType;
+    LocSvUsedSlot slot;
+};
+
+// the signals a multi band mask is kept for
+static constexpr SvUsedSignal sSvUsedSignals[] = {
+    { GNSS_SV_TYPE_GPS,     GNSS_SIGNAL_GPS_L1CA,    SV_USED_GPS_L1CA },
+    { GNSS_SV_TYPE_GPS,     GNSS_SIGNAL_GPS_L1C,     SV_USED_GPS_L1C },
+    { GNSS_SV_TYPE_GPS,     GNSS_SIGNAL_GPS_L2,      SV_USED_GPS_L2 },
+    { GNSS_SV_TYPE_GPS,     GNSS_SIGNAL_GPS_L5,      SV_USED_GPS_L5 },
+    { GNSS_SV_TYPE_GLONASS, GNSS_SIGNAL_GLONASS_G1,  SV_USED_GLO_G1 },
+    { GNSS_SV_TYPE_GLONASS, GNSS_SIGNAL_GLONASS_G2,  SV_USED_GLO_G2 },
+    { GNSS_SV_TYPE_GALILEO, GNSS_SIGNAL_GALILEO_E1,  SV_USED_GAL_E1 },
+    { GNSS_SV_TYPE_GALILEO, GNSS_SIGNAL_GALILEO_E5A, SV_USED_GAL_E5A },
+    { GNSS_SV_TYPE_GALILEO, GNSS_SIGNAL_GALILEO_E5B, SV_USED_GAL_E5B },
+    { GNSS_SV_TYPE_BEIDOU,  GNSS_SIGNAL_BEIDOU_B1I,  SV_USED_BDS_B1I },
+    { GNSS_SV_TYPE_BEIDOU,  GNSS_SIGNAL_BEIDOU_B1C,  SV_USED_BDS_B1C },
+    { GNSS_SV_TYPE_BEIDOU,  GNSS_SIGNAL_BEIDOU_B2I,  SV_USED_BDS_B2I },
+    { GNSS_SV_TYPE_BEIDOU,  GNSS_SIGNAL_BEIDOU_B2AI, SV_USED_BDS_B2AI },
+    { GNSS_SV_TYPE_BEIDOU,  GNSS_SIGNAL_BEIDOU_B2AQ, SV_USED_BDS_B2AQ },
+    { GNSS_SV_TYPE_QZSS,    GNSS_SIGNAL_QZSS_L1CA,   SV_USED_QZSS_L1CA },
+    { GNSS_SV_TYPE_QZSS,    GNSS_SIGNAL_QZSS_L1S,    SV_USED_QZSS_L1S },
+    { GNSS_SV_TYPE_QZSS,    GNSS_SIGNAL_QZSS_L2,     SV_USED_QZSS_L2 },
+    { GNSS_SV_TYPE_QZSS,    GNSS_SIGNAL_QZSS_L5,     SV_USED_QZSS_L5 },
+};
+
+// the single band mask of each constellation
+static constexpr LocSvUsedSlot sSvUsedConstellations[LocSvUsedMasks::SV_TYPES] = {
+    SV_USED_NONE,   // GNSS_SV_TYPE_UNKNOWN
+    SV_USED_GPS,    // GNSS_SV_TYPE_GPS
+    SV_USED_NONE,   // GNSS_SV_TYPE_SBAS
+    SV_USED_GLO,    // GNSS_SV_TYPE_GLONASS
+    SV_USED_QZSS,   // GNSS_SV_TYPE_QZSS
+    SV_USED_BDS,    // GNSS_SV_TYPE_BEIDOU
+    SV_USED_GAL,    // GNSS_SV_TYPE_GALILEO
+    SV_USED_NAVIC,  // GNSS_SV_TYPE_NAVIC
+};
+
+static constexpr uint32_t bitPosition(GnssSignalTypeMask signalType) {
+    return (signalType & 1) ? 0 : 1 + bitPosition(signalType >> 1);
+}
+
+static constexpr LocSvUsedMasks::Table buildSvUsedTable() {
+    LocSvUsedMasks::Table table = {};
+    for (uint32_t type = 0; type < LocSvUsedMasks::SV_TYPES; type++) {
+        for (uint32_t column = 0; column < LocSvUsedMasks::SIGNAL_COLUMNS; column++) {
+            table.slot[0][type][column] = sSvUsedConstellations[type];
+            table.slot[1][type][column] = (GNSS_SV_TYPE_NAVIC == type) ?
+                    SV_USED_NAVIC : SV_USED_NONE;
+        }
+    }
+    for (size_t i = 0; i < sizeof(sSvUsedSignals) / sizeof(sSvUsedSignals[0]); i++) {
+        table.slot[1][sSvUsedSignals[i].svType][bitPosition(sSvUsedSignals[i].signalType)] =
+                sSvUsedSignals[i].slot;
+    }
+    return table;
+}
+
+static constexpr LocSvUsedMasks::Table sSvUsedTable = buildSvUsedTable();
+static_assert(sSvUsedTable.slot[1][GNSS_SV_TYPE_BEIDOU][19] == SV_USED_BDS_B2AQ &&
+              sSvUsedTable.slot[1][GNSS_SV_TYPE_SBAS][17] == SV_USED_NONE &&
+              sSvUsedTable.slot[0][GNSS_SV_TYPE_QZSS][20] == SV_USED_QZSS,
+              "SV used table is not built as expected");
+
+const LocSvUsedMasks::Table LocSvUsedMasks::sTable = sSvUsedTable;
+
+} // namespace loc_util
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <time.h>
+
+using namespace loc_util;
+
+// the per SV lookup as GnssAdapter::reportSv had it
+static uint64_t legacySvUsedMask(GnssSvType type, GnssSignalTypeMask signalTypeMask,
+                                 bool usedAvail, bool mbUsedAvail,
+                                 const GnssSvUsedInPosition& used,
+                                 const GnssSvMbUsedInPosition& mbUsed) {
+    uint64_t svUsedIdMask = 0;
+    switch (type) {
+        case GNSS_SV_TYPE_GPS:
+            if (usedAvail) {
+                if (mbUsedAvail) {
+                    switch (signalTypeMask) {
+                    case GNSS_SIGNAL_GPS_L1CA: svUsedIdMask = mbUsed.gps_l1ca_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_GPS_L1C: svUsedIdMask = mbUsed.gps_l1c_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_GPS_L2: svUsedIdMask = mbUsed.gps_l2_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_GPS_L5: svUsedIdMask = mbUsed.gps_l5_sv_used_ids_mask; break;
+                    }
+                } else {
+                    svUsedIdMask = used.gps_sv_used_ids_mask;
+                }
+            }
+            break;
+        case GNSS_SV_TYPE_GLONASS:
+            if (usedAvail) {
+                if (mbUsedAvail) {
+                    switch (signalTypeMask) {
+                    case GNSS_SIGNAL_GLONASS_G1: svUsedIdMask = mbUsed.glo_g1_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_GLONASS_G2: svUsedIdMask = mbUsed.glo_g2_sv_used_ids_mask; break;
+                    }
+                } else {
+                    svUsedIdMask = used.glo_sv_used_ids_mask;
+                }
+            }
+            break;
+        case GNSS_SV_TYPE_BEIDOU:
+            if (usedAvail) {
+                if (mbUsedAvail) {
+                    switch (signalTypeMask) {
+                    case GNSS_SIGNAL_BEIDOU_B1I: svUsedIdMask = mbUsed.bds_b1i_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_BEIDOU_B1C: svUsedIdMask = mbUsed.bds_b1c_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_BEIDOU_B2I: svUsedIdMask = mbUsed.bds_b2i_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_BEIDOU_B2AI: svUsedIdMask = mbUsed.bds_b2ai_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_BEIDOU_B2AQ: svUsedIdMask = mbUsed.bds_b2aq_sv_used_ids_mask; break;
+                    }
+                } else {
+                    svUsedIdMask = used.bds_sv_used_ids_mask;
+                }
+            }
+            break;
+        case GNSS_SV_TYPE_GALILEO:
+            if (usedAvail) {
+                if (mbUsedAvail) {
+                    switch (signalTypeMask) {
+                    case GNSS_SIGNAL_GALILEO_E1: svUsedIdMask = mbUsed.gal_e1_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_GALILEO_E5A: svUsedIdMask = mbUsed.gal_e5a_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_GALILEO_E5B: svUsedIdMask = mbUsed.gal_e5b_sv_used_ids_mask; break;
+                    }
+                } else {
+                    svUsedIdMask = used.gal_sv_used_ids_mask;
+                }
+            }
+            break;
+        case GNSS_SV_TYPE_QZSS:
+            if (usedAvail) {
+                if (mbUsedAvail) {
+                    switch (signalTypeMask) {
+                    case GNSS_SIGNAL_QZSS_L1CA: svUsedIdMask = mbUsed.qzss_l1ca_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_QZSS_L1S: svUsedIdMask = mbUsed.qzss_l1s_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_QZSS_L2: svUsedIdMask = mbUsed.qzss_l2_sv_used_ids_mask; break;
+                    case GNSS_SIGNAL_QZSS_L5: svUsedIdMask = mbUsed.qzss_l5_sv_used_ids_mask; break;
+                    }
+                } else {
+                    svUsedIdMask = used.qzss_sv_used_ids_mask;
+                }
+            }
+            break;
+        case GNSS_SV_TYPE_NAVIC:
+            if (usedAvail) {
+                svUsedIdMask = used.navic_sv_used_ids_mask;
+            }
+            break;
+        default:
+            svUsedIdMask = 0;
+            break;
+    }
+    return svUsedIdMask;
+}
+
+// the constellation mask loc_nmea_generate_sv added a used SV to
+static uint64_t* legacyNmeaUsedMask(GnssSvType type, GnssSvUsedInPosition& used) {
+    if (GNSS_SV_TYPE_GPS == type) {
+        return &used.gps_sv_used_ids_mask;
+    } else if (GNSS_SV_TYPE_GLONASS == type) {
+        return &used.glo_sv_used_ids_mask;
+    } else if (GNSS_SV_TYPE_GALILEO == type) {
+        return &used.gal_sv_used_ids_mask;
+    } else if (GNSS_SV_TYPE_QZSS == type) {
+        return &used.qzss_sv_used_ids_mask;
+    } else if (GNSS_SV_TYPE_BEIDOU == type) {
+        return &used.bds_sv_used_ids_mask;
+    } else if (GNSS_SV_TYPE_NAVIC == type) {
+        return &used.navic_sv_used_ids_mask;
+    }
+    return NULL;
+}
+
+static uint64_t randomMask() {
+    return ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+}
+
+// For Linux command line testing:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../location -I../pla/oe LocSvUsedMask.cpp
+// test: ./a.out
+// Compares the table against the switch GnssAdapter::reportSv used to have,
+// and against the constellation chain of loc_nmea_generate_sv, for every
+// constellation value, every signal type mask of up to the 20 defined bits
+// and every availability of the masks; then times both per SV.
+int main() {
+    GnssSvUsedInPosition used;
+    GnssSvMbUsedInPosition mbUsed;
+    uint64_t* fields = (uint64_t*)&used;
+    for (size_t i = 0; i < sizeof(used) / sizeof(uint64_t); i++) {
+        fields[i] = randomMask() | 1;
+    }
+    fields = (uint64_t*)&mbUsed;
+    for (size_t i = 0; i < sizeof(mbUsed) / sizeof(uint64_t); i++) {
+        fields[i] = randomMask() | 1;
+    }
+
+    uint64_t checked = 0, failed = 0;
+    for (int avail = 0; avail < 3; avail++) {
+        bool usedAvail = (avail > 0);
+        bool mbUsedAvail = (avail > 1);
+        LocSvUsedMasks masks;
+        if (usedAvail) {
+            masks.load(used, mbUsedAvail ? &mbUsed : nullptr);
+        }
+        for (uint32_t type = 0; type < 16; type++) {
+            for (uint32_t signal = 0; signal < (1u << 20); signal++) {
+                uint64_t expected = legacySvUsedMask((GnssSvType)type, signal, usedAvail,
+                                                     mbUsedAvail, used, mbUsed);
+                uint64_t actual = masks.get(
+                        LocSvUsedMasks::slotOf((GnssSvType)type, signal, mbUsedAvail));
+                checked++;
+                if (expected != actual && failed++ < 10) {
+                    printf("FAIL: type %u signal 0x%x avail %d: 0x%" PRIx64 " != 0x%" PRIx64 "\n",
+                           type, signal, avail, actual, expected);
+                }
+            }
+            // and the bits past the defined ones, alone
+            for (uint32_t bit = 20; bit < 32; bit++) {
+                GnssSignalTypeMask signal = 1u << bit;
+                uint64_t expected = legacySvUsedMask((GnssSvType)type, signal, usedAvail,
+                                                     mbUsedAvail, used, mbUsed);
+                uint64_t actual = masks.get(
+                        LocSvUsedMasks::slotOf((GnssSvType)type, signal, mbUsedAvail));
+                checked++;
+                if (expected != actual && failed++ < 10) {
+                    printf("FAIL: type %u signal 0x%x avail %d\n", type, signal, avail);
+                }
+            }
+        }
+    }
+    for (uint32_t type = 0; type < 16; type++) {
+        GnssSvUsedInPosition expected = {};
+        uint64_t* field = legacyNmeaUsedMask((GnssSvType)type, expected);
+        if (NULL != field) {
+            *field = 1;
+        }
+        LocSvUsedMasks masks;
+        masks.add(LocSvUsedMasks::slotOf((GnssSvType)type, 0, false), 1);
+        GnssSvUsedInPosition actual = {};
+        masks.store(actual);
+        checked++;
+        if (0 != memcmp(&expected, &actual, sizeof(actual)) && failed++ < 10) {
+            printf("FAIL: nmea type %u\n", type);
+        }
+    }
+    printf("%" PRIu64 " lookups compared, %" PRIu64 " mismatches\n", checked, failed);
+
+    // one report of 64 SVs over all constellations and common signals
+    const int SVS = 64;
+    GnssSvType types[SVS];
+    GnssSignalTypeMask signals[SVS];
+    for (int i = 0; i < SVS; i++) {
+        const SvUsedSignal& s = sSvUsedSignals[rand() % (sizeof(sSvUsedSignals) /
+                                                         sizeof(sSvUsedSignals[0]))];
+        types[i] = s.svType;
+        signals[i] = s.signalType;
+    }
+    const int rounds = 200000;
+    volatile uint64_t sink = 0;
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int r = 0; r < rounds; r++) {
+        uint64_t sum = 0;
+        for (int i = 0; i < SVS; i++) {
+            sum += legacySvUsedMask(types[i], signals[(i + r) % SVS], true, true, used, mbUsed);
+        }
+        sink += sum;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    LocSvUsedMasks masks;
+    masks.load(used, &mbUsed);
+    for (int r = 0; r < rounds; r++) {
+        uint64_t sum = 0;
+        for (int i = 0; i < SVS; i++) {
+            sum += masks.get(LocSvUsedMasks::slotOf(types[i], signals[(i + r) % SVS], true));
+        }
+        sink += sum;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    double legacyNs = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) /
+            ((double)rounds * SVS);
+    double tableNs = ((t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec)) /
+            ((double)rounds * SVS);
+    printf("per SV: switch %.2f ns, table %.2f ns\n", legacyNs, tableNs);
+    printf("%s\n", (0 == failed) ? "PASS" : "FAIL");
+    return (0 == failed) ? 0 : 1;
+}
+
+#endif // __LOC_DEBUG__
@@ -0,0 +1,129 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_SV_USED_MASK_H__
+#define __LOC_SV_USED_MASK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <LocationDataTypes.h>
+#include <gps_extended_c.h>
+
+namespace loc_util {
+
+// Slots of the SV used in fix masks: the GnssSvMbUsedInPosition fields
+// first, in their order, then the GnssSvUsedInPosition ones, in theirs,
+// then one slot that is always 0.
+enum LocSvUsedSlot {
+    SV_USED_GPS_L1CA = 0,
+    SV_USED_GPS_L1C,
+    SV_USED_GPS_L2,
+    SV_USED_GPS_L5,
+    SV_USED_GLO_G1,
+    SV_USED_GLO_G2,
+    SV_USED_GAL_E1,
+    SV_USED_GAL_E5A,
+    SV_USED_GAL_E5B,
+    SV_USED_BDS_B1I,
+    SV_USED_BDS_B1C,
+    SV_USED_BDS_B2I,
+    SV_USED_BDS_B2AI,
+    SV_USED_QZSS_L1CA,
+    SV_USED_QZSS_L1S,
+    SV_USED_QZSS_L2,
+    SV_USED_QZSS_L5,
+    SV_USED_SBAS_L1,
+    SV_USED_BDS_B2AQ,
+    SV_USED_GPS,
+    SV_USED_GLO,
+    SV_USED_GAL,
+    SV_USED_BDS,
+    SV_USED_QZSS,
+    SV_USED_NAVIC,
+    SV_USED_NONE,
+    SV_USED_SLOTS
+};
+
+// The masks of SVs used in the last fix, in LocSvUsedSlot order, and the
+// slot that holds the mask of an SV, looked up in a table built at compile
+// time by constellation and by the bit of its signal type. An SV of an
+// unknown constellation, or whose signal type is not exactly one bit, gets
+// SV_USED_NONE when the multi band masks are used, like a signal type no
+// mask is kept for. NAVIC has no multi band mask and keeps its own.
+class LocSvUsedMasks {
+public:
+    static const uint32_t SV_TYPES = GNSS_SV_TYPE_NAVIC + 1;
+    // one column per signal type bit, and the last one for any other mask
+    static const uint32_t SIGNAL_COLUMNS = 21;
+    struct Table {
+        uint8_t slot[2][SV_TYPES][SIGNAL_COLUMNS]; // [multiBand][svType][signal]
+    };
+
+    inline LocSvUsedMasks() { clear(); }
+    inline void clear() { memset(mSlots, 0, sizeof(mSlots)); }
+    // masks of the last fix; NULL mbUsed if it has no multi band masks
+    inline void load(const GnssSvUsedInPosition& used, const GnssSvMbUsedInPosition* mbUsed) {
+        if (nullptr != mbUsed) {
+            memcpy(&mSlots[SV_USED_GPS_L1CA], mbUsed, sizeof(GnssSvMbUsedInPosition));
+        } else {
+            memset(&mSlots[SV_USED_GPS_L1CA], 0, sizeof(GnssSvMbUsedInPosition));
+        }
+        memcpy(&mSlots[SV_USED_GPS], &used, sizeof(GnssSvUsedInPosition));
+        mSlots[SV_USED_NONE] = 0;
+    }
+    inline void store(GnssSvUsedInPosition& used) const {
+        memcpy(&used, &mSlots[SV_USED_GPS], sizeof(GnssSvUsedInPosition));
+    }
+
+    inline static uint32_t slotOf(GnssSvType svType, GnssSignalTypeMask signalType,
+                                  bool multiBand) {
+        uint32_t type = (uint32_t)svType;
+        type = (type < SV_TYPES) ? type : (uint32_t)GNSS_SV_TYPE_UNKNOWN;
+        // position of the only bit set, else past the last column
+        uint32_t column = (0 == (signalType & (signalType - 1))) ?
+                __builtin_ctz(signalType | 0x80000000u) : 31;
+        column = (column < SIGNAL_COLUMNS - 1) ? column : SIGNAL_COLUMNS - 1;
+        return sTable.slot[multiBand ? 1 : 0][type][column];
+    }
+    inline uint64_t get(uint32_t slot) const { return mSlots[slot]; }
+    inline void add(uint32_t slot, uint64_t mask) {
+        mSlots[slot] |= mask;
+        mSlots[SV_USED_NONE] = 0;
+    }
+
+    static const Table sTable;
+
+private:
+    uint64_t mSlots[SV_USED_SLOTS];
+};
+
+} // namespace loc_util
+
+#endif // __LOC_SV_USED_MASK_H__
@@ -38,6 +38,7 @@
 #include <loc_timer.h>
 #include <LocTimer.h>
 #include <LocHeap.h>
+#include <LocTimerWheel.h>
 #include <LocThread.h>
 #include <LocSharedLock.h>
 #include <MsgTask.h>
@@ -54,7 +55,8 @@ LocTimer, LocTimerDelegate, LocTimerContainer, LocTimerPollTask, LocTimerWrapper
 
 LocTimer - client front end, interface for client to start / stop timers, also
            to provide a callback.
-LocTimerDelegate - an internal timer entity, which also is a LocRankable obj.
+LocTimerDelegate - an internal timer entity, which also is a LocRankable obj
+                   and a LocTimerWheelNode.
                    Its life cycle is different than that of LocTimer. It gets
                    created when LocTimer::start() is called, and gets deleted
                    when it expires or clients calls the hosting LocTimer obj's
@@ -71,7 +73,10 @@ LocTimerContainer - core of the timer service. It is a container (derived from
                     each (those that expire the soonest) to kernel via services
                     provided by LocTimerPollTask. All the heap management on the
                     LocTimerDelegate objs are done in the MsgTask context, such
-                    that synchronization is ensured.
+                    that synchronization is ensured. If LocTimer::useTimerWheel()
+                    was called, the timers are kept on a LocTimerWheel instead
+                    of the heap, with O(1) start / stop, and expirations are
+                    coalesced into slack sized windows.
 LocTimerPollTask - is a class that wraps timerfd and epoll POXIS APIs. It also
                    both implements LocRunnalbe with epoll_wait() in the run()
                    method. It is also a LocThread client, so as to loop the run
@@ -102,8 +107,14 @@ class LocTimerContainer : public LocHeap {
     static MsgTask* mMsgTask;
     // Poll task to provide epoll call and threading to poll.
     static LocTimerPollTask* mPollTask;
+    // 0 to keep timers in the heap; otherwise slack window of timer wheel
+    static uint32_t mWheelSlackMs;
     // timer / alarm fd
     int mDevFd;
+    // timer wheel, if enabled
+    LocTimerWheel* mWheel;
+    // wheel tick timerfd is currently armed with, 0 if disarmed
+    uint64_t mArmedTick;
     // ctor
     LocTimerContainer(bool wakeOnExpire);
     // dtor
@@ -114,10 +125,16 @@ class LocTimerContainer : public LocHeap {
     LocTimerDelegate* popIfOutRanks(LocTimerDelegate& timer);
     // update the timer POSIX calls with updated soonest timer spec
     void updateSoonestTime(LocTimerDelegate* priorTop);
+    // update the timer POSIX calls with the soonest tick of mWheel
+    void updateSoonestTick();
+    // wheel ticks are counted in mWheelSlackMs since boot
+    static uint64_t toTick(const struct timespec& time, bool roundUp);
 
 public:
     // factory method to control the creation of mSwTimers / mHwTimers
     static LocTimerContainer* get(bool wakeOnExpire);
+    // select the timer wheel for containers yet to be created
+    static void setWheelSlack(uint32_t slackInMs);
 
     LocTimerDelegate* getSoonestTimer();
     int getTimerFd();
@@ -173,7 +190,7 @@ public:
 // and gets deleted when client calls LocTimer::stop() or when the it expire()'s.
 // This class implements LocRankable::ranks() so that when an obj is added into
 // the container (of LocHeap), it gets placed in sorted order.
-class LocTimerDelegate : public LocRankable {
+class LocTimerDelegate : public LocRankable, public LocTimerWheelNode {
     friend class LocTimerContainer;
     friend class LocTimer;
     LocTimer* mClient;
@@ -205,12 +222,14 @@ LocTimerContainer* LocTimerContainer::mSwTimers = NULL;
 LocTimerContainer* LocTimerContainer::mHwTimers = NULL;
 MsgTask* LocTimerContainer::mMsgTask = NULL;
 LocTimerPollTask* LocTimerContainer::mPollTask = NULL;
+uint32_t LocTimerContainer::mWheelSlackMs = 0;
 
 // ctor - initialize timer heaps
 // A container for swTimer (timer) is created, when wakeOnExpire is true; or
 // HwTimer (alarm), when wakeOnExpire is false.
 LocTimerContainer::LocTimerContainer(bool wakeOnExpire) :
-    mDevFd(timerfd_create(wakeOnExpire ? CLOCK_BOOTTIME_ALARM : CLOCK_BOOTTIME, 0)) {
+    mDevFd(timerfd_create(wakeOnExpire ? CLOCK_BOOTTIME_ALARM : CLOCK_BOOTTIME, 0)),
+    mWheel(NULL), mArmedTick(0) {
 
     if ((-1 == mDevFd) && (errno == EINVAL)) {
         LOC_LOGW("%s: timerfd_create failure, fallback to CLOCK_MONOTONIC - %s",
@@ -222,6 +241,11 @@ LocTimerContainer::LocTimerContainer(bool wakeOnExpire) :
         // ensure we have the necessary resources created
         LocTimerContainer::getPollTaskLocked();
         LocTimerContainer::getMsgTaskLocked();
+        if (mWheelSlackMs > 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_BOOTTIME, &now);
+            mWheel = new LocTimerWheel(toTick(now, false));
+        }
     } else {
         LOC_LOGE("%s: timerfd_create failure - %s", __FUNCTION__, strerror(errno));
     }
@@ -232,6 +256,7 @@ LocTimerContainer::LocTimerContainer(bool wakeOnExpire) :
 inline
 LocTimerContainer::~LocTimerContainer() {
     close(mDevFd);
+    delete mWheel;
 }
 
 LocTimerContainer* LocTimerContainer::get(bool wakeOnExpire) {
@@ -254,6 +279,23 @@ LocTimerContainer* LocTimerContainer::get(bool wakeOnExpire) {
     return container;
 }
 
+void LocTimerContainer::setWheelSlack(uint32_t slackInMs) {
+    pthread_mutex_lock(&mMutex);
+    if (mSwTimers || mHwTimers) {
+        LOC_LOGW("%s: timers already in use, keeping slack %u ms",
+                 __FUNCTION__, mWheelSlackMs);
+    } else {
+        mWheelSlackMs = slackInMs;
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+uint64_t LocTimerContainer::toTick(const struct timespec& time, bool roundUp) {
+    uint64_t ns = (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+    uint64_t nsPerTick = (uint64_t)mWheelSlackMs * 1000000;
+    return (ns + (roundUp ? nsPerTick - 1 : 0)) / nsPerTick;
+}
+
 MsgTask* LocTimerContainer::getMsgTaskLocked() {
     // it is cheap to check pointer first than locking mutext unconditionally
     if (!mMsgTask) {
@@ -308,18 +350,53 @@ void LocTimerContainer::updateSoonestTime(LocTimerDelegate* priorTop) {
     }
 }
 
+// Only rewrites timerfd if the soonest tick changes. As timers are rounded up
+// to whole ticks, starting a timer in an already armed window is free.
+void LocTimerContainer::updateSoonestTick() {
+    uint64_t tick = 0;
+    if (!mWheel->getSoonestTick(tick)) {
+        tick = 0;
+    }
+
+    if (tick != mArmedTick) {
+        struct itimerspec delay;
+        memset(&delay, 0, sizeof(struct itimerspec));
+        if (0 == tick) {
+            mPollTask->removePoll(*this);
+        } else {
+            mPollTask->addPoll(*this);
+            uint64_t ms = tick * mWheelSlackMs;
+            delay.it_value.tv_sec = ms / 1000;
+            delay.it_value.tv_nsec = (ms % 1000) * 1000000;
+        }
+        timerfd_settime(getTimerFd(), TFD_TIMER_ABSTIME, &delay, NULL);
+        mArmedTick = tick;
+    }
+}
+
 // all the heap management is done in the MsgTask context.
 inline
 void LocTimerContainer::add(LocTimerDelegate& timer) {
     struct MsgTimerPush : public LocMsg {
         LocTimerContainer* mTimerContainer;
-        LocHeapNode* mTree;
         LocTimerDelegate* mTimer;
         inline MsgTimerPush(LocTimerContainer& container, LocTimerDelegate& timer) :
             LocMsg(), mTimerContainer(&container), mTimer(&timer) {}
         inline virtual void proc() const {
+            if (mTimerContainer->mWheel) {
+                mTimer->mTick = toTick(mTimer->mFutureTime, true);
+                mTimerContainer->mWheel->add(*mTimer);
+                mTimerContainer->updateSoonestTick();
+                return;
+            }
             LocTimerDelegate* priorTop = mTimerContainer->getSoonestTimer();
-            mTimerContainer->push((LocRankable&)(*mTimer));
+            if (!mTimerContainer->push((LocRankable&)(*mTimer))) {
+                // out of memory; a timer that is never armed would never
+                // call back, so it expires right away instead
+                LOC_LOGE("%s: failed to add timer, expiring it now", __func__);
+                mTimer->expire();
+                return;
+            }
             mTimerContainer->updateSoonestTime(priorTop);
         }
     };
@@ -335,6 +412,14 @@ void LocTimerContainer::remove(LocTimerDelegate& timer) {
         inline MsgTimerRemove(LocTimerContainer& container, LocTimerDelegate& timer) :
             LocMsg(), mTimerContainer(&container), mTimer(&timer) {}
         inline virtual void proc() const {
+            if (mTimerContainer->mWheel) {
+                // not on the wheel any more if it has expired already
+                if (mTimerContainer->mWheel->remove(*mTimer)) {
+                    mTimerContainer->updateSoonestTick();
+                }
+                delete mTimer;
+                return;
+            }
             LocTimerDelegate* priorTop = mTimerContainer->getSoonestTimer();
 
             // update soonest timer only if mTimer is actually removed from
@@ -364,6 +449,18 @@ void LocTimerContainer::expire() {
             struct timespec now;
             // get time spec of now
             clock_gettime(CLOCK_BOOTTIME, &now);
+            if (mTimerContainer->mWheel) {
+                // expire() has disarmed the timerfd
+                mTimerContainer->mArmedTick = 0;
+                LocTimerWheelNode* node = mTimerContainer->mWheel->advance(toTick(now, false));
+                while (NULL != node) {
+                    LocTimerDelegate* timer = static_cast<LocTimerDelegate*>(node);
+                    node = node->next();
+                    timer->expire();
+                }
+                mTimerContainer->updateSoonestTick();
+                return;
+            }
             LocTimerDelegate timerOfNow(now);
             // pop everything in the heap that outRanks now, i.e. has time older than now
             // and then call expire() on that timer.
@@ -386,7 +483,7 @@ void LocTimerContainer::expire() {
 
 LocTimerDelegate* LocTimerContainer::popIfOutRanks(LocTimerDelegate& timer) {
     LocTimerDelegate* poppedNode = NULL;
-    if (mTree && !timer.outRanks(*peek())) {
+    if (peek() && !timer.outRanks(*peek())) {
         poppedNode = (LocTimerDelegate*)(pop());
     }
 
@@ -542,6 +639,10 @@ void LocTimerDelegate::expire() {
 LocTimer::LocTimer() : mTimer(NULL), mLock(new LocSharedLock()) {
 }
 
+void LocTimer::useTimerWheel(uint32_t slackInMs) {
+    LocTimerContainer::setWheelSlack(slackInMs);
+}
+
 LocTimer::~LocTimer() {
     stop();
     if (mLock) {
@@ -698,10 +799,14 @@ public:
 //     g++ -D__LOC_HOST_DEBUG__ -D__LOC_DEBUG__ -g -I. -I../../../../system/core/include -o LocHeap.o LocHeap.cpp
 //     g++ -D__LOC_HOST_DEBUG__ -D__LOC_DEBUG__ -g -std=c++0x -I. -I../../../../system/core/include -lpthread -o LocThread.o LocThread.cpp
 //     g++ -D__LOC_HOST_DEBUG__ -D__LOC_DEBUG__ -g -I. -I../../../../system/core/include -o LocTimer.o LocTimer.cpp
+// test: ./a.out <tries> [<timer wheel slack in ms>]
 int main(int argc, char** argv) {
     struct timespec timeOfStart=getNow();
     srand(time(NULL));
     int tries = atoi(argv[1]);
+    if (argc > 2) {
+        LocTimer::useTimerWheel(atoi(argv[2]));
+    }
     int checks = tries >> 3;
     LocTimerTest** timerArray = new LocTimerTest*[tries];
     memset(timerArray, NULL, tries);
@@ -65,6 +65,12 @@ public:
     //               false on failure, e.g. timer is not running.
     bool stop();
 
+    // Keeps timers on a hierarchical timer wheel, instead of the default heap.
+    // Timers are rounded up to multiples of slackInMs, so that all of those
+    // due within one slack window expire on one wakeup.
+    // Only takes effect if called before the first timer is ever started.
+    static void useTimerWheel(uint32_t slackInMs);
+
     //  LocTimer client Should implement this method.
     //  This method is used for timeout calling back to client. This method
     //  should be short enough (eg: send a message to your own thread).
@@ -0,0 +1,305 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <LocTimerWheel.h>
+
+#define LEVEL_SHIFT(k) ((k) * SLOT_BITS)
+#define SLOT_OF(tick, k) ((uint32_t)((tick) >> LEVEL_SHIFT(k)) & (SLOTS - 1))
+
+LocTimerWheel::LocTimerWheel(uint64_t nowTick) :
+    mCurTick(nowTick), mOverflow(NULL), mCount(0) {
+    for (int k = 0; k < LEVELS; k++) {
+        mOccupied[k] = 0;
+        for (uint32_t i = 0; i < SLOTS; i++) {
+            mSlots[k][i] = NULL;
+        }
+    }
+}
+
+inline
+void LocTimerWheel::link(LocTimerWheelNode*& head, LocTimerWheelNode& node,
+                         int level, uint32_t slot) {
+    node.mLevel = level;
+    node.mSlot = slot;
+    node.mPrev = NULL;
+    node.mNext = head;
+    if (head) {
+        head->mPrev = &node;
+    }
+    head = &node;
+    if (level < LEVELS) {
+        mOccupied[level] |= (1ULL << slot);
+    }
+}
+
+inline
+void LocTimerWheel::unlink(LocTimerWheelNode*& head, LocTimerWheelNode& node) {
+    if (node.mPrev) {
+        node.mPrev->mNext = node.mNext;
+    } else {
+        head = node.mNext;
+    }
+    if (node.mNext) {
+        node.mNext->mPrev = node.mPrev;
+    }
+    if (NULL == head && node.mLevel < LEVELS) {
+        mOccupied[node.mLevel] &= ~(1ULL << node.mSlot);
+    }
+    node.mPrev = node.mNext = NULL;
+    node.mLevel = -1;
+}
+
+// The level is picked by the highest 6 bit group in which the node's tick
+// differs from mCurTick, so that the node is cascaded exactly when mCurTick
+// enters its slot of that level. A node due at mCurTick itself can only
+// come from a cascade, and goes into the level 0 slot about to be expired.
+void LocTimerWheel::place(LocTimerWheelNode& node) {
+    uint64_t diff = node.mTick ^ mCurTick;
+    int level = (0 == diff) ? 0 : (63 - __builtin_clzll(diff)) / SLOT_BITS;
+    if (level >= LEVELS) {
+        link(mOverflow, node, LEVELS, 0);
+    } else {
+        uint32_t slot = SLOT_OF(node.mTick, level);
+        link(mSlots[level][slot], node, level, slot);
+    }
+}
+
+// mCurTick has just entered a new slot of level 1 and up, when its lower
+// bits wrap to 0. Those slots get redistributed to lower levels.
+void LocTimerWheel::cascade(uint64_t tick) {
+    int k = 1;
+    for (; k < LEVELS && 0 == (tick & ((1ULL << LEVEL_SHIFT(k)) - 1)); k++) {
+        uint32_t slot = SLOT_OF(tick, k);
+        LocTimerWheelNode* node = mSlots[k][slot];
+        mSlots[k][slot] = NULL;
+        mOccupied[k] &= ~(1ULL << slot);
+        while (node) {
+            LocTimerWheelNode* next = node->mNext;
+            place(*node);
+            node = next;
+        }
+    }
+    if (LEVELS == k && 0 == (tick & ((1ULL << LEVEL_SHIFT(LEVELS)) - 1))) {
+        LocTimerWheelNode* node = mOverflow;
+        mOverflow = NULL;
+        while (node) {
+            LocTimerWheelNode* next = node->mNext;
+            place(*node);
+            node = next;
+        }
+    }
+}
+
+// Occupied slots of a level all lie after the current slot of that level,
+// within the current slot of the level above; so the first occupied slot
+// of the lowest non empty level is the next place anything happens.
+bool LocTimerWheel::nextStep(uint64_t& tick) {
+    for (int k = 0; k < LEVELS; k++) {
+        uint32_t cur = SLOT_OF(mCurTick, k);
+        uint64_t later = (SLOTS - 1 == cur) ? 0 : (mOccupied[k] & (~0ULL << (cur + 1)));
+        if (later) {
+            uint64_t span = mCurTick >> LEVEL_SHIFT(k + 1);
+            tick = ((span << SLOT_BITS) | __builtin_ctzll(later)) << LEVEL_SHIFT(k);
+            return true;
+        }
+    }
+    if (mOverflow) {
+        tick = ((mCurTick >> LEVEL_SHIFT(LEVELS)) + 1) << LEVEL_SHIFT(LEVELS);
+        return true;
+    }
+    return false;
+}
+
+void LocTimerWheel::add(LocTimerWheelNode& node) {
+    // overdue, expire on the next advance()
+    if (node.mTick <= mCurTick) {
+        node.mTick = mCurTick + 1;
+    }
+    place(node);
+    mCount++;
+}
+
+bool LocTimerWheel::remove(LocTimerWheelNode& node) {
+    bool removed = false;
+    if (node.mLevel >= 0) {
+        unlink((LEVELS == node.mLevel) ? mOverflow : mSlots[node.mLevel][node.mSlot], node);
+        mCount--;
+        removed = true;
+    }
+    return removed;
+}
+
+LocTimerWheelNode* LocTimerWheel::advance(uint64_t nowTick) {
+    LocTimerWheelNode* expired = NULL;
+    LocTimerWheelNode* tail = NULL;
+    uint64_t tick;
+
+    while (nextStep(tick) && tick <= nowTick) {
+        mCurTick = tick;
+        if (0 == SLOT_OF(tick, 0)) {
+            cascade(tick);
+        }
+        // everything left in the level 0 slot of now expires now
+        uint32_t slot = SLOT_OF(tick, 0);
+        LocTimerWheelNode* node = mSlots[0][slot];
+        mSlots[0][slot] = NULL;
+        mOccupied[0] &= ~(1ULL << slot);
+        while (node) {
+            LocTimerWheelNode* next = node->mNext;
+            node->mLevel = -1;
+            node->mPrev = tail;
+            node->mNext = NULL;
+            if (tail) {
+                tail->mNext = node;
+            } else {
+                expired = node;
+            }
+            tail = node;
+            mCount--;
+            node = next;
+        }
+    }
+    // no slot boundary with anything in it lies in between, so it is safe
+    // to jump straight to nowTick
+    if (nowTick > mCurTick) {
+        mCurTick = nowTick;
+    }
+
+    return expired;
+}
+
+bool LocTimerWheel::getSoonestTick(uint64_t& tick) {
+    LocTimerWheelNode* node = NULL;
+    for (int k = 0; k < LEVELS && NULL == node; k++) {
+        uint32_t cur = SLOT_OF(mCurTick, k);
+        uint64_t later = (SLOTS - 1 == cur) ? 0 : (mOccupied[k] & (~0ULL << (cur + 1)));
+        if (later) {
+            node = mSlots[k][__builtin_ctzll(later)];
+        }
+    }
+    if (NULL == node) {
+        node = mOverflow;
+    }
+
+    bool found = (NULL != node);
+    if (found) {
+        // all of a level 0 slot expire at the same tick; higher level slots
+        // and the overflow list need a scan
+        tick = node->mTick;
+        for (node = node->mNext; node; node = node->mNext) {
+            if (node->mTick < tick) {
+                tick = node->mTick;
+            }
+        }
+    }
+    return found;
+}
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <LocHeap.h>
+
+struct LocTimerWheelDebugData : public LocRankable, public LocTimerWheelNode {
+    inline virtual int ranks(LocRankable& rankable) {
+        LocTimerWheelDebugData* data = static_cast<LocTimerWheelDebugData*>(&rankable);
+        return (data->mTick > mTick) ? 1 : ((data->mTick < mTick) ? -1 : 0);
+    }
+};
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+// For Linux command line testing:
+// compilation: g++ -O2 -c -I. LocHeap.cpp && g++ -D__LOC_DEBUG__ -O2 -g -I. LocTimerWheel.cpp LocHeap.o
+// test: ./a.out 100000 600000
+// Starts *count* timers with random timeouts up to *range* ticks, stops every
+// other one, then expires the rest while checking expiry order, once on the
+// wheel and once on LocHeap.
+int main(int argc, char** argv) {
+    int count = (argc > 1) ? atoi(argv[1]) : 100000;
+    uint64_t range = (argc > 2) ? atoll(argv[2]) : 600000;
+    LocTimerWheelDebugData* data = new LocTimerWheelDebugData[count];
+    srand(time(NULL));
+    for (int i = 0; i < count; i++) {
+        data[i].mTick = 1000 + rand() % range;
+    }
+
+    LocTimerWheel wheel(1000);
+    double t0 = getSeconds();
+    for (int i = 0; i < count; i++) {
+        wheel.add(data[i]);
+    }
+    double t1 = getSeconds();
+    for (int i = 0; i < count; i += 2) {
+        wheel.remove(data[i]);
+    }
+    double t2 = getSeconds();
+    uint64_t last = 0;
+    int expired = 0;
+    bool ordered = true;
+    // expire in steps of 10 ticks, the way a timerfd would wake us up
+    for (uint64_t now = 1000; now <= 1000 + range; now += 10) {
+        for (LocTimerWheelNode* node = wheel.advance(now); node; node = node->next()) {
+            ordered = ordered && (node->mTick >= last) && (node->mTick <= now);
+            last = node->mTick;
+            expired++;
+        }
+    }
+    double t3 = getSeconds();
+    printf("wheel: start %.3f s, stop %.3f s, expire %.3f s, %d expired, %s\n",
+           t1 - t0, t2 - t1, t3 - t2, expired, ordered ? "in order" : "OUT OF ORDER");
+
+    LocHeap heap;
+    t0 = getSeconds();
+    for (int i = 0; i < count; i++) {
+        heap.push(data[i]);
+    }
+    t1 = getSeconds();
+    for (int i = 0; i < count; i += 2) {
+        heap.remove(data[i]);
+    }
+    t2 = getSeconds();
+    expired = 0;
+    for (LocRankable* node = heap.pop(); node; node = heap.pop()) {
+        expired++;
+    }
+    t3 = getSeconds();
+    printf("heap:  start %.3f s, stop %.3f s, expire %.3f s, %d expired\n",
+           t1 - t0, t2 - t1, t3 - t2, expired);
+
+    delete[] data;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,101 @@
+/* Copyright (c) 2020, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_TIMER_WHEEL__
+#define __LOC_TIMER_WHEEL__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Intrusive entry of LocTimerWheel. The owner sets mTick, the absolute
+// expiry time in ticks, before adding it to a wheel. While the entry is on
+// the wheel, it must not be modified or deleted.
+class LocTimerWheelNode {
+    friend class LocTimerWheel;
+    LocTimerWheelNode* mPrev;
+    LocTimerWheelNode* mNext;
+    // level of the slot that holds this node, -1 if not on a wheel
+    int mLevel;
+    uint32_t mSlot;
+public:
+    uint64_t mTick;
+    inline LocTimerWheelNode() :
+        mPrev(NULL), mNext(NULL), mLevel(-1), mSlot(0), mTick(0) {}
+    inline bool isQueued() { return mLevel >= 0; }
+    // walks the list returned by LocTimerWheel::advance()
+    inline LocTimerWheelNode* next() { return mNext; }
+};
+
+// A hierarchical timing wheel: LEVELS levels of SLOTS slots, where a slot of
+// level k spans SLOTS^k ticks. A node is hashed into the level of the highest
+// 6 bit group in which its tick differs from the current time, and moves
+// down a level (cascades) when the current time enters its slot. Nodes too
+// far out for the top level wait in an overflow list. add() and remove() are
+// O(1); advance() skips empty slots with per level occupancy bitmaps, so the
+// wheel needs no periodic tick.
+class LocTimerWheel {
+public:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const uint32_t SLOTS = 1 << SLOT_BITS;
+
+private:
+    uint64_t mCurTick;
+    uint64_t mOccupied[LEVELS];
+    LocTimerWheelNode* mSlots[LEVELS][SLOTS];
+    LocTimerWheelNode* mOverflow;
+    uint32_t mCount;
+
+    void link(LocTimerWheelNode*& head, LocTimerWheelNode& node, int level, uint32_t slot);
+    void unlink(LocTimerWheelNode*& head, LocTimerWheelNode& node);
+    void place(LocTimerWheelNode& node);
+    void cascade(uint64_t tick);
+    // the next tick at which a slot needs to be cascaded or expired
+    bool nextStep(uint64_t& tick);
+
+public:
+    LocTimerWheel(uint64_t nowTick);
+
+    // adds node, which must not be on any wheel. Nodes whose tick is not
+    // in the future expire on the next advance().
+    void add(LocTimerWheelNode& node);
+
+    // returns false if node is not on this wheel, e.g. already expired
+    bool remove(LocTimerWheelNode& node);
+
+    // moves time forward to nowTick, and returns the list of nodes whose
+    // tick is <= nowTick, linked through next(), in expiry order.
+    LocTimerWheelNode* advance(uint64_t nowTick);
+
+    // exact tick of the soonest node; false if the wheel is empty
+    bool getSoonestTick(uint64_t& tick);
+
+    inline uint32_t size() { return mCount; }
+};
+
+#endif //__LOC_TIMER_WHEEL__
@@ -30,27 +30,107 @@
 #define LOG_TAG "LocSvc_MsgTask"
 
 #include <unistd.h>
+#include <time.h>
+#include <string>
+#include <atomic>
 #include <MsgTask.h>
+#include <LocMsgPool.h>
 #include <msg_q.h>
 #include <log_util.h>
 #include <loc_log.h>
 #include <loc_pla.h>
 
-static void LocMsgDestroy(void* msg) {
-    delete (LocMsg*)msg;
+using namespace loc_util;
+
+// log2 buckets: bucket 0 counts 0, bucket i counts [2^(i-1), 2^i)
+struct LocHistogram {
+    static const int BUCKETS = 16;
+    std::atomic<uint32_t> mBuckets[BUCKETS];
+    inline LocHistogram() { for (int i = 0; i < BUCKETS; i++) mBuckets[i] = 0; }
+    inline void add(uint64_t val) {
+        int i = (0 == val) ? 0 : (64 - __builtin_clzll(val));
+        mBuckets[(i < BUCKETS) ? i : (BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+// What MsgTask::mQ points to. The task only has room for the msg_q handle,
+// so the msg_q is kept here along with everything that came after it.
+struct LocMsgTaskQueue {
+    const void* mQ;
+    const char* mName;
+    uint32_t mDrainBatch;
+    uint64_t mRunCount;
+    // messages received per run(), and usec spent queued per message
+    LocHistogram mQueueDepth;
+    LocHistogram mQueueLatencyUs;
+};
+
+// What is actually queued: the message, when it was sent, and its key if it
+// was sent as a LocCoalescableMsg
+struct LocMsgCell {
+    const LocMsg* mMsg;
+    uint64_t mQueuedTimeNs;
+    const void* mCoalesceKey;
+    inline static LocMsgPool& pool() {
+        static LocMsgPool* sPool = new LocMsgPool("LocMsgCell", sizeof(LocMsgCell), 64);
+        return *sPool;
+    }
+    inline static void* operator new(size_t size) {
+        return pool().alloc(size);
+    }
+    inline static void operator delete(void* p, size_t size) {
+        pool().release(p, size);
+    }
+};
+
+static void LocMsgCellDestroy(void* cell) {
+    delete ((LocMsgCell*)cell)->mMsg;
+    delete (LocMsgCell*)cell;
+}
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static LocMsgTaskQueue* LocMsgTaskQueueInit(const char* threadName, uint32_t queueSize,
+                                            msg_q_overflow_type overflow, uint32_t drainBatch) {
+    LocMsgTaskQueue* q = new LocMsgTaskQueue();
+    q->mQ = (0 == queueSize) ? msg_q_init2() : msg_q_ring_init2(queueSize, overflow);
+    q->mName = threadName ? threadName : "MsgTask";
+    q->mDrainBatch = (drainBatch > MsgTask::MAX_DRAIN_BATCH) ?
+            MsgTask::MAX_DRAIN_BATCH : drainBatch;
+    q->mRunCount = 0;
+    return q;
 }
 
 MsgTask::MsgTask(LocThread::tCreate tCreator,
                  const char* threadName, bool joinable) :
-    mQ(msg_q_init2()), mThread(new LocThread()) {
+    MsgTask(tCreator, threadName, joinable, 0) {
+}
+
+MsgTask::MsgTask(const char* threadName, bool joinable) :
+    MsgTask(threadName, joinable, 0) {
+}
+
+MsgTask::MsgTask(LocThread::tCreate tCreator,
+                 const char* threadName, bool joinable,
+                 uint32_t queueSize, msg_q_overflow_type overflow,
+                 uint32_t drainBatch) :
+    mQ(LocMsgTaskQueueInit(threadName, queueSize, overflow, drainBatch)),
+    mThread(new LocThread()) {
     if (!mThread->start(tCreator, threadName, this, joinable)) {
         delete mThread;
         mThread = NULL;
     }
 }
 
-MsgTask::MsgTask(const char* threadName, bool joinable) :
-    mQ(msg_q_init2()), mThread(new LocThread()) {
+MsgTask::MsgTask(const char* threadName, bool joinable,
+                 uint32_t queueSize, msg_q_overflow_type overflow,
+                 uint32_t drainBatch) :
+    mQ(LocMsgTaskQueueInit(threadName, queueSize, overflow, drainBatch)),
+    mThread(new LocThread()) {
     if (!mThread->start(threadName, this, joinable)) {
         delete mThread;
         mThread = NULL;
@@ -58,13 +138,14 @@ MsgTask::MsgTask(const char* threadName, bool joinable) :
 }
 
 MsgTask::~MsgTask() {
-    msg_q_flush((void*)mQ);
-    msg_q_destroy((void**)&mQ);
+    msg_q_flush((void*)queue()->mQ);
+    msg_q_destroy((void**)&queue()->mQ);
+    delete queue();
 }
 
 void MsgTask::destroy() {
     LocThread* thread = mThread;
-    msg_q_unblock((void*)mQ);
+    msg_q_unblock((void*)queue()->mQ);
     if (thread) {
         mThread = NULL;
         delete thread;
@@ -73,9 +154,26 @@ void MsgTask::destroy() {
     }
 }
 
+static void LocMsgSend(const void* q, const LocMsg* msg, const void* coalesceKey) {
+    LocMsgCell* cell = new LocMsgCell();
+    cell->mMsg = msg;
+    cell->mQueuedTimeNs = nowNs();
+    cell->mCoalesceKey = coalesceKey;
+    msg_q_snd((void*)q, (void*)cell, LocMsgCellDestroy);
+}
+
 void MsgTask::sendMsg(const LocMsg* msg) const {
     if (msg && this) {
-        msg_q_snd((void*)mQ, (void*)msg, LocMsgDestroy);
+        LocMsgSend(queue()->mQ, msg, nullptr);
+    } else {
+        LOC_LOGE("%s: msg is %p and this is %p",
+                 __func__, msg, this);
+    }
+}
+
+void MsgTask::sendMsg(const LocCoalescableMsg* msg) const {
+    if (msg && this) {
+        LocMsgSend(queue()->mQ, msg, msg->coalesceKey());
     } else {
         LOC_LOGE("%s: msg is %p and this is %p",
                  __func__, msg, this);
@@ -89,20 +187,72 @@ void MsgTask::prerun() {
 #endif /* FEATURE_EXTERNAL_AP */
 }
 
+void MsgTask::logStats() const {
+    std::string depth, latency;
+    for (int i = 0; i < LocHistogram::BUCKETS; i++) {
+        depth += " " + std::to_string(queue()->mQueueDepth.mBuckets[i].load());
+        latency += " " + std::to_string(queue()->mQueueLatencyUs.mBuckets[i].load());
+    }
+    LOC_LOGD("%s: %s log2 queue depth:%s", __func__, queue()->mName, depth.c_str());
+    LOC_LOGD("%s: %s log2 queue latency (us):%s", __func__, queue()->mName,
+             latency.c_str());
+}
+
 bool MsgTask::run() {
-    LocMsg* msg;
-    msq_q_err_type result = msg_q_rcv((void*)mQ, (void **)&msg);
+    LocMsgTaskQueue* q = queue();
+    LocMsgCell* cells[MAX_DRAIN_BATCH];
+    const LocMsg* msgs[MAX_DRAIN_BATCH];
+    const void* keys[MAX_DRAIN_BATCH];
+    uint32_t count = 0;
+    msq_q_err_type result = (q->mDrainBatch > 1) ?
+            msg_q_rcv_batch((void*)q->mQ, (void **)cells, q->mDrainBatch, &count) :
+            msg_q_rcv((void*)q->mQ, (void **)&cells[0]);
     if (eMSG_Q_SUCCESS != result) {
         LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
                  loc_get_msg_q_status(result));
         return false;
     }
+    if (q->mDrainBatch <= 1) {
+        count = 1;
+    }
 
-    msg->log();
-    // there is where each individual msg handling is invoked
-    msg->proc();
+    uint64_t now = nowNs();
+    q->mQueueDepth.add(count);
+    for (uint32_t i = 0; i < count; i++) {
+        q->mQueueLatencyUs.add((now - cells[i]->mQueuedTimeNs) / 1000);
+        msgs[i] = cells[i]->mMsg;
+        keys[i] = cells[i]->mCoalesceKey;
+        delete cells[i];
+    }
+    // keep an eye on backpressure without anyone having to ask
+    if (0 == (++q->mRunCount & 0xFFF)) {
+        logStats();
+    }
 
-    delete msg;
+    // a message is superseded by a newer one of the same key in this batch
+    for (uint32_t i = 0; i + 1 < count; i++) {
+        if (nullptr != keys[i]) {
+            for (uint32_t j = i + 1; j < count; j++) {
+                if (keys[j] == keys[i]) {
+                    delete msgs[i];
+                    msgs[i] = nullptr;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        const LocMsg* msg = msgs[i];
+        if (nullptr == msg) {
+            continue;
+        }
+        msg->log();
+        // there is where each individual msg handling is invoked
+        msg->proc();
+
+        delete msg;
+    }
 
     return true;
 }
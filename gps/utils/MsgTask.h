@@ -30,7 +30,11 @@
 #define __MSG_TASK__
 
 #include <LocThread.h>
+#include <msg_q.h>
 
+// LocMsg and MsgTask are also built into prebuilt libraries, so neither may
+// change its layout; what a queued message needs beyond it is kept in the
+// queue, see MsgTask.cpp
 struct LocMsg {
     inline LocMsg() {}
     inline virtual ~LocMsg() {}
@@ -38,18 +42,44 @@ struct LocMsg {
     inline virtual void log() const {}
 };
 
+// For messages that only carry the latest state of something, e.g. SV
+// status. When a batch draining MsgTask finds several queued messages with
+// the same non null key, only the newest is proc'ed. The key is taken by
+// the sendMsg() overload below, so LocMsg itself needs no new virtual.
+struct LocCoalescableMsg : public LocMsg {
+    virtual const void* coalesceKey() const = 0;
+};
+
+struct LocMsgTaskQueue;
+
 class MsgTask : public LocRunnable {
+    // a LocMsgTaskQueue: the msg_q, and the settings and stats of the task
     const void* mQ;
     LocThread* mThread;
     friend class LocThreadDelegate;
+    inline LocMsgTaskQueue* queue() const { return (LocMsgTaskQueue*)mQ; }
 protected:
     virtual ~MsgTask();
 public:
     MsgTask(LocThread::tCreate tCreator, const char* threadName = NULL, bool joinable = true);
     MsgTask(const char* threadName = NULL, bool joinable = true);
+    // queueSize 0 keeps the unbounded linked list queue; any other value
+    // selects a lock free ring of that many slots, see msg_q_ring_init()
+    // drainBatch > 1 makes run() take up to that many queued messages at
+    // once (at most MAX_DRAIN_BATCH) and coalesce them by their coalesceKey()
+    MsgTask(LocThread::tCreate tCreator, const char* threadName, bool joinable,
+            uint32_t queueSize, msg_q_overflow_type overflow = eMSG_Q_OVERFLOW_BLOCK,
+            uint32_t drainBatch = 1);
+    MsgTask(const char* threadName, bool joinable,
+            uint32_t queueSize, msg_q_overflow_type overflow = eMSG_Q_OVERFLOW_BLOCK,
+            uint32_t drainBatch = 1);
+    static const uint32_t MAX_DRAIN_BATCH = 32;
     // this obj will be deleted once thread is deleted
     void destroy();
     void sendMsg(const LocMsg* msg) const;
+    void sendMsg(const LocCoalescableMsg* msg) const;
+    // log the queue depth and latency histograms
+    void logStats() const;
     // Overrides of LocRunnable methods
     // This method will be repeated called until it returns false; or
     // until thread is stopped.
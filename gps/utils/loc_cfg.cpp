@@ -39,6 +39,11 @@
 #include <time.h>
 #include <grp.h>
 #include <errno.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
 #include <loc_cfg.h>
 #include <loc_pla.h>
 #include <loc_target.h>
@@ -205,6 +210,63 @@ int loc_set_config_entry(const loc_param_s_type* config_entry, loc_param_v_type*
     return ret;
 }
 
+/*===========================================================================
+FUNCTION loc_parse_conf_item
+
+DESCRIPTION
+   Splits a line of configuration item into its name and value, and parses
+   the value as a number as well.
+
+PARAMETERS:
+   input_buf : buffer contanis config item, tokenized in place
+   config_value: name and values, pointing into input_buf
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   true if the line has both a name and a value
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static bool loc_parse_conf_item(char* input_buf, loc_param_v_type* config_value)
+{
+    char *lasts;
+    memset(config_value, 0, sizeof(*config_value));
+
+    /* Separate variable and value */
+    config_value->param_name = strtok_r(input_buf, "=", &lasts);
+    /* skip lines that do not contain "=" */
+    if (NULL == config_value->param_name) {
+        return false;
+    }
+    config_value->param_str_value = strtok_r(NULL, "=", &lasts);
+    /* skip lines that do not contain two operands */
+    if (NULL == config_value->param_str_value) {
+        return false;
+    }
+
+    /* Trim leading and trailing spaces */
+    loc_util_trim_space(config_value->param_name);
+    loc_util_trim_space(config_value->param_str_value);
+
+    /* Parse numerical value */
+    if ((strlen(config_value->param_str_value) >=3) &&
+        (config_value->param_str_value[0] == '0') &&
+        (tolower(config_value->param_str_value[1]) == 'x'))
+    {
+        /* hex */
+        config_value->param_int_value = (int) strtol(&config_value->param_str_value[2],
+                                                     (char**) NULL, 16);
+    }
+    else {
+        config_value->param_double_value = (double) atof(config_value->param_str_value); /* float */
+        config_value->param_int_value = atoi(config_value->param_str_value); /* dec */
+    }
+    return true;
+}
+
 /*===========================================================================
 FUNCTION loc_fill_conf_item
 
@@ -231,44 +293,13 @@ int loc_fill_conf_item(char* input_buf,
                        const loc_param_s_type* config_table, uint32_t table_length)
 {
     int ret = 0;
+    loc_param_v_type config_value;
 
-    if (input_buf && config_table) {
-        char *lasts;
-        loc_param_v_type config_value;
-        memset(&config_value, 0, sizeof(config_value));
-
-        /* Separate variable and value */
-        config_value.param_name = strtok_r(input_buf, "=", &lasts);
-        /* skip lines that do not contain "=" */
-        if (config_value.param_name) {
-            config_value.param_str_value = strtok_r(NULL, "=", &lasts);
-
-            /* skip lines that do not contain two operands */
-            if (config_value.param_str_value) {
-                /* Trim leading and trailing spaces */
-                loc_util_trim_space(config_value.param_name);
-                loc_util_trim_space(config_value.param_str_value);
-
-                /* Parse numerical value */
-                if ((strlen(config_value.param_str_value) >=3) &&
-                    (config_value.param_str_value[0] == '0') &&
-                    (tolower(config_value.param_str_value[1]) == 'x'))
-                {
-                    /* hex */
-                    config_value.param_int_value = (int) strtol(&config_value.param_str_value[2],
-                                                                (char**) NULL, 16);
-                }
-                else {
-                    config_value.param_double_value = (double) atof(config_value.param_str_value); /* float */
-                    config_value.param_int_value = atoi(config_value.param_str_value); /* dec */
-                }
-
-                for(uint32_t i = 0; NULL != config_table && i < table_length; i++)
-                {
-                    if(!loc_set_config_entry(&config_table[i], &config_value)) {
-                        ret += 1;
-                    }
-                }
+    if (input_buf && config_table && loc_parse_conf_item(input_buf, &config_value)) {
+        for(uint32_t i = 0; NULL != config_table && i < table_length; i++)
+        {
+            if(!loc_set_config_entry(&config_table[i], &config_value)) {
+                ret += 1;
             }
         }
     }
@@ -402,6 +433,222 @@ int loc_update_conf(const char* conf_data, int32_t length,
     return ret;
 }
 
+/*=============================================================================
+ *
+ *                     Parsed Configuration File Cache
+ *
+ *============================================================================*/
+/* A conf file is read and parsed once, and kept along with the stat() data
+   it was read with. Each read of an unchanged file after that looks up the
+   table's parameter names in the file's sorted name index, instead of going
+   through every line of the file with every entry of the table. The
+   outcome is the same as loc_read_conf_r() reading the file: lines are cut
+   the same way fgets() cuts them, values go into the table in file order,
+   and reading stops after as many matches as the table has entries. */
+typedef struct loc_conf_item
+{
+    std::string name;
+    std::string str_value;
+    int int_value;
+    double double_value;
+} loc_conf_item;
+
+typedef struct loc_conf_file
+{
+    struct stat st;
+    std::vector<loc_conf_item> items;   /* in file order */
+    std::vector<uint32_t> by_name;      /* items indexes sorted by name, then file order */
+} loc_conf_file;
+
+typedef struct loc_conf_cache_entry
+{
+    std::string path;
+    std::shared_ptr<const loc_conf_file> conf;
+} loc_conf_cache_entry;
+
+static pthread_mutex_t loc_conf_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+/* a handful of conf files at most, a linear search does */
+static std::vector<loc_conf_cache_entry> loc_conf_cache;
+
+static inline bool loc_conf_file_unchanged(const struct stat& a, const struct stat& b)
+{
+    return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_size == b.st_size &&
+           a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+}
+
+/*===========================================================================
+FUNCTION loc_parse_conf_file
+
+DESCRIPTION
+   Reads and parses a configuration file into a loc_conf_file.
+
+PARAMETERS:
+   conf_fp : file pointer
+   st: stat of the file
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   parsed file
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static std::shared_ptr<const loc_conf_file> loc_parse_conf_file(FILE* conf_fp,
+                                                                const struct stat& st)
+{
+    std::shared_ptr<loc_conf_file> conf = std::make_shared<loc_conf_file>();
+    char input_buf[LOC_MAX_PARAM_LINE];
+    loc_param_v_type config_value;
+
+    conf->st = st;
+    while (fgets(input_buf, LOC_MAX_PARAM_LINE, conf_fp)) {
+        if (loc_parse_conf_item(input_buf, &config_value)) {
+            conf->items.push_back({config_value.param_name, config_value.param_str_value,
+                                   config_value.param_int_value,
+                                   config_value.param_double_value});
+        }
+    }
+
+    const std::vector<loc_conf_item>& items = conf->items;
+    conf->by_name.resize(items.size());
+    for (uint32_t i = 0; i < items.size(); i++) {
+        conf->by_name[i] = i;
+    }
+    std::stable_sort(conf->by_name.begin(), conf->by_name.end(),
+                     [&items](uint32_t a, uint32_t b) { return items[a].name < items[b].name; });
+    return conf;
+}
+
+/*===========================================================================
+FUNCTION loc_get_conf_file
+
+DESCRIPTION
+   Gets the parsed configuration file from the cache, reading it again only
+   if it changed since.
+
+PARAMETERS:
+   conf_file_name: configuration file to read
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   parsed file, or NULL if the file can not be read
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static std::shared_ptr<const loc_conf_file> loc_get_conf_file(const char* conf_file_name)
+{
+    std::shared_ptr<const loc_conf_file> conf;
+    struct stat st;
+    FILE *conf_fp = NULL;
+
+    if (NULL == conf_file_name || stat(conf_file_name, &st) != 0) {
+        return conf;
+    }
+
+    pthread_mutex_lock(&loc_conf_cache_lock);
+    for (const loc_conf_cache_entry& entry : loc_conf_cache) {
+        if (entry.path == conf_file_name && loc_conf_file_unchanged(entry.conf->st, st)) {
+            conf = entry.conf;
+        }
+    }
+    pthread_mutex_unlock(&loc_conf_cache_lock);
+
+    if (conf == nullptr && (conf_fp = fopen(conf_file_name, "r")) != NULL) {
+        // the stat() of what gets read, in case the file changed in between
+        if (fstat(fileno(conf_fp), &st) == 0) {
+            conf = loc_parse_conf_file(conf_fp, st);
+        }
+        fclose(conf_fp);
+
+        if (conf != nullptr) {
+            pthread_mutex_lock(&loc_conf_cache_lock);
+            auto it = std::find_if(loc_conf_cache.begin(), loc_conf_cache.end(),
+                    [conf_file_name](const loc_conf_cache_entry& entry) {
+                        return entry.path == conf_file_name;
+                    });
+            if (it == loc_conf_cache.end()) {
+                loc_conf_cache.push_back({conf_file_name, conf});
+            } else {
+                it->conf = conf;
+            }
+            pthread_mutex_unlock(&loc_conf_cache_lock);
+        }
+    }
+    return conf;
+}
+
+/*===========================================================================
+FUNCTION loc_fill_conf_table
+
+DESCRIPTION
+   Sets defined values of the configuration table from a parsed configuration
+   file, the same way loc_read_conf_r() would from the file itself.
+
+PARAMETERS:
+   conf: parsed configuration file
+   config_table: table definition of strings to places to store information
+   table_length: length of the configuration table
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_fill_conf_table(const loc_conf_file& conf,
+                                const loc_param_s_type* config_table, uint32_t table_length)
+{
+    /* (item, table entry) of each name match, in the order reading the file
+       line by line would set them */
+    std::vector<std::pair<uint32_t, uint32_t>> matches;
+    const std::vector<loc_conf_item>& items = conf.items;
+    unsigned int num_params = table_length;
+
+    /* Clear all validity bits */
+    for(uint32_t i = 0; i < table_length; i++)
+    {
+        if(NULL != config_table[i].param_set)
+        {
+            *(config_table[i].param_set) = 0;
+        }
+    }
+
+    for (uint32_t i = 0; i < table_length; i++) {
+        const char* name = config_table[i].param_name;
+        if (NULL == name) {
+            continue;
+        }
+        auto first = std::lower_bound(conf.by_name.begin(), conf.by_name.end(), name,
+                [&items](uint32_t a, const char* b) { return strcmp(items[a].name.c_str(), b) < 0; });
+        for (auto it = first; it != conf.by_name.end() && items[*it].name == name; it++) {
+            matches.push_back(std::make_pair(*it, i));
+        }
+    }
+    std::sort(matches.begin(), matches.end());
+
+    LOC_LOGD("%s:%d]: num_params: %d\n", __func__, __LINE__, num_params);
+    for (size_t k = 0; k < matches.size() && num_params; ) {
+        const loc_conf_item& item = items[matches[k].first];
+        loc_param_v_type config_value = {(char*)item.name.c_str(), (char*)item.str_value.c_str(),
+                                         item.int_value, item.double_value};
+        unsigned int filled = 0;
+        for (; k < matches.size() && &items[matches[k].first] == &item; k++) {
+            if (!loc_set_config_entry(&config_table[matches[k].second], &config_value)) {
+                filled++;
+            }
+        }
+        num_params -= filled;
+    }
+}
+
 /*===========================================================================
 FUNCTION loc_read_conf
 
@@ -410,6 +657,9 @@ DESCRIPTION
    the passed in configuration table. This table maps strings to values to
    set along with the type of each of these values.
 
+   The file is parsed only the first time it is read, and again after it
+   changed; see loc_get_conf_file().
+
 PARAMETERS:
    conf_file_name: configuration file to read
    config_table: table definition of strings to places to store information
@@ -427,17 +677,15 @@ SIDE EFFECTS
 void loc_read_conf(const char* conf_file_name, const loc_param_s_type* config_table,
                    uint32_t table_length)
 {
-    FILE *conf_fp = NULL;
+    std::shared_ptr<const loc_conf_file> conf = loc_get_conf_file(conf_file_name);
 
-    if((conf_fp = fopen(conf_file_name, "r")) != NULL)
+    if (conf != nullptr)
     {
         LOC_LOGD("%s: using %s", __FUNCTION__, conf_file_name);
         if(table_length && config_table) {
-            loc_read_conf_r(conf_fp, config_table, table_length);
-            rewind(conf_fp);
+            loc_fill_conf_table(*conf, config_table, table_length);
         }
-        loc_read_conf_r(conf_fp, loc_param_table, loc_param_num);
-        fclose(conf_fp);
+        loc_fill_conf_table(*conf, loc_param_table, loc_param_num);
     }
     /* Initialize logging mechanism with parsed data */
     loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
@@ -1114,3 +1362,185 @@ err:
 
     return ret;
 }
+
+#ifdef __LOC_DEBUG__
+
+#include <dirent.h>
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+// Every parameter name in a file, three times over as 's', 'n' and 'f', in
+// reverse order of the file, plus names that are not in the file and an
+// entry without storage. Names the file has more than once go into the
+// table more than once too, unless unique.
+struct LocCfgDebugTable {
+    std::vector<std::string> names;
+    std::vector<loc_param_s_type> table;
+    std::vector<char> values;
+    std::vector<uint8_t> set;
+
+    LocCfgDebugTable(const char* file_name, uint32_t max_names, bool unique = false) {
+        FILE* fp = fopen(file_name, "r");
+        char input_buf[LOC_MAX_PARAM_LINE];
+        loc_param_v_type config_value;
+        while (fp && fgets(input_buf, LOC_MAX_PARAM_LINE, fp)) {
+            if (loc_parse_conf_item(input_buf, &config_value) &&
+                (!unique || std::find(names.begin(), names.end(),
+                                      config_value.param_name) == names.end())) {
+                names.insert(names.begin(), config_value.param_name);
+            }
+        }
+        if (fp) {
+            fclose(fp);
+        }
+        names.resize(std::min((uint32_t)names.size(), max_names));
+        names.push_back("NOT_IN_THE_FILE");
+        names.push_back("");
+        values.resize(names.size() * 3 * LOC_MAX_PARAM_STRING);
+        set.resize(names.size() * 3 + 1);
+        const char types[] = {'s', 'n', 'f'};
+        for (uint32_t i = 0; i < names.size() * 3; i++) {
+            table.push_back({names[i / 3].c_str(), &values[i * LOC_MAX_PARAM_STRING], &set[i],
+                             types[i % 3]});
+        }
+        table.push_back({names[0].c_str(), NULL, &set.back(), 'n'});
+    }
+    void clear() {
+        memset(values.data(), 0x5A, values.size());
+        memset(set.data(), 0x5A, set.size());
+    }
+    bool operator==(const LocCfgDebugTable& other) const {
+        return values == other.values && set == other.set;
+    }
+};
+
+// loc_read_conf() the way it read before the cache
+static void loc_read_conf_uncached(const char* conf_file_name,
+                                   const loc_param_s_type* config_table, uint32_t table_length)
+{
+    FILE *conf_fp = NULL;
+
+    if((conf_fp = fopen(conf_file_name, "r")) != NULL)
+    {
+        if(table_length && config_table) {
+            loc_read_conf_r(conf_fp, config_table, table_length);
+            rewind(conf_fp);
+        }
+        loc_read_conf_r(conf_fp, loc_param_table, loc_param_num);
+        fclose(conf_fp);
+    }
+    loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
+}
+
+static bool checkSame(const char* file_name, uint32_t max_names) {
+    LocCfgDebugTable uncached(file_name, max_names);
+    LocCfgDebugTable cached(file_name, max_names);
+    uncached.clear();
+    cached.clear();
+    loc_read_conf_uncached(file_name, uncached.table.data(), uncached.table.size());
+    loc_read_conf(file_name, cached.table.data(), cached.table.size());
+    bool ok = (uncached == cached);
+    // and once more from the cache
+    cached.clear();
+    loc_read_conf(file_name, cached.table.data(), cached.table.size());
+    ok = ok && (uncached == cached);
+    if (!ok) {
+        printf("%s, %u names: DIFFERENT\n", file_name, max_names);
+    }
+    return ok;
+}
+
+static void writeFile(const char* file_name, const char* content) {
+    FILE* fp = fopen(file_name, "w");
+    fputs(content, fp);
+    fclose(fp);
+}
+
+// For Linux command line testing:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../pla/oe loc_cfg.cpp, link with libgps_utils
+// test: ./a.out ../etc 1000
+// Checks that the cached reads fill tables the same as reading the files did,
+// for all conf files in the directory and some odd ones, then times reading
+// the conf files the way the location stack does while starting up.
+int main(int argc, char** argv) {
+    const char* dir = (argc > 1) ? argv[1] : "/etc";
+    int iterations = (argc > 2) ? atoi(argv[2]) : 1000;
+    std::vector<std::string> files;
+    char path[PATH_MAX];
+    bool ok = true;
+
+    DIR* d = opendir(dir);
+    for (struct dirent* entry = d ? readdir(d) : NULL; entry; entry = readdir(d)) {
+        const char* ext = strrchr(entry->d_name, '.');
+        if (ext && 0 == strcmp(ext, ".conf")) {
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            files.push_back(path);
+        }
+    }
+    if (d) {
+        closedir(d);
+    }
+
+    // duplicates, which stop the reading early when the table is short,
+    // lines longer than fgets() takes, and odd splits around "="
+    snprintf(path, sizeof(path), "/tmp/loc_cfg_debug.%d.conf", getpid());
+    std::string odd("A=1\nA = 2\nB=0x1F\n  C  =  NULL  \n=D=4\nE==5\nF=6=7\n# G=8\nH\n\nA=3\n");
+    odd += "LONG=" + std::string(LOC_MAX_PARAM_LINE * 2, '9') + "\n" + "B=-1.5e3\nC=x\n";
+    writeFile(path, odd.c_str());
+    files.push_back(path);
+    for (const std::string& file : files) {
+        for (uint32_t max_names : {1, 2, 3, 1000}) {
+            ok = checkSame(file.c_str(), max_names) && ok;
+        }
+    }
+    // a changed file has to be read again
+    writeFile(path, "A=10\nB=11\n");
+    ok = checkSame(path, 1000) && ok;
+    unlink(path);
+    printf("%zu files: %s\n", files.size(), ok ? "same" : "DIFFERENT");
+
+    // what ContextBase, loc_read_process_conf(), GnssAdapter, BatchingAdapter
+    // and LocationAPIClientBase read, with gps.conf and flp.conf tables as big
+    // as the files
+    const char* startup[] = {"gps.conf", "sap.conf", "gps.conf", "izat.conf",
+                             "flp.conf", "flp.conf", "flp.conf"};
+    std::vector<std::string> paths;
+    std::vector<std::unique_ptr<LocCfgDebugTable>> tables;
+    for (const char* file : startup) {
+        snprintf(path, sizeof(path), "%s/%s", dir, file);
+        paths.push_back(path);
+        tables.emplace_back(new LocCfgDebugTable(path, 1000, true));
+    }
+    double uncached = 0, cold = 0, warm = 0;
+    for (int i = 0; i < iterations; i++) {
+        double start = getSeconds();
+        for (size_t k = 0; k < paths.size(); k++) {
+            loc_read_conf_uncached(paths[k].c_str(), tables[k]->table.data(),
+                                   tables[k]->table.size());
+        }
+        double t1 = getSeconds();
+        loc_conf_cache.clear();
+        double t2 = getSeconds();
+        for (size_t k = 0; k < paths.size(); k++) {
+            loc_read_conf(paths[k].c_str(), tables[k]->table.data(), tables[k]->table.size());
+        }
+        double t3 = getSeconds();
+        for (size_t k = 0; k < paths.size(); k++) {
+            loc_read_conf(paths[k].c_str(), tables[k]->table.data(), tables[k]->table.size());
+        }
+        double t4 = getSeconds();
+        uncached += t1 - start;
+        cold += t3 - t2;
+        warm += t4 - t3;
+    }
+    printf("startup reads: %.1f us uncached, %.1f us cached (%.1f us first time)\n",
+           uncached * 1000000 / iterations, warm * 1000000 / iterations,
+           cold * 1000000 / iterations);
+    return ok ? 0 : 1;
+}
+
+#endif
@@ -31,9 +31,11 @@
 #define LOG_TAG "LocSvc_nmea"
 #include <loc_nmea.h>
 #include <math.h>
+#include <float.h>
 #include <log_util.h>
 #include <loc_pla.h>
 #include <loc_cfg.h>
+#include <LocSvUsedMask.h>
 
 #define GLONASS_SV_ID_OFFSET 64
 #define QZSS_SV_ID_OFFSET    (-192)
@@ -121,12 +123,7 @@ typedef struct loc_nmea_sv_meta_s
 
 typedef struct loc_sv_cache_info_s
 {
-    uint64_t gps_used_mask;
-    uint64_t glo_used_mask;
-    uint64_t gal_used_mask;
-    uint64_t qzss_used_mask;
-    uint64_t bds_used_mask;
-    uint64_t navic_used_mask;
+    GnssSvUsedInPosition used;
     uint32_t gps_l1_count;
     uint32_t gps_l5_count;
     uint32_t glo_g1_count;
@@ -143,6 +140,26 @@ typedef struct loc_sv_cache_info_s
     float vdop;
 } loc_sv_cache_info;
 
+// GSV groups, one per constellation and signal, in the order they are sent
+#define LOC_NMEA_GSV_GROUPS 11
+static const struct {
+    GnssSvType svType;
+    GnssSignalTypeMask signalType;
+    uint32_t signalId;
+} sGsvGroups[LOC_NMEA_GSV_GROUPS] = {
+    { GNSS_SV_TYPE_GPS,     GNSS_SIGNAL_GPS_L1CA,    SIGNAL_ID_GPS_L1CA },    // $GPGSV:L1CA
+    { GNSS_SV_TYPE_GPS,     GNSS_SIGNAL_GPS_L5,      SIGNAL_ID_GPS_L5Q },     // $GPGSV:L5
+    { GNSS_SV_TYPE_GLONASS, GNSS_SIGNAL_GLONASS_G1,  SIGNAL_ID_GLO_G1CA },    // $GLGSV:G1
+    { GNSS_SV_TYPE_GLONASS, GNSS_SIGNAL_GLONASS_G2,  SIGNAL_ID_GLO_G2CA },    // $GLGSV:G2
+    { GNSS_SV_TYPE_GALILEO, GNSS_SIGNAL_GALILEO_E1,  SIGNAL_ID_GAL_L1BC },    // $GAGSV:E1
+    { GNSS_SV_TYPE_GALILEO, GNSS_SIGNAL_GALILEO_E5A, SIGNAL_ID_GAL_E5A },     // $GAGSV:E5A
+    { GNSS_SV_TYPE_QZSS,    GNSS_SIGNAL_QZSS_L1CA,   SIGNAL_ID_QZSS_L1CA },   // $GQGSV:L1CA
+    { GNSS_SV_TYPE_QZSS,    GNSS_SIGNAL_QZSS_L5,     SIGNAL_ID_QZSS_L5Q },    // $GQGSV:L5
+    { GNSS_SV_TYPE_BEIDOU,  GNSS_SIGNAL_BEIDOU_B1I,  SIGNAL_ID_BDS_B1I },     // $GBGSV:B1I
+    { GNSS_SV_TYPE_BEIDOU,  GNSS_SIGNAL_BEIDOU_B2AI, SIGNAL_ID_BDS_B2A },     // $GBGSV:B2AI
+    { GNSS_SV_TYPE_NAVIC,   GNSS_SIGNAL_NAVIC_L5,    SIGNAL_ID_NAVIC_L5SPS }, // $GIGSV:L5
+};
+
 /*===========================================================================
 FUNCTION    convert_Lla_to_Ecef
 
@@ -159,14 +176,16 @@ SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-static void convert_Lla_to_Ecef(const LocLla& plla, LocEcef& pecef)
+static inline void convert_Lla_to_Ecef(const LocLla& plla, LocEcef& pecef)
 {
+    double sinLat = sin(plla.lat);
+    double cosLat = cos(plla.lat);
     double r;
 
-    r = MAJA / sqrt(1.0 - ESQR * sin(plla.lat) * sin(plla.lat));
-    pecef.X = (r + plla.alt) * cos(plla.lat) * cos(plla.lon);
-    pecef.Y = (r + plla.alt) * cos(plla.lat) * sin(plla.lon);
-    pecef.Z = (r * OMES + plla.alt) * sin(plla.lat);
+    r = MAJA / sqrt(1.0 - ESQR * sinLat * sinLat);
+    pecef.X = (r + plla.alt) * cosLat * cos(plla.lon);
+    pecef.Y = (r + plla.alt) * cosLat * sin(plla.lon);
+    pecef.Z = (r * OMES + plla.alt) * sinLat;
 }
 
 /*===========================================================================
@@ -185,7 +204,7 @@ SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-static void convert_WGS84_to_PZ90(const LocEcef& pWGS84, LocEcef& pPZ90)
+static inline void convert_WGS84_to_PZ90(const LocEcef& pWGS84, LocEcef& pPZ90)
 {
     double deltaX     = DatumConstFromWGS84[0];
     double deltaY     = DatumConstFromWGS84[1];
@@ -201,10 +220,12 @@ static void convert_WGS84_to_PZ90(const LocEcef& pWGS84, LocEcef& pPZ90)
 }
 
 /*===========================================================================
-FUNCTION    convert_Ecef_to_Lla
+FUNCTION    convert_Ecef_to_Lla_Bowring
 
 DESCRIPTION
-   Convert ECEF to LLA
+   Convert ECEF to LLA on the PZ90 ellipsoid, with one step of Bowring's
+   method. Only used for points within the evolute of the ellipsoid, tens of
+   km around the centre of the earth, where convert_Ecef_to_Lla does not apply.
 
 DEPENDENCIES
    NONE
@@ -216,7 +237,7 @@ SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-static void convert_Ecef_to_Lla(const LocEcef& pecef, LocLla& plla)
+static void convert_Ecef_to_Lla_Bowring(const LocEcef& pecef, LocLla& plla)
 {
     double p, r;
     double EcefA = C_PZ90A;
@@ -263,6 +284,98 @@ static void convert_Ecef_to_Lla(const LocEcef& pecef, LocLla& plla)
     }
 }
 
+/* PZ90 ellipsoid terms of convert_Ecef_to_Lla */
+#define PZ90_A2            (C_PZ90A * C_PZ90A)
+/* 1st eccentricity squared, and its square */
+#define PZ90_E2            (1.0 - (C_PZ90B * C_PZ90B) / PZ90_A2)
+#define PZ90_E4            (PZ90_E2 * PZ90_E2)
+
+/*===========================================================================
+FUNCTION    convert_Ecef_to_Lla
+
+DESCRIPTION
+   Convert ECEF to LLA on the PZ90 ellipsoid, in closed form after
+   H. Vermeille, "Direct transformation from geocentric coordinates to
+   geodetic coordinates", Journal of Geodesy (2002) 76: 451-454.
+   Exact up to rounding, with no trigonometry besides the final atan2s.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static inline void convert_Ecef_to_Lla(const LocEcef& pecef, LocLla& plla)
+{
+    double w2 = pecef.X * pecef.X + pecef.Y * pecef.Y;
+    double p = w2 / PZ90_A2;
+    double q = (1.0 - PZ90_E2) * pecef.Z * pecef.Z / PZ90_A2;
+    double r = (p + q - PZ90_E4) / 6.0;
+
+    if (r <= 0.0) {
+        // inside the evolute, not a place a fix can be
+        convert_Ecef_to_Lla_Bowring(pecef, plla);
+        return;
+    }
+
+    double s = PZ90_E4 * p * q / (4.0 * r * r * r);
+    double t = cbrt(1.0 + s + sqrt(s * (2.0 + s)));
+    double u = r * (1.0 + t + 1.0 / t);
+    double v = sqrt(u * u + PZ90_E4 * q);
+    double w = PZ90_E2 * (u + v - q) / (2.0 * v);
+    double k = sqrt(u + v + w * w) - w;
+    double d = k * sqrt(w2) / (k + PZ90_E2);
+    double dz = sqrt(d * d + pecef.Z * pecef.Z);
+
+    plla.lat = 2.0 * atan2(pecef.Z, d + dz);
+    plla.alt = (k + PZ90_E2 - 1.0) / k * dz;
+    if (w2 > 1.0) {
+        plla.lon = atan2(pecef.Y, pecef.X);
+    } else {
+        plla.lon = 0.0;
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_convert_WGS84_to_PZ90
+
+DESCRIPTION
+   Convert positions from the WGS84 to the PZ90 datum, latitude and
+   longitude in degrees. wgs84 and pz90 may be the same array.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_convert_WGS84_to_PZ90(const LocLla* wgs84, LocLla* pz90, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        LocLla lla;
+        LocEcef ecef_w84;
+        LocEcef ecef_p90;
+
+        lla.lat = wgs84[i].lat / 180.0 * M_PI;
+        lla.lon = wgs84[i].lon / 180.0 * M_PI;
+        lla.alt = wgs84[i].alt;
+        convert_Lla_to_Ecef(lla, ecef_w84);
+        convert_WGS84_to_PZ90(ecef_w84, ecef_p90);
+        convert_Ecef_to_Lla(ecef_p90, lla);
+        pz90[i].lat = lla.lat / M_PI * 180.0;
+        pz90[i].lon = lla.lon / M_PI * 180.0;
+        pz90[i].alt = lla.alt;
+    }
+}
+
 /*===========================================================================
 FUNCTION    convert_signalType_to_signalId
 
@@ -359,19 +472,15 @@ SIDE EFFECTS
 ===========================================================================*/
 static uint32_t get_sv_count_from_mask(uint64_t svMask, int totalSvCount)
 {
-    int index = 0;
-    uint32_t svCount = 0;
-
     if(totalSvCount > MAX_SV_COUNT_SUPPORTED_IN_ONE_CONSTELLATION) {
         LOC_LOGE("total SV count in this constellation %d exceeded limit %d",
                  totalSvCount, MAX_SV_COUNT_SUPPORTED_IN_ONE_CONSTELLATION);
+    } else if (totalSvCount <= 0) {
+        return 0;
+    } else if (totalSvCount < 64) {
+        svMask &= (1ULL << totalSvCount) - 1;
     }
-    for(index = 0; index < totalSvCount; index++) {
-        if(svMask & 0x1)
-            svCount += 1;
-        svMask >>= 1;
-    }
-    return svCount;
+    return __builtin_popcountll(svMask);
 }
 
 /*===========================================================================
@@ -404,7 +513,7 @@ static loc_nmea_sv_meta* loc_nmea_sv_meta_init(loc_nmea_sv_meta& sv_meta,
         case GNSS_SV_TYPE_GPS:
             sv_meta.talker[0] = 'G';
             sv_meta.talker[1] = 'P';
-            sv_meta.mask = sv_cache_info.gps_used_mask;
+            sv_meta.mask = sv_cache_info.used.gps_sv_used_ids_mask;
             sv_meta.systemId = SYSTEM_ID_GPS;
             if (GNSS_SIGNAL_GPS_L1CA == signalType) {
                 sv_meta.svCount = sv_cache_info.gps_l1_count;
@@ -415,7 +524,7 @@ static loc_nmea_sv_meta* loc_nmea_sv_meta_init(loc_nmea_sv_meta& sv_meta,
         case GNSS_SV_TYPE_GLONASS:
             sv_meta.talker[0] = 'G';
             sv_meta.talker[1] = 'L';
-            sv_meta.mask = sv_cache_info.glo_used_mask;
+            sv_meta.mask = sv_cache_info.used.glo_sv_used_ids_mask;
             // GLONASS SV ids are from 65-96
             sv_meta.svIdOffset = GLONASS_SV_ID_OFFSET;
             sv_meta.systemId = SYSTEM_ID_GLONASS;
@@ -428,7 +537,7 @@ static loc_nmea_sv_meta* loc_nmea_sv_meta_init(loc_nmea_sv_meta& sv_meta,
         case GNSS_SV_TYPE_GALILEO:
             sv_meta.talker[0] = 'G';
             sv_meta.talker[1] = 'A';
-            sv_meta.mask = sv_cache_info.gal_used_mask;
+            sv_meta.mask = sv_cache_info.used.gal_sv_used_ids_mask;
             sv_meta.systemId = SYSTEM_ID_GALILEO;
             if (GNSS_SIGNAL_GALILEO_E1 == signalType) {
                 sv_meta.svCount = sv_cache_info.gal_e1_count;
@@ -439,7 +548,7 @@ static loc_nmea_sv_meta* loc_nmea_sv_meta_init(loc_nmea_sv_meta& sv_meta,
         case GNSS_SV_TYPE_QZSS:
             sv_meta.talker[0] = 'G';
             sv_meta.talker[1] = 'Q';
-            sv_meta.mask = sv_cache_info.qzss_used_mask;
+            sv_meta.mask = sv_cache_info.used.qzss_sv_used_ids_mask;
             // QZSS SV ids are from 193-199. So keep svIdOffset -192
             sv_meta.svIdOffset = QZSS_SV_ID_OFFSET;
             sv_meta.systemId = SYSTEM_ID_QZSS;
@@ -452,7 +561,7 @@ static loc_nmea_sv_meta* loc_nmea_sv_meta_init(loc_nmea_sv_meta& sv_meta,
         case GNSS_SV_TYPE_BEIDOU:
             sv_meta.talker[0] = 'G';
             sv_meta.talker[1] = 'B';
-            sv_meta.mask = sv_cache_info.bds_used_mask;
+            sv_meta.mask = sv_cache_info.used.bds_sv_used_ids_mask;
             // BDS SV ids are from 201-235. So keep svIdOffset 0
             sv_meta.systemId = SYSTEM_ID_BDS;
             if (GNSS_SIGNAL_BEIDOU_B1I == signalType) {
@@ -464,7 +573,7 @@ static loc_nmea_sv_meta* loc_nmea_sv_meta_init(loc_nmea_sv_meta& sv_meta,
         case GNSS_SV_TYPE_NAVIC:
             sv_meta.talker[0] = 'G';
             sv_meta.talker[1] = 'I';
-            sv_meta.mask = sv_cache_info.navic_used_mask;
+            sv_meta.mask = sv_cache_info.used.navic_sv_used_ids_mask;
             // NAVIC SV ids are from 401-414. So keep svIdOffset 0
             sv_meta.systemId = SYSTEM_ID_NAVIC;
             if (GNSS_SIGNAL_NAVIC_L5 == signalType) {
@@ -477,25 +586,25 @@ static loc_nmea_sv_meta* loc_nmea_sv_meta_init(loc_nmea_sv_meta& sv_meta,
     }
     sv_meta.signalId = convert_signalType_to_signalId(signalType);
     sv_meta.totalSvUsedCount =
-            get_sv_count_from_mask(sv_cache_info.gps_used_mask,
+            get_sv_count_from_mask(sv_cache_info.used.gps_sv_used_ids_mask,
                     GPS_SV_PRN_MAX - GPS_SV_PRN_MIN + 1) +
-            get_sv_count_from_mask(sv_cache_info.glo_used_mask,
+            get_sv_count_from_mask(sv_cache_info.used.glo_sv_used_ids_mask,
                     GLO_SV_PRN_MAX - GLO_SV_PRN_MIN + 1) +
-            get_sv_count_from_mask(sv_cache_info.gal_used_mask,
+            get_sv_count_from_mask(sv_cache_info.used.gal_sv_used_ids_mask,
                     GAL_SV_PRN_MAX - GAL_SV_PRN_MIN + 1) +
-            get_sv_count_from_mask(sv_cache_info.qzss_used_mask,
+            get_sv_count_from_mask(sv_cache_info.used.qzss_sv_used_ids_mask,
                     QZSS_SV_PRN_MAX - QZSS_SV_PRN_MIN + 1) +
-            get_sv_count_from_mask(sv_cache_info.bds_used_mask,
+            get_sv_count_from_mask(sv_cache_info.used.bds_sv_used_ids_mask,
                     BDS_SV_PRN_MAX - BDS_SV_PRN_MIN + 1) +
-            get_sv_count_from_mask(sv_cache_info.navic_used_mask,
+            get_sv_count_from_mask(sv_cache_info.used.navic_sv_used_ids_mask,
                     NAVIC_SV_PRN_MAX - NAVIC_SV_PRN_MIN + 1);
     if (needCombine &&
-                (sv_cache_info.gps_used_mask ? 1 : 0) +
-                (sv_cache_info.glo_used_mask ? 1 : 0) +
-                (sv_cache_info.gal_used_mask ? 1 : 0) +
-                (sv_cache_info.qzss_used_mask ? 1 : 0) +
-                (sv_cache_info.bds_used_mask ? 1 : 0) +
-                (sv_cache_info.navic_used_mask ? 1 : 0) > 1)
+                (sv_cache_info.used.gps_sv_used_ids_mask ? 1 : 0) +
+                (sv_cache_info.used.glo_sv_used_ids_mask ? 1 : 0) +
+                (sv_cache_info.used.gal_sv_used_ids_mask ? 1 : 0) +
+                (sv_cache_info.used.qzss_sv_used_ids_mask ? 1 : 0) +
+                (sv_cache_info.used.bds_sv_used_ids_mask ? 1 : 0) +
+                (sv_cache_info.used.navic_sv_used_ids_mask ? 1 : 0) > 1)
     {
         // If GPS, GLONASS, Galileo, QZSS, BDS etc. are combined
         // to obtain the reported position solution,
@@ -508,42 +617,206 @@ static loc_nmea_sv_meta* loc_nmea_sv_meta_init(loc_nmea_sv_meta& sv_meta,
 }
 
 /*===========================================================================
-FUNCTION    loc_nmea_put_checksum
+CLASS       LocNmeaWriter
 
 DESCRIPTION
-   Generate NMEA sentences generated based on position report
+   Appends NMEA sentences to a caller supplied buffer, back to back and
+   NUL terminated, without going through printf or temporary strings.
+   The number formatters produce exactly what the printf conversion named
+   on each of them would, so the output stays the same byte for byte.
+   A sentence that does not fit into the buffer, or would be longer than
+   NMEA_SENTENCE_MAX_LENGTH, is dropped as a whole.
 
-DEPENDENCIES
-   NONE
+===========================================================================*/
+class LocNmeaWriter
+{
+    char* const mBuffer;
+    const size_t mSize;
+    // end of the last complete sentence, and of the one being written
+    size_t mLength;
+    size_t mCursor;
+    bool mOverflow;
+
+    // digits of *value* into the tail of *digits*, returns where they start
+    static inline char* toDigits(uint64_t value, char* end, int minDigits)
+    {
+        char* p = end;
+        do {
+            *--p = '0' + (value % 10);
+            value /= 10;
+        } while (value > 0 || (end - p) < minDigits);
+        return p;
+    }
 
-RETURN VALUE
-   Total length of the nmea sentence
+    // zero padded to *width* after the sign, like printf's '0' flag
+    inline void putPadded(bool negative, const char* digits, int count, int width)
+    {
+        if (negative) {
+            put('-');
+            width--;
+        }
+        for (; width > count; width--) {
+            put('0');
+        }
+        put(digits, count);
+    }
 
-SIDE EFFECTS
-   N/A
+public:
+    inline LocNmeaWriter(char* buffer, size_t size) :
+        mBuffer(buffer), mSize(size), mLength(0), mCursor(0), mOverflow(false)
+    {
+        if (mSize > 0) {
+            mBuffer[0] = '\0';
+        }
+    }
 
-===========================================================================*/
-static int loc_nmea_put_checksum(char *pNmea, int maxSize)
-{
-    uint8_t checksum = 0;
-    int length = 0;
-    if(NULL == pNmea)
-        return 0;
+    // bytes in the complete sentences, not counting the NUL
+    inline size_t length() const { return mLength; }
 
-    pNmea++; //skip the $
-    while (*pNmea != '\0')
+    // starts a sentence with "$<talker><type>"
+    inline void begin(const char* talker, const char* type)
     {
-        checksum ^= *pNmea++;
-        length++;
+        mCursor = mLength;
+        mOverflow = false;
+        put('$');
+        put(talker);
+        put(type);
     }
 
-    // length now contains nmea sentence string length not including $ sign.
-    int checksumLength = snprintf(pNmea,(maxSize-length-1),"*%02X\r\n", checksum);
+    inline void put(char c)
+    {
+        // one byte is always left for the NUL
+        if (mCursor + 1 < mSize) {
+            mBuffer[mCursor++] = c;
+        } else {
+            mOverflow = true;
+        }
+    }
 
-    // total length of nmea sentence is length of nmea sentence inc $ sign plus
-    // length of checksum (+1 is to cover the $ character in the length).
-    return (length + checksumLength + 1);
-}
+    inline void put(const char* s, size_t length)
+    {
+        if (mCursor + length < mSize) {
+            memcpy(mBuffer + mCursor, s, length);
+            mCursor += length;
+        } else {
+            mOverflow = true;
+        }
+    }
+
+    inline void put(const char* s)
+    {
+        put(s, strlen(s));
+    }
+
+    // "%0<width>d"
+    void putInt(int value, int width = 0)
+    {
+        char digits[16];
+        char* end = digits + sizeof(digits);
+        uint64_t magnitude = (value < 0) ? -(int64_t)value : value;
+        char* p = toDigits(magnitude, end, 1);
+        putPadded(value < 0, p, end - p, width);
+    }
+
+    // "%X"
+    void putHex(uint32_t value)
+    {
+        static const char sHexDigits[] = "0123456789ABCDEF";
+        char digits[8];
+        char* end = digits + sizeof(digits);
+        char* p = end;
+        do {
+            *--p = sHexDigits[value & 0xF];
+            value >>= 4;
+        } while (value > 0);
+        put(p, end - p);
+    }
+
+    // "%02X"
+    inline void putHex2(uint8_t value)
+    {
+        static const char sHexDigits[] = "0123456789ABCDEF";
+        put(sHexDigits[value >> 4]);
+        put(sHexDigits[value & 0xF]);
+    }
+
+    // "%0<width>.<decimals>f", decimals up to 6
+    void putFixed(double value, int decimals, int width = 0)
+    {
+        static const double sScale[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+        static const uint64_t sDivisor[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+        double magnitude = fabs(value);
+        double scaled = magnitude * sScale[decimals];
+
+        // 2^52, beyond which scaled has no fraction bits left; also NaN / inf.
+        // Never seen in a fix, leave those to libc rather than duplicating it.
+        if (!(scaled < 4503599627370496.0)) {
+            char fallback[DBL_MAX_10_EXP + 16];
+            snprintf(fallback, sizeof(fallback), "%0*.*f", width, decimals, value);
+            put(fallback);
+            return;
+        }
+
+        // printf rounds the exact binary value, half to even. The product above
+        // may itself have been rounded onto or across the half way point, so
+        // when it is that close, the exact remainder of it decides.
+        double whole = floor(scaled);
+        uint64_t units = (uint64_t)whole;
+        double fromHalf = (scaled - whole) - 0.5;
+        if (fabs(fromHalf) <= scaled * DBL_EPSILON) {
+            fromHalf += fma(magnitude, sScale[decimals], -scaled);
+        }
+        if (fromHalf > 0.0 || (0.0 == fromHalf && (units & 1))) {
+            units++;
+        }
+
+        char digits[32];
+        char* end = digits + sizeof(digits);
+        char* p = end;
+        if (decimals > 0) {
+            p = toDigits(units % sDivisor[decimals], end, decimals);
+            *--p = '.';
+        }
+        p = toDigits(units / sDivisor[decimals], p, 1);
+        putPadded(signbit(value), p, end - p, width);
+    }
+
+    // appends "*<checksum>\r\n" and keeps the sentence, if it fit
+    bool end()
+    {
+        uint8_t checksum = 0;
+        for (size_t i = mLength + 1; i < mCursor; i++) {
+            checksum ^= (uint8_t)mBuffer[i];
+        }
+        put('*');
+        putHex2(checksum);
+        put("\r\n", 2);
+
+        if (mOverflow || mCursor - mLength >= NMEA_SENTENCE_MAX_LENGTH) {
+            LOC_LOGE("NMEA Error in string formatting");
+            mCursor = mLength;
+        } else {
+            mLength = mCursor;
+        }
+        if (mSize > 0) {
+            mBuffer[mLength] = '\0';
+        }
+        return (mLength == mCursor) && !mOverflow;
+    }
+
+    // appends another copy of a complete sentence written earlier
+    void repeat(size_t offset, size_t length)
+    {
+        if (offset + length <= mLength && mLength + length < mSize) {
+            memcpy(mBuffer + mLength, mBuffer + offset, length);
+            mLength += length;
+            mCursor = mLength;
+            mBuffer[mLength] = '\0';
+        } else if (length > 0) {
+            LOC_LOGE("NMEA Error in string formatting");
+        }
+    }
+};
 
 /*===========================================================================
 FUNCTION    loc_nmea_generate_GSA
@@ -567,21 +840,15 @@ SIDE EFFECTS
 
 ===========================================================================*/
 static uint32_t loc_nmea_generate_GSA(const GpsLocationExtended &locationExtended,
-                              char* sentence,
-                              int bufSize,
-                              loc_nmea_sv_meta* sv_meta_p,
-                              std::vector<std::string> &nmeaArraystr)
+                              LocNmeaWriter &writer,
+                              loc_nmea_sv_meta* sv_meta_p)
 {
-    if (!sentence || bufSize <= 0 || !sv_meta_p)
+    if (!sv_meta_p)
     {
         LOC_LOGE("NMEA Error invalid arguments.");
         return 0;
     }
 
-    char* pMarker = sentence;
-    int lengthRemaining = bufSize;
-    int length = 0;
-
     uint32_t svUsedCount = 0;
     uint32_t svUsedList[64] = {0};
 
@@ -622,60 +889,104 @@ static uint32_t loc_nmea_generate_GSA(const GpsLocationExtended &locationExtende
     // v.v : Vertical DOP
     // s : GNSS System Id
     // cc : Checksum value
-    length = snprintf(pMarker, lengthRemaining, "$%sGSA,A,%c,", talker, fixType);
-
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return 0;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+    writer.begin(talker, "GSA");
+    writer.put(",A,");
+    writer.put(fixType);
+    writer.put(',');
 
     // Add first 12 satellite IDs
     for (uint8_t i = 0; i < 12; i++)
     {
         if (i < svUsedCount)
-            length = snprintf(pMarker, lengthRemaining, "%02d,", svUsedList[i]);
-        else
-            length = snprintf(pMarker, lengthRemaining, ",");
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return 0;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+            writer.putInt(svUsedList[i], 2);
+        writer.put(',');
     }
 
     // Add the position/horizontal/vertical DOP values
     if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
     {
-        length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f,",
-                locationExtended.pdop,
-                locationExtended.hdop,
-                locationExtended.vdop);
+        writer.putFixed(locationExtended.pdop, 1);
+        writer.put(',');
+        writer.putFixed(locationExtended.hdop, 1);
+        writer.put(',');
+        writer.putFixed(locationExtended.vdop, 1);
+        writer.put(',');
     }
     else
     {   // no dop
-        length = snprintf(pMarker, lengthRemaining, ",,,");
+        writer.put(",,,");
     }
-    pMarker += length;
-    lengthRemaining -= length;
 
     // system id
-    length = snprintf(pMarker, lengthRemaining, "%d", sv_meta_p->systemId);
-    pMarker += length;
-    lengthRemaining -= length;
+    writer.putInt(sv_meta_p->systemId);
 
     /* Sentence is ready, add checksum and broadcast */
-    length = loc_nmea_put_checksum(sentence, bufSize);
-    nmeaArraystr.push_back(sentence);
+    if (!writer.end())
+        return 0;
 
     return svUsedCount;
 }
 
+/*===========================================================================
+FUNCTION    loc_nmea_get_gsv_group
+
+DESCRIPTION
+   Find the GSV group an SV is listed in, by constellation and signal
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   Index into sGsvGroups, or -1 if the SV is not listed in any of them
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_nmea_get_gsv_group(const GnssSv &sv)
+{
+    GnssSignalTypeMask signalType = sv.gnssSignalTypeMask;
+    if (0 == signalType) {
+        // If no signal type in report, it means default L1,G1,E1,B1I
+        switch (sv.type)
+        {
+            case GNSS_SV_TYPE_GPS:
+                signalType = GNSS_SIGNAL_GPS_L1CA;
+                break;
+            case GNSS_SV_TYPE_GLONASS:
+                signalType = GNSS_SIGNAL_GLONASS_G1;
+                break;
+            case GNSS_SV_TYPE_GALILEO:
+                signalType = GNSS_SIGNAL_GALILEO_E1;
+                break;
+            case GNSS_SV_TYPE_QZSS:
+                signalType = GNSS_SIGNAL_QZSS_L1CA;
+                break;
+            case GNSS_SV_TYPE_BEIDOU:
+                signalType = GNSS_SIGNAL_BEIDOU_B1I;
+                break;
+            case GNSS_SV_TYPE_SBAS:
+                signalType = GNSS_SIGNAL_SBAS_L1;
+                break;
+            case GNSS_SV_TYPE_NAVIC:
+                signalType = GNSS_SIGNAL_NAVIC_L5;
+                break;
+            default:
+                LOC_LOGE("NMEA Error unknow constellation type: %d", sv.type);
+                return -1;
+        }
+    }
+
+    uint32_t signalId = convert_signalType_to_signalId(signalType);
+    for (int group = 0; group < LOC_NMEA_GSV_GROUPS; group++) {
+        if (sGsvGroups[group].svType == sv.type &&
+                sGsvGroups[group].signalId == signalId) {
+            return group;
+        }
+    }
+    return -1;
+}
+
 /*===========================================================================
 FUNCTION    loc_nmea_generate_GSV
 
@@ -685,6 +996,7 @@ DESCRIPTION
    - $GPGSV: GPS Satellites in View
    - $GLGSV: GLONASS Satellites in View
    - $GAGSV: GALILEO Satellites in View
+   svIndexes lists the SVs of the group, in the order of the report.
 
 DEPENDENCIES
    NONE
@@ -697,23 +1009,20 @@ SIDE EFFECTS
 
 ===========================================================================*/
 static void loc_nmea_generate_GSV(const GnssSvNotification &svNotify,
-                              char* sentence,
-                              int bufSize,
-                              loc_nmea_sv_meta* sv_meta_p,
-                              std::vector<std::string> &nmeaArraystr)
+                              const uint8_t* svIndexes,
+                              uint32_t svIndexCount,
+                              LocNmeaWriter &writer,
+                              loc_nmea_sv_meta* sv_meta_p)
 {
-    if (!sentence || bufSize <= 0)
+    if (!sv_meta_p)
     {
         LOC_LOGE("NMEA Error invalid argument.");
         return;
     }
 
-    char* pMarker = sentence;
-    int lengthRemaining = bufSize;
-    int length = 0;
     int sentenceCount = 0;
     int sentenceNumber = 1;
-    size_t svNumber = 1;
+    uint32_t svIndex = 0;
 
     const char* talker = sv_meta_p->talker;
     uint32_t svIdOffset = sv_meta_p->svIdOffset;
@@ -724,108 +1033,47 @@ static void loc_nmea_generate_GSV(const GnssSvNotification &svNotify,
         return;
     }
 
-    svNumber = 1;
     sentenceNumber = 1;
     sentenceCount = svCount / 4 + (svCount % 4 != 0);
 
     while (sentenceNumber <= sentenceCount)
     {
-        pMarker = sentence;
-        lengthRemaining = bufSize;
-
-        length = snprintf(pMarker, lengthRemaining, "$%sGSV,%d,%d,%02d",
-                talker, sentenceCount, sentenceNumber, svCount);
-
-        if (length < 0 || length >= lengthRemaining)
+        writer.begin(talker, "GSV");
+        writer.put(',');
+        writer.putInt(sentenceCount);
+        writer.put(',');
+        writer.putInt(sentenceNumber);
+        writer.put(',');
+        writer.putInt(svCount, 2);
+
+        for (int i = 0; (svIndex < svIndexCount) && (i < 4); i++, svIndex++)
         {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        for (int i=0; (svNumber <= svNotify.count) && (i < 4);  svNumber++)
-        {
-            GnssSignalTypeMask signalType = svNotify.gnssSvs[svNumber-1].gnssSignalTypeMask;
-            if (0 == signalType) {
-                // If no signal type in report, it means default L1,G1,E1,B1I
-                switch (svNotify.gnssSvs[svNumber - 1].type)
-                {
-                    case GNSS_SV_TYPE_GPS:
-                        signalType = GNSS_SIGNAL_GPS_L1CA;
-                        break;
-                    case GNSS_SV_TYPE_GLONASS:
-                        signalType = GNSS_SIGNAL_GLONASS_G1;
-                        break;
-                    case GNSS_SV_TYPE_GALILEO:
-                        signalType = GNSS_SIGNAL_GALILEO_E1;
-                        break;
-                    case GNSS_SV_TYPE_QZSS:
-                        signalType = GNSS_SIGNAL_QZSS_L1CA;
-                        break;
-                    case GNSS_SV_TYPE_BEIDOU:
-                        signalType = GNSS_SIGNAL_BEIDOU_B1I;
-                        break;
-                    case GNSS_SV_TYPE_SBAS:
-                        signalType = GNSS_SIGNAL_SBAS_L1;
-                        break;
-                    case GNSS_SV_TYPE_NAVIC:
-                        signalType = GNSS_SIGNAL_NAVIC_L5;
-                        break;
-                    default:
-                        LOC_LOGE("NMEA Error unknow constellation type: %d",
-                                svNotify.gnssSvs[svNumber - 1].type);
-                        continue;
-                }
+            const GnssSv& sv = svNotify.gnssSvs[svIndexes[svIndex]];
+            uint16_t svId = sv.svId;
+            // For QZSS we adjusted SV id's in GnssAdapter, we need to re-adjust here
+            if (GNSS_SV_TYPE_QZSS == sv.type) {
+                svId = svId - (QZSS_SV_PRN_MIN - 1);
             }
-
-            if (sv_meta_p->svType == svNotify.gnssSvs[svNumber - 1].type &&
-                    sv_meta_p->signalId == convert_signalType_to_signalId(signalType))
+            writer.put(',');
+            writer.putInt(svId + svIdOffset, 2);
+            writer.put(',');
+            writer.putInt((int)(0.5 + sv.elevation), 2); //float to int
+            writer.put(',');
+            writer.putInt((int)(0.5 + sv.azimuth), 3); //float to int
+            writer.put(',');
+
+            if (sv.cN0Dbhz > 0)
             {
-                uint16_t svId = svNotify.gnssSvs[svNumber - 1].svId;
-                // For QZSS we adjusted SV id's in GnssAdapter, we need to re-adjust here
-                if (GNSS_SV_TYPE_QZSS == svNotify.gnssSvs[svNumber - 1].type) {
-                    svId = svId - (QZSS_SV_PRN_MIN - 1);
-                }
-                length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
-                        svId + svIdOffset,
-                        (int)(0.5 + svNotify.gnssSvs[svNumber - 1].elevation), //float to int
-                        (int)(0.5 + svNotify.gnssSvs[svNumber - 1].azimuth)); //float to int
-
-                if (length < 0 || length >= lengthRemaining)
-                {
-                    LOC_LOGE("NMEA Error in string formatting");
-                    return;
-                }
-                pMarker += length;
-                lengthRemaining -= length;
-
-                if (svNotify.gnssSvs[svNumber - 1].cN0Dbhz > 0)
-                {
-                    length = snprintf(pMarker, lengthRemaining,"%02d",
-                            (int)(0.5 + svNotify.gnssSvs[svNumber - 1].cN0Dbhz)); //float to int
-
-                    if (length < 0 || length >= lengthRemaining)
-                    {
-                        LOC_LOGE("NMEA Error in string formatting");
-                        return;
-                    }
-                    pMarker += length;
-                    lengthRemaining -= length;
-                }
-
-                i++;
+                writer.putInt((int)(0.5 + sv.cN0Dbhz), 2); //float to int
             }
-
         }
 
         // append signalId
-        length = snprintf(pMarker, lengthRemaining,",%X",sv_meta_p->signalId);
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(',');
+        writer.putHex(sv_meta_p->signalId);
 
-        length = loc_nmea_put_checksum(sentence, bufSize);
-        nmeaArraystr.push_back(sentence);
+        if (!writer.end())
+            return;
         sentenceNumber++;
 
     }  //while
@@ -849,14 +1097,10 @@ SIDE EFFECTS
 ===========================================================================*/
 static void loc_nmea_generate_DTM(const LocLla &ref_lla,
                                   const LocLla &local_lla,
-                                  char *talker,
-                                  char *sentence,
-                                  int bufSize)
+                                  int datum_type,
+                                  const char *talker,
+                                  LocNmeaWriter &writer)
 {
-    char* pMarker = sentence;
-    int lengthRemaining = bufSize;
-    int length = 0;
-    int datum_type;
     char ref_datum[4] = {0};
     char local_datum[4] = {0};
     double lla_offset[3] = {0};
@@ -864,8 +1108,6 @@ static void loc_nmea_generate_DTM(const LocLla &ref_lla,
     double latMins, longMins;
 
 
-
-    datum_type = loc_get_datum_type();
     switch (datum_type) {
         case LOC_GNSS_DATUM_WGS84:
             ref_datum[0] = 'W';
@@ -886,13 +1128,10 @@ static void loc_nmea_generate_DTM(const LocLla &ref_lla,
         default:
             break;
     }
-    length = snprintf(pMarker , lengthRemaining , "$%sDTM,%s,," , talker, local_datum);
-    if (length < 0 || length >= lengthRemaining) {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+    writer.begin(talker, "DTM");
+    writer.put(',');
+    writer.put(local_datum);
+    writer.put(",,");
 
     lla_offset[0] = local_lla.lat - ref_lla.lat;
     lla_offset[1] = fmod(local_lla.lon - ref_lla.lon, 360.0);
@@ -916,24 +1155,116 @@ static void loc_nmea_generate_DTM(const LocLla &ref_lla,
         longHem = 'E';
     }
     longMins = fmod(lla_offset[1] * 60.0, 60.0);
-    length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,%.3lf,",
-                     (uint8_t)floor(lla_offset[0]), latMins, latHem,
-                     (uint8_t)floor(lla_offset[1]), longMins, longHem, lla_offset[2]);
-    if (length < 0 || length >= lengthRemaining) {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
+    writer.putInt((uint8_t)floor(lla_offset[0]), 2);
+    writer.putFixed(latMins, 6, 9);
+    writer.put(',');
+    writer.put(latHem);
+    writer.put(',');
+    writer.putInt((uint8_t)floor(lla_offset[1]), 3);
+    writer.putFixed(longMins, 6, 9);
+    writer.put(',');
+    writer.put(longHem);
+    writer.put(',');
+    writer.putFixed(lla_offset[2], 3);
+    writer.put(',');
+    writer.put(ref_datum);
+
+    writer.end();
+}
+
+/*===========================================================================
+FUNCTION    loc_nmea_put_utc_time
+
+DESCRIPTION
+   Append the hhmmss.ss time field shared by RMC, GNS and GGA sentences
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_nmea_put_utc_time(LocNmeaWriter &writer, int utcHours, int utcMinutes,
+                                  int utcSeconds, int utcMSeconds)
+{
+    writer.putInt(utcHours, 2);
+    writer.putInt(utcMinutes, 2);
+    writer.putInt(utcSeconds, 2);
+    writer.put('.');
+    writer.putInt(utcMSeconds/10, 2);
+}
+
+/*===========================================================================
+FUNCTION    loc_nmea_put_lat_long
+
+DESCRIPTION
+   Append the latitude and longitude fields shared by RMC, GNS and GGA
+   sentences, or the empty fields if the position has none
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   NONE
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_nmea_put_lat_long(LocNmeaWriter &writer, const UlpLocation &location,
+                                  const LocLla &ref_lla)
+{
+    if (location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_LAT_LONG)
+    {
+        double latitude = ref_lla.lat;
+        double longitude = ref_lla.lon;
+        char latHemisphere;
+        char lonHemisphere;
+        double latMinutes;
+        double lonMinutes;
+
+        if (latitude > 0)
+        {
+            latHemisphere = 'N';
+        }
+        else
+        {
+            latHemisphere = 'S';
+            latitude *= -1.0;
+        }
+
+        if (longitude < 0)
+        {
+            lonHemisphere = 'W';
+            longitude *= -1.0;
+        }
+        else
+        {
+            lonHemisphere = 'E';
+        }
+
+        latMinutes = fmod(latitude * 60.0 , 60.0);
+        lonMinutes = fmod(longitude * 60.0 , 60.0);
+
+        writer.putInt((uint8_t)floor(latitude), 2);
+        writer.putFixed(latMinutes, 6, 9);
+        writer.put(',');
+        writer.put(latHemisphere);
+        writer.put(',');
+        writer.putInt((uint8_t)floor(longitude), 3);
+        writer.putFixed(lonMinutes, 6, 9);
+        writer.put(',');
+        writer.put(lonHemisphere);
+        writer.put(',');
     }
-    pMarker += length;
-    lengthRemaining -= length;
-    length = snprintf(pMarker , lengthRemaining , "%s" , ref_datum);
-    if (length < 0 || length >= lengthRemaining) {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
+    else
+    {
+        writer.put(",,,,");
     }
-    pMarker += length;
-    lengthRemaining -= length;
-
-    length = loc_nmea_put_checksum(sentence, bufSize);
 }
 
 /*===========================================================================
@@ -1166,28 +1497,33 @@ DESCRIPTION
    - $GAGSA : GALILEO DOP and active SVs
    - $GNGSA : GNSS DOP and active SVs
    - $--VTG : Track made good and ground speed
+   - $--DTM : Datum reference
    - $--RMC : Recommended minimum navigation information
+   - $--GNS : GNSS fix data
    - $--GGA : Time, position and fix related data
+   The sentences are written back to back into nmea, which should be
+   NMEA_POS_MAX_LENGTH bytes, and NUL terminated.
 
 DEPENDENCIES
    NONE
 
 RETURN VALUE
-   0
+   Length of the sentences written, not counting the NUL
 
 SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-void loc_nmea_generate_pos(const UlpLocation &location,
+size_t loc_nmea_generate_pos(const UlpLocation &location,
                                const GpsLocationExtended &locationExtended,
                                const LocationSystemInfo &systemInfo,
                                unsigned char generate_nmea,
                                bool custom_gga_fix_quality,
-                               std::vector<std::string> &nmeaArraystr)
+                               char *nmea, size_t nmeaSize)
 {
     ENTRY_LOG();
 
+    LocNmeaWriter writer(nmea, nmeaSize);
     LocGpsUtcTime utcPosTimestamp = 0;
     bool inLsTransition = false;
 
@@ -1195,20 +1531,13 @@ void loc_nmea_generate_pos(const UlpLocation &location,
                     (location, locationExtended, systemInfo, utcPosTimestamp);
 
     time_t utcTime(utcPosTimestamp/1000);
-    tm * pTm = gmtime(&utcTime);
+    struct tm tmUtc;
+    tm * pTm = gmtime_r(&utcTime, &tmUtc);
     if (NULL == pTm) {
         LOC_LOGE("gmtime failed");
-        return;
+        return 0;
     }
 
-    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char sentence_DTM[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char sentence_RMC[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char sentence_GNS[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char sentence_GGA[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char* pMarker = sentence;
-    int lengthRemaining = sizeof(sentence);
-    int length = 0;
     int utcYear = pTm->tm_year % 100; // 2 digit year
     int utcMonth = pTm->tm_mon + 1; // tm_mon starts at zero
     int utcDay = pTm->tm_mday;
@@ -1217,8 +1546,6 @@ void loc_nmea_generate_pos(const UlpLocation &location,
     int utcSeconds = pTm->tm_sec;
     int utcMSeconds = (location.gpsLocation.timestamp)%1000;
     int datum_type = loc_get_datum_type();
-    LocEcef ecef_w84;
-    LocEcef ecef_p90;
     LocLla  lla_w84;
     LocLla  lla_p90;
     LocLla  ref_lla;
@@ -1238,18 +1565,7 @@ void loc_nmea_generate_pos(const UlpLocation &location,
    loc_sv_cache_info sv_cache_info = {};
 
     if (GPS_LOCATION_EXTENDED_HAS_GNSS_SV_USED_DATA & locationExtended.flags) {
-        sv_cache_info.gps_used_mask =
-                locationExtended.gnss_sv_used_ids.gps_sv_used_ids_mask;
-        sv_cache_info.glo_used_mask =
-                locationExtended.gnss_sv_used_ids.glo_sv_used_ids_mask;
-        sv_cache_info.gal_used_mask =
-                locationExtended.gnss_sv_used_ids.gal_sv_used_ids_mask;
-        sv_cache_info.bds_used_mask =
-                locationExtended.gnss_sv_used_ids.bds_sv_used_ids_mask;
-        sv_cache_info.qzss_used_mask =
-                locationExtended.gnss_sv_used_ids.qzss_sv_used_ids_mask;
-        sv_cache_info.navic_used_mask =
-                locationExtended.gnss_sv_used_ids.navic_sv_used_ids_mask;
+        sv_cache_info.used = locationExtended.gnss_sv_used_ids;
     }
 
     if (generate_nmea) {
@@ -1262,9 +1578,9 @@ void loc_nmea_generate_pos(const UlpLocation &location,
         // ---$GPGSA/$GNGSA---
         // -------------------
 
-        count = loc_nmea_generate_GSA(locationExtended, sentence, sizeof(sentence),
+        count = loc_nmea_generate_GSA(locationExtended, writer,
                         loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_GPS,
-                        GNSS_SIGNAL_GPS_L1CA, true), nmeaArraystr);
+                        GNSS_SIGNAL_GPS_L1CA, true));
         if (count > 0)
         {
             svUsedCount += count;
@@ -1276,9 +1592,9 @@ void loc_nmea_generate_pos(const UlpLocation &location,
         // ---$GLGSA/$GNGSA---
         // -------------------
 
-        count = loc_nmea_generate_GSA(locationExtended, sentence, sizeof(sentence),
+        count = loc_nmea_generate_GSA(locationExtended, writer,
                         loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_GLONASS,
-                        GNSS_SIGNAL_GLONASS_G1, true), nmeaArraystr);
+                        GNSS_SIGNAL_GLONASS_G1, true));
         if (count > 0)
         {
             svUsedCount += count;
@@ -1290,9 +1606,9 @@ void loc_nmea_generate_pos(const UlpLocation &location,
         // ---$GAGSA/$GNGSA---
         // -------------------
 
-        count = loc_nmea_generate_GSA(locationExtended, sentence, sizeof(sentence),
+        count = loc_nmea_generate_GSA(locationExtended, writer,
                         loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_GALILEO,
-                        GNSS_SIGNAL_GALILEO_E1, true), nmeaArraystr);
+                        GNSS_SIGNAL_GALILEO_E1, true));
         if (count > 0)
         {
             svUsedCount += count;
@@ -1303,9 +1619,9 @@ void loc_nmea_generate_pos(const UlpLocation &location,
         // ----------------------------
         // ---$GBGSA/$GNGSA (BEIDOU)---
         // ----------------------------
-        count = loc_nmea_generate_GSA(locationExtended, sentence, sizeof(sentence),
+        count = loc_nmea_generate_GSA(locationExtended, writer,
                         loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_BEIDOU,
-                        GNSS_SIGNAL_BEIDOU_B1I, true), nmeaArraystr);
+                        GNSS_SIGNAL_BEIDOU_B1I, true));
         if (count > 0)
         {
             svUsedCount += count;
@@ -1317,9 +1633,9 @@ void loc_nmea_generate_pos(const UlpLocation &location,
         // ---$GQGSA/$GNGSA (QZSS)---
         // --------------------------
 
-        count = loc_nmea_generate_GSA(locationExtended, sentence, sizeof(sentence),
+        count = loc_nmea_generate_GSA(locationExtended, writer,
                         loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_QZSS,
-                        GNSS_SIGNAL_QZSS_L1CA, true), nmeaArraystr);
+                        GNSS_SIGNAL_QZSS_L1CA, true));
         if (count > 0)
         {
             svUsedCount += count;
@@ -1337,8 +1653,8 @@ void loc_nmea_generate_pos(const UlpLocation &location,
         // ------$--VTG-------
         // -------------------
 
-        pMarker = sentence;
-        lengthRemaining = sizeof(sentence);
+        writer.begin(talker, "VTG");
+        writer.put(',');
 
         if (location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_BEARING)
         {
@@ -1352,73 +1668,51 @@ void loc_nmea_generate_pos(const UlpLocation &location,
                     magTrack -= 360.0;
             }
 
-            length = snprintf(pMarker, lengthRemaining, "$%sVTG,%.1lf,T,%.1lf,M,", talker, location.gpsLocation.bearing, magTrack);
+            writer.putFixed(location.gpsLocation.bearing, 1);
+            writer.put(",T,");
+            writer.putFixed(magTrack, 1);
+            writer.put(",M,");
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining, "$%sVTG,,T,,M,", talker);
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
+            writer.put(",T,,M,");
         }
-        pMarker += length;
-        lengthRemaining -= length;
 
         if (location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_SPEED)
         {
             float speedKnots = location.gpsLocation.speed * (3600.0/1852.0);
             float speedKmPerHour = location.gpsLocation.speed * 3.6;
 
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,N,%.1lf,K,", speedKnots, speedKmPerHour);
+            writer.putFixed(speedKnots, 1);
+            writer.put(",N,");
+            writer.putFixed(speedKmPerHour, 1);
+            writer.put(",K,");
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining, ",N,,K,");
+            writer.put(",N,,K,");
         }
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(vtgModeIndicator);
 
-        length = snprintf(pMarker, lengthRemaining, "%c", vtgModeIndicator);
+        writer.end();
 
-        length = loc_nmea_put_checksum(sentence, sizeof(sentence));
-        nmeaArraystr.push_back(sentence);
-
-        memset(&ecef_w84, 0, sizeof(ecef_w84));
-        memset(&ecef_p90, 0, sizeof(ecef_p90));
-        memset(&lla_w84, 0, sizeof(lla_w84));
-        memset(&lla_p90, 0, sizeof(lla_p90));
         memset(&ref_lla, 0, sizeof(ref_lla));
         memset(&local_lla, 0, sizeof(local_lla));
-        lla_w84.lat = location.gpsLocation.latitude / 180.0 * M_PI;
-        lla_w84.lon = location.gpsLocation.longitude / 180.0 * M_PI;
+        lla_w84.lat = location.gpsLocation.latitude;
+        lla_w84.lon = location.gpsLocation.longitude;
         lla_w84.alt = location.gpsLocation.altitude;
-
-        convert_Lla_to_Ecef(lla_w84, ecef_w84);
-        convert_WGS84_to_PZ90(ecef_w84, ecef_p90);
-        convert_Ecef_to_Lla(ecef_p90, lla_p90);
+        loc_convert_WGS84_to_PZ90(&lla_w84, &lla_p90, 1);
 
         switch (datum_type) {
             case LOC_GNSS_DATUM_WGS84:
                 ref_lla.lat = location.gpsLocation.latitude;
                 ref_lla.lon = location.gpsLocation.longitude;
                 ref_lla.alt = location.gpsLocation.altitude;
-                local_lla.lat = lla_p90.lat / M_PI * 180.0;
-                local_lla.lon = lla_p90.lon / M_PI * 180.0;
-                local_lla.alt = lla_p90.alt;
+                local_lla = lla_p90;
                 break;
             case LOC_GNSS_DATUM_PZ90:
-                ref_lla.lat = lla_p90.lat / M_PI * 180.0;
-                ref_lla.lon = lla_p90.lon / M_PI * 180.0;
-                ref_lla.alt = lla_p90.alt;
+                ref_lla = lla_p90;
                 local_lla.lat = location.gpsLocation.latitude;
                 local_lla.lon = location.gpsLocation.longitude;
                 local_lla.alt = location.gpsLocation.altitude;
@@ -1430,120 +1724,39 @@ void loc_nmea_generate_pos(const UlpLocation &location,
         // -------------------
         // ------$--DTM-------
         // -------------------
-        loc_nmea_generate_DTM(ref_lla, local_lla, talker, sentence_DTM, sizeof(sentence_DTM));
+        // written once, and repeated ahead of GNS and GGA for PZ90
+        size_t dtmOffset = writer.length();
+        loc_nmea_generate_DTM(ref_lla, local_lla, datum_type, talker, writer);
+        size_t dtmLength = writer.length() - dtmOffset;
 
         // -------------------
         // ------$--RMC-------
         // -------------------
 
-        pMarker = sentence_RMC;
-        lengthRemaining = sizeof(sentence_RMC);
-
-        length = snprintf(pMarker, lengthRemaining, "$%sRMC,%02d%02d%02d.%02d,A," ,
-                          talker, utcHours, utcMinutes, utcSeconds,utcMSeconds/10);
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_LAT_LONG)
-        {
-            double latitude = ref_lla.lat;
-            double longitude = ref_lla.lon;
-            char latHemisphere;
-            char lonHemisphere;
-            double latMinutes;
-            double lonMinutes;
-
-            if (latitude > 0)
-            {
-                latHemisphere = 'N';
-            }
-            else
-            {
-                latHemisphere = 'S';
-                latitude *= -1.0;
-            }
-
-            if (longitude < 0)
-            {
-                lonHemisphere = 'W';
-                longitude *= -1.0;
-            }
-            else
-            {
-                lonHemisphere = 'E';
-            }
-
-            latMinutes = fmod(latitude * 60.0 , 60.0);
-            lonMinutes = fmod(longitude * 60.0 , 60.0);
+        writer.begin(talker, "RMC");
+        writer.put(',');
+        loc_nmea_put_utc_time(writer, utcHours, utcMinutes, utcSeconds, utcMSeconds);
+        writer.put(",A,");
 
-            length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                              (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                              (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,,,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        loc_nmea_put_lat_long(writer, location, ref_lla);
 
         if (location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_SPEED)
         {
             float speedKnots = location.gpsLocation.speed * (3600.0/1852.0);
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,", speedKnots);
+            writer.putFixed(speedKnots, 1);
         }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining, ",");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(',');
 
         if (location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_BEARING)
         {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,", location.gpsLocation.bearing);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining, ",");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
+            writer.putFixed(location.gpsLocation.bearing, 1);
         }
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(',');
 
-        length = snprintf(pMarker, lengthRemaining, "%2.2d%2.2d%2.2d,",
-                          utcDay, utcMonth, utcYear);
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.putInt(utcDay, 2);
+        writer.putInt(utcMonth, 2);
+        writer.putInt(utcYear, 2);
+        writer.put(',');
 
         if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
         {
@@ -1559,101 +1772,40 @@ void loc_nmea_generate_pos(const UlpLocation &location,
                 direction = 'E';
             }
 
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,%c,",
-                              magneticVariation, direction);
+            writer.putFixed(magneticVariation, 1);
+            writer.put(',');
+            writer.put(direction);
+            writer.put(',');
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining, ",,");
+            writer.put(",,");
         }
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        length = snprintf(pMarker, lengthRemaining, "%c", rmcModeIndicator);
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(rmcModeIndicator);
 
         // hardcode Navigation Status field to 'V'
-        length = snprintf(pMarker, lengthRemaining, ",%c", 'V');
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(",V");
 
-        length = loc_nmea_put_checksum(sentence_RMC, sizeof(sentence_RMC));
+        writer.end();
+
+        if(LOC_GNSS_DATUM_PZ90 == datum_type) {
+            // ------$--DTM-------
+            writer.repeat(dtmOffset, dtmLength);
+        }
 
         // -------------------
         // ------$--GNS-------
         // -------------------
 
-        pMarker = sentence_GNS;
-        lengthRemaining = sizeof(sentence_GNS);
-
-        length = snprintf(pMarker, lengthRemaining, "$%sGNS,%02d%02d%02d.%02d," ,
-                          talker, utcHours, utcMinutes, utcSeconds, utcMSeconds/10);
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_LAT_LONG)
-        {
-            double latitude = ref_lla.lat;
-            double longitude = ref_lla.lon;
-            char latHemisphere;
-            char lonHemisphere;
-            double latMinutes;
-            double lonMinutes;
-
-            if (latitude > 0)
-            {
-                latHemisphere = 'N';
-            }
-            else
-            {
-                latHemisphere = 'S';
-                latitude *= -1.0;
-            }
-
-            if (longitude < 0)
-            {
-                lonHemisphere = 'W';
-                longitude *= -1.0;
-            }
-            else
-            {
-                lonHemisphere = 'E';
-            }
+        writer.begin(talker, "GNS");
+        writer.put(',');
+        loc_nmea_put_utc_time(writer, utcHours, utcMinutes, utcSeconds, utcMSeconds);
+        writer.put(',');
 
-            latMinutes = fmod(latitude * 60.0 , 60.0);
-            lonMinutes = fmod(longitude * 60.0 , 60.0);
+        loc_nmea_put_lat_long(writer, location, ref_lla);
 
-            length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                              (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                              (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,,,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if(!(sv_cache_info.gps_used_mask ? 1 : 0))
+        if(!(sv_cache_info.used.gps_sv_used_ids_mask ? 1 : 0))
             modeIndicator[0] = 'N';
         else if (LOC_NAV_MASK_SBAS_CORRECTION_IONO & locationExtended.navSolutionMask)
             modeIndicator[0] = 'D';
@@ -1661,31 +1813,31 @@ void loc_nmea_generate_pos(const UlpLocation &location,
             modeIndicator[0] = 'E';
         else
             modeIndicator[0] = 'A';
-        if(!(sv_cache_info.glo_used_mask ? 1 : 0))
+        if(!(sv_cache_info.used.glo_sv_used_ids_mask ? 1 : 0))
             modeIndicator[1] = 'N';
         else if (LOC_POS_TECH_MASK_SENSORS == locationExtended.tech_mask)
             modeIndicator[1] = 'E';
         else
             modeIndicator[1] = 'A';
-        if(!(sv_cache_info.gal_used_mask ? 1 : 0))
+        if(!(sv_cache_info.used.gal_sv_used_ids_mask ? 1 : 0))
             modeIndicator[2] = 'N';
         else if (LOC_POS_TECH_MASK_SENSORS == locationExtended.tech_mask)
             modeIndicator[2] = 'E';
         else
             modeIndicator[2] = 'A';
-        if(!(sv_cache_info.bds_used_mask ? 1 : 0))
+        if(!(sv_cache_info.used.bds_sv_used_ids_mask ? 1 : 0))
             modeIndicator[3] = 'N';
         else if (LOC_POS_TECH_MASK_SENSORS == locationExtended.tech_mask)
             modeIndicator[3] = 'E';
         else
             modeIndicator[3] = 'A';
-        if(!(sv_cache_info.qzss_used_mask ? 1 : 0))
+        if(!(sv_cache_info.used.qzss_sv_used_ids_mask ? 1 : 0))
             modeIndicator[4] = 'N';
         else if (LOC_POS_TECH_MASK_SENSORS == locationExtended.tech_mask)
             modeIndicator[4] = 'E';
         else
             modeIndicator[4] = 'A';
-        if(!(sv_cache_info.navic_used_mask ? 1 : 0))
+        if(!(sv_cache_info.used.navic_sv_used_ids_mask ? 1 : 0))
             modeIndicator[5] = 'N';
         else if (LOC_POS_TECH_MASK_SENSORS == locationExtended.tech_mask)
             modeIndicator[5] = 'E';
@@ -1695,234 +1847,115 @@ void loc_nmea_generate_pos(const UlpLocation &location,
         for(int index = 5; index > 0 && 'N' == modeIndicator[index]; index--) {
             modeIndicator[index] = '\0';
         }
-        length = snprintf(pMarker, lengthRemaining,"%s,", modeIndicator);
-
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(modeIndicator);
+        writer.put(',');
 
+        writer.putInt(svUsedCount, 2);
+        writer.put(',');
         if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP) {
-            length = snprintf(pMarker, lengthRemaining, "%02d,%.1f,",
-                              svUsedCount, locationExtended.hdop);
-        }
-        else {   // no hdop
-            length = snprintf(pMarker, lengthRemaining, "%02d,,",
-                              svUsedCount);
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
+            writer.putFixed(locationExtended.hdop, 1);
         }
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(',');
 
         if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL)
         {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,",
-                              locationExtended.altitudeMeanSeaLevel);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
+            writer.putFixed(locationExtended.altitudeMeanSeaLevel, 1);
         }
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(',');
 
         if ((location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_ALTITUDE) &&
             (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL))
         {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,,",
-                              ref_lla.alt - locationExtended.altitudeMeanSeaLevel);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,");
+            writer.putFixed(ref_lla.alt - locationExtended.altitudeMeanSeaLevel, 1);
         }
-
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(",,");
 
         // hardcode Navigation Status field to 'V'
-        length = snprintf(pMarker, lengthRemaining, ",%c", 'V');
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(",V");
 
-        length = loc_nmea_put_checksum(sentence_GNS, sizeof(sentence_GNS));
+        writer.end();
 
+        if(LOC_GNSS_DATUM_PZ90 == datum_type) {
+            // ------$--DTM-------
+            writer.repeat(dtmOffset, dtmLength);
+        }
 
         // -------------------
         // ------$--GGA-------
         // -------------------
 
-        pMarker = sentence_GGA;
-        lengthRemaining = sizeof(sentence_GGA);
-
-        length = snprintf(pMarker, lengthRemaining, "$%sGGA,%02d%02d%02d.%02d," ,
-                          talker, utcHours, utcMinutes, utcSeconds, utcMSeconds/10);
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_LAT_LONG)
-        {
-            double latitude = ref_lla.lat;
-            double longitude = ref_lla.lon;
-            char latHemisphere;
-            char lonHemisphere;
-            double latMinutes;
-            double lonMinutes;
-
-            if (latitude > 0)
-            {
-                latHemisphere = 'N';
-            }
-            else
-            {
-                latHemisphere = 'S';
-                latitude *= -1.0;
-            }
-
-            if (longitude < 0)
-            {
-                lonHemisphere = 'W';
-                longitude *= -1.0;
-            }
-            else
-            {
-                lonHemisphere = 'E';
-            }
-
-            latMinutes = fmod(latitude * 60.0 , 60.0);
-            lonMinutes = fmod(longitude * 60.0 , 60.0);
+        writer.begin(talker, "GGA");
+        writer.put(',');
+        loc_nmea_put_utc_time(writer, utcHours, utcMinutes, utcSeconds, utcMSeconds);
+        writer.put(',');
 
-            length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                              (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                              (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,,,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        loc_nmea_put_lat_long(writer, location, ref_lla);
 
         // Number of satellites in use, 00-12
         if (svUsedCount > MAX_SATELLITES_IN_USE)
             svUsedCount = MAX_SATELLITES_IN_USE;
+        writer.put(ggaGpsQuality);
+        writer.put(',');
+        writer.putInt(svUsedCount, 2);
+        writer.put(',');
         if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
         {
-            length = snprintf(pMarker, lengthRemaining, "%s,%02d,%.1f,",
-                              ggaGpsQuality, svUsedCount, locationExtended.hdop);
-        }
-        else
-        {   // no hdop
-            length = snprintf(pMarker, lengthRemaining, "%s,%02d,,",
-                              ggaGpsQuality, svUsedCount);
+            writer.putFixed(locationExtended.hdop, 1);
         }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        writer.put(',');
 
         if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL)
         {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,M,",
-                              locationExtended.altitudeMeanSeaLevel);
+            writer.putFixed(locationExtended.altitudeMeanSeaLevel, 1);
+            writer.put(",M,");
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining,",,");
+            writer.put(",,");
         }
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
         if ((location.gpsLocation.flags & LOC_GPS_LOCATION_HAS_ALTITUDE) &&
             (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL))
         {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,M,,",
-                              ref_lla.alt - locationExtended.altitudeMeanSeaLevel);
+            writer.putFixed(ref_lla.alt - locationExtended.altitudeMeanSeaLevel, 1);
+            writer.put(",M,,");
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining,",,,");
-        }
-
-        length = loc_nmea_put_checksum(sentence_GGA, sizeof(sentence_GGA));
-
-        // ------$--DTM-------
-        nmeaArraystr.push_back(sentence_DTM);
-        // ------$--RMC-------
-        nmeaArraystr.push_back(sentence_RMC);
-        if(LOC_GNSS_DATUM_PZ90 == datum_type) {
-            // ------$--DTM-------
-            nmeaArraystr.push_back(sentence_DTM);
-        }
-        // ------$--GNS-------
-        nmeaArraystr.push_back(sentence_GNS);
-        if(LOC_GNSS_DATUM_PZ90 == datum_type) {
-            // ------$--DTM-------
-            nmeaArraystr.push_back(sentence_DTM);
+            writer.put(",,,");
         }
-        // ------$--GGA-------
-        nmeaArraystr.push_back(sentence_GGA);
 
+        writer.end();
     }
     //Send blank NMEA reports for non-final fixes
     else {
-        strlcpy(sentence, "$GPGSA,A,1,,,,,,,,,,,,,,,,", sizeof(sentence));
-        length = loc_nmea_put_checksum(sentence, sizeof(sentence));
-        nmeaArraystr.push_back(sentence);
+        writer.begin("GP", "GSA");
+        writer.put(",A,1,,,,,,,,,,,,,,,,");
+        writer.end();
 
-        strlcpy(sentence, "$GPVTG,,T,,M,,N,,K,N", sizeof(sentence));
-        length = loc_nmea_put_checksum(sentence, sizeof(sentence));
-        nmeaArraystr.push_back(sentence);
+        writer.begin("GP", "VTG");
+        writer.put(",,T,,M,,N,,K,N");
+        writer.end();
 
-        strlcpy(sentence, "$GPDTM,,,,,,,,", sizeof(sentence));
-        length = loc_nmea_put_checksum(sentence, sizeof(sentence));
-        nmeaArraystr.push_back(sentence);
+        writer.begin("GP", "DTM");
+        writer.put(",,,,,,,,");
+        writer.end();
 
-        strlcpy(sentence, "$GPRMC,,V,,,,,,,,,,N,V", sizeof(sentence));
-        length = loc_nmea_put_checksum(sentence, sizeof(sentence));
-        nmeaArraystr.push_back(sentence);
+        writer.begin("GP", "RMC");
+        writer.put(",,V,,,,,,,,,,N,V");
+        writer.end();
 
-        strlcpy(sentence, "$GPGNS,,,,,,N,,,,,,,V", sizeof(sentence));
-        length = loc_nmea_put_checksum(sentence, sizeof(sentence));
-        nmeaArraystr.push_back(sentence);
+        writer.begin("GP", "GNS");
+        writer.put(",,,,,,N,,,,,,,V");
+        writer.end();
 
-        strlcpy(sentence, "$GPGGA,,,,,,0,,,,,,,,", sizeof(sentence));
-        length = loc_nmea_put_checksum(sentence, sizeof(sentence));
-        nmeaArraystr.push_back(sentence);
+        writer.begin("GP", "GGA");
+        writer.put(",,,,,,0,,,,,,,,");
+        writer.end();
     }
 
-    EXIT_LOG(%d, 0);
+    EXIT_LOG(%zu, writer.length());
+    return writer.length();
 }
 
 
@@ -1932,40 +1965,61 @@ FUNCTION    loc_nmea_generate_sv
 
 DESCRIPTION
    Generate NMEA sentences generated based on sv report
+   The sentences are written back to back into nmea, which should be
+   NMEA_SV_MAX_LENGTH bytes, and NUL terminated.
 
 DEPENDENCIES
    NONE
 
 RETURN VALUE
-   0
+   Length of the sentences written, not counting the NUL
 
 SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-void loc_nmea_generate_sv(const GnssSvNotification &svNotify,
-                              std::vector<std::string> &nmeaArraystr)
+size_t loc_nmea_generate_sv(const GnssSvNotification &svNotify,
+                              char *nmea, size_t nmeaSize)
 {
     ENTRY_LOG();
 
-    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    int svCount = svNotify.count;
+    LocNmeaWriter writer(nmea, nmeaSize);
+    int svCount = (svNotify.count < GNSS_SV_MAX) ? svNotify.count : GNSS_SV_MAX;
     int svNumber = 1;
     loc_sv_cache_info sv_cache_info = {};
+    // indexes of the SVs listed in each GSV group, sorted out in the same
+    // pass that counts them, so that no group has to search the report again
+    static_assert(GNSS_SV_MAX <= UINT8_MAX + 1, "SV index does not fit uint8_t");
+    uint8_t groupSvs[LOC_NMEA_GSV_GROUPS][GNSS_SV_MAX];
+    uint32_t groupSize[LOC_NMEA_GSV_GROUPS] = {};
+    loc_util::LocSvUsedMasks usedMasks;
 
     //Count GPS SVs for saparating GPS from GLONASS and throw others
     for(svNumber=1; svNumber <= svCount; svNumber++) {
-        if (GNSS_SV_TYPE_GPS == svNotify.gnssSvs[svNumber - 1].type)
-        {
-            // cache the used in fix mask, as it will be needed to send $GPGSA
-            // during the position report
-            if (GNSS_SV_OPTIONS_USED_IN_FIX_BIT ==
-                    (svNotify.gnssSvs[svNumber - 1].gnssSvOptionsMask &
-                      GNSS_SV_OPTIONS_USED_IN_FIX_BIT))
-            {
-                sv_cache_info.gps_used_mask |= (1ULL << (svNotify.gnssSvs[svNumber - 1].svId - 1));
+        int group = loc_nmea_get_gsv_group(svNotify.gnssSvs[svNumber - 1]);
+        if (group >= 0) {
+            groupSvs[group][groupSize[group]++] = svNumber - 1;
+        }
+
+        // cache the used in fix masks, as they will be needed to send $--GSA
+        // during the position report
+        const GnssSv& sv = svNotify.gnssSvs[svNumber - 1];
+        if (GNSS_SV_OPTIONS_USED_IN_FIX_BIT & sv.gnssSvOptionsMask) {
+            // For QZSS we adjusted SV id's in GnssAdapter, we need to re-adjust here
+            uint16_t svId = (GNSS_SV_TYPE_QZSS == sv.type) ?
+                    sv.svId - (QZSS_SV_PRN_MIN - 1) : sv.svId;
+            uint32_t slot = loc_util::LocSvUsedMasks::slotOf(sv.type, sv.gnssSignalTypeMask,
+                                                             false);
+            // SBAS and unknown constellations have no mask, and SV ids past 64
+            // have no bit in one
+            if (loc_util::SV_USED_NONE != slot && svId >= 1 && svId <= 64) {
+                usedMasks.add(slot, 1ULL << (svId - 1));
             }
-            if (GNSS_SIGNAL_GPS_L5 == svNotify.gnssSvs[svNumber - 1].gnssSignalTypeMask) {
+        }
+
+        if (GNSS_SV_TYPE_GPS == sv.type)
+        {
+            if (GNSS_SIGNAL_GPS_L5 == sv.gnssSignalTypeMask) {
                 sv_cache_info.gps_l5_count++;
             } else {
                 // GNSS_SIGNAL_GPS_L1CA or default
@@ -1973,17 +2027,9 @@ void loc_nmea_generate_sv(const GnssSvNotification &svNotify,
                 sv_cache_info.gps_l1_count++;
             }
         }
-        else if (GNSS_SV_TYPE_GLONASS == svNotify.gnssSvs[svNumber - 1].type)
+        else if (GNSS_SV_TYPE_GLONASS == sv.type)
         {
-            // cache the used in fix mask, as it will be needed to send $GNGSA
-            // during the position report
-            if (GNSS_SV_OPTIONS_USED_IN_FIX_BIT ==
-                    (svNotify.gnssSvs[svNumber - 1].gnssSvOptionsMask &
-                      GNSS_SV_OPTIONS_USED_IN_FIX_BIT))
-            {
-                sv_cache_info.glo_used_mask |= (1ULL << (svNotify.gnssSvs[svNumber - 1].svId - 1));
-            }
-            if (GNSS_SIGNAL_GLONASS_G2 == svNotify.gnssSvs[svNumber - 1].gnssSignalTypeMask){
+            if (GNSS_SIGNAL_GLONASS_G2 == sv.gnssSignalTypeMask){
                 sv_cache_info.glo_g2_count++;
             } else {
                 // GNSS_SIGNAL_GLONASS_G1 or default
@@ -1991,17 +2037,9 @@ void loc_nmea_generate_sv(const GnssSvNotification &svNotify,
                 sv_cache_info.glo_g1_count++;
             }
         }
-        else if (GNSS_SV_TYPE_GALILEO == svNotify.gnssSvs[svNumber - 1].type)
+        else if (GNSS_SV_TYPE_GALILEO == sv.type)
         {
-            // cache the used in fix mask, as it will be needed to send $GAGSA
-            // during the position report
-            if (GNSS_SV_OPTIONS_USED_IN_FIX_BIT ==
-                    (svNotify.gnssSvs[svNumber - 1].gnssSvOptionsMask &
-                      GNSS_SV_OPTIONS_USED_IN_FIX_BIT))
-            {
-                sv_cache_info.gal_used_mask |= (1ULL << (svNotify.gnssSvs[svNumber - 1].svId - 1));
-            }
-            if(GNSS_SIGNAL_GALILEO_E5A == svNotify.gnssSvs[svNumber - 1].gnssSignalTypeMask){
+            if(GNSS_SIGNAL_GALILEO_E5A == sv.gnssSignalTypeMask){
                 sv_cache_info.gal_e5_count++;
             } else {
                 // GNSS_SIGNAL_GALILEO_E1 or default
@@ -2009,19 +2047,9 @@ void loc_nmea_generate_sv(const GnssSvNotification &svNotify,
                 sv_cache_info.gal_e1_count++;
             }
         }
-        else if (GNSS_SV_TYPE_QZSS == svNotify.gnssSvs[svNumber - 1].type)
+        else if (GNSS_SV_TYPE_QZSS == sv.type)
         {
-            // cache the used in fix mask, as it will be needed to send $PQGSA
-            // during the position report
-            if (GNSS_SV_OPTIONS_USED_IN_FIX_BIT ==
-                (svNotify.gnssSvs[svNumber - 1].gnssSvOptionsMask &
-                  GNSS_SV_OPTIONS_USED_IN_FIX_BIT))
-            {
-                // For QZSS we adjusted SV id's in GnssAdapter, we need to re-adjust here
-                sv_cache_info.qzss_used_mask |=
-                        (1ULL << (svNotify.gnssSvs[svNumber - 1].svId - (QZSS_SV_PRN_MIN - 1) - 1));
-            }
-            if (GNSS_SIGNAL_QZSS_L5 == svNotify.gnssSvs[svNumber - 1].gnssSignalTypeMask) {
+            if (GNSS_SIGNAL_QZSS_L5 == sv.gnssSignalTypeMask) {
                 sv_cache_info.qzss_l5_count++;
             } else {
                 // GNSS_SIGNAL_QZSS_L1CA or default
@@ -2029,17 +2057,9 @@ void loc_nmea_generate_sv(const GnssSvNotification &svNotify,
                 sv_cache_info.qzss_l1_count++;
             }
         }
-        else if (GNSS_SV_TYPE_BEIDOU == svNotify.gnssSvs[svNumber - 1].type)
+        else if (GNSS_SV_TYPE_BEIDOU == sv.type)
         {
-            // cache the used in fix mask, as it will be needed to send $PQGSA
-            // during the position report
-            if (GNSS_SV_OPTIONS_USED_IN_FIX_BIT ==
-                (svNotify.gnssSvs[svNumber - 1].gnssSvOptionsMask &
-                  GNSS_SV_OPTIONS_USED_IN_FIX_BIT))
-            {
-                sv_cache_info.bds_used_mask |= (1ULL << (svNotify.gnssSvs[svNumber - 1].svId - 1));
-            }
-            if(GNSS_SIGNAL_BEIDOU_B2AI == svNotify.gnssSvs[svNumber - 1].gnssSignalTypeMask){
+            if(GNSS_SIGNAL_BEIDOU_B2AI == sv.gnssSignalTypeMask){
                 sv_cache_info.bds_b2_count++;
             } else {
                 // GNSS_SIGNAL_BEIDOU_B1I or default
@@ -2047,107 +2067,388 @@ void loc_nmea_generate_sv(const GnssSvNotification &svNotify,
                 sv_cache_info.bds_b1_count++;
             }
         }
-        else if (GNSS_SV_TYPE_NAVIC == svNotify.gnssSvs[svNumber - 1].type)
+        else if (GNSS_SV_TYPE_NAVIC == sv.type)
         {
-            // cache the used in fix mask, as it will be needed to send $PQGSA
-            // during the position report
-            if (GNSS_SV_OPTIONS_USED_IN_FIX_BIT ==
-                (svNotify.gnssSvs[svNumber - 1].gnssSvOptionsMask &
-                  GNSS_SV_OPTIONS_USED_IN_FIX_BIT))
-            {
-                sv_cache_info.navic_used_mask |=
-                        (1ULL << (svNotify.gnssSvs[svNumber - 1].svId - 1));
-            }
             // GNSS_SIGNAL_NAVIC_L5 is the only signal type for NAVIC
             sv_cache_info.navic_l5_count++;
         }
     }
+    usedMasks.store(sv_cache_info.used);
 
     loc_nmea_sv_meta sv_meta;
-    // ---------------------
-    // ------$GPGSV:L1CA----
-    // ---------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_GPS,
-            GNSS_SIGNAL_GPS_L1CA, false), nmeaArraystr);
-
-    // ---------------------
-    // ------$GPGSV:L5------
-    // ---------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_GPS,
-            GNSS_SIGNAL_GPS_L5, false), nmeaArraystr);
-    // ---------------------
-    // ------$GLGSV:G1------
-    // ---------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_GLONASS,
-            GNSS_SIGNAL_GLONASS_G1, false), nmeaArraystr);
-
-    // ---------------------
-    // ------$GLGSV:G2------
-    // ---------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_GLONASS,
-            GNSS_SIGNAL_GLONASS_G2, false), nmeaArraystr);
-
-    // ---------------------
-    // ------$GAGSV:E1------
-    // ---------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_GALILEO,
-            GNSS_SIGNAL_GALILEO_E1, false), nmeaArraystr);
-
-    // -------------------------
-    // ------$GAGSV:E5A---------
-    // -------------------------
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_GALILEO,
-            GNSS_SIGNAL_GALILEO_E5A, false), nmeaArraystr);
-
-    // -----------------------------
-    // ------$PQGSV (QZSS):L1CA-----
-    // -----------------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_QZSS,
-            GNSS_SIGNAL_QZSS_L1CA, false), nmeaArraystr);
-
-    // -----------------------------
-    // ------$PQGSV (QZSS):L5-------
-    // -----------------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_QZSS,
-            GNSS_SIGNAL_QZSS_L5, false), nmeaArraystr);
-    // -----------------------------
-    // ------$PQGSV (BEIDOU:B1I)----
-    // -----------------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_BEIDOU,
-            GNSS_SIGNAL_BEIDOU_B1I,false), nmeaArraystr);
-
-    // -----------------------------
-    // ------$PQGSV (BEIDOU:B2AI)---
-    // -----------------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_BEIDOU,
-            GNSS_SIGNAL_BEIDOU_B2AI,false), nmeaArraystr);
-
-    // -----------------------------
-    // ------$GIGSV (NAVIC:L5)------
-    // -----------------------------
-
-    loc_nmea_generate_GSV(svNotify, sentence, sizeof(sentence),
-            loc_nmea_sv_meta_init(sv_meta, sv_cache_info, GNSS_SV_TYPE_NAVIC,
-            GNSS_SIGNAL_NAVIC_L5,false), nmeaArraystr);
-
-    EXIT_LOG(%d, 0);
+    for (int group = 0; group < LOC_NMEA_GSV_GROUPS; group++) {
+        loc_nmea_generate_GSV(svNotify, groupSvs[group], groupSize[group], writer,
+                loc_nmea_sv_meta_init(sv_meta, sv_cache_info, sGsvGroups[group].svType,
+                sGsvGroups[group].signalType, false));
+    }
+
+    EXIT_LOG(%zu, writer.length());
+    return writer.length();
+}
+
+#ifdef __LOC_DEBUG__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+
+static double getSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+static void fillFix(UlpLocation& location, GpsLocationExtended& locationExtended,
+                    LocationSystemInfo& systemInfo) {
+    memset(&location, 0, sizeof(location));
+    memset(&locationExtended, 0, sizeof(locationExtended));
+    memset(&systemInfo, 0, sizeof(systemInfo));
+    location.gpsLocation.flags = LOC_GPS_LOCATION_HAS_LAT_LONG | LOC_GPS_LOCATION_HAS_ALTITUDE |
+            LOC_GPS_LOCATION_HAS_SPEED | LOC_GPS_LOCATION_HAS_BEARING;
+    location.gpsLocation.latitude = 37.4219983;
+    location.gpsLocation.longitude = -122.084;
+    location.gpsLocation.altitude = 12.5;
+    location.gpsLocation.speed = 1.25;
+    location.gpsLocation.bearing = 271.35;
+    location.gpsLocation.timestamp = 1602673251250LL;
+    locationExtended.flags = GPS_LOCATION_EXTENDED_HAS_DOP | GPS_LOCATION_EXTENDED_HAS_MAG_DEV |
+            GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL |
+            GPS_LOCATION_EXTENDED_HAS_GNSS_SV_USED_DATA | GPS_LOCATION_EXTENDED_HAS_POS_TECH_MASK |
+            GPS_LOCATION_EXTENDED_HAS_NAV_SOLUTION_MASK;
+    locationExtended.pdop = 1.25;
+    locationExtended.hdop = 0.85;
+    locationExtended.vdop = 0.95;
+    locationExtended.magneticDeviation = -3.25;
+    locationExtended.altitudeMeanSeaLevel = 44.75;
+    locationExtended.tech_mask = LOC_POS_TECH_MASK_SATELLITE | LOC_POS_TECH_MASK_SENSORS;
+    locationExtended.navSolutionMask = LOC_NAV_MASK_SBAS_CORRECTION_IONO;
+    locationExtended.gnss_sv_used_ids.gps_sv_used_ids_mask = 0x800041f1;
+    locationExtended.gnss_sv_used_ids.glo_sv_used_ids_mask = 0x0c;
+    locationExtended.gnss_sv_used_ids.gal_sv_used_ids_mask = 0x1000000002ULL;
+    locationExtended.gnss_sv_used_ids.qzss_sv_used_ids_mask = 0x2;
+}
+
+static void fillSv(GnssSvNotification& svNotify) {
+    static const struct {
+        GnssSvType type; uint16_t svId; float elevation, azimuth, cN0Dbhz;
+        GnssSignalTypeMask signal; bool used;
+    } svs[] = {
+        { GNSS_SV_TYPE_GPS,      1, 45.4f, 120.5f, 38.6f, 0,                      true  },
+        { GNSS_SV_TYPE_GPS,      5,  3.0f,   7.2f, 21.2f, GNSS_SIGNAL_GPS_L1CA,   true  },
+        { GNSS_SV_TYPE_GPS,     12, 88.9f, 359.6f,  0.0f, GNSS_SIGNAL_GPS_L1CA,   false },
+        { GNSS_SV_TYPE_GPS,     17, 20.0f, 200.0f, 30.0f, GNSS_SIGNAL_GPS_L1CA,   false },
+        { GNSS_SV_TYPE_GPS,     24, 61.5f,  45.5f, 44.4f, GNSS_SIGNAL_GPS_L1CA,   true  },
+        { GNSS_SV_TYPE_GPS,      1, 45.4f, 120.5f, 41.0f, GNSS_SIGNAL_GPS_L5,     true  },
+        { GNSS_SV_TYPE_GLONASS,  3, 33.3f, 300.0f, 28.8f, 0,                      true  },
+        { GNSS_SV_TYPE_GLONASS,  4, 12.0f, 150.1f, 25.0f, GNSS_SIGNAL_GLONASS_G2, false },
+        { GNSS_SV_TYPE_GALILEO, 36, 70.0f,  90.0f, 35.5f, GNSS_SIGNAL_GALILEO_E5A, true },
+        { GNSS_SV_TYPE_BEIDOU,  11, -1.0f,  10.0f, 18.0f, 0,                      false },
+        { GNSS_SV_TYPE_QZSS,   194, 52.0f, 170.0f, 40.0f, GNSS_SIGNAL_QZSS_L1CA,  true  },
+        { GNSS_SV_TYPE_NAVIC,    2, 30.0f, 250.0f, 33.0f, GNSS_SIGNAL_NAVIC_L5,   false },
+    };
+    memset(&svNotify, 0, sizeof(svNotify));
+    for (size_t i = 0; i < sizeof(svs) / sizeof(svs[0]); i++) {
+        GnssSv& sv = svNotify.gnssSvs[svNotify.count++];
+        sv.type = svs[i].type;
+        sv.svId = svs[i].svId;
+        sv.elevation = svs[i].elevation;
+        sv.azimuth = svs[i].azimuth;
+        sv.cN0Dbhz = svs[i].cN0Dbhz;
+        sv.gnssSignalTypeMask = svs[i].signal;
+        sv.gnssSvOptionsMask = svs[i].used ? GNSS_SV_OPTIONS_USED_IN_FIX_BIT : 0;
+    }
+}
+
+// A multi band report the size of a good open sky fix: every constellation
+// on both its signals, plus SBAS and signals that get no GSV of their own.
+static void fillSvMultiBand(GnssSvNotification& svNotify) {
+    static const struct {
+        GnssSvType type; uint16_t firstSvId; int count; GnssSignalTypeMask signal;
+    } groups[] = {
+        { GNSS_SV_TYPE_GPS,      1, 12, GNSS_SIGNAL_GPS_L1CA },
+        { GNSS_SV_TYPE_GPS,      1,  7, GNSS_SIGNAL_GPS_L5 },
+        { GNSS_SV_TYPE_GPS,     20,  1, GNSS_SIGNAL_GPS_L2 },
+        { GNSS_SV_TYPE_SBAS,   131,  2, 0 },
+        { GNSS_SV_TYPE_GLONASS,  1,  8, 0 },
+        { GNSS_SV_TYPE_GLONASS,  3,  5, GNSS_SIGNAL_GLONASS_G2 },
+        { GNSS_SV_TYPE_GALILEO,  2,  9, GNSS_SIGNAL_GALILEO_E1 },
+        { GNSS_SV_TYPE_GALILEO,  4,  6, GNSS_SIGNAL_GALILEO_E5A },
+        { GNSS_SV_TYPE_BEIDOU,  19,  8, GNSS_SIGNAL_BEIDOU_B1I },
+        { GNSS_SV_TYPE_BEIDOU,  21,  3, GNSS_SIGNAL_BEIDOU_B2AI },
+        { GNSS_SV_TYPE_BEIDOU,  30,  1, GNSS_SIGNAL_BEIDOU_B2AQ },
+        { GNSS_SV_TYPE_QZSS,   193,  2, GNSS_SIGNAL_QZSS_L1CA },
+        { GNSS_SV_TYPE_QZSS,   194,  1, GNSS_SIGNAL_QZSS_L5 },
+        { GNSS_SV_TYPE_NAVIC,    2,  3, GNSS_SIGNAL_NAVIC_L5 },
+    };
+    memset(&svNotify, 0, sizeof(svNotify));
+    // interleave the groups, the way the engine reports SVs of several signals
+    for (int n = 0; n < 12; n++) {
+        for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++) {
+            if (n < groups[g].count) {
+                uint32_t i = svNotify.count++;
+                GnssSv& sv = svNotify.gnssSvs[i];
+                sv.type = groups[g].type;
+                sv.svId = groups[g].firstSvId + n;
+                sv.elevation = (float)((i * 37) % 90) + 0.25f * (i % 4);
+                sv.azimuth = (float)((i * 113) % 360) + 0.5f;
+                sv.cN0Dbhz = (0 == i % 9) ? 0.0f : 15.0f + (float)((i * 7) % 35) + 0.4f;
+                sv.gnssSignalTypeMask = groups[g].signal;
+                sv.gnssSvOptionsMask = (0 == i % 3) ? 0 : GNSS_SV_OPTIONS_USED_IN_FIX_BIT;
+            }
+        }
+    }
 }
+
+// Output of the snprintf based generators for fillFix() / fillSv(), with
+// DATUM_TYPE 0, the output of the writer has to match byte for byte.
+static const char sGoldenPos[] =
+        "$GNGSA,A,3,01,05,06,07,08,09,15,32,,,,,1.2,0.9,0.9,1*33\r\n"
+        "$GNGSA,A,3,67,68,,,,,,,,,,,1.2,0.9,0.9,2*3E\r\n"
+        "$GNGSA,A,3,02,37,,,,,,,,,,,1.2,0.9,0.9,3*36\r\n"
+        "$GNGSA,A,3,02,,,,,,,,,,,,1.2,0.9,0.9,5*34\r\n"
+        "$GNVTG,271.4,T,271.4,M,2.4,N,4.5,K,D*3F\r\n"
+        "$GNDTM,P90,,0000.000025,S,00000.000001,E,0.981,W84*58\r\n"
+        "$GNRMC,110051.25,A,3725.319898,N,12205.040000,W,2.4,271.4,141020,3.2,W,D,V*57\r\n"
+        "$GNGNS,110051.25,3725.319898,N,12205.040000,W,DAANA,13,0.9,44.8,-32.2,,,V*64\r\n"
+        "$GNGGA,110051.25,3725.319898,N,12205.040000,W,2,12,0.9,44.8,M,-32.2,M,,*7D\r\n";
+
+static const char sGoldenPosCustomGga[] =
+        "$GNGSA,A,3,01,05,06,07,08,09,15,32,,,,,1.2,0.9,0.9,1*33\r\n"
+        "$GNGSA,A,3,67,68,,,,,,,,,,,1.2,0.9,0.9,2*3E\r\n"
+        "$GNGSA,A,3,02,37,,,,,,,,,,,1.2,0.9,0.9,3*36\r\n"
+        "$GNGSA,A,3,02,,,,,,,,,,,,1.2,0.9,0.9,5*34\r\n"
+        "$GNVTG,271.4,T,271.4,M,2.4,N,4.5,K,D*3F\r\n"
+        "$GNDTM,P90,,0000.000025,S,00000.000001,E,0.981,W84*58\r\n"
+        "$GNRMC,110051.25,A,3725.319898,N,12205.040000,W,2.4,271.4,141020,3.2,W,D,V*57\r\n"
+        "$GNGNS,110051.25,3725.319898,N,12205.040000,W,DAANA,13,0.9,44.8,-32.2,,,V*64\r\n"
+        "$GNGGA,110051.25,3725.319898,N,12205.040000,W,62,12,0.9,44.8,M,-32.2,M,,*4B\r\n";
+
+static const char sGoldenPosBlank[] =
+        "$GPGSA,A,1,,,,,,,,,,,,,,,,*32\r\n"
+        "$GPVTG,,T,,M,,N,,K,N*2C\r\n"
+        "$GPDTM,,,,,,,,*4A\r\n"
+        "$GPRMC,,V,,,,,,,,,,N,V*29\r\n"
+        "$GPGNS,,,,,,N,,,,,,,V*79\r\n"
+        "$GPGGA,,,,,,0,,,,,,,,*66\r\n";
+
+static const char sGoldenSv[] =
+        "$GPGSV,2,1,05,01,45,121,39,05,03,007,21,12,89,360,,17,20,200,30,1*6A\r\n"
+        "$GPGSV,2,2,05,24,62,046,44,1*51\r\n"
+        "$GPGSV,1,1,01,01,45,121,41,8*5B\r\n"
+        "$GLGSV,1,1,01,67,33,300,29,1*40\r\n"
+        "$GLGSV,1,1,01,68,12,150,25,3*45\r\n"
+        "$GAGSV,1,1,01,36,70,090,36,1*4A\r\n"
+        "$GQGSV,1,1,01,-190,52,170,40,1*44\r\n"
+        "$GBGSV,1,1,01,11,00,010,18,1*4F\r\n"
+        "$GIGSV,1,1,01,02,30,250,33,1*4A\r\n";
+
+// Output for fillSvMultiBand() from the generator that searched the whole
+// report once per GSV group, before SVs were sorted into groups up front.
+static const char sGoldenSvMultiBand[] =
+        "$GPGSV,4,1,13,01,00,001,,02,69,143,43,03,25,306,15,04,89,243,43,1*6D\r\n"
+        "$GPGSV,4,2,13,05,77,314,22,06,66,025,36,07,19,343,,08,24,188,43,1*64\r\n"
+        "$GPGSV,4,3,13,09,82,280,,10,65,146,15,11,13,259,22,12,50,012,29,1*6F\r\n"
+        "$GPGSV,4,4,13,1*66\r\n"
+        "$GPGSV,2,1,07,01,37,114,22,02,16,256,15,03,63,059,22,04,36,356,15,8*67\r\n"
+        "$GPGSV,2,2,07,05,25,067,29,06,13,138,43,07,56,096,15,8*54\r\n"
+        "$GLGSV,2,1,08,65,58,093,43,66,89,122,29,67,10,172,,68,72,109,,1*7C\r\n"
+        "$GLGSV,2,2,08,69,62,180,36,70,51,251,15,71,02,209,22,72,60,301,15,1*7C\r\n"
+        "$GLGSV,2,1,05,67,05,206,15,68,37,235,,69,46,285,36,70,19,222,29,3*77\r\n"
+        "$GLGSV,2,2,05,71,08,293,43,3*4E\r\n"
+        "$GAGSV,3,1,09,02,43,319,22,03,74,348,43,04,83,038,43,05,57,335,36,7*7A\r\n"
+        "$GAGSV,3,2,09,06,45,046,,07,88,004,22,08,39,322,29,09,07,054,22,7*78\r\n"
+        "$GAGSV,3,3,09,10,28,033,43,7*46\r\n"
+        "$GAGSV,2,1,06,04,80,072,29,05,20,101,15,06,31,151,15,07,04,088,43,1*70\r\n"
+        "$GAGSV,2,2,06,08,83,159,22,09,34,117,29,1*7F\r\n"
+        "$GQGSV,1,1,02,-191,48,164,22,-190,42,080,36,1*62\r\n"
+        "$GQGSV,1,1,01,-190,84,277,29,8*4D\r\n"
+        "$GBGSV,3,1,09,19,26,185,36,20,57,214,22,21,68,264,22,22,40,201,15,1*71\r\n"
+        "$GBGSV,3,2,09,23,30,272,29,24,71,230,36,25,77,075,36,26,45,167,29,1*7A\r\n"
+        "$GBGSV,3,3,09,1*7F\r\n"
+        "$GBGSV,1,1,03,21,63,298,,30,11,051,15,22,05,327,29,23,14,017,29,5*76\r\n"
+        "$GIGSV,1,1,03,02,31,030,36,03,78,193,43,04,51,130,36,1*4F\r\n";
+
+static bool checkGolden(const char* name, const char* nmea, size_t length, const char* golden) {
+    bool match = (length == strlen(golden)) && (0 == memcmp(nmea, golden, length + 1));
+    printf("golden %s: %s\n", name, match ? "ok" : "MISMATCH");
+    if (!match) {
+        printf("expected:\n%sgot:\n%s", golden, nmea);
+    }
+    return match;
+}
+
+// Checks every formatter against the printf conversion it stands in for,
+// with values around the rounding points, signed zeros and non finite ones.
+static int checkFormatters(int count) {
+    static const double specials[] = { 0.0, -0.0, 0.05, 0.15, 0.25, 0.35, -0.45, 2.5, 0.0005,
+            1.0005, 59.9999995, 59.99999949, 1e15, 4503599627370496.0, 1e20, -1e20,
+            INFINITY, -INFINITY, NAN, -NAN };
+    static const struct { int decimals, width; } formats[] = { {1, 0}, {3, 0}, {6, 9} };
+    int failures = 0;
+    char buffer[NMEA_SENTENCE_MAX_LENGTH];
+    char expected[128];
+    for (int i = 0; i < count; i++) {
+        double value;
+        if (i < (int)(sizeof(specials) / sizeof(specials[0]))) {
+            value = specials[i];
+        } else if (i & 1) {
+            // k + 1/2 units of the last decimal, or right next to it
+            value = ((rand() % 2000000) - 1000000 + 0.5) / 1000.0;
+            value = nextafter(value, (rand() & 1) ? value + 1 : value - 1);
+        } else {
+            value = (rand() / (double)RAND_MAX - 0.5) * 20000.0;
+        }
+        int number = rand() - RAND_MAX / 2;
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+            LocNmeaWriter writer(buffer, sizeof(buffer));
+            writer.begin("", "");
+            writer.putFixed(value, formats[f].decimals, formats[f].width);
+            writer.put('|');
+            writer.putInt(number % 1000, 2);
+            writer.put('|');
+            writer.putInt(number, 3);
+            writer.put('|');
+            writer.putHex(number);
+            writer.end();
+            int length = snprintf(expected, sizeof(expected), "$%0*.*f|%02d|%03d|%X*",
+                                  formats[f].width, formats[f].decimals, value,
+                                  number % 1000, number, number);
+            if (0 != strncmp(buffer, expected, length)) {
+                if (failures++ < 10) {
+                    printf("format %.17g: expected %s got %s", value, expected, buffer);
+                }
+            }
+        }
+    }
+    printf("formatters: %d values, %d failures\n", count, failures);
+    return failures;
+}
+
+// Transforms random positions from the ground up to 100 km with
+// loc_convert_WGS84_to_PZ90() and with the Bowring based conversion it
+// replaced, and compares the results to a tenth of a millimetre.
+static bool checkDatum(int count) {
+    LocLla* wgs84 = new LocLla[count];
+    LocLla* pz90 = new LocLla[count];
+    LocLla* bowring = new LocLla[count];
+    for (int i = 0; i < count; i++) {
+        wgs84[i].lat = (rand() / (double)RAND_MAX - 0.5) * 180.0;
+        wgs84[i].lon = (rand() / (double)RAND_MAX - 0.5) * 360.0;
+        wgs84[i].alt = (rand() / (double)RAND_MAX) * 100000.0 - 500.0;
+    }
+
+    double start = getSeconds();
+    for (int i = 0; i < count; i++) {
+        LocLla lla;
+        LocEcef ecef_w84;
+        LocEcef ecef_p90;
+        lla.lat = wgs84[i].lat / 180.0 * M_PI;
+        lla.lon = wgs84[i].lon / 180.0 * M_PI;
+        lla.alt = wgs84[i].alt;
+        convert_Lla_to_Ecef(lla, ecef_w84);
+        convert_WGS84_to_PZ90(ecef_w84, ecef_p90);
+        convert_Ecef_to_Lla_Bowring(ecef_p90, lla);
+        bowring[i].lat = lla.lat / M_PI * 180.0;
+        bowring[i].lon = lla.lon / M_PI * 180.0;
+        bowring[i].alt = lla.alt;
+    }
+    double bowringTime = getSeconds() - start;
+
+    start = getSeconds();
+    loc_convert_WGS84_to_PZ90(wgs84, pz90, count);
+    double closedTime = getSeconds() - start;
+
+    // meters per degree, well enough for a difference
+    const double degree = MAJA * M_PI / 180.0;
+    double maxHorizontal = 0.0, maxVertical = 0.0;
+    for (int i = 0; i < count; i++) {
+        double dLat = (pz90[i].lat - bowring[i].lat) * degree;
+        double dLon = fmod(pz90[i].lon - bowring[i].lon + 540.0, 360.0) - 180.0;
+        dLon *= degree * cos(pz90[i].lat / 180.0 * M_PI);
+        maxHorizontal = std::max(maxHorizontal, sqrt(dLat * dLat + dLon * dLon));
+        maxVertical = std::max(maxVertical, fabs(pz90[i].alt - bowring[i].alt));
+    }
+    bool ok = (maxHorizontal < 0.0001) && (maxVertical < 0.0001);
+    printf("datum: %d positions, max difference %.6f m horizontal, %.6f m vertical, %s\n"
+           "datum: %.1f ns per position, was %.1f ns\n",
+           count, maxHorizontal, maxVertical, ok ? "ok" : "TOO LARGE",
+           closedTime * 1e9 / count, bowringTime * 1e9 / count);
+
+    delete[] wgs84;
+    delete[] pz90;
+    delete[] bowring;
+    return ok;
+}
+
+// For Linux command line testing, link with libgps_utils:
+// compilation: g++ -D__LOC_DEBUG__ -O2 -I. -I../location -I../pla/oe loc_nmea.cpp libgps_utils.a
+// test: ./a.out <iterations>
+//     compares the generators with golden output, the number formatters
+//     with printf and the datum transform with the one it replaced, then
+//     times the generators on the golden inputs.
+int main(int argc, char** argv) {
+    int iterations = (argc > 1) ? atoi(argv[1]) : 100000;
+    srand(time(NULL));
+
+    UlpLocation location;
+    GpsLocationExtended locationExtended;
+    LocationSystemInfo systemInfo;
+    GnssSvNotification svNotify;
+    fillFix(location, locationExtended, systemInfo);
+    fillSv(svNotify);
+
+    static char nmea[NMEA_SV_MAX_LENGTH];
+    size_t length;
+    bool ok = true;
+    length = loc_nmea_generate_pos(location, locationExtended, systemInfo, 1, false,
+                                   nmea, NMEA_POS_MAX_LENGTH);
+    ok = checkGolden("pos", nmea, length, sGoldenPos) && ok;
+    length = loc_nmea_generate_pos(location, locationExtended, systemInfo, 1, true,
+                                   nmea, NMEA_POS_MAX_LENGTH);
+    ok = checkGolden("pos custom GGA", nmea, length, sGoldenPosCustomGga) && ok;
+    length = loc_nmea_generate_pos(location, locationExtended, systemInfo, 0, false,
+                                   nmea, NMEA_POS_MAX_LENGTH);
+    ok = checkGolden("pos blank", nmea, length, sGoldenPosBlank) && ok;
+    length = loc_nmea_generate_sv(svNotify, nmea, NMEA_SV_MAX_LENGTH);
+    ok = checkGolden("sv", nmea, length, sGoldenSv) && ok;
+    static GnssSvNotification svMultiBand;
+    fillSvMultiBand(svMultiBand);
+    length = loc_nmea_generate_sv(svMultiBand, nmea, NMEA_SV_MAX_LENGTH);
+    ok = checkGolden("sv multi band", nmea, length, sGoldenSvMultiBand) && ok;
+
+    // a short buffer keeps as many whole sentences as fit
+    length = loc_nmea_generate_pos(location, locationExtended, systemInfo, 1, false, nmea, 150);
+    const char* next = strstr(sGoldenPos + length, "\r\n");
+    bool truncated = (length > 0) && ('\0' == nmea[length]) &&
+            (0 == memcmp(nmea, sGoldenPos, length)) && (0 == memcmp(nmea + length - 2, "\r\n", 2)) &&
+            (nullptr != next) && (next + 2 - sGoldenPos >= 150);
+    printf("short buffer: %s\n", truncated ? "ok" : "FAILED");
+    ok = truncated && ok;
+
+    ok = (0 == checkFormatters(iterations)) && ok;
+    ok = checkDatum(iterations) && ok;
+
+    double start = getSeconds();
+    uint64_t bytes = 0;
+    for (int i = 0; i < iterations; i++) {
+        bytes += loc_nmea_generate_pos(location, locationExtended, systemInfo, 1, false,
+                                       nmea, NMEA_POS_MAX_LENGTH);
+    }
+    double elapsed = getSeconds() - start;
+    printf("pos: %.2f us per report, %.1f MB/s\n",
+           elapsed * 1000000 / iterations, bytes / elapsed / 1000000);
+
+    start = getSeconds();
+    bytes = 0;
+    for (int i = 0; i < iterations; i++) {
+        bytes += loc_nmea_generate_sv(svMultiBand, nmea, NMEA_SV_MAX_LENGTH);
+    }
+    elapsed = getSeconds() - start;
+    printf("sv: %.2f us per report of %u SVs, %.1f MB/s\n",
+           elapsed * 1000000 / iterations, svMultiBand.count, bytes / elapsed / 1000000);
+
+    return ok ? 0 : 1;
+}
+
+#endif
@@ -31,8 +31,6 @@
 #define LOC_ENG_NMEA_H
 
 #include <gps_extended.h>
-#include <vector>
-#include <string>
 #define NMEA_SENTENCE_MAX_LENGTH 200
 
 /** gnss datum type */
@@ -72,15 +70,28 @@ typedef struct {
     double     Z;
 } LocEcef;
 
-void loc_nmea_generate_sv(const GnssSvNotification &svNotify,
-                              std::vector<std::string> &nmeaArraystr);
+/* Converts count positions, latitude and longitude in degrees, from the
+   WGS84 to the PZ90 datum, e.g. for batched or replayed fixes.
+   wgs84 and pz90 may be the same array. */
+void loc_convert_WGS84_to_PZ90(const LocLla* wgs84, LocLla* pz90, size_t count);
 
-void loc_nmea_generate_pos(const UlpLocation &location,
+/* Both generators write their sentences back to back into the nmea buffer,
+   each ending in "\r\n", NUL terminate them and return their length.
+   Buffers of the sizes below fit the most sentences a report can produce:
+   5 GSA, VTG, 3 DTM, RMC, GNS and GGA for a position, and 4 SVs per GSV
+   plus one partly filled GSV for each of the 11 signals for SVs. */
+#define NMEA_POS_MAX_LENGTH   (12 * NMEA_SENTENCE_MAX_LENGTH)
+#define NMEA_SV_MAX_LENGTH    ((GNSS_SV_MAX / 4 + 11) * NMEA_SENTENCE_MAX_LENGTH)
+
+size_t loc_nmea_generate_sv(const GnssSvNotification &svNotify,
+                              char *nmea, size_t nmeaSize);
+
+size_t loc_nmea_generate_pos(const UlpLocation &location,
                                const GpsLocationExtended &locationExtended,
                                const LocationSystemInfo &systemInfo,
                                unsigned char generate_nmea,
                                bool custom_gga_fix_quality,
-                               std::vector<std::string> &nmeaArraystr);
+                               char *nmea, size_t nmeaSize);
 
 #define DEBUG_NMEA_MINSIZE 6
 #define DEBUG_NMEA_MAXSIZE 4096
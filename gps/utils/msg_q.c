@@ -30,16 +30,44 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 #include <loc_pla.h>
 #include <log_util.h>
 #include "linked_list.h"
 #include "msg_q.h"
 
+/* Times the receiver polls an empty ring before sleeping on the eventfd */
+#define MSG_RING_SPIN_COUNT 16
+
+typedef struct msg_ring_cell {
+   uint32_t seq;                    /* Slot sequence number, see msg_ring_put */
+   void* msg_obj;
+   void (*dealloc)(void*);
+} msg_ring_cell;
+
+typedef struct msg_ring {
+   uint32_t mask;                   /* Number of cells - 1 */
+   msg_q_overflow_type overflow;    /* What to do when all cells are in use */
+   int event_fd;                    /* Doorbell for the sleeping receiver */
+   /* Producers and the receiver touch these two on every message; keep them
+      on separate cache lines so they do not bounce between cores. */
+   uint32_t enqueue_pos __attribute__((aligned(64)));
+   uint32_t dequeue_pos __attribute__((aligned(64)));
+   int waiting;                     /* Receiver is (about to be) asleep */
+   msg_ring_cell cells[];
+} msg_ring;
+
 typedef struct msg_q {
    void* msg_list;                  /* Linked list to store information */
    pthread_cond_t  list_cond;       /* Condition variable for waiting on msg queue */
    pthread_mutex_t list_mutex;      /* Mutex for exclusive access to message queue */
    int unblocked;                   /* Has this message queue been unblocked? */
+   msg_ring* ring;                  /* Lock free storage, used instead of msg_list if set */
+   int spilled;                     /* Messages in msg_list of a full eMSG_Q_OVERFLOW_SPILL ring */
+   pthread_cond_t  space_cond;      /* Senders waiting on a full eMSG_Q_OVERFLOW_BLOCK ring */
+   int space_waiters;               /* Number of them, guarded by list_mutex for the writers */
 } msg_q;
 
 /*===========================================================================
@@ -81,6 +109,390 @@ static msq_q_err_type convert_linked_list_err_type(linked_list_err_type linked_l
    }
 }
 
+/*===========================================================================
+FUNCTION    msg_ring_create
+
+DESCRIPTION
+   Allocates a ring with capacity rounded up to a power of 2 and marks every
+   cell free for the first lap.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Ring on success, NULL on failure.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msg_ring* msg_ring_create(uint32_t capacity, msg_q_overflow_type overflow)
+{
+   uint32_t size = 2;
+   while( size < capacity && size < 0x80000000 )
+   {
+      size <<= 1;
+   }
+
+   msg_ring* ring = (msg_ring*)calloc(1, sizeof(msg_ring) + size * sizeof(msg_ring_cell));
+   if( ring == NULL )
+   {
+      return NULL;
+   }
+
+   ring->event_fd = eventfd(0, EFD_CLOEXEC);
+   if( ring->event_fd < 0 )
+   {
+      free(ring);
+      return NULL;
+   }
+
+   for( uint32_t i = 0; i < size; i++ )
+   {
+      ring->cells[i].seq = i;
+   }
+   ring->mask = size - 1;
+   ring->overflow = overflow;
+
+   return ring;
+}
+
+/*===========================================================================
+FUNCTION    msg_ring_notify
+
+DESCRIPTION
+   Wakes the receiver after a message was published, if it went to sleep.
+   Pairs with the fence in msg_ring_wait: either the receiver sees the
+   message on its re-check, or we see it waiting and ring the doorbell.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_ring_notify(msg_ring* ring)
+{
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if( __atomic_load_n(&ring->waiting, __ATOMIC_RELAXED) &&
+       __atomic_exchange_n(&ring->waiting, 0, __ATOMIC_RELAXED) )
+   {
+      /* only the first producer after the receiver went idle pays the syscall */
+      eventfd_write(ring->event_fd, 1);
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_ring_put
+
+DESCRIPTION
+   Bounded MPMC enqueue (D. Vyukov). A cell is free for position pos when its
+   seq equals pos, and holds data for the receiver when its seq is pos + 1.
+   Producers claim a position with a CAS on enqueue_pos, fill the cell and
+   publish it by bumping seq; a receiver that went to sleep on an empty ring
+   is then woken through the eventfd.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if the ring is full.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_ring_put(msg_ring* ring, void* msg_obj, void (*dealloc)(void*))
+{
+   msg_ring_cell* cell;
+   uint32_t pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+
+   for( ;; )
+   {
+      cell = &ring->cells[pos & ring->mask];
+      int32_t dif = (int32_t)(__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) - pos);
+      if( dif == 0 )
+      {
+         if( __atomic_compare_exchange_n(&ring->enqueue_pos, &pos, pos + 1, 1,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+         {
+            break;
+         }
+      }
+      else if( dif < 0 )
+      {
+         return -1;
+      }
+      else
+      {
+         pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+      }
+   }
+
+   cell->msg_obj = msg_obj;
+   cell->dealloc = dealloc;
+   __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+   msg_ring_notify(ring);
+
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    msg_ring_get
+
+DESCRIPTION
+   Single consumer dequeue. Never blocks.
+
+DEPENDENCIES
+   Must not be called concurrently from more than one thread.
+
+RETURN VALUE
+   0 on success, -1 if the ring is empty.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_ring_get(msg_ring* ring, void** msg_obj, void (**dealloc)(void*))
+{
+   uint32_t pos = ring->dequeue_pos;
+   msg_ring_cell* cell = &ring->cells[pos & ring->mask];
+
+   if( __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE) != pos + 1 )
+   {
+      return -1;
+   }
+
+   *msg_obj = cell->msg_obj;
+   if( dealloc != NULL )
+   {
+      *dealloc = cell->dealloc;
+   }
+   /* hand the cell back to producers for the next lap */
+   __atomic_store_n(&cell->seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+   ring->dequeue_pos = pos + 1;
+
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_freed
+
+DESCRIPTION
+   Wakes the senders of an eMSG_Q_OVERFLOW_BLOCK ring sleeping on a full ring,
+   after the receiver took a cell. Pairs with the fence in msg_q_ring_block:
+   either the sender sees the free cell on its retry, or we see it waiting.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_ring_freed(msg_q* p_msg_q)
+{
+   if( p_msg_q->ring->overflow != eMSG_Q_OVERFLOW_BLOCK )
+   {
+      return;
+   }
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if( __atomic_load_n(&p_msg_q->space_waiters, __ATOMIC_RELAXED) != 0 )
+   {
+      pthread_mutex_lock(&p_msg_q->list_mutex);
+      pthread_cond_broadcast(&p_msg_q->space_cond);
+      pthread_mutex_unlock(&p_msg_q->list_mutex);
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_block
+
+DESCRIPTION
+   Enqueues on the full ring of an eMSG_Q_OVERFLOW_BLOCK queue, sleeping on
+   space_cond until the receiver frees a cell or the queue gets unblocked.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msq_q_err_type msg_q_ring_block(msg_q* p_msg_q, void* msg_obj, void (*dealloc)(void*))
+{
+   msq_q_err_type rv = eMSG_Q_SUCCESS;
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+   __atomic_add_fetch(&p_msg_q->space_waiters, 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+   while( msg_ring_put(p_msg_q->ring, msg_obj, dealloc) != 0 )
+   {
+      if( p_msg_q->unblocked )
+      {
+         LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+         rv = eMSG_Q_UNAVAILABLE_RESOURCE;
+         break;
+      }
+      pthread_cond_wait(&p_msg_q->space_cond, &p_msg_q->list_mutex);
+   }
+
+   __atomic_sub_fetch(&p_msg_q->space_waiters, 1, __ATOMIC_RELAXED);
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
+
+   return rv;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_spill
+
+DESCRIPTION
+   Appends a message that did not fit in the full ring of an
+   eMSG_Q_OVERFLOW_SPILL queue to msg_list, see msg_q_ring_get.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msq_q_err_type msg_q_spill(msg_q* p_msg_q, void* msg_obj, void (*dealloc)(void*))
+{
+   msq_q_err_type rv;
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+   rv = convert_linked_list_err_type(linked_list_add(p_msg_q->msg_list, msg_obj, dealloc));
+   if( rv == eMSG_Q_SUCCESS )
+   {
+      __atomic_add_fetch(&p_msg_q->spilled, 1, __ATOMIC_RELEASE);
+   }
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
+
+   if( rv == eMSG_Q_SUCCESS )
+   {
+      msg_ring_notify(p_msg_q->ring);
+   }
+   return rv;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_get
+
+DESCRIPTION
+   Single consumer dequeue from a ring queue, never blocks. Spilled messages
+   are taken only once the ring is empty, as everything in the ring was sent
+   before them; and senders keep spilling until the list is drained, so the
+   messages of one sender stay in order.
+
+DEPENDENCIES
+   Must not be called concurrently from more than one thread.
+
+RETURN VALUE
+   0 on success, -1 if the queue is empty.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_ring_get(msg_q* p_msg_q, void** msg_obj)
+{
+   int rv = -1;
+
+   if( msg_ring_get(p_msg_q->ring, msg_obj, NULL) == 0 )
+   {
+      msg_q_ring_freed(p_msg_q);
+      return 0;
+   }
+   if( __atomic_load_n(&p_msg_q->spilled, __ATOMIC_ACQUIRE) == 0 )
+   {
+      return -1;
+   }
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+   if( !linked_list_empty(p_msg_q->msg_list) )
+   {
+      if( linked_list_remove(p_msg_q->msg_list, msg_obj) == eLINKED_LIST_SUCCESS )
+      {
+         __atomic_sub_fetch(&p_msg_q->spilled, 1, __ATOMIC_RELEASE);
+         rv = 0;
+      }
+   }
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
+
+   return rv;
+}
+
+/*===========================================================================
+FUNCTION    msg_ring_wait
+
+DESCRIPTION
+   Blocking single consumer dequeue. Sleeps on the eventfd while the queue is
+   empty until a producer publishes a cell or the queue gets unblocked.
+
+DEPENDENCIES
+   Must not be called concurrently from more than one thread.
+
+RETURN VALUE
+   0 on success, -1 if the queue has been unblocked.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_ring_wait(msg_q* p_msg_q, void** msg_obj)
+{
+   msg_ring* ring = p_msg_q->ring;
+   eventfd_t count;
+   int spin;
+
+   while( msg_q_ring_get(p_msg_q, msg_obj) != 0 )
+   {
+      /* a producer may be mid-publish; give it a moment before sleeping */
+      for( spin = 0; spin < MSG_RING_SPIN_COUNT; spin++ )
+      {
+         if( msg_q_ring_get(p_msg_q, msg_obj) == 0 )
+         {
+            return 0;
+         }
+         sched_yield();
+      }
+
+      __atomic_store_n(&ring->waiting, 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+      if( msg_q_ring_get(p_msg_q, msg_obj) == 0 )
+      {
+         __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+         break;
+      }
+      if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
+      {
+         __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+         return -1;
+      }
+
+      eventfd_read(ring->event_fd, &count);
+      __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELAXED);
+   }
+
+   return 0;
+}
+
 /* ----------------------- END INTERNAL FUNCTIONS ---------------------------------------- */
 
 /*===========================================================================
@@ -128,6 +540,16 @@ msq_q_err_type msg_q_init(void** msg_q_data)
       return eMSG_Q_FAILURE_GENERAL;
    }
 
+   if( pthread_cond_init(&tmp_msg_q->space_cond, NULL) != 0 )
+   {
+      LOC_LOGE("%s: Unable to initialize msg q space cond var!\n", __FUNCTION__);
+      linked_list_destroy(&tmp_msg_q->msg_list);
+      pthread_mutex_destroy(&tmp_msg_q->list_mutex);
+      pthread_cond_destroy(&tmp_msg_q->list_cond);
+      free(tmp_msg_q);
+      return eMSG_Q_FAILURE_GENERAL;
+   }
+
    tmp_msg_q->unblocked = 0;
 
    *msg_q_data = tmp_msg_q;
@@ -149,6 +571,46 @@ const void* msg_q_init2()
   return q;
 }
 
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_init
+
+  ===========================================================================*/
+msq_q_err_type msg_q_ring_init(void** msg_q_data, uint32_t capacity,
+                               msg_q_overflow_type overflow)
+{
+   msq_q_err_type rv = msg_q_init(msg_q_data);
+   if( rv != eMSG_Q_SUCCESS )
+   {
+      return rv;
+   }
+
+   msg_q* p_msg_q = (msg_q*)*msg_q_data;
+   p_msg_q->ring = msg_ring_create(capacity, overflow);
+   if( p_msg_q->ring == NULL )
+   {
+      LOC_LOGE("%s: Unable to allocate ring of %u entries!\n", __FUNCTION__, capacity);
+      msg_q_destroy(msg_q_data);
+      return eMSG_Q_FAILURE_GENERAL;
+   }
+
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_ring_init2
+
+  ===========================================================================*/
+const void* msg_q_ring_init2(uint32_t capacity, msg_q_overflow_type overflow)
+{
+  void* q = NULL;
+  if (eMSG_Q_SUCCESS != msg_q_ring_init(&q, capacity, overflow)) {
+    q = NULL;
+  }
+  return q;
+}
+
 /*===========================================================================
 
   FUNCTION:   msg_q_destroy
@@ -167,6 +629,24 @@ msq_q_err_type msg_q_destroy(void** msg_q_data)
    linked_list_destroy(&p_msg_q->msg_list);
    pthread_mutex_destroy(&p_msg_q->list_mutex);
    pthread_cond_destroy(&p_msg_q->list_cond);
+   pthread_cond_destroy(&p_msg_q->space_cond);
+
+   if( p_msg_q->ring != NULL )
+   {
+      /* whatever is still pending is freed the way linked_list_destroy does */
+      void* msg_obj;
+      void (*dealloc)(void*);
+      while( msg_ring_get(p_msg_q->ring, &msg_obj, &dealloc) == 0 )
+      {
+         if( dealloc != NULL )
+         {
+            dealloc(msg_obj);
+         }
+      }
+      close(p_msg_q->ring->event_fd);
+      free(p_msg_q->ring);
+      p_msg_q->ring = NULL;
+   }
 
    p_msg_q->unblocked = 0;
 
@@ -197,6 +677,46 @@ msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*)
 
    msg_q* p_msg_q = (msg_q*)msg_q_data;
 
+   if( p_msg_q->ring != NULL )
+   {
+      LOC_LOGV("%s: Sending message with handle = %p\n", __FUNCTION__, msg_obj);
+      if( p_msg_q->ring->overflow == eMSG_Q_OVERFLOW_SPILL )
+      {
+         if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
+         {
+            LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+            return eMSG_Q_UNAVAILABLE_RESOURCE;
+         }
+         /* behind what was spilled already, if anything */
+         if( __atomic_load_n(&p_msg_q->spilled, __ATOMIC_ACQUIRE) != 0 ||
+             msg_ring_put(p_msg_q->ring, msg_obj, dealloc) != 0 )
+         {
+            return msg_q_spill(p_msg_q, msg_obj, dealloc);
+         }
+         return eMSG_Q_SUCCESS;
+      }
+      if( msg_ring_put(p_msg_q->ring, msg_obj, dealloc) == 0 )
+      {
+         return eMSG_Q_SUCCESS;
+      }
+      if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
+      {
+         LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+      if( p_msg_q->ring->overflow == eMSG_Q_OVERFLOW_DROP )
+      {
+         LOC_LOGW("%s: Message queue full, dropping %p\n", __FUNCTION__, msg_obj);
+         if( dealloc != NULL )
+         {
+            dealloc(msg_obj);
+         }
+         return eMSG_Q_INSUFFICIENT_BUFFER;
+      }
+      /* eMSG_Q_OVERFLOW_BLOCK: wait for the receiver to catch up */
+      return msg_q_ring_block(p_msg_q, msg_obj, dealloc);
+   }
+
    pthread_mutex_lock(&p_msg_q->list_mutex);
    LOC_LOGV("%s: Sending message with handle = %p\n", __FUNCTION__, msg_obj);
 
@@ -241,6 +761,18 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
 
    msg_q* p_msg_q = (msg_q*)msg_q_data;
 
+   if( p_msg_q->ring != NULL )
+   {
+      if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) ||
+          msg_ring_wait(p_msg_q, msg_obj) != 0 )
+      {
+         LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+      LOC_LOGV("%s: Received message %p rv = %d\n", __FUNCTION__, *msg_obj, eMSG_Q_SUCCESS);
+      return eMSG_Q_SUCCESS;
+   }
+
    pthread_mutex_lock(&p_msg_q->list_mutex);
 
    if( p_msg_q->unblocked )
@@ -265,6 +797,83 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
    return rv;
 }
 
+/*===========================================================================
+
+  FUNCTION:   msg_q_rcv_batch
+
+  ===========================================================================*/
+msq_q_err_type msg_q_rcv_batch(void* msg_q_data, void** msg_objs,
+                               uint32_t max_count, uint32_t* count)
+{
+   /* stays so if we got woken up by msg_q_unblock with nothing queued */
+   msq_q_err_type rv = eMSG_Q_UNAVAILABLE_RESOURCE;
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   if( msg_objs == NULL || count == NULL || max_count == 0 )
+   {
+      LOC_LOGE("%s: Invalid msg_objs parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+   *count = 0;
+
+   if( p_msg_q->ring != NULL )
+   {
+      if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) ||
+          msg_ring_wait(p_msg_q, &msg_objs[0]) != 0 )
+      {
+         LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+      *count = 1;
+      while( *count < max_count &&
+             msg_q_ring_get(p_msg_q, &msg_objs[*count]) == 0 )
+      {
+         (*count)++;
+      }
+      LOC_LOGV("%s: Received %u messages\n", __FUNCTION__, *count);
+      return eMSG_Q_SUCCESS;
+   }
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+
+   if( p_msg_q->unblocked )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      pthread_mutex_unlock(&p_msg_q->list_mutex);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   /* Wait for data in the message queue */
+   while( linked_list_empty(p_msg_q->msg_list) && !p_msg_q->unblocked )
+   {
+      pthread_cond_wait(&p_msg_q->list_cond, &p_msg_q->list_mutex);
+   }
+
+   /* Take everything pending, up to max_count, while we hold the lock */
+   while( *count < max_count && !linked_list_empty(p_msg_q->msg_list) )
+   {
+      rv = convert_linked_list_err_type(linked_list_remove(p_msg_q->msg_list,
+                                                           &msg_objs[*count]));
+      if( rv != eMSG_Q_SUCCESS )
+      {
+         break;
+      }
+      (*count)++;
+   }
+
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
+
+   LOC_LOGV("%s: Received %u messages rv = %d\n", __FUNCTION__, *count, rv);
+
+   return (*count > 0) ? eMSG_Q_SUCCESS : rv;
+}
+
 /*===========================================================================
 
   FUNCTION:   msg_q_rmv
@@ -285,6 +894,19 @@ msq_q_err_type msg_q_rmv(void* msg_q_data, void** msg_obj)
 
    msg_q* p_msg_q = (msg_q*)msg_q_data;
 
+   if (p_msg_q->ring != NULL) {
+      if (__atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE)) {
+         LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+      if (msg_q_ring_get(p_msg_q, msg_obj) != 0) {
+         LOC_LOGW("%s: list is empty !!\n", __FUNCTION__);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+      LOC_LOGV("%s: Removed message %p rv = %d\n", __FUNCTION__, *msg_obj, eMSG_Q_SUCCESS);
+      return eMSG_Q_SUCCESS;
+   }
+
    pthread_mutex_lock(&p_msg_q->list_mutex);
 
    if (p_msg_q->unblocked) {
@@ -328,6 +950,26 @@ msq_q_err_type msg_q_flush(void* msg_q_data)
 
    LOC_LOGD("%s: Flushing Message Queue\n", __FUNCTION__);
 
+   if( p_msg_q->ring != NULL )
+   {
+      void* msg_obj;
+      void (*dealloc)(void*);
+      while( msg_ring_get(p_msg_q->ring, &msg_obj, &dealloc) == 0 )
+      {
+         if( dealloc != NULL )
+         {
+            dealloc(msg_obj);
+         }
+      }
+      msg_q_ring_freed(p_msg_q);
+      pthread_mutex_lock(&p_msg_q->list_mutex);
+      linked_list_flush(p_msg_q->msg_list);
+      __atomic_store_n(&p_msg_q->spilled, 0, __ATOMIC_RELEASE);
+      pthread_mutex_unlock(&p_msg_q->list_mutex);
+      LOC_LOGD("%s: Message Queue flushed\n", __FUNCTION__);
+      return eMSG_Q_SUCCESS;
+   }
+
    pthread_mutex_lock(&p_msg_q->list_mutex);
 
    /* Remove all elements from the list */
@@ -365,10 +1007,15 @@ msq_q_err_type msg_q_unblock(void* msg_q_data)
 
    LOC_LOGD("%s: Unblocking Message Queue\n", __FUNCTION__);
    /* Unblocking message queue */
-   p_msg_q->unblocked = 1;
+   __atomic_store_n(&p_msg_q->unblocked, 1, __ATOMIC_RELEASE);
 
    /* Allow all the waiters to wake up */
    pthread_cond_broadcast(&p_msg_q->list_cond);
+   pthread_cond_broadcast(&p_msg_q->space_cond);
+   if( p_msg_q->ring != NULL )
+   {
+      eventfd_write(p_msg_q->ring->event_fd, 1);
+   }
 
    pthread_mutex_unlock(&p_msg_q->list_mutex);
 
@@ -376,3 +1023,151 @@ msq_q_err_type msg_q_unblock(void* msg_q_data)
 
    return eMSG_Q_SUCCESS;
 }
+
+#ifdef __LOC_DEBUG__
+
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+   void* q;
+   uint32_t id;
+   uint32_t count;
+} msg_q_test_producer;
+
+/* a message is its producer and sequence number, never NULL */
+#define MSG_Q_TEST_MSG(id, seq) ((void*)(((uintptr_t)(id) << 24) | ((seq) + 1)))
+#define MSG_Q_TEST_ID(msg)      ((uint32_t)((uintptr_t)(msg) >> 24))
+#define MSG_Q_TEST_SEQ(msg)     ((uint32_t)((uintptr_t)(msg) & 0xFFFFFF) - 1)
+
+static double msg_q_test_seconds()
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (double)now.tv_sec + (double)now.tv_nsec / 1000000000;
+}
+
+static void* msg_q_test_produce(void* arg)
+{
+   msg_q_test_producer* producer = (msg_q_test_producer*)arg;
+   uint32_t seq;
+   for( seq = 0; seq < producer->count; seq++ )
+   {
+      msg_q_snd(producer->q, MSG_Q_TEST_MSG(producer->id, seq), NULL);
+   }
+   return NULL;
+}
+
+/* Sends *count* messages from each of *producers* threads and receives them,
+   in batches if *batch* > 1; returns the messages per second, or -1 if the
+   messages of a producer came out of order or got lost. With *self* set, the
+   receiver also sends one message to its own queue per message received from
+   a producer, as a MsgTask does when a message posts a follow up. */
+static double msg_q_test_run(void* q, uint32_t producers, uint32_t count,
+                             uint32_t batch, int self)
+{
+   pthread_t threads[64];
+   msg_q_test_producer args[64];
+   uint32_t next[65] = { 0 };
+   uint32_t total = producers * count * (self ? 2 : 1);
+   uint32_t received = 0;
+   uint32_t sent_self = 0;
+   int in_order = 1;
+   uint32_t i;
+   double start = msg_q_test_seconds();
+
+   for( i = 0; i < producers; i++ )
+   {
+      args[i].q = q;
+      args[i].id = i + 1;
+      args[i].count = count;
+      pthread_create(&threads[i], NULL, msg_q_test_produce, &args[i]);
+   }
+   while( received < total )
+   {
+      void* msgs[32];
+      uint32_t n = 1, j;
+      if( batch > 1 )
+      {
+         msg_q_rcv_batch(q, msgs, batch, &n);
+      }
+      else
+      {
+         msg_q_rcv(q, &msgs[0]);
+      }
+      for( j = 0; j < n; j++ )
+      {
+         uint32_t id = MSG_Q_TEST_ID(msgs[j]);
+         in_order &= (MSG_Q_TEST_SEQ(msgs[j]) == next[id]);
+         next[id]++;
+         if( self && 0 != id )
+         {
+            msg_q_snd(q, MSG_Q_TEST_MSG(0, sent_self++), NULL);
+         }
+      }
+      received += n;
+   }
+   for( i = 0; i < producers; i++ )
+   {
+      pthread_join(threads[i], NULL);
+   }
+   return in_order ? total / (msg_q_test_seconds() - start) : -1;
+}
+
+/* For Linux command line testing:
+   compilation: gcc -D__LOC_DEBUG__ -O2 -I. -I../pla/oe msg_q.c linked_list.c, link with
+       libgps_utils for the logging
+   test: ./a.out [<producers> [<messages per producer>]]
+       N producers against one receiver, on the linked list, on a ring that
+       blocks senders when full and on one that spills to the list, each with
+       single and batched receives; then a receiver that keeps sending to its
+       own queue, which a full ring that blocks would deadlock. */
+int main(int argc, char** argv)
+{
+   uint32_t producers = (argc > 1) ? (uint32_t)atoi(argv[1]) : 4;
+   uint32_t count = (argc > 2) ? (uint32_t)atoi(argv[2]) : 1000000;
+   static const struct {
+      const char* name;
+      int ring;
+      msg_q_overflow_type overflow;
+   } queues[] = {
+      { "list", 0, eMSG_Q_OVERFLOW_BLOCK },
+      { "ring/block", 1, eMSG_Q_OVERFLOW_BLOCK },
+      { "ring/spill", 1, eMSG_Q_OVERFLOW_SPILL },
+   };
+   uint32_t i, batch;
+
+   if( producers < 1 || producers > 64 || count < 1 || count > 0xFFFFFE )
+   {
+      printf("usage: %s [<producers 1..64> [<messages per producer>]]\n", argv[0]);
+      return 1;
+   }
+   printf("%u producers x %u messages, msgs/s:\n", producers, count);
+   for( i = 0; i < sizeof(queues) / sizeof(queues[0]); i++ )
+   {
+      for( batch = 1; batch <= 32; batch += 31 )
+      {
+         void* q = NULL;
+         if( queues[i].ring )
+         {
+            msg_q_ring_init(&q, 1024, queues[i].overflow);
+         }
+         else
+         {
+            msg_q_init(&q);
+         }
+         printf("  %-12s batch %2u: %12.0f\n", queues[i].name, batch,
+                msg_q_test_run(q, producers, count, batch, 0));
+         msg_q_destroy(&q);
+      }
+   }
+
+   void* q = NULL;
+   msg_q_ring_init(&q, 64, eMSG_Q_OVERFLOW_SPILL);
+   printf("  %-12s self send: %12.0f\n", "ring/spill",
+          msg_q_test_run(q, producers, count / 10 + 1, 32, 1));
+   msg_q_destroy(&q);
+   return 0;
+}
+
+#endif /* __LOC_DEBUG__ */
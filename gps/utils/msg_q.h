@@ -34,6 +34,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 #include <stdlib.h>
+#include <stdint.h>
 
 /** Linked List Return Codes */
 typedef enum
@@ -52,6 +53,21 @@ typedef enum
      /**< Failed because an the supplied buffer was too small. */
 }msq_q_err_type;
 
+/** Ring Queue Overflow Policies */
+typedef enum
+{
+  eMSG_Q_OVERFLOW_BLOCK                      = 0,
+     /**< Sender waits until the receiver frees a slot. */
+  eMSG_Q_OVERFLOW_DROP                       = 1,
+     /**< Sender fails with eMSG_Q_INSUFFICIENT_BUFFER and the message is
+          released through its dealloc function. */
+  eMSG_Q_OVERFLOW_SPILL                      = 2,
+     /**< Sender appends to a locked list, which the receiver drains once the
+          ring is empty; later sends go there too until it is drained. Never
+          fails and never waits, so the receiving thread may send to its own
+          queue. */
+}msg_q_overflow_type;
+
 /*===========================================================================
 FUNCTION    msg_q_init
 
@@ -90,6 +106,52 @@ SIDE EFFECTS
 ===========================================================================*/
 const void* msg_q_init2();
 
+/*===========================================================================
+FUNCTION    msg_q_ring_init
+
+DESCRIPTION
+   Initializes a message queue backed by a bounded multi-producer /
+   single-consumer ring instead of a linked list. Sending takes no lock and
+   allocates nothing; the receiver sleeps on an eventfd only when the ring
+   is empty. All other msg_q_* functions work on the returned handle, but
+   msg_q_rcv, msg_q_rmv and msg_q_flush must only be called from a single
+   receiving thread at a time.
+
+   msg_q_data: pointer to an opaque Q handle to be returned; NULL if fails
+   capacity:   number of slots, rounded up to the next power of 2
+   overflow:   what msg_q_snd does when all slots are in use
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_ring_init(void** msg_q_data, uint32_t capacity,
+                               msg_q_overflow_type overflow);
+
+/*===========================================================================
+FUNCTION    msg_q_ring_init2
+
+DESCRIPTION
+   Initializes a ring backed message queue. See msg_q_ring_init.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   opaque handle to the Q created; NULL if create fails
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+const void* msg_q_ring_init2(uint32_t capacity, msg_q_overflow_type overflow);
+
 /*===========================================================================
 FUNCTION    msg_q_destroy
 
@@ -122,6 +184,7 @@ DESCRIPTION
    msgp:       Pointer to data to add into message queue.
    dealloc:    Function used to deallocate memory for this element. Pass NULL
                if you do not want data deallocated during a flush operation
+               (or when a full ring queue drops the element)
 
 DEPENDENCIES
    N/A
@@ -157,6 +220,31 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj);
 
+/*===========================================================================
+FUNCTION    msg_q_rcv_batch
+
+DESCRIPTION
+   Retrieves up to max_count messages, oldest first, with a single lock
+   acquisition. Blocks like msg_q_rcv until at least one message is queued.
+
+   msg_q_data: Message Queue to copy data from into msg_objs.
+   msg_objs:   Array of at least max_count pointers to receive the messages.
+   max_count:  Size of msg_objs.
+   count:      Number of messages placed in msg_objs.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_rcv_batch(void* msg_q_data, void** msg_objs,
+                               uint32_t max_count, uint32_t* count);
+
 /*===========================================================================
 FUNCTION    msg_q_rmv
 